@@ -39,6 +39,7 @@ class TaskRunner;
 class Consumer;
 class Producer;
 class SharedMemoryArbiter;
+class TracePacket;
 class TraceWriter;
 
 // TODO: for the moment this assumes that all the calls happen on the same
@@ -297,6 +298,28 @@ class PERFETTO_EXPORT TracingService {
   //
   // This feature is currently used by Chrome.
   virtual void SetSMBScrapingEnabled(bool enabled) = 0;
+
+  // Enable/disable the file writer thread. If enabled, the writes into the
+  // file of |write_into_file| sessions happen on a dedicated thread rather
+  // than on the service thread, and the periodic draining of the trace buffers
+  // is split into several smaller tasks. This keeps the service responsive to
+  // producers (e.g. CommitData requests) while draining large buffers into
+  // slow storage, at the cost of a copy of the trace data.
+  //
+  // Must be called before any tracing session is started. This is a no-op on
+  // Windows.
+  virtual void SetFileWriterThreadEnabled(bool enabled) = 0;
+
+  // Function used to compress the packets of the sessions which write into a
+  // file and set |compression_type| in their TraceConfig. It must replace the
+  // packets with packets using the |compressed_packets| field. The packets are
+  // compressed as part of each periodic write into the file, the rest of the
+  // sessions are unaffected (the consumer takes care of the compression).
+  //
+  // This is injected by the embedder to avoid depending on zlib in the tracing
+  // library. If not set, the files are written uncompressed.
+  using CompressorFn = void (*)(std::vector<TracePacket>*);
+  virtual void SetCompressorFn(CompressorFn) = 0;
 };
 
 }  // namespace perfetto
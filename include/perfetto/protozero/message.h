@@ -196,6 +196,11 @@ class PERFETTO_EXPORT Message {
   // Called by Finalize and Append* methods.
   void EndNestedMessage();
 
+  // Rewrites the redundant size field of a just finalized nested message,
+  // which spans |size| bytes after |size_field|, with its minimal varint
+  // encoding. Returns the number of bytes saved.
+  uint32_t CompactNestedMessage(uint8_t* size_field, uint32_t size);
+
   void WriteToStream(const uint8_t* src_begin, const uint8_t* src_end) {
     PERFETTO_DCHECK(!finalized_);
     PERFETTO_DCHECK(src_begin <= src_end);
@@ -159,6 +159,64 @@ class RepeatedFieldIterator {
   const Field* last_;
 };
 
+// An iterator-like class used to iterate through repeated fields by scanning
+// the encoded message, rather than a pre-populated array of fields. Used by
+// SpecializedProtoDecoder, which only stores the position of the first
+// occurrence of each field. Iterates in FIFO order, like RepeatedFieldIterator.
+template <typename T>
+class ScanningRepeatedFieldIterator {
+ public:
+  // |begin| points to the preamble of the first occurrence of the field, or is
+  // null if the field isn't set.
+  ScanningRepeatedFieldIterator(uint32_t field_id,
+                                const uint8_t* begin,
+                                const uint8_t* end)
+      : field_id_(field_id),
+        decoder_(begin, begin ? static_cast<size_t>(end - begin) : 0) {
+    FindNextMatchingId();
+  }
+
+  explicit operator bool() const { return field_.valid(); }
+  const Field& field() const { return field_; }
+
+  T operator*() const {
+    T val{};
+    field_.get(&val);
+    return val;
+  }
+  const Field* operator->() const { return &field_; }
+
+  ScanningRepeatedFieldIterator& operator++() {
+    PERFETTO_DCHECK(field_.valid());
+    FindNextMatchingId();
+    return *this;
+  }
+
+  ScanningRepeatedFieldIterator operator++(int) {
+    PERFETTO_DCHECK(field_.valid());
+    ScanningRepeatedFieldIterator it(*this);
+    ++(*this);
+    return it;
+  }
+
+ private:
+  void FindNextMatchingId() {
+    for (field_ = decoder_.ReadField(); field_.valid();
+         field_ = decoder_.ReadField()) {
+      if (field_.id() == field_id_)
+        return;
+    }
+  }
+
+  uint32_t field_id_;
+
+  // Reads the fields following the current occurrence of the repeated field.
+  ProtoDecoder decoder_;
+
+  // The current occurrence of the field. Invalid once the iteration is over.
+  Field field_;
+};
+
 // As RepeatedFieldIterator, but allows iterating over a packed repeated field
 // (which will be initially stored as a single length-delimited field).
 // See |GetPackedRepeatedField| for details.
@@ -420,6 +478,129 @@ class TypedProtoDecoder : public TypedProtoDecoderBase {
   Field on_stack_storage_[kCapacity];
 };
 
+// Like TypedProtoDecoderBase, but only stores the fields declared in the
+// message rather than one entry per possible field id. This saves
+// zero-initializing (and touching) up to ~1000 Field entries every time a
+// message with high field ids (e.g. TracePacket) is decoded. It is used as a
+// base class by the decoders generated by the pbzero plugin for the messages
+// that are decoded most often (see kSpecializedDecoderMessages in
+// protozero_plugin.cc).
+// The fields are stored in the order they are declared in the message,
+// starting from 1. |field_slots_| maps each field id to its index in the
+// storage, or to 0 (which is never set) if the field is not in the message:
+// [ field 0 (invalid) ] [ fields 1 .. N ]
+// Repeated fields are not stored, instead the position of the first occurrence
+// of each field is recorded and GetRepeated() scans the message from there.
+class SpecializedProtoDecoderBase : public ProtoDecoder {
+ public:
+  const Field& Get(uint32_t id) const {
+    return fields_[PERFETTO_LIKELY(id <= max_field_id_) ? field_slots_[id] : 0];
+  }
+
+  // Returns an object that allows to iterate over all instances of a repeated
+  // field given its id. Example usage:
+  //   for (auto it = decoder.GetRepeated<int32_t>(N); it; ++it) { ... }
+  template <typename T>
+  ScanningRepeatedFieldIterator<T> GetRepeated(uint32_t field_id) const {
+    uint32_t slot =
+        PERFETTO_LIKELY(field_id <= max_field_id_) ? field_slots_[field_id] : 0;
+    const uint8_t* first =
+        fields_[slot].valid() ? first_occurrences_[slot] : nullptr;
+    return ScanningRepeatedFieldIterator<T>(field_id, first, end_);
+  }
+
+  // See TypedProtoDecoderBase::GetPackedRepeated().
+  template <proto_utils::ProtoWireType wire_type, typename cpp_type>
+  PackedRepeatedFieldIterator<wire_type, cpp_type> GetPackedRepeated(
+      uint32_t field_id,
+      bool* parse_error_location) const {
+    const Field& field = Get(field_id);
+    if (field.valid()) {
+      return PackedRepeatedFieldIterator<wire_type, cpp_type>(
+          field.data(), field.size(), parse_error_location);
+    } else {
+      return PackedRepeatedFieldIterator<wire_type, cpp_type>(
+          nullptr, 0, parse_error_location);
+    }
+  }
+
+ protected:
+  SpecializedProtoDecoderBase(Field* fields,
+                              const uint8_t** first_occurrences,
+                              uint32_t num_fields,
+                              const uint16_t* field_slots,
+                              uint32_t max_field_id,
+                              const uint8_t* buffer,
+                              size_t length)
+      : ProtoDecoder(buffer, length),
+        fields_(fields),
+        first_occurrences_(first_occurrences),
+        field_slots_(field_slots),
+        num_fields_(num_fields),
+        max_field_id_(max_field_id) {
+    static_assert(std::is_trivial<Field>::value,
+                  "Field must be a trivial aggregate type");
+    // |first_occurrences_| doesn't need to be initialized, entries are only
+    // read when the corresponding field is valid.
+    memset(fields_, 0, sizeof(Field) * (num_fields_ + 1));
+  }
+
+  void ParseAllFields();
+
+  // Points to the storage of the SpecializedProtoDecoder specialization.
+  Field* fields_;
+  const uint8_t** first_occurrences_;
+
+  // Provided by the generated decoder, has |max_field_id_| + 1 entries.
+  const uint16_t* field_slots_;
+
+  // Number of fields declared in the message. |fields_| has one more entry.
+  uint32_t num_fields_;
+  uint32_t max_field_id_;
+};
+
+// Template class instantiated by the auto-generated decoder classes declared in
+// xxx.pbzero.h files for the messages listed in kSpecializedDecoderMessages.
+template <uint32_t NUM_FIELDS>
+class SpecializedProtoDecoder : public SpecializedProtoDecoderBase {
+ public:
+  SpecializedProtoDecoder(const uint16_t* field_slots,
+                          uint32_t max_field_id,
+                          const uint8_t* buffer,
+                          size_t length)
+      : SpecializedProtoDecoderBase(fields_storage_,
+                                    first_occurrences_storage_,
+                                    NUM_FIELDS,
+                                    field_slots,
+                                    max_field_id,
+                                    buffer,
+                                    length) {
+    SpecializedProtoDecoderBase::ParseAllFields();
+  }
+
+  // Returns the field stored at the given index. Used by the generated
+  // accessors, which know the index of each field at compile time.
+  template <uint32_t SLOT>
+  const Field& at_slot() const {
+    static_assert(SLOT >= 1 && SLOT <= NUM_FIELDS, "SLOT out of range");
+    return fields_storage_[SLOT];
+  }
+
+  SpecializedProtoDecoder(SpecializedProtoDecoder&& other) noexcept
+      : SpecializedProtoDecoderBase(std::move(other)) {
+    // Point to our own storage rather than the moved-from decoder one.
+    fields_ = fields_storage_;
+    first_occurrences_ = first_occurrences_storage_;
+    memcpy(fields_storage_, other.fields_storage_, sizeof(fields_storage_));
+    memcpy(first_occurrences_storage_, other.first_occurrences_storage_,
+           sizeof(first_occurrences_storage_));
+  }
+
+ private:
+  Field fields_storage_[NUM_FIELDS + 1];
+  const uint8_t* first_occurrences_storage_[NUM_FIELDS + 1];
+};
+
 }  // namespace protozero
 
 #endif  // INCLUDE_PERFETTO_PROTOZERO_PROTO_DECODER_H_
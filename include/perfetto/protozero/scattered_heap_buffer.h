@@ -138,6 +138,12 @@ class HeapBuffered {
   T* get() { return &msg_; }
   T* operator->() { return &msg_; }
 
+  // Encodes the size of nested messages minimally. See
+  // ScatteredStreamWriter::set_compact_nested_messages().
+  void set_compact_nested_messages(bool compact) {
+    writer_.set_compact_nested_messages(compact);
+  }
+
   bool empty() const { return shb_.slices().empty(); }
 
   std::vector<uint8_t> SerializeAsArray() {
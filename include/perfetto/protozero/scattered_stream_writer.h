@@ -106,6 +106,35 @@ class PERFETTO_EXPORT ScatteredStreamWriter {
 
   uint8_t* write_ptr() const { return write_ptr_; }
 
+  // Returns true if |ptr| points to a byte already written into the current
+  // contiguous range, i.e. no new buffer has been requested since then.
+  bool IsInCurrentRange(const uint8_t* ptr) const {
+    return ptr >= cur_range_.begin && ptr < write_ptr_;
+  }
+
+  // Drops the last |size| bytes written. They must all lie in the current
+  // range (see IsInCurrentRange()).
+  void Rewind(size_t size) {
+    assert(write_ptr_ - size >= cur_range_.begin);
+    write_ptr_ -= size;
+  }
+
+  // When enabled, the size field of nested messages written into this stream
+  // is shrunk to its minimal varint encoding when the message is finalized,
+  // moving the contents of the message back accordingly. This saves up to 3
+  // bytes per nested message, at the cost of a memmove() of the message. Only
+  // nested messages that fit in a single contiguous range are shrunk, so this
+  // is most effective with a single buffer (e.g. StaticBuffered) or with large
+  // slices (e.g. HeapBuffered). The size field of root messages is never
+  // touched.
+  // This must not be enabled when other parties hold pointers into the data
+  // written so far (e.g. TraceWriterImpl and its patches for fragmented
+  // packets), as the bytes written by nested messages can be moved around.
+  void set_compact_nested_messages(bool compact) {
+    compact_nested_messages_ = compact;
+  }
+  bool compact_nested_messages() const { return compact_nested_messages_; }
+
   uint64_t written() const {
     return written_previously_ +
            static_cast<uint64_t>(write_ptr_ - cur_range_.begin);
@@ -121,6 +150,7 @@ class PERFETTO_EXPORT ScatteredStreamWriter {
   ContiguousMemoryRange cur_range_;
   uint8_t* write_ptr_;
   uint64_t written_previously_ = 0;
+  bool compact_nested_messages_ = false;
 };
 
 }  // namespace protozero
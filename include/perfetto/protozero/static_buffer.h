@@ -67,6 +67,12 @@ class StaticBuffered {
   T* get() { return &msg_; }
   T* operator->() { return &msg_; }
 
+  // Encodes the size of nested messages minimally. See
+  // ScatteredStreamWriter::set_compact_nested_messages().
+  void set_compact_nested_messages(bool compact) {
+    writer_.set_compact_nested_messages(compact);
+  }
+
   // The lack of a size() method is deliberate. It's to prevent that one
   // accidentally calls size() before Finalize().
 
@@ -43,6 +43,18 @@ struct PERFETTO_EXPORT Config {
   // When set to a non-zero value, this overrides the default block size used
   // by the StringPool. For defaults, see kDefaultBlockSize in string_pool.h.
   size_t string_pool_block_size_bytes = 0;
+
+  // When set to a value greater than one, the per-CPU queues of the sorter
+  // are sorted concurrently using up to this number of threads when all the
+  // events are flushed at the end of the trace. Parsing and storing of events
+  // always happens on the calling thread. Ignored on platforms without threads
+  // (e.g. WASM).
+  uint32_t sorting_threads = 1;
+
+  // The maximum amount of memory used to cache the results of filtering the
+  // tables in SQL queries, which makes repeated queries faster. Setting this
+  // to zero disables the cache.
+  size_t query_cache_size_bytes = 32 * 1024 * 1024;
 };
 
 // Represents a dynamically typed value returned by SQL.
@@ -19,6 +19,7 @@
 
 #include <stdint.h>
 
+#include <functional>
 #include <memory>
 
 #include "perfetto/base/export.h"
@@ -45,6 +46,16 @@ class PERFETTO_EXPORT TraceProcessorStorage {
   // floor and return errors forever.
   virtual util::Status Parse(std::unique_ptr<uint8_t[]>, size_t) = 0;
 
+  // Like Parse(), but for trace data which is not owned through a
+  // std::unique_ptr<uint8_t[]> (e.g. a memory-mapped trace file). Whenever
+  // possible (e.g. protobuf traces) the data is not copied: the trace
+  // processor keeps referring to it until the last trace packet pointing into
+  // it has been parsed, and then invokes |release|. |data| must stay valid
+  // until then.
+  virtual util::Status ParseExternalBuffer(const uint8_t* data,
+                                           size_t size,
+                                           std::function<void()> release) = 0;
+
   // When parsing a bounded file (as opposite to streaming from a device) this
   // function should be called when the last chunk of the file has been passed
   // into Parse(). This allows to flush the events queued in the ordering stage,
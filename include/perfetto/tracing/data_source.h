@@ -130,13 +130,25 @@ struct DefaultDataSourceTraits {
   static internal::DataSourceThreadLocalState* GetDataSourceTLS(
       internal::DataSourceStaticState* static_state,
       internal::TracingTLS* root_tls) {
-    auto* ds_tls = &root_tls->data_sources_tls[static_state->index];
+    auto& tls_vector = root_tls->data_sources_tls;
+    if (static_state->index >= tls_vector.size())
+      tls_vector.resize(static_state->index + 1);
+    auto& ds_tls = tls_vector[static_state->index];
+    if (!ds_tls)
+      ds_tls.reset(new internal::DataSourceThreadLocalState());
     // The per-type TLS is either zero-initialized or must have been initialized
     // for this specific data source type.
     assert(!ds_tls->static_state ||
            ds_tls->static_state->index == static_state->index);
-    return ds_tls;
+    return ds_tls.get();
   }
+
+  // Allows the trace writers of the data source to coalesce up to this many
+  // consecutive trace packets into a single packet (see
+  // TracePacket.coalesced_packets). This reduces the overhead of data sources
+  // writing many small packets, at the cost of delaying when packets are
+  // committed into the trace. Zero disables coalescing.
+  static uint32_t GetMaxCoalescedPackets() { return 0; }
 };
 
 // Templated base class meant to be derived by embedders to create a custom data
@@ -306,7 +318,10 @@ class DataSource : public DataSourceBase {
       tracing_impl->DestroyStoppedTraceWritersForCurrentThread();
     }
 
-    for (uint32_t i = 0; i < kMaxDataSourceInstances; i++) {
+    // Stop as soon as there are no more active instances, so that the cost of
+    // this loop depends on the number of active instances rather than on
+    // kMaxDataSourceInstances.
+    for (uint32_t i = 0; i < kMaxDataSourceInstances && (instances >> i); i++) {
       internal::DataSourceState* instance_state =
           static_state_.TryGetCached(instances, i);
       if (!instance_state)
@@ -349,7 +364,8 @@ class DataSource : public DataSourceBase {
         tls_inst.backend_id = instance_state->backend_id;
         tls_inst.buffer_id = instance_state->buffer_id;
         tls_inst.trace_writer = tracing_impl->CreateTraceWriter(
-            instance_state, DataSourceType::kBufferExhaustedPolicy);
+            instance_state, DataSourceType::kBufferExhaustedPolicy,
+            DataSourceTraits::GetMaxCoalescedPackets());
         CreateIncrementalState(
             &tls_inst,
             static_cast<typename DataSourceTraits::IncrementalStateType*>(
@@ -371,8 +387,8 @@ class DataSource : public DataSourceBase {
   // This must be called after Tracing::Initialize().
   // The caller must also use the DEFINE_DATA_SOURCE_STATIC_MEMBERS() macro
   // documented below.
-  // Can return false to signal failure if attemping to register more than
-  // kMaxDataSources (32) data sources types.
+  // Returns true if the data source was registered (or was already
+  // registered).
   static bool Register(const DataSourceDescriptor& descriptor) {
     // Silences -Wunused-variable warning in case the trace method is not used
     // by the translation unit that declares the data source.
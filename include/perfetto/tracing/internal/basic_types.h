@@ -31,14 +31,20 @@ using BufferId = uint16_t;
 // Backends are only added and never removed.
 using TracingBackendId = size_t;
 
-// Max numbers of data sources that can be registered in a process.
-constexpr size_t kMaxDataSources = 32;
+// Data source types are assigned a sequential index when registered. There is
+// no limit on the number of data source types that can be registered in a
+// process, as their thread-local state is allocated lazily (see TracingTLS).
+// This is the index of data sources that haven't been registered yet.
+constexpr uint32_t kInvalidDataSourceIndex = static_cast<uint32_t>(-1);
 
 // Max instances for each data source type. This typically matches the
 // "max number of concurrent tracing sessions". However remember that a data
 // source can be instantiated more than once within one tracing session by
 // creating two entries for it in the trace config.
-constexpr size_t kMaxDataSourceInstances = 8;
+// This is bound by the width of the bitmaps of active instances (see
+// DataSourceStaticState::valid_instances), which the trace point fast path
+// checks with a single atomic load.
+constexpr size_t kMaxDataSourceInstances = 32;
 
 }  // namespace internal
 }  // namespace perfetto
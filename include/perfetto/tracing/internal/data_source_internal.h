@@ -99,7 +99,7 @@ struct DataSourceStateStorage {
 // Per-DataSource-type global state.
 struct DataSourceStaticState {
   // Unique index of the data source, assigned at registration time.
-  uint32_t index = kMaxDataSources;
+  uint32_t index = kInvalidDataSourceIndex;
 
   // A bitmap that tells about the validity of each |instances| entry. When the
   // i-th bit of the bitmap it's set, instances[i] is valid.
@@ -108,7 +108,7 @@ struct DataSourceStaticState {
 
   // Can be used with a cached |valid_instances| bitmap.
   DataSourceState* TryGetCached(uint32_t cached_bitmap, size_t n) {
-    return cached_bitmap & (1 << n)
+    return cached_bitmap & (1u << n)
                ? reinterpret_cast<DataSourceState*>(&instances[n])
                : nullptr;
   }
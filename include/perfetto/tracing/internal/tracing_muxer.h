@@ -56,8 +56,8 @@ class PERFETTO_EXPORT TracingMuxer {
     return static_cast<TracingTLS*>(platform_->GetOrCreateThreadLocalObject());
   }
 
-  // This method can fail and return false if trying to register more than
-  // kMaxDataSources types.
+  // Registers a data source type. Returns true on success, including when the
+  // data source has been registered already.
   using DataSourceFactory = std::function<std::unique_ptr<DataSourceBase>()>;
   virtual bool RegisterDataSource(const DataSourceDescriptor&,
                                   DataSourceFactory,
@@ -67,9 +67,12 @@ class PERFETTO_EXPORT TracingMuxer {
   // The returned TraceWriter must be used within the same sequence (for most
   // projects this means "same thread"). Alternatively the client needs to take
   // care of using synchronization primitives to prevent concurrent accesses.
+  // If |max_coalesced_packets| is non-zero, the writer coalesces up to that
+  // many consecutive packets into a single one.
   virtual std::unique_ptr<TraceWriterBase> CreateTraceWriter(
       DataSourceState*,
-      BufferExhaustedPolicy buffer_exhausted_policy) = 0;
+      BufferExhaustedPolicy buffer_exhausted_policy,
+      uint32_t max_coalesced_packets) = 0;
 
   virtual void DestroyStoppedTraceWritersForCurrentThread() = 0;
 
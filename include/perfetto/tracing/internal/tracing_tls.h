@@ -19,6 +19,7 @@
 
 #include <array>
 #include <memory>
+#include <vector>
 
 #include "perfetto/tracing/internal/basic_types.h"
 #include "perfetto/tracing/internal/data_source_internal.h"
@@ -37,8 +38,9 @@ namespace internal {
 // and up to N concurrent instances for each data source, so up to M * N total
 // data source instances around.
 // Each data source instance can be accessed by T threads (no upper bound).
-// We can safely put hard limits both to M and N (i.e. say that we support at
-// most 32 data source types per process and up to 8 concurrent instances).
+// We can safely put a hard limit to N (i.e. say that we support up to 32
+// concurrent instances). M is unbounded, but each thread only allocates state
+// for the data sources it actually traces.
 //
 // We want to make it so from the Platform viewpoint, we use only one global
 // TLS object, so T instances in total, one per thread, regardless of M and N.
@@ -58,12 +60,15 @@ namespace internal {
 //  Instance 2         |               | |               | |               |
 //                     +---------------+ +---------------+ +---------------+
 //
-// Each TLS Object is organized as an array of M DataSourceThreadLocalState.
+// Each TLS Object is organized as an array of M DataSourceThreadLocalState,
+// which are allocated the first time the thread traces each data source.
 // Each DSTLS itself is an array of up to N per-instance objects.
 // The only per-instance object for now is the TraceWriter.
 // So for each data source, for each instance, for each thread we keep one
 // TraceWriter.
 // The lookup is O(1): Given the TLS object, the TraceWriter is just tls[M][N].
+// Furthermore, the trace point fast path doesn't even do that lookup, as
+// each DataSource type caches a pointer to its DSTLS in a thread_local.
 class TracingTLS : public Platform::ThreadLocalObject {
  public:
   ~TracingTLS() override;
@@ -75,8 +80,9 @@ class TracingTLS : public Platform::ThreadLocalObject {
   uint32_t generation = 0;
 
   // By default all data source instances have independent thread-local state
-  // (see above).
-  std::array<DataSourceThreadLocalState, kMaxDataSources> data_sources_tls{};
+  // (see above). Indexed by DataSourceStaticState::index. Entries are
+  // heap-allocated so that pointers to them stay valid when this grows.
+  std::vector<std::unique_ptr<DataSourceThreadLocalState>> data_sources_tls;
 
   // Track event data sources, however, share the same thread-local state in
   // order to be able to share trace writers and interning state across all
@@ -40,6 +40,11 @@ struct TrackEventDataSourceTraits : public perfetto::DefaultDataSourceTraits {
                                                       TracingTLS* root_tls) {
     return &root_tls->track_event_tls;
   }
+
+  // See TrackEventDataSource::SetMaxCoalescedEvents().
+  static uint32_t GetMaxCoalescedPackets() {
+    return TrackEventInternal::GetMaxCoalescedEvents();
+  }
 };
 
 // A helper that ensures movable debug annotations are passed by value to
@@ -76,14 +81,29 @@ class TrackEventDataSource
     Base::template Trace([](typename Base::TraceContext ctx) { ctx.Flush(); });
   }
 
+  // Opts into coalescing up to |max_events| consecutive track events from the
+  // same thread into a single trace packet, which amortizes the per-packet
+  // overhead over many events. The trade-offs are that events are committed
+  // into the trace only once their batch is complete (or on Flush()) and that
+  // the trace needs to be read by a trace processor which supports coalesced
+  // packets. Only affects trace writers created after this call, i.e., in new
+  // tracing sessions. Zero (the default) disables coalescing. The setting is
+  // shared by all track event category namespaces.
+  static void SetMaxCoalescedEvents(uint32_t max_events) {
+    TrackEventInternal::SetMaxCoalescedEvents(max_events);
+  }
+
   // This is the inlined entrypoint for all track event trace points. It tries
   // to be as lightweight as possible in terms of instructions and aims to
   // compile down to an unlikely conditional jump to the actual trace writing
-  // function.
-  template <size_t CategoryIndex, typename Callback>
+  // function. Trace points for categories which aren't |EnabledAtBuildTime|
+  // compile down to nothing.
+  template <size_t CategoryIndex,
+            bool EnabledAtBuildTime = true,
+            typename Callback>
   static void CallIfCategoryEnabled(Callback callback) PERFETTO_ALWAYS_INLINE {
-    Base::template CallIfEnabled<CategoryTracePointTraits<CategoryIndex>>(
-        [&callback](uint32_t instances) { callback(instances); });
+    CallIfCategoryEnabledImpl<CategoryIndex>(
+        std::integral_constant<bool, EnabledAtBuildTime>(), callback);
   }
 
   // Once we've determined tracing to be enabled for this category, actually
@@ -100,10 +120,9 @@ class TrackEventDataSource
       ArgumentFunction arg_function = [](EventContext) {}) PERFETTO_NO_INLINE {
     Base::template TraceWithInstances<CategoryTracePointTraits<CategoryIndex>>(
         instances, [&](typename Base::TraceContext ctx) {
-          // TODO(skyostil): Intern categories at compile time.
           arg_function(TrackEventInternal::WriteEvent(
               ctx.tls_inst_->trace_writer.get(), ctx.GetIncrementalState(),
-              Registry->GetCategory(CategoryIndex)->name, event_name, type));
+              *Registry, CategoryIndex, event_name, type));
         });
   }
 
@@ -139,10 +158,9 @@ class TrackEventDataSource
       PERFETTO_NO_INLINE {
     Base::template TraceWithInstances<CategoryTracePointTraits<CategoryIndex>>(
         instances, [&](typename Base::TraceContext ctx) {
-          // TODO(skyostil): Intern categories at compile time.
           auto event_ctx = TrackEventInternal::WriteEvent(
               ctx.tls_inst_->trace_writer.get(), ctx.GetIncrementalState(),
-              Registry->GetCategory(CategoryIndex)->name, event_name, type);
+              *Registry, CategoryIndex, event_name, type);
           TrackEventInternal::AddDebugAnnotation(&event_ctx, arg_name,
                                                  arg_value);
         });
@@ -177,10 +195,9 @@ class TrackEventDataSource
       PERFETTO_NO_INLINE {
     Base::template TraceWithInstances<CategoryTracePointTraits<CategoryIndex>>(
         instances, [&](typename Base::TraceContext ctx) {
-          // TODO(skyostil): Intern categories at compile time.
           auto event_ctx = TrackEventInternal::WriteEvent(
               ctx.tls_inst_->trace_writer.get(), ctx.GetIncrementalState(),
-              Registry->GetCategory(CategoryIndex)->name, event_name, type);
+              *Registry, CategoryIndex, event_name, type);
           TrackEventInternal::AddDebugAnnotation(&event_ctx, arg_name,
                                                  arg_value);
           TrackEventInternal::AddDebugAnnotation(&event_ctx, arg_name2,
@@ -196,11 +213,23 @@ class TrackEventDataSource
   }
 
  private:
+  template <size_t CategoryIndex, typename Callback>
+  static void CallIfCategoryEnabledImpl(std::true_type, Callback& callback)
+      PERFETTO_ALWAYS_INLINE {
+    Base::template CallIfEnabled<CategoryTracePointTraits<CategoryIndex>>(
+        [&callback](uint32_t instances) { callback(instances); });
+  }
+
+  // The category was compiled out. Note that the callback is never invoked, so
+  // the code for writing the event isn't emitted either.
+  template <size_t CategoryIndex, typename Callback>
+  static void CallIfCategoryEnabledImpl(std::false_type, Callback&) {}
+
   // Each category has its own enabled/disabled state, stored in the category
   // registry.
   template <size_t CategoryIndex>
   struct CategoryTracePointTraits {
-    static constexpr std::atomic<uint8_t>* GetActiveInstances() {
+    static constexpr std::atomic<uint32_t>* GetActiveInstances() {
       return Registry->GetCategoryState(CategoryIndex);
     }
   };
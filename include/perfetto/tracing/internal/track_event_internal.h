@@ -18,6 +18,7 @@
 #define INCLUDE_PERFETTO_TRACING_INTERNAL_TRACK_EVENT_INTERNAL_H_
 
 #include <unordered_map>
+#include <vector>
 
 #include "perfetto/protozero/scattered_heap_buffer.h"
 #include "perfetto/tracing/core/forward_decls.h"
@@ -70,6 +71,21 @@ struct TrackEventIncrementalState {
                 std::unique_ptr<BaseTrackEventInternedDataIndex>>;
   std::array<InternedDataIndex, kMaxInternedDataFields> interned_data_indices =
       {};
+
+  // Categories are known at compile time, so instead of looking them up in an
+  // interning index, each category registry is given a contiguous range of
+  // interning ids and a category's id is derived from its index in the
+  // registry. Since all track event data sources share the same incremental
+  // state, there is one entry for each registry which has written events on
+  // this sequence (typically just one).
+  struct InternedCategories {
+    const TrackEventCategoryRegistry* registry;
+    size_t first_iid;
+    // Whether each category has been written into the trace already.
+    std::vector<bool> seen;
+  };
+  std::vector<InternedCategories> interned_categories;
+  size_t next_category_iid = 1;
 };
 
 // The backend portion of the track event trace point implemention. Outlined to
@@ -86,10 +102,14 @@ class TrackEventInternal {
   static void DisableTracing(const TrackEventCategoryRegistry& registry,
                              uint32_t instance_index);
 
+  static void SetMaxCoalescedEvents(uint32_t max_events);
+  static uint32_t GetMaxCoalescedEvents();
+
   static perfetto::EventContext WriteEvent(
       TraceWriterBase*,
       TrackEventIncrementalState*,
-      const char* category,
+      const TrackEventCategoryRegistry&,
+      size_t category_index,
       const char* name,
       perfetto::protos::pbzero::TrackEvent::Type);
 
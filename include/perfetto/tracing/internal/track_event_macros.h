@@ -28,12 +28,12 @@
 // Defines data structures for backing a category registry.
 //
 // Each category has one enabled/disabled bit per possible data source instance.
-// The bits are packed, i.e., each byte holds the state for instances. To
-// improve cache locality, the bits for each instance are stored separately from
-// the names of the categories:
+// The bits are packed, i.e., each 32-bit word holds the state for all the
+// instances. To improve cache locality, the bits for each instance are stored
+// separately from the names of the categories:
 //
-//   byte 0                      byte 1
-//   (inst0, inst1, ..., inst7), (inst0, inst1, ..., inst7)
+//   word 0                       word 1
+//   (inst0, inst1, ..., inst31), (inst0, inst1, ..., inst31)
 //
 #define PERFETTO_INTERNAL_DECLARE_CATEGORIES(...)                             \
   namespace internal {                                                        \
@@ -42,7 +42,7 @@
   constexpr size_t kCategoryCount =                                           \
       sizeof(kCategories) / sizeof(kCategories[0]);                           \
   /* The per-instance enable/disable state per category */                    \
-  extern std::atomic<uint8_t> g_category_state_storage[kCategoryCount];       \
+  extern std::atomic<uint32_t> g_category_state_storage[kCategoryCount];      \
   /* The category registry which mediates access to the above structures. */  \
   /* The registry is used for two purposes: */                                \
   /**/                                                                        \
@@ -66,13 +66,13 @@
   }  // namespace internal
 
 // In a .cc file, declares storage for each category's runtime state.
-#define PERFETTO_INTERNAL_CATEGORY_STORAGE()                     \
-  namespace internal {                                           \
-  std::atomic<uint8_t> g_category_state_storage[kCategoryCount]; \
-  constexpr ::perfetto::internal::TrackEventCategoryRegistry     \
-      kCategoryRegistry(kCategoryCount,                          \
-                        &kCategories[0],                         \
-                        &g_category_state_storage[0]);           \
+#define PERFETTO_INTERNAL_CATEGORY_STORAGE()                      \
+  namespace internal {                                            \
+  std::atomic<uint32_t> g_category_state_storage[kCategoryCount]; \
+  constexpr ::perfetto::internal::TrackEventCategoryRegistry      \
+      kCategoryRegistry(kCategoryCount,                           \
+                        &kCategories[0],                          \
+                        &g_category_state_storage[0]);            \
   }  // namespace internal
 
 // Defines the TrackEvent data source for the current track event namespace.
@@ -88,14 +88,25 @@
       ::PERFETTO_TRACK_EVENT_NAMESPACE::internal::kConstExprCategoryRegistry \
           .Find(category)>()
 
+// At compile time, determines whether trace points for the given category are
+// compiled in. See PERFETTO_TRACK_EVENT_ENABLED_CATEGORIES.
+#define PERFETTO_IS_CATEGORY_ENABLED_AT_BUILD_TIME(category)              \
+  ::perfetto::internal::TrackEventCategoryRegistry::IsEnabledAtBuildTime( \
+      category, PERFETTO_TRACK_EVENT_ENABLED_CATEGORIES,                  \
+      PERFETTO_TRACK_EVENT_DISABLED_CATEGORIES)
+
 // Efficiently determines whether tracing is enabled for the given category, and
-// if so, emits one trace event with the given arguments.
+// if so, emits one trace event with the given arguments. Trace points for
+// categories which are compiled out don't generate any code.
 #define PERFETTO_INTERNAL_TRACK_EVENT(category, ...)                      \
   ::PERFETTO_TRACK_EVENT_NAMESPACE::TrackEvent::CallIfCategoryEnabled<    \
-      PERFETTO_GET_CATEGORY_INDEX(category)>([&](uint32_t instances) {    \
-    ::PERFETTO_TRACK_EVENT_NAMESPACE::TrackEvent::TraceForCategory<       \
-        PERFETTO_GET_CATEGORY_INDEX(category)>(instances, ##__VA_ARGS__); \
-  })
+      PERFETTO_GET_CATEGORY_INDEX(category),                              \
+      PERFETTO_IS_CATEGORY_ENABLED_AT_BUILD_TIME(category)>(              \
+      [&](uint32_t instances) {                                           \
+        ::PERFETTO_TRACK_EVENT_NAMESPACE::TrackEvent::TraceForCategory<   \
+            PERFETTO_GET_CATEGORY_INDEX(category)>(instances,             \
+                                                   ##__VA_ARGS__);        \
+      })
 
 // Generate a unique variable name with a given prefix.
 #define PERFETTO_INTERNAL_CONCAT2(a, b) a##b
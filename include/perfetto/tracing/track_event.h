@@ -116,6 +116,24 @@
 #define PERFETTO_TRACK_EVENT_NAMESPACE perfetto
 #endif
 
+// Trace points for some categories can be compiled out entirely, so that they
+// cost no instructions (or binary size) even while tracing is disabled. Define
+// these macros as comma-separated lists of category names (e.g., with
+// -DPERFETTO_TRACK_EVENT_DISABLED_CATEGORIES=\"debug,v8.*\") before including
+// this header. A trailing '*' in a name matches any suffix.
+//
+// Only the categories in PERFETTO_TRACK_EVENT_ENABLED_CATEGORIES (by default,
+// all of them) which aren't in PERFETTO_TRACK_EVENT_DISABLED_CATEGORIES are
+// compiled in. Compiled out categories still need to be registered with
+// PERFETTO_DEFINE_CATEGORIES.
+#ifndef PERFETTO_TRACK_EVENT_ENABLED_CATEGORIES
+#define PERFETTO_TRACK_EVENT_ENABLED_CATEGORIES "*"
+#endif
+
+#ifndef PERFETTO_TRACK_EVENT_DISABLED_CATEGORIES
+#define PERFETTO_TRACK_EVENT_DISABLED_CATEGORIES ""
+#endif
+
 // A name for a single category. Wrapped in a macro in case we need to introduce
 // more fields in the future.
 #define PERFETTO_CATEGORY(name) \
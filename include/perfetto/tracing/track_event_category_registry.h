@@ -36,7 +36,7 @@ class TrackEventCategoryRegistry {
  public:
   constexpr TrackEventCategoryRegistry(size_t category_count,
                                        const TrackEventCategory* categories,
-                                       std::atomic<uint8_t>* state_storage)
+                                       std::atomic<uint32_t>* state_storage)
       : categories_(categories),
         category_count_(category_count),
         state_storage_(state_storage) {
@@ -58,7 +58,7 @@ class TrackEventCategoryRegistry {
   void DisableCategoryForInstance(size_t category_index,
                                   uint32_t instance_index) const;
 
-  constexpr std::atomic<uint8_t>* GetCategoryState(
+  constexpr std::atomic<uint32_t>* GetCategoryState(
       size_t category_index) const {
     return &state_storage_[category_index];
   }
@@ -89,6 +89,18 @@ class TrackEventCategoryRegistry {
     return CategoryIndex;
   }
 
+  // At compile time, determines whether trace points for the category |name|
+  // are compiled into the program. |enabled_categories| and
+  // |disabled_categories| are comma-separated lists of category names, where a
+  // trailing '*' matches any suffix. See
+  // PERFETTO_TRACK_EVENT_ENABLED_CATEGORIES.
+  static constexpr bool IsEnabledAtBuildTime(const char* name,
+                                             const char* enabled_categories,
+                                             const char* disabled_categories) {
+    return MatchesAnyPattern(name, enabled_categories) &&
+           !MatchesAnyPattern(name, disabled_categories);
+  }
+
   constexpr bool ValidateCategories(size_t index = 0) const {
     return (index == category_count_)
                ? true
@@ -110,9 +122,31 @@ class TrackEventCategoryRegistry {
                     : (!*a || !*b) ? (*a == *b) : StringEq(a + 1, b + 1);
   }
 
+  // Matches |name| against the first pattern in the comma-separated |pattern|
+  // list.
+  static constexpr bool MatchesPattern(const char* name, const char* pattern) {
+    return *pattern == '*'
+               ? true
+               : (*pattern == ',' || !*pattern)
+                     ? !*name
+                     : *name == *pattern ? MatchesPattern(name + 1, pattern + 1)
+                                         : false;
+  }
+
+  static constexpr const char* NextPattern(const char* list) {
+    return !*list ? list : *list == ',' ? list + 1 : NextPattern(list + 1);
+  }
+
+  static constexpr bool MatchesAnyPattern(const char* name, const char* list) {
+    return !*list ? false
+                  : MatchesPattern(name, list)
+                        ? true
+                        : MatchesAnyPattern(name, NextPattern(list));
+  }
+
   const TrackEventCategory* const categories_;
   const size_t category_count_;
-  std::atomic<uint8_t>* const state_storage_;
+  std::atomic<uint32_t>* const state_storage_;
 };
 
 }  // namespace internal
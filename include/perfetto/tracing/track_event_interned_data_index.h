@@ -22,7 +22,10 @@
 #include "perfetto/base/compiler.h"
 #include "perfetto/tracing/event_context.h"
 
+#include <stdint.h>
+
 #include <map>
+#include <memory>
 #include <type_traits>
 #include <unordered_map>
 
@@ -143,6 +146,79 @@ struct HashedInternedDataTraits {
   };
 };
 
+// This type of interning index keeps full copies of at most |MaxEntries|
+// values, evicting the least recently used ones when it runs out of space.
+// Evicted values are assigned a new interning id (and hence emitted into the
+// trace again) the next time they are used. This bounds the per-thread memory
+// usage of the index to roughly |MaxEntries| * (sizeof(ValueType) + 24) bytes
+// (plus any heap storage owned by the values themselves), at the cost of
+// re-emitting interned data for high-cardinality data sets. Unlike the other
+// indices, no memory is allocated when new values are inserted.
+//
+// Values are kept in a fixed-size table which is split into sets of |kWays|
+// entries. A value can only be stored in the set selected by its hash, so a
+// lookup only needs to scan a few adjacent entries. When a set is full, its
+// least recently used entry is evicted.
+//
+// Note that the given type must have a specialization for std::hash and be
+// default-constructible.
+template <size_t MaxEntries = 1024>
+struct BoundedInternedDataTraits {
+  template <typename ValueType>
+  class Index {
+   public:
+    static constexpr size_t kWays = 4;
+    static_assert(MaxEntries >= kWays && (MaxEntries & (MaxEntries - 1)) == 0,
+                  "MaxEntries must be a power of two >= kWays");
+
+    Index() : entries_(new Entry[MaxEntries]) {}
+
+    bool LookUpOrInsert(size_t* iid, const ValueType& value) {
+      size_t hash = std::hash<ValueType>()(value);
+      // std::hash is the identity function for integers and pointers on most
+      // STL implementations, so mix the bits before picking a set.
+      uint64_t set_idx =
+          ((static_cast<uint64_t>(hash) * 0x9e3779b97f4a7c15ull) >> 32) &
+          (kNumSets - 1);
+      Entry* set = &entries_[static_cast<size_t>(set_idx) * kWays];
+      Entry* victim = &set[0];
+      for (size_t i = 0; i < kWays; i++) {
+        Entry* entry = &set[i];
+        if (entry->iid && entry->hash == hash && entry->value == value) {
+          entry->last_use = ++use_count_;
+          *iid = entry->iid;
+          return true;
+        }
+        // Free entries have |last_use| == 0, so they are picked first.
+        if (entry->last_use < victim->last_use)
+          victim = entry;
+      }
+      victim->hash = hash;
+      victim->iid = next_iid_++;
+      victim->last_use = ++use_count_;
+      victim->value = value;
+      *iid = victim->iid;
+      return false;
+    }
+
+   private:
+    static constexpr size_t kNumSets = MaxEntries / kWays;
+
+    struct Entry {
+      size_t hash = 0;
+      size_t iid = 0;  // 0 if the entry is free.
+      uint64_t last_use = 0;
+      ValueType value{};
+    };
+
+    std::unique_ptr<Entry[]> entries_;
+    // Interning ids are never reused, even after eviction, since an id must
+    // keep referring to the same value until the incremental state is cleared.
+    size_t next_iid_ = 1;
+    uint64_t use_count_ = 0;
+  };
+};
+
 // A templated base class for an interned data type which corresponds to a field
 // in interned_data.proto.
 //
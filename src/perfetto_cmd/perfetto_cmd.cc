@@ -598,11 +598,9 @@ int PerfettoCmd::Main(int argc, char** argv) {
 
   if (trace_config_->compression_type() ==
       TraceConfig::COMPRESSION_TYPE_DEFLATE) {
-    if (packet_writer_) {
+    // When tracing directly into the file, the service does the compression.
+    if (packet_writer_)
       packet_writer_ = CreateZipPacketWriter(std::move(packet_writer_));
-    } else {
-      PERFETTO_ELOG("Cannot compress when tracing directly to file.");
-    }
   }
 
   RateLimiter::Args args{};
@@ -190,6 +190,14 @@ std::string FormatStats(const protos::gen::ProfilePacket_ProcessStats& stats) {
          std::to_string(stats.unwinding_errors()) + "\n" +
          "heap_samples: " + std::to_string(stats.heap_samples()) + "\n" +
          "map_reparses: " + std::to_string(stats.map_reparses()) + "\n" +
+         "unwinding_cache_hits: " +
+         std::to_string(stats.unwinding_cache_hits()) + "\n" +
+         "unwinding_cache_hit_rate: " +
+         std::to_string(stats.heap_samples()
+                            ? 100 * stats.unwinding_cache_hits() /
+                                  stats.heap_samples()
+                            : 0) +
+         "%\n" +
          "unwinding_time_us: " + FormatHistogram(stats.unwinding_time_us());
 }
 
@@ -311,6 +319,25 @@ class HeapprofdEndToEnd : public ::testing::TestWithParam<bool> {
     EXPECT_GT(last_freed, 0u);
   }
 
+  void ValidateUnwindingCacheHits(TestHelper* helper, uint64_t pid) {
+    const auto& packets = helper->trace();
+    uint64_t heap_samples = 0;
+    uint64_t unwinding_cache_hits = 0;
+    for (const protos::gen::TracePacket& packet : packets) {
+      for (const auto& dump : packet.profile_packet().process_dumps()) {
+        if (dump.pid() != pid)
+          continue;
+        // The stats are cumulative, so the last dump has the totals.
+        heap_samples = dump.stats().heap_samples();
+        unwinding_cache_hits = dump.stats().unwinding_cache_hits();
+      }
+    }
+    // All the samples are taken at the same callsite with the same callers,
+    // so they should mostly be unwinding cache hits.
+    EXPECT_GT(heap_samples, 0u);
+    EXPECT_GT(unwinding_cache_hits, 0u);
+  }
+
   void ValidateOnlyPID(TestHelper* helper, uint64_t pid) {
     size_t dumps = 0;
     const auto& packets = helper->trace();
@@ -352,6 +379,7 @@ TEST_P(HeapprofdEndToEnd, Smoke) {
   ValidateHasSamples(helper.get(), static_cast<uint64_t>(pid));
   ValidateOnlyPID(helper.get(), static_cast<uint64_t>(pid));
   ValidateSampleSizes(helper.get(), static_cast<uint64_t>(pid), kAllocSize);
+  ValidateUnwindingCacheHits(helper.get(), static_cast<uint64_t>(pid));
 
   PERFETTO_CHECK(kill(pid, SIGKILL) == 0);
   PERFETTO_CHECK(PERFETTO_EINTR(waitpid(pid, nullptr, 0)) == pid);
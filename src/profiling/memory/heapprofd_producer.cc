@@ -17,6 +17,7 @@
 #include "src/profiling/memory/heapprofd_producer.h"
 
 #include <algorithm>
+#include <thread>
 
 #include <inttypes.h>
 #include <signal.h>
@@ -38,7 +39,14 @@ namespace {
 using ::perfetto::protos::pbzero::ProfilePacket;
 
 constexpr char kHeapprofdDataSource[] = "android.heapprofd";
-constexpr size_t kUnwinderThreads = 5;
+// Used if the number of CPUs is unknown.
+constexpr size_t kDefaultUnwinderThreads = 5;
+constexpr size_t kMaxUnwinderThreads = 16;
+constexpr uint32_t kUnwinderRebalancePeriodMs = 1000;
+// Only move clients between unwinders if that saves the busiest one at least
+// 10% of its time.
+constexpr uint64_t kMinUnwinderImbalanceUs =
+    kUnwinderRebalancePeriodMs * 1000 / 10;
 constexpr int kHeapprofdSignal = 36;
 
 constexpr uint32_t kInitialConnectionBackoffMs = 100;
@@ -49,6 +57,17 @@ constexpr uint32_t kChildModeWatchdogPeriodMs = 10 * 1000;
 constexpr uint64_t kDefaultShmemSize = 8 * 1048576;  // ~8 MB
 constexpr uint64_t kMaxShmemSize = 500 * 1048576;    // ~500 MB
 
+size_t GetUnwinderThreadCount(HeapprofdMode mode) {
+  // In child mode there is only one client, and the records of a client are
+  // handled by one worker at a time.
+  if (mode == HeapprofdMode::kChild)
+    return 1;
+  size_t num_cpus = std::thread::hardware_concurrency();
+  if (num_cpus == 0)
+    return kDefaultUnwinderThreads;
+  return std::min(num_cpus, kMaxUnwinderThreads);
+}
+
 std::vector<UnwindingWorker> MakeUnwindingWorkers(HeapprofdProducer* delegate,
                                                   size_t n) {
   std::vector<UnwindingWorker> ret;
@@ -113,13 +132,141 @@ size_t LogHistogram::GetBucket(uint64_t value) {
   return hibit;
 }
 
-// We create kUnwinderThreads unwinding threads. Bookkeeping is done on the main
-// thread.
+UnwinderLoadBalancer::UnwinderLoadBalancer(size_t num_workers,
+                                           uint64_t min_imbalance_us)
+    : min_imbalance_us_(min_imbalance_us),
+      worker_unwinding_time_us_(num_workers),
+      worker_num_clients_(num_workers) {
+  PERFETTO_CHECK(num_workers > 0);
+}
+
+size_t UnwinderLoadBalancer::AddClient(pid_t pid) {
+  // The pid might have been reused before we learnt about the disconnection of
+  // the previous process.
+  RemoveClient(pid);
+
+  size_t worker = 0;
+  for (size_t i = 1; i < worker_unwinding_time_us_.size(); ++i) {
+    if (std::make_pair(worker_unwinding_time_us_[i], worker_num_clients_[i]) <
+        std::make_pair(worker_unwinding_time_us_[worker],
+                       worker_num_clients_[worker])) {
+      worker = i;
+    }
+  }
+  clients_[pid] = {worker, 0};
+  worker_num_clients_[worker]++;
+  return worker;
+}
+
+void UnwinderLoadBalancer::RemoveClient(pid_t pid) {
+  auto it = clients_.find(pid);
+  if (it == clients_.end())
+    return;
+  const Client& client = it->second;
+  worker_unwinding_time_us_[client.worker] -= client.unwinding_time_us;
+  worker_num_clients_[client.worker]--;
+  clients_.erase(it);
+  if (IsMigrating(pid))
+    pending_migration_ = base::nullopt;
+}
+
+base::Optional<size_t> UnwinderLoadBalancer::WorkerForClient(pid_t pid) const {
+  auto it = clients_.find(pid);
+  if (it == clients_.end())
+    return base::nullopt;
+  return it->second.worker;
+}
+
+void UnwinderLoadBalancer::RecordUnwindingTime(pid_t pid,
+                                               uint64_t unwinding_time_us) {
+  auto it = clients_.find(pid);
+  if (it == clients_.end())
+    return;
+  Client& client = it->second;
+  client.unwinding_time_us += unwinding_time_us;
+  worker_unwinding_time_us_[client.worker] += unwinding_time_us;
+}
+
+base::Optional<UnwinderLoadBalancer::Migration>
+UnwinderLoadBalancer::Rebalance() {
+  size_t busiest = 0;
+  size_t idlest = 0;
+  for (size_t i = 1; i < worker_unwinding_time_us_.size(); ++i) {
+    if (worker_unwinding_time_us_[i] > worker_unwinding_time_us_[busiest])
+      busiest = i;
+    if (std::make_pair(worker_unwinding_time_us_[i], worker_num_clients_[i]) <
+        std::make_pair(worker_unwinding_time_us_[idlest],
+                       worker_num_clients_[idlest])) {
+      idlest = i;
+    }
+  }
+
+  base::Optional<Migration> migration;
+  const uint64_t busiest_us = worker_unwinding_time_us_[busiest];
+  const uint64_t idlest_us = worker_unwinding_time_us_[idlest];
+  if (!pending_migration_ && busiest_us > idlest_us &&
+      busiest_us - idlest_us >= min_imbalance_us_) {
+    // Move the client that minimizes the time spent by the busier of the two
+    // workers afterwards. If there is none, the busiest worker only has one
+    // client that is busy, and there is nothing we can do.
+    uint64_t best_us = busiest_us;
+    for (const auto& pid_and_client : clients_) {
+      const Client& client = pid_and_client.second;
+      if (client.worker != busiest || client.unwinding_time_us == 0)
+        continue;
+      uint64_t max_us = std::max(busiest_us - client.unwinding_time_us,
+                                 idlest_us + client.unwinding_time_us);
+      if (max_us < best_us) {
+        best_us = max_us;
+        migration = Migration{pid_and_client.first, busiest, idlest};
+      }
+    }
+  }
+  if (migration) {
+    pending_migration_ = migration->pid;
+    pending_migration_worker_ = migration->to_worker;
+  }
+
+  std::fill(worker_unwinding_time_us_.begin(), worker_unwinding_time_us_.end(),
+            0);
+  for (auto& pid_and_client : clients_) {
+    Client& client = pid_and_client.second;
+    client.unwinding_time_us /= 2;
+    worker_unwinding_time_us_[client.worker] += client.unwinding_time_us;
+  }
+  return migration;
+}
+
+size_t UnwinderLoadBalancer::CompleteMigration(pid_t pid) {
+  if (!IsMigrating(pid)) {
+    // The pid was reused by a new client while the old one was migrating.
+    PERFETTO_DLOG("Unexpected migration of %d.", pid);
+    return WorkerForClient(pid).value_or(0);
+  }
+  size_t to_worker = pending_migration_worker_;
+  pending_migration_ = base::nullopt;
+
+  auto it = clients_.find(pid);
+  if (it == clients_.end())
+    return to_worker;
+  Client& client = it->second;
+  worker_unwinding_time_us_[client.worker] -= client.unwinding_time_us;
+  worker_num_clients_[client.worker]--;
+  client.worker = to_worker;
+  worker_unwinding_time_us_[client.worker] += client.unwinding_time_us;
+  worker_num_clients_[client.worker]++;
+  return to_worker;
+}
+
+// We create one unwinding thread per CPU, see GetUnwinderThreadCount.
+// Bookkeeping is done on the main thread.
 HeapprofdProducer::HeapprofdProducer(HeapprofdMode mode,
                                      base::TaskRunner* task_runner)
     : task_runner_(task_runner),
       mode_(mode),
-      unwinding_workers_(MakeUnwindingWorkers(this, kUnwinderThreads)),
+      unwinding_workers_(
+          MakeUnwindingWorkers(this, GetUnwinderThreadCount(mode))),
+      unwinder_balancer_(unwinding_workers_.size(), kMinUnwinderImbalanceUs),
       socket_delegate_(this),
       weak_factory_(this) {}
 
@@ -464,7 +611,40 @@ void HeapprofdProducer::StartDataSource(DataSourceInstanceID id,
 }
 
 UnwindingWorker& HeapprofdProducer::UnwinderForPID(pid_t pid) {
-  return unwinding_workers_[static_cast<uint64_t>(pid) % kUnwinderThreads];
+  base::Optional<size_t> worker = unwinder_balancer_.WorkerForClient(pid);
+  if (!worker) {
+    // The client was never handed off to an unwinder. The unwinder will
+    // complain about the unknown pid.
+    worker = static_cast<uint64_t>(pid) % unwinding_workers_.size();
+  }
+  return unwinding_workers_[*worker];
+}
+
+void HeapprofdProducer::ScheduleUnwinderRebalance() {
+  if (unwinder_rebalance_scheduled_ || unwinding_workers_.size() < 2)
+    return;
+  unwinder_rebalance_scheduled_ = true;
+  auto weak_producer = weak_factory_.GetWeakPtr();
+  task_runner_->PostDelayedTask(
+      [weak_producer] {
+        if (weak_producer)
+          weak_producer->RebalanceUnwinders();
+      },
+      kUnwinderRebalancePeriodMs);
+}
+
+void HeapprofdProducer::RebalanceUnwinders() {
+  unwinder_rebalance_scheduled_ = false;
+  base::Optional<UnwinderLoadBalancer::Migration> migration =
+      unwinder_balancer_.Rebalance();
+  if (migration) {
+    PERFETTO_DLOG("Moving %d from unwinder %zu to %zu.", migration->pid,
+                  migration->from_worker, migration->to_worker);
+    unwinding_workers_[migration->from_worker].PostReleaseClient(
+        migration->pid);
+  }
+  if (unwinder_balancer_.num_clients() > 0)
+    ScheduleUnwinderRebalance();
 }
 
 void HeapprofdProducer::StopDataSource(DataSourceInstanceID id) {
@@ -502,6 +682,10 @@ void HeapprofdProducer::StopDataSource(DataSourceInstanceID id) {
 
   for (const auto& pid_and_process_state : data_source.process_states) {
     pid_t pid = pid_and_process_state.first;
+    // Clients being moved between unwinders get disconnected once they reach
+    // their new one, see HandleClientReleased.
+    if (unwinder_balancer_.IsMigrating(pid))
+      continue;
     UnwinderForPID(pid).PostDisconnectSocket(pid);
   }
   auto weak_producer = weak_factory_.GetWeakPtr();
@@ -561,6 +745,7 @@ void HeapprofdProducer::DumpProcessState(DataSource* data_source,
     stats->set_unwinding_errors(process_state->unwinding_errors);
     stats->set_heap_samples(process_state->heap_samples);
     stats->set_map_reparses(process_state->map_reparses);
+    stats->set_unwinding_cache_hits(process_state->unwinding_cache_hits);
     stats->set_total_unwinding_time_us(process_state->total_unwinding_time_us);
     auto* unwinding_hist = stats->set_unwinding_time_us();
     for (const auto& p : process_state->unwinding_time_us.GetData()) {
@@ -768,8 +953,10 @@ void HeapprofdProducer::SocketDelegate::OnDataAvailable(
     handoff_data.shmem = std::move(pending_process.shmem);
     handoff_data.client_config = data_source.client_configuration;
 
-    producer_->UnwinderForPID(self->peer_pid())
-        .PostHandoffSocket(std::move(handoff_data));
+    size_t worker = producer_->unwinder_balancer_.AddClient(self->peer_pid());
+    producer_->unwinding_workers_[worker].PostHandoffSocket(
+        std::move(handoff_data));
+    producer_->ScheduleUnwinderRebalance();
     producer_->pending_processes_.erase(it);
   } else if (fds[kHandshakeMaps] || fds[kHandshakeMem] ||
              fds[kHandshakePageIdle]) {
@@ -867,8 +1054,37 @@ void HeapprofdProducer::PostSocketDisconnected(DataSourceInstanceID ds_id,
   });
 }
 
+void HeapprofdProducer::PostClientReleased(
+    UnwindingWorker::MigrationData migration_data) {
+  // Once we can use C++14, this should be std::moved into the lambda instead.
+  UnwindingWorker::MigrationData* raw_data =
+      new UnwindingWorker::MigrationData(std::move(migration_data));
+  auto weak_this = weak_factory_.GetWeakPtr();
+  task_runner_->PostTask([weak_this, raw_data] {
+    if (weak_this)
+      weak_this->HandleClientReleased(std::move(*raw_data));
+    delete raw_data;
+  });
+}
+
+void HeapprofdProducer::HandleClientReleased(
+    UnwindingWorker::MigrationData migration_data) {
+  pid_t pid = migration_data.metadata.pid;
+  auto it = data_sources_.find(migration_data.data_source_instance_id);
+  bool shutting_down = it != data_sources_.end() && it->second.shutting_down;
+
+  UnwindingWorker& worker =
+      unwinding_workers_[unwinder_balancer_.CompleteMigration(pid)];
+  worker.PostAdoptClient(std::move(migration_data));
+  // StopDataSource skipped this client while it was being migrated.
+  if (shutting_down)
+    worker.PostDisconnectSocket(pid);
+}
+
 void HeapprofdProducer::HandleAllocRecord(AllocRecord alloc_rec) {
   const AllocMetadata& alloc_metadata = alloc_rec.alloc_metadata;
+  unwinder_balancer_.RecordUnwindingTime(alloc_rec.pid,
+                                         alloc_rec.unwinding_time_us);
   auto it = data_sources_.find(alloc_rec.data_source_instance_id);
   if (it == data_sources_.end()) {
     PERFETTO_LOG("Invalid data source in alloc record.");
@@ -902,6 +1118,8 @@ void HeapprofdProducer::HandleAllocRecord(AllocRecord alloc_rec) {
     process_state.unwinding_errors++;
   if (alloc_rec.reparsed_map)
     process_state.map_reparses++;
+  if (alloc_rec.unwinding_cache_hit)
+    process_state.unwinding_cache_hits++;
   process_state.heap_samples++;
   process_state.unwinding_time_us.Add(alloc_rec.unwinding_time_us);
   process_state.total_unwinding_time_us += alloc_rec.unwinding_time_us;
@@ -975,6 +1193,8 @@ void HeapprofdProducer::HandleSocketDisconnected(
     DataSourceInstanceID ds_id,
     pid_t pid,
     SharedRingBuffer::Stats stats) {
+  unwinder_balancer_.RemoveClient(pid);
+
   auto it = data_sources_.find(ds_id);
   if (it == data_sources_.end())
     return;
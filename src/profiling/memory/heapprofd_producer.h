@@ -66,6 +66,62 @@ class LogHistogram {
   std::array<uint64_t, kBuckets> values_ = {};
 };
 
+// Decides which UnwindingWorker handles the records of each client. New clients
+// go to the worker that recently spent the least time unwinding. Rebalance is
+// called periodically, and moves a client away from the busiest worker if that
+// evens out the time spent unwinding.
+//
+// All records of a client are handled by a single worker at a time, as its
+// UnwindingMetadata and the reading end of its SharedRingBuffer are not
+// thread-safe. HeapTracker orders the operations of a client by sequence
+// number, so records handled before and after a migration can be interleaved.
+class UnwinderLoadBalancer {
+ public:
+  struct Migration {
+    pid_t pid;
+    size_t from_worker;
+    size_t to_worker;
+  };
+
+  // Clients are only moved if the busiest worker spent at least
+  // |min_imbalance_us| more time unwinding than the least busy one.
+  UnwinderLoadBalancer(size_t num_workers, uint64_t min_imbalance_us);
+
+  // Returns the worker to hand the new client |pid| to.
+  size_t AddClient(pid_t pid);
+  void RemoveClient(pid_t pid);
+
+  base::Optional<size_t> WorkerForClient(pid_t pid) const;
+  bool IsMigrating(pid_t pid) const {
+    return pending_migration_ && *pending_migration_ == pid;
+  }
+  size_t num_clients() const { return clients_.size(); }
+
+  void RecordUnwindingTime(pid_t pid, uint64_t unwinding_time_us);
+
+  // Ends the current period, halving the accumulated unwinding times so that
+  // recent periods weigh more. Returns the client to move, if any. At most one
+  // client is moved at a time, and it is considered to be handled by
+  // |from_worker| until CompleteMigration.
+  base::Optional<Migration> Rebalance();
+
+  // Returns the worker to hand the client that was being migrated to.
+  size_t CompleteMigration(pid_t pid);
+
+ private:
+  struct Client {
+    size_t worker;
+    uint64_t unwinding_time_us;
+  };
+
+  const uint64_t min_imbalance_us_;
+  std::map<pid_t, Client> clients_;
+  std::vector<uint64_t> worker_unwinding_time_us_;
+  std::vector<size_t> worker_num_clients_;
+  base::Optional<pid_t> pending_migration_;
+  size_t pending_migration_worker_ = 0;
+};
+
 // TODO(rsavitski): central daemon can do less work if it knows that the global
 // operating mode is fork-based, as it then will not be interacting with the
 // clients. This can be implemented as an additional mode here.
@@ -136,12 +192,14 @@ class HeapprofdProducer : public Producer, public UnwindingWorker::Delegate {
   void PostSocketDisconnected(DataSourceInstanceID,
                               pid_t,
                               SharedRingBuffer::Stats) override;
+  void PostClientReleased(UnwindingWorker::MigrationData) override;
 
   void HandleAllocRecord(AllocRecord);
   void HandleFreeRecord(FreeRecord);
   void HandleSocketDisconnected(DataSourceInstanceID,
                                 pid_t,
                                 SharedRingBuffer::Stats);
+  void HandleClientReleased(UnwindingWorker::MigrationData);
 
   // Valid only if mode_ == kChild.
   void SetTargetProcess(pid_t target_pid,
@@ -180,6 +238,7 @@ class HeapprofdProducer : public Producer, public UnwindingWorker::Delegate {
     uint64_t heap_samples = 0;
     uint64_t map_reparses = 0;
     uint64_t unwinding_errors = 0;
+    uint64_t unwinding_cache_hits = 0;
 
     uint64_t total_unwinding_time_us = 0;
     LogHistogram unwinding_time_us;
@@ -227,6 +286,8 @@ class HeapprofdProducer : public Producer, public UnwindingWorker::Delegate {
   void DoContinuousDump(DataSourceInstanceID id, uint32_t dump_interval);
 
   UnwindingWorker& UnwinderForPID(pid_t);
+  void ScheduleUnwinderRebalance();
+  void RebalanceUnwinders();
   bool IsPidProfiled(pid_t);
   DataSource* GetDataSourceForProcess(const Process& proc);
   void RecordOtherSourcesAsRejected(DataSource* active_ds, const Process& proc);
@@ -275,6 +336,8 @@ class HeapprofdProducer : public Producer, public UnwindingWorker::Delegate {
   std::map<FlushRequestID, size_t> flushes_in_progress_;
   std::map<DataSourceInstanceID, DataSource> data_sources_;
   std::vector<UnwindingWorker> unwinding_workers_;
+  UnwinderLoadBalancer unwinder_balancer_;
+  bool unwinder_rebalance_scheduled_ = false;
 
   // Specific to mode_ == kChild
   Process target_process_{base::kInvalidPid, ""};
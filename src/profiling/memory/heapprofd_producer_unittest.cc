@@ -64,6 +64,96 @@ TEST(LogHistogramTest, Overflow) {
   EXPECT_THAT(h.GetData(), Contains(Pair(LogHistogram::kMaxBucket, 1)));
 }
 
+TEST(UnwinderLoadBalancerTest, AddClientSpreadsClients) {
+  UnwinderLoadBalancer balancer(3, 0);
+  EXPECT_EQ(balancer.AddClient(1), 0u);
+  EXPECT_EQ(balancer.AddClient(2), 1u);
+  EXPECT_EQ(balancer.AddClient(3), 2u);
+  balancer.RecordUnwindingTime(1, 100);
+  balancer.RecordUnwindingTime(2, 10);
+  // Worker 2 has not unwound anything yet.
+  EXPECT_EQ(balancer.AddClient(4), 2u);
+  balancer.RemoveClient(3);
+  balancer.RemoveClient(4);
+  EXPECT_EQ(balancer.AddClient(5), 2u);
+  EXPECT_EQ(balancer.WorkerForClient(5), base::make_optional<size_t>(2));
+  EXPECT_EQ(balancer.WorkerForClient(3), base::nullopt);
+}
+
+TEST(UnwinderLoadBalancerTest, RebalanceMovesClient) {
+  UnwinderLoadBalancer balancer(2, 0);
+  EXPECT_EQ(balancer.AddClient(1), 0u);
+  EXPECT_EQ(balancer.AddClient(2), 1u);
+  EXPECT_EQ(balancer.AddClient(3), 0u);
+  EXPECT_EQ(balancer.AddClient(4), 1u);
+  balancer.RecordUnwindingTime(1, 600);
+  balancer.RecordUnwindingTime(3, 400);
+  balancer.RecordUnwindingTime(4, 100);
+
+  base::Optional<UnwinderLoadBalancer::Migration> migration =
+      balancer.Rebalance();
+  ASSERT_TRUE(migration);
+  // Moving 3 leaves 600us on worker 0 and 500us on worker 1, moving 1 would
+  // leave 700us on worker 1.
+  EXPECT_EQ(migration->pid, 3);
+  EXPECT_EQ(migration->from_worker, 0u);
+  EXPECT_EQ(migration->to_worker, 1u);
+  EXPECT_TRUE(balancer.IsMigrating(3));
+  EXPECT_EQ(balancer.WorkerForClient(3), base::make_optional<size_t>(0));
+
+  // Only one client is moved at a time.
+  balancer.RecordUnwindingTime(1, 1000);
+  EXPECT_FALSE(balancer.Rebalance());
+
+  EXPECT_EQ(balancer.CompleteMigration(3), 1u);
+  EXPECT_FALSE(balancer.IsMigrating(3));
+  EXPECT_EQ(balancer.WorkerForClient(3), base::make_optional<size_t>(1));
+}
+
+TEST(UnwinderLoadBalancerTest, RebalanceSingleBusyClient) {
+  UnwinderLoadBalancer balancer(2, 0);
+  EXPECT_EQ(balancer.AddClient(1), 0u);
+  EXPECT_EQ(balancer.AddClient(2), 1u);
+  EXPECT_EQ(balancer.AddClient(3), 0u);
+  balancer.RecordUnwindingTime(1, 1000);
+  // Moving 1 would just make worker 1 the busy one.
+  EXPECT_FALSE(balancer.Rebalance());
+}
+
+TEST(UnwinderLoadBalancerTest, RebalanceMinImbalance) {
+  UnwinderLoadBalancer balancer(2, 1000);
+  EXPECT_EQ(balancer.AddClient(1), 0u);
+  EXPECT_EQ(balancer.AddClient(2), 1u);
+  EXPECT_EQ(balancer.AddClient(3), 0u);
+  balancer.RecordUnwindingTime(1, 500);
+  balancer.RecordUnwindingTime(3, 400);
+  EXPECT_FALSE(balancer.Rebalance());
+
+  // Half of the previous period still counts.
+  balancer.RecordUnwindingTime(1, 600);
+  balancer.RecordUnwindingTime(3, 350);
+  base::Optional<UnwinderLoadBalancer::Migration> migration =
+      balancer.Rebalance();
+  ASSERT_TRUE(migration);
+  EXPECT_EQ(migration->from_worker, 0u);
+  EXPECT_EQ(migration->to_worker, 1u);
+}
+
+TEST(UnwinderLoadBalancerTest, RemoveMigratingClient) {
+  UnwinderLoadBalancer balancer(2, 0);
+  EXPECT_EQ(balancer.AddClient(1), 0u);
+  EXPECT_EQ(balancer.AddClient(2), 1u);
+  EXPECT_EQ(balancer.AddClient(3), 0u);
+  balancer.RecordUnwindingTime(1, 100);
+  balancer.RecordUnwindingTime(3, 100);
+  base::Optional<UnwinderLoadBalancer::Migration> migration =
+      balancer.Rebalance();
+  ASSERT_TRUE(migration);
+  balancer.RemoveClient(migration->pid);
+  EXPECT_FALSE(balancer.IsMigrating(migration->pid));
+  EXPECT_EQ(balancer.num_clients(), 2u);
+}
+
 TEST(HeapprofdProducerTest, ExposesDataSource) {
   base::TestTaskRunner task_runner;
   HeapprofdProducer producer(HeapprofdMode::kCentral, &task_runner);
@@ -21,6 +21,7 @@
 
 #include <errno.h>
 #include <inttypes.h>
+#include <string.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -28,7 +29,6 @@
 #include "perfetto/base/build_config.h"
 #include "perfetto/ext/base/scoped_file.h"
 #include "perfetto/ext/base/temp_file.h"
-#include "src/profiling/memory/scoped_spinlock.h"
 
 #if PERFETTO_BUILDFLAG(PERFETTO_OS_ANDROID)
 #include <linux/memfd.h>
@@ -168,20 +168,9 @@ void SharedRingBuffer::Initialize(base::ScopedFile mem_fd) {
   mem_fd_ = std::move(mem_fd);
 }
 
-SharedRingBuffer::Buffer SharedRingBuffer::BeginWrite(
-    const ScopedSpinlock& spinlock,
-    size_t size) {
-  PERFETTO_DCHECK(spinlock.locked());
+SharedRingBuffer::Buffer SharedRingBuffer::BeginWrite(size_t size) {
   Buffer result;
 
-  base::Optional<PointerPositions> opt_pos = GetPointerPositions();
-  if (!opt_pos) {
-    meta_->stats.num_writes_corrupt++;
-    errno = EBADF;
-    return result;
-  }
-  auto pos = opt_pos.value();
-
   const uint64_t size_with_header =
       base::AlignUp<kAlignment>(size + kHeaderSize);
 
@@ -191,28 +180,33 @@ SharedRingBuffer::Buffer SharedRingBuffer::BeginWrite(
     return result;
   }
 
-  if (size_with_header > write_avail(pos)) {
-    meta_->stats.num_writes_overflow++;
-    errno = EAGAIN;
-    return result;
-  }
+  PointerPositions pos;
+  do {
+    base::Optional<PointerPositions> opt_pos = GetWriterPointerPositions();
+    if (!opt_pos) {
+      meta_->num_writes_corrupt.fetch_add(1, std::memory_order_relaxed);
+      errno = EBADF;
+      return result;
+    }
+    pos = opt_pos.value();
 
+    if (size_with_header > write_avail(pos)) {
+      meta_->num_writes_overflow.fetch_add(1, std::memory_order_relaxed);
+      errno = EAGAIN;
+      return result;
+    }
+    // If this fails, another writer has reserved space in the meantime. Try
+    // again with the new write_pos.
+  } while (!meta_->write_pos.compare_exchange_weak(
+      pos.write_pos, pos.write_pos + size_with_header,
+      std::memory_order_relaxed));
+
+  // The header of the reserved record is already zero, so the reader will not
+  // consume it until EndWrite. See EndRead.
   uint8_t* wr_ptr = at(pos.write_pos);
 
   result.size = size;
   result.data = wr_ptr + kHeaderSize;
-  meta_->stats.bytes_written += size;
-  meta_->stats.num_writes_succeeded++;
-
-  // We can make this a relaxed store, as this gets picked up by the acquire
-  // load in GetPointerPositions (and the release store below).
-  reinterpret_cast<std::atomic<uint32_t>*>(wr_ptr)->store(
-      0, std::memory_order_relaxed);
-
-  // This needs to happen after the store above, so the reader never observes an
-  // incorrect byte count. This is matched by the acquire load in
-  // GetPointerPositions.
-  meta_->write_pos.fetch_add(size_with_header, std::memory_order_release);
   return result;
 }
 
@@ -259,6 +253,20 @@ SharedRingBuffer::Buffer SharedRingBuffer::BeginRead() {
   }
   const size_t size_with_header = base::AlignUp<kAlignment>(size + kHeaderSize);
 
+  if (size_with_header > avail_read) {
+    // The record might have been reserved after we loaded write_pos above.
+    // Now that the acquire load of its size has synchronized with its writer,
+    // we are guaranteed to observe the reservation.
+    opt_pos = GetPointerPositions();
+    if (!opt_pos) {
+      meta_->stats.num_reads_corrupt++;
+      errno = EBADF;
+      return Buffer();
+    }
+    pos = opt_pos.value();
+    avail_read = read_avail(pos);
+  }
+
   if (size_with_header > avail_read) {
     PERFETTO_ELOG(
         "Corrupted header detected, size=%zu"
@@ -278,7 +286,15 @@ void SharedRingBuffer::EndRead(Buffer buf) {
   if (!buf)
     return;
   size_t size_with_header = base::AlignUp<kAlignment>(buf.size + kHeaderSize);
-  meta_->read_pos.fetch_add(size_with_header, std::memory_order_relaxed);
+  // Writers can reserve space before their previous contents are overwritten,
+  // so the reader relies on the header of a reserved record being zero until
+  // its writer commits it in EndWrite. Zero the consumed record (which is
+  // contiguous in memory thanks to the double mapping) before handing it back.
+  memset(buf.data - kHeaderSize, 0, size_with_header);
+
+  // This is matched by the acquire load in GetWriterPointerPositions, so
+  // writers observe the memset above before reusing the space.
+  meta_->read_pos.fetch_add(size_with_header, std::memory_order_release);
   meta_->stats.num_reads_succeeded++;
 }
 
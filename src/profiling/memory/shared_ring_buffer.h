@@ -20,7 +20,6 @@
 #include "perfetto/ext/base/optional.h"
 #include "perfetto/ext/base/unix_socket.h"
 #include "perfetto/ext/base/utils.h"
-#include "src/profiling/memory/scoped_spinlock.h"
 
 #include <atomic>
 #include <map>
@@ -41,16 +40,19 @@ namespace profiling {
 // - Reads are atomic, no fragmentation.
 // - The reader sees writes in write order (% discarding).
 //
+// Writers don't take any lock: they reserve space for their record by
+// advancing |write_pos| with a compare-and-swap, so concurrent writers only
+// contend on that cache line for the duration of the CAS. A reserved record
+// becomes visible to the reader once its writer stores its size in EndWrite().
+// Until then its header reads as zero, as the reader zeroes all the records it
+// consumes before releasing their space to the writers.
+//
 // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 // *IMPORTANT*: The ring buffer must be written under the assumption that the
-// other end modifies arbitrary shared memory without holding the spin-lock.
-// This means we must make local copies of read and write pointers for doing
-// bounds checks followed by reads / writes, as they might change in the
-// meantime.
+// other end modifies arbitrary shared memory at any time. This means we must
+// make local copies of read and write pointers for doing bounds checks
+// followed by reads / writes, as they might change in the meantime.
 // !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-//
-// TODO:
-// - Write a benchmark.
 class SharedRingBuffer {
  public:
   class Buffer {
@@ -71,17 +73,18 @@ class SharedRingBuffer {
   };
 
   struct Stats {
+    // Fields below get set by GetStats as copies of atomics in MetadataPage.
+    //
+    // There is no count of successful writes, as it would add a contended
+    // atomic increment to every write. bytes_written is derived from
+    // write_pos instead, so it includes record headers and padding.
     uint64_t bytes_written;
-    uint64_t num_writes_succeeded;
     uint64_t num_writes_corrupt;
     uint64_t num_writes_overflow;
 
     uint64_t num_reads_succeeded;
     uint64_t num_reads_corrupt;
     uint64_t num_reads_nodata;
-
-    // Fields below get set by GetStats as copies of atomics in MetadataPage.
-    uint64_t failed_spinlocks;
   };
 
   static base::Optional<SharedRingBuffer> Create(size_t);
@@ -97,44 +100,41 @@ class SharedRingBuffer {
   size_t size() const { return size_; }
   int fd() const { return *mem_fd_; }
 
-  Buffer BeginWrite(const ScopedSpinlock& spinlock, size_t size);
+  // Can be called concurrently by any number of writers.
+  Buffer BeginWrite(size_t size);
   void EndWrite(Buffer buf);
 
   Buffer BeginRead();
   void EndRead(Buffer);
 
-  Stats GetStats(ScopedSpinlock& spinlock) {
-    PERFETTO_DCHECK(spinlock.locked());
+  Stats GetStats() {
     Stats stats = meta_->stats;
-    stats.failed_spinlocks =
-        meta_->failed_spinlocks.load(std::memory_order_relaxed);
+    stats.bytes_written = meta_->write_pos.load(std::memory_order_relaxed);
+    stats.num_writes_corrupt =
+        meta_->num_writes_corrupt.load(std::memory_order_relaxed);
+    stats.num_writes_overflow =
+        meta_->num_writes_overflow.load(std::memory_order_relaxed);
     return stats;
   }
 
-  // This is used by the caller to be able to hold the SpinLock after
-  // BeginWrite has returned. This is so that additional bookkeeping can be
-  // done under the lock. This will be used to increment the sequence_number.
-  ScopedSpinlock AcquireLock(ScopedSpinlock::Mode mode) {
-    auto lock = ScopedSpinlock(&meta_->spinlock, mode);
-    if (PERFETTO_UNLIKELY(!lock.locked()))
-      meta_->failed_spinlocks.fetch_add(1, std::memory_order_relaxed);
-    return lock;
-  }
-
   // Exposed for fuzzers.
   struct MetadataPage {
-    alignas(uint64_t) std::atomic<bool> spinlock;
+    // Only modified by the reader.
     std::atomic<uint64_t> read_pos;
-    std::atomic<uint64_t> write_pos;
 
-    std::atomic<uint64_t> failed_spinlocks;
-    // For stats that are only accessed by a single thread or under the
-    // spinlock, members of this struct are directly modified. Other stats use
-    // the atomics above this struct.
+    // Modified by all the writers. Kept on a different cache line than
+    // |read_pos| so that reads don't invalidate it.
+    alignas(64) std::atomic<uint64_t> write_pos;
+    std::atomic<uint64_t> num_writes_corrupt;
+    std::atomic<uint64_t> num_writes_overflow;
+
+    // For stats that are only accessed by the reader, members of this struct
+    // are directly modified. Stats modified by the writers use the atomics
+    // above this struct.
     //
     // When the user requests stats, the atomics above get copied into this
     // struct, which is then returned.
-    Stats stats;
+    alignas(64) Stats stats;
   };
 
  private:
@@ -155,15 +155,12 @@ class SharedRingBuffer {
   void Initialize(base::ScopedFile mem_fd);
   bool IsCorrupt(const PointerPositions& pos);
 
+  // Used by the reader, which is the only one modifying read_pos. The
+  // records it consumes are published by the release store of their size in
+  // EndWrite, not by the write_pos increment.
   inline base::Optional<PointerPositions> GetPointerPositions() {
     PointerPositions pos;
-    // We need to acquire load the write_pos to make sure we observe a
-    // consistent ring buffer in BeginRead, otherwise it is possible that we
-    // observe the write_pos increment, but not the size field write of the
-    // payload.
-    //
-    // This is matched by a release at the end of BeginWrite.
-    pos.write_pos = meta_->write_pos.load(std::memory_order_acquire);
+    pos.write_pos = meta_->write_pos.load(std::memory_order_relaxed);
     pos.read_pos = meta_->read_pos.load(std::memory_order_relaxed);
 
     base::Optional<PointerPositions> result;
@@ -173,6 +170,29 @@ class SharedRingBuffer {
     return result;
   }
 
+  // Used by the writers. Both positions can change concurrently here, so we
+  // re-check read_pos to make sure the two form a consistent snapshot, rather
+  // than mistaking a concurrent read for corruption.
+  inline base::Optional<PointerPositions> GetWriterPointerPositions() {
+    PointerPositions pos;
+    do {
+      // We need to acquire load the read_pos to make sure we observe the
+      // zeroing of the records consumed by the reader before reusing their
+      // space.
+      //
+      // This is matched by a release at the end of EndRead.
+      pos.read_pos = meta_->read_pos.load(std::memory_order_acquire);
+      pos.write_pos = meta_->write_pos.load(std::memory_order_relaxed);
+    } while (PERFETTO_UNLIKELY(
+        pos.read_pos != meta_->read_pos.load(std::memory_order_relaxed)));
+
+    base::Optional<PointerPositions> result;
+    if (IsCorrupt(pos))
+      return result;
+    result = pos;
+    return result;
+  }
+
   inline size_t read_avail(const PointerPositions& pos) {
     PERFETTO_DCHECK(pos.write_pos >= pos.read_pos);
     auto res = static_cast<size_t>(pos.write_pos - pos.read_pos);
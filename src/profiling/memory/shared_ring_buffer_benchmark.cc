@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include <benchmark/benchmark.h>
+
+#include "src/profiling/memory/shared_ring_buffer.h"
+
+namespace {
+
+using perfetto::profiling::SharedRingBuffer;
+
+constexpr size_t kBufSize = 8 * 1024 * 1024;  // Default heapprofd shmem size.
+
+// Plays the role of heapprofd, consuming records as fast as possible.
+struct Env {
+  Env() : buf(*SharedRingBuffer::Create(kBufSize)) {
+    reader = std::thread([this] {
+      while (!stop.load(std::memory_order_relaxed)) {
+        SharedRingBuffer::Buffer rd = buf.BeginRead();
+        if (!rd) {
+          std::this_thread::yield();
+          continue;
+        }
+        benchmark::DoNotOptimize(rd.data[0]);
+        buf.EndRead(std::move(rd));
+      }
+    });
+  }
+
+  ~Env() {
+    stop.store(true, std::memory_order_relaxed);
+    reader.join();
+  }
+
+  SharedRingBuffer buf;
+  std::atomic<bool> stop{false};
+  std::thread reader;
+};
+
+Env* g_env = nullptr;
+
+// Each thread writes records of state.range(0) bytes, like Client::RecordMalloc
+// does for every sampled allocation on the allocating thread. This measures
+// how the per-record overhead scales with the number of threads writing to
+// the same buffer.
+static void BM_SharedRingBuffer_Write(benchmark::State& state) {
+  if (state.thread_index == 0)
+    g_env = new Env();
+
+  const std::string payload(static_cast<size_t>(state.range(0)), 'x');
+
+  for (auto _ : state) {
+    SharedRingBuffer::Buffer wr = g_env->buf.BeginWrite(payload.size());
+    if (PERFETTO_UNLIKELY(!wr)) {
+      // The reader can't keep up. Wait for it outside of the measured time,
+      // like Client does when configured to block.
+      state.PauseTiming();
+      while (!(wr = g_env->buf.BeginWrite(payload.size())))
+        std::this_thread::yield();
+      state.ResumeTiming();
+    }
+    memcpy(wr.data, payload.data(), payload.size());
+    g_env->buf.EndWrite(std::move(wr));
+  }
+
+  if (state.thread_index == 0) {
+    delete g_env;
+    g_env = nullptr;
+  }
+}
+
+}  // namespace
+
+BENCHMARK(BM_SharedRingBuffer_Write)
+    ->Arg(128)
+    ->Arg(4096)
+    ->ThreadRange(1, 32)
+    ->UseRealTime();
@@ -35,13 +35,7 @@ std::string ToString(const SharedRingBuffer::Buffer& buf_and_size) {
 }
 
 bool TryWrite(SharedRingBuffer* wr, const char* src, size_t size) {
-  SharedRingBuffer::Buffer buf;
-  {
-    auto lock = wr->AcquireLock(ScopedSpinlock::Mode::Try);
-    if (!lock.locked())
-      return false;
-    buf = wr->BeginWrite(lock, size);
-  }
+  SharedRingBuffer::Buffer buf = wr->BeginWrite(size);
   if (!buf)
     return false;
   memcpy(buf.data, src, size);
@@ -162,11 +156,7 @@ TEST(SharedRingBufferTest, WriteShutdown) {
   ASSERT_TRUE(rd);
   SharedRingBuffer wr =
       *SharedRingBuffer::Attach(base::ScopedFile(dup(rd->fd())));
-  SharedRingBuffer::Buffer buf;
-  {
-    auto lock = wr.AcquireLock(ScopedSpinlock::Mode::Blocking);
-    buf = wr.BeginWrite(lock, 10);
-  }
+  SharedRingBuffer::Buffer buf = wr.BeginWrite(10);
   rd = base::nullopt;
   memset(buf.data, 0, buf.size);
   wr.EndWrite(std::move(buf));
@@ -265,16 +255,59 @@ TEST(SharedRingBufferTest, EmptyWrite) {
   constexpr auto kBufSize = base::kPageSize * 4;
   base::Optional<SharedRingBuffer> wr = SharedRingBuffer::Create(kBufSize);
   ASSERT_TRUE(wr);
-  SharedRingBuffer::Buffer buf;
-  {
-    auto lock = wr->AcquireLock(ScopedSpinlock::Mode::Try);
-    ASSERT_TRUE(lock.locked());
-    buf = wr->BeginWrite(lock, 0);
-  }
+  SharedRingBuffer::Buffer buf = wr->BeginWrite(0);
   EXPECT_TRUE(buf);
   wr->EndWrite(std::move(buf));
 }
 
+TEST(SharedRingBufferTest, UncommittedWriteAfterWrap) {
+  constexpr auto kBufSize = base::kPageSize * 4;
+  base::Optional<SharedRingBuffer> buf = SharedRingBuffer::Create(kBufSize);
+  ASSERT_TRUE(buf);
+
+  // Fill the whole buffer with non-zero bytes and read them back.
+  std::string data(kBufSize - sizeof(uint64_t), '!');
+  ASSERT_TRUE(TryWrite(&*buf, data.data(), data.size()));
+  {
+    auto buf_and_size = buf->BeginRead();
+    ASSERT_EQ(ToString(buf_and_size), data);
+    buf->EndRead(std::move(buf_and_size));
+  }
+
+  // Records reserved but not committed yet must not be visible to the reader,
+  // even if their space previously held other data.
+  SharedRingBuffer::Buffer first = buf->BeginWrite(16);
+  SharedRingBuffer::Buffer second = buf->BeginWrite(16);
+  ASSERT_TRUE(first);
+  ASSERT_TRUE(second);
+  EXPECT_FALSE(buf->BeginRead());
+
+  // Committing out of order does not publish the later record first.
+  memcpy(second.data, "second", 7);
+  buf->EndWrite(std::move(second));
+  EXPECT_FALSE(buf->BeginRead());
+
+  memcpy(first.data, "first", 6);
+  buf->EndWrite(std::move(first));
+  {
+    auto buf_and_size = buf->BeginRead();
+    ASSERT_EQ(buf_and_size.size, 16u);
+    EXPECT_STREQ(reinterpret_cast<const char*>(buf_and_size.data), "first");
+    buf->EndRead(std::move(buf_and_size));
+  }
+  {
+    auto buf_and_size = buf->BeginRead();
+    ASSERT_EQ(buf_and_size.size, 16u);
+    EXPECT_STREQ(reinterpret_cast<const char*>(buf_and_size.data), "second");
+    buf->EndRead(std::move(buf_and_size));
+  }
+
+  SharedRingBuffer::Stats stats = buf->GetStats();
+  EXPECT_EQ(stats.bytes_written, kBufSize + 2 * 24u);
+  EXPECT_EQ(stats.num_reads_succeeded, 3u);
+  EXPECT_EQ(stats.num_reads_corrupt, 0u);
+}
+
 }  // namespace
 }  // namespace profiling
 }  // namespace perfetto
@@ -19,6 +19,8 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
+
 #include <unwindstack/MachineArm.h>
 #include <unwindstack/MachineArm64.h>
 #include <unwindstack/MachineMips.h>
@@ -50,6 +52,7 @@
 #include "perfetto/ext/base/scoped_file.h"
 #include "perfetto/ext/base/string_utils.h"
 #include "perfetto/ext/base/thread_task_runner.h"
+#include "perfetto/ext/base/utils.h"
 
 #include "src/profiling/memory/utils.h"
 #include "src/profiling/memory/wire_protocol.h"
@@ -72,6 +75,20 @@ constexpr size_t kUnwindBatchSize = 1000;
 static std::vector<std::string> kSkipMaps{"heapprofd_client.so"};
 #pragma GCC diagnostic pop
 
+// Bounds the memory used by the UnwindingCache of a process to a few MB.
+constexpr size_t kMaxUnwindingCacheEntries = 512;
+// Samples at the same pc and sp that differ in the stack usually come from
+// different callers of the same function at the same depth.
+constexpr size_t kMaxUnwindingCacheEntriesPerKey = 4;
+
+// Frames in anonymous maps (e.g. JIT code) might change, so unwinds that went
+// through them cannot be cached.
+bool IsFileBacked(const std::string& map_name) {
+  return !map_name.empty() && map_name[0] == '/' &&
+         !base::StartsWith(map_name, "/dev/") &&
+         !base::StartsWith(map_name, "/memfd:");
+}
+
 size_t GetRegsSize(unwindstack::Regs* regs) {
   if (regs->Is32Bit())
     return sizeof(uint32_t) * regs->total_regs();
@@ -82,6 +99,42 @@ void ReadFromRawData(unwindstack::Regs* regs, void* raw_data) {
   memcpy(regs->RawData(), raw_data, GetRegsSize(regs));
 }
 
+// Registers used by GetUnwindingRegs for each architecture.
+constexpr uint16_t kX86UnwindingRegs[] = {
+    unwindstack::X86_REG_EBX, unwindstack::X86_REG_EBP,
+    unwindstack::X86_REG_ESI, unwindstack::X86_REG_EDI};
+constexpr uint16_t kX86_64UnwindingRegs[] = {
+    unwindstack::X86_64_REG_RBX, unwindstack::X86_64_REG_RBP,
+    unwindstack::X86_64_REG_R12, unwindstack::X86_64_REG_R13,
+    unwindstack::X86_64_REG_R14, unwindstack::X86_64_REG_R15};
+constexpr uint16_t kArmUnwindingRegs[] = {
+    unwindstack::ARM_REG_R4,  unwindstack::ARM_REG_R5,
+    unwindstack::ARM_REG_R6,  unwindstack::ARM_REG_R7,
+    unwindstack::ARM_REG_R8,  unwindstack::ARM_REG_R9,
+    unwindstack::ARM_REG_R10, unwindstack::ARM_REG_R11,
+    unwindstack::ARM_REG_LR};
+constexpr uint16_t kArm64UnwindingRegs[] = {
+    unwindstack::ARM64_REG_R19, unwindstack::ARM64_REG_R20,
+    unwindstack::ARM64_REG_R21, unwindstack::ARM64_REG_R22,
+    unwindstack::ARM64_REG_R23, unwindstack::ARM64_REG_R24,
+    unwindstack::ARM64_REG_R25, unwindstack::ARM64_REG_R26,
+    unwindstack::ARM64_REG_R27, unwindstack::ARM64_REG_R28,
+    unwindstack::ARM64_REG_R29, unwindstack::ARM64_REG_LR};
+constexpr uint16_t kMipsUnwindingRegs[] = {
+    unwindstack::MIPS_REG_R16, unwindstack::MIPS_REG_R17,
+    unwindstack::MIPS_REG_R18, unwindstack::MIPS_REG_R19,
+    unwindstack::MIPS_REG_R20, unwindstack::MIPS_REG_R21,
+    unwindstack::MIPS_REG_R22, unwindstack::MIPS_REG_R23,
+    unwindstack::MIPS_REG_R28, unwindstack::MIPS_REG_R30,
+    unwindstack::MIPS_REG_RA};
+constexpr uint16_t kMips64UnwindingRegs[] = {
+    unwindstack::MIPS64_REG_R16, unwindstack::MIPS64_REG_R17,
+    unwindstack::MIPS64_REG_R18, unwindstack::MIPS64_REG_R19,
+    unwindstack::MIPS64_REG_R20, unwindstack::MIPS64_REG_R21,
+    unwindstack::MIPS64_REG_R22, unwindstack::MIPS64_REG_R23,
+    unwindstack::MIPS64_REG_R28, unwindstack::MIPS64_REG_R30,
+    unwindstack::MIPS64_REG_RA};
+
 }  // namespace
 
 std::unique_ptr<unwindstack::Regs> CreateRegsFromRawData(
@@ -115,6 +168,49 @@ std::unique_ptr<unwindstack::Regs> CreateRegsFromRawData(
   return ret;
 }
 
+std::vector<uint64_t> GetUnwindingRegs(unwindstack::Regs* regs) {
+  const uint16_t* idxs = nullptr;
+  size_t num_idxs = 0;
+  switch (regs->Arch()) {
+    case unwindstack::ARCH_X86:
+      idxs = kX86UnwindingRegs;
+      num_idxs = base::ArraySize(kX86UnwindingRegs);
+      break;
+    case unwindstack::ARCH_X86_64:
+      idxs = kX86_64UnwindingRegs;
+      num_idxs = base::ArraySize(kX86_64UnwindingRegs);
+      break;
+    case unwindstack::ARCH_ARM:
+      idxs = kArmUnwindingRegs;
+      num_idxs = base::ArraySize(kArmUnwindingRegs);
+      break;
+    case unwindstack::ARCH_ARM64:
+      idxs = kArm64UnwindingRegs;
+      num_idxs = base::ArraySize(kArm64UnwindingRegs);
+      break;
+    case unwindstack::ARCH_MIPS:
+      idxs = kMipsUnwindingRegs;
+      num_idxs = base::ArraySize(kMipsUnwindingRegs);
+      break;
+    case unwindstack::ARCH_MIPS64:
+      idxs = kMips64UnwindingRegs;
+      num_idxs = base::ArraySize(kMips64UnwindingRegs);
+      break;
+    case unwindstack::ARCH_UNKNOWN:
+      break;
+  }
+
+  std::vector<uint64_t> values(num_idxs);
+  for (size_t i = 0; i < num_idxs; ++i) {
+    PERFETTO_DCHECK(idxs[i] < regs->total_regs());
+    if (regs->Is32Bit())
+      values[i] = static_cast<const uint32_t*>(regs->RawData())[idxs[i]];
+    else
+      values[i] = static_cast<const uint64_t*>(regs->RawData())[idxs[i]];
+  }
+  return values;
+}
+
 StackOverlayMemory::StackOverlayMemory(std::shared_ptr<unwindstack::Memory> mem,
                                        uint64_t sp,
                                        uint8_t* stack,
@@ -125,12 +221,99 @@ size_t StackOverlayMemory::Read(uint64_t addr, void* dst, size_t size) {
   if (addr >= sp_ && addr + size <= stack_end_ && addr + size > sp_) {
     size_t offset = static_cast<size_t>(addr - sp_);
     memcpy(dst, stack_ + offset, size);
+    stack_reads_.push_back({addr, size});
     return size;
   }
 
+  read_other_memory_ = true;
   return mem_->Read(addr, dst, size);
 }
 
+const std::vector<FrameData>* UnwindingCache::Lookup(
+    uint64_t pc,
+    uint64_t sp,
+    const std::vector<uint64_t>& regs,
+    uint64_t stack_base,
+    const uint8_t* stack,
+    size_t stack_size) const {
+  auto it = entries_.find({pc, sp});
+  if (it == entries_.end())
+    return nullptr;
+  const uint64_t stack_end = stack_base + stack_size;
+  for (const Entry& entry : it->second) {
+    if (entry.regs != regs)
+      continue;
+    const char* contents = entry.contents.data();
+    bool match = true;
+    for (const StackRead& read : entry.reads) {
+      if (read.addr < stack_base || read.addr + read.size > stack_end) {
+        match = false;
+        break;
+      }
+      size_t offset = static_cast<size_t>(read.addr - stack_base);
+      size_t size = static_cast<size_t>(read.size);
+      if (memcmp(stack + offset, contents, size) != 0) {
+        match = false;
+        break;
+      }
+      contents += size;
+    }
+    if (match)
+      return &entry.frames;
+  }
+  return nullptr;
+}
+
+void UnwindingCache::Insert(uint64_t pc,
+                            uint64_t sp,
+                            std::vector<uint64_t> regs,
+                            std::vector<StackRead> reads,
+                            uint64_t stack_base,
+                            const uint8_t* stack,
+                            size_t stack_size,
+                            std::vector<FrameData> frames) {
+  if (num_entries_ >= kMaxUnwindingCacheEntries)
+    Clear();
+
+  std::sort(reads.begin(), reads.end(),
+            [](const StackRead& a, const StackRead& b) {
+              return a.addr < b.addr;
+            });
+  Entry entry;
+  entry.regs = std::move(regs);
+  for (const StackRead& read : reads) {
+    PERFETTO_DCHECK(read.addr >= stack_base &&
+                    read.addr + read.size <= stack_base + stack_size);
+    if (!entry.reads.empty()) {
+      StackRead& prev = entry.reads.back();
+      if (read.addr <= prev.addr + prev.size) {
+        prev.size = std::max(prev.size, read.addr + read.size - prev.addr);
+        continue;
+      }
+    }
+    entry.reads.push_back(read);
+  }
+  for (const StackRead& read : entry.reads) {
+    size_t offset = static_cast<size_t>(read.addr - stack_base);
+    entry.contents.append(reinterpret_cast<const char*>(stack + offset),
+                          static_cast<size_t>(read.size));
+  }
+  entry.frames = std::move(frames);
+
+  std::vector<Entry>& entries = entries_[{pc, sp}];
+  if (entries.size() >= kMaxUnwindingCacheEntriesPerKey) {
+    entries.erase(entries.begin());
+    num_entries_--;
+  }
+  entries.emplace_back(std::move(entry));
+  num_entries_++;
+}
+
+void UnwindingCache::Clear() {
+  entries_.clear();
+  num_entries_ = 0;
+}
+
 FDMemory::FDMemory(base::ScopedFile mem_fd) : mem_fd_(std::move(mem_fd)) {}
 
 size_t FDMemory::Read(uint64_t addr, void* dst, size_t size) {
@@ -189,7 +372,21 @@ bool DoUnwind(WireMessage* msg, UnwindingMetadata* metadata, AllocRecord* out) {
     return false;
   }
   uint8_t* stack = reinterpret_cast<uint8_t*>(msg->payload);
-  std::shared_ptr<unwindstack::Memory> mems =
+  // The unwinder modifies regs, so remember where we started.
+  const uint64_t pc = regs->pc();
+  const uint64_t sp = regs->sp();
+  std::vector<uint64_t> unwinding_regs = GetUnwindingRegs(regs.get());
+  const std::vector<FrameData>* cached_frames =
+      metadata->unwinding_cache.Lookup(pc, sp, unwinding_regs,
+                                       alloc_metadata->stack_pointer, stack,
+                                       msg->payload_size);
+  if (cached_frames) {
+    out->frames = *cached_frames;
+    out->unwinding_cache_hit = true;
+    return true;
+  }
+
+  std::shared_ptr<StackOverlayMemory> mems =
       std::make_shared<StackOverlayMemory>(metadata->fd_mem,
                                            alloc_metadata->stack_pointer, stack,
                                            msg->payload_size);
@@ -221,6 +418,7 @@ bool DoUnwind(WireMessage* msg, UnwindingMetadata* metadata, AllocRecord* out) {
       break;
   }
   std::vector<unwindstack::FrameData> frames = unwinder.ConsumeFrames();
+  bool cacheable = error_code == 0 && !mems->read_other_memory();
   for (unwindstack::FrameData& fd : frames) {
     std::string build_id;
     if (fd.map_name != "") {
@@ -228,10 +426,17 @@ bool DoUnwind(WireMessage* msg, UnwindingMetadata* metadata, AllocRecord* out) {
       if (map_info)
         build_id = map_info->GetBuildID();
     }
+    cacheable = cacheable && IsFileBacked(fd.map_name);
 
     out->frames.emplace_back(std::move(fd), std::move(build_id));
   }
 
+  if (cacheable) {
+    metadata->unwinding_cache.Insert(
+        pc, sp, std::move(unwinding_regs), mems->stack_reads(),
+        alloc_metadata->stack_pointer, stack, msg->payload_size, out->frames);
+  }
+
   if (error_code != 0) {
     PERFETTO_DLOG("Unwinding error %" PRIu8, error_code);
     unwindstack::FrameData frame_data{};
@@ -254,14 +459,7 @@ void UnwindingWorker::OnDisconnect(base::UnixSocket* self) {
   ClientData& client_data = it->second;
   SharedRingBuffer& shmem = client_data.shmem;
 
-  SharedRingBuffer::Stats stats = {};
-  {
-    auto lock = shmem.AcquireLock(ScopedSpinlock::Mode::Try);
-    if (lock.locked())
-      stats = shmem.GetStats(lock);
-    else
-      PERFETTO_ELOG("Failed to log shmem to get stats.");
-  }
+  SharedRingBuffer::Stats stats = shmem.GetStats();
   DataSourceInstanceID ds_id = client_data.data_source_instance_id;
   pid_t peer_pid = self->peer_pid();
   client_data_.erase(it);
@@ -394,6 +592,68 @@ void UnwindingWorker::PostDisconnectSocket(pid_t pid) {
       [this, pid] { HandleDisconnectSocket(pid); });
 }
 
+void UnwindingWorker::PostReleaseClient(pid_t pid) {
+  // We do not need to use a WeakPtr here because the task runner will not
+  // outlive its UnwindingWorker.
+  thread_task_runner_.get()->PostTask(
+      [this, pid] { HandleReleaseClient(pid); });
+}
+
+void UnwindingWorker::HandleReleaseClient(pid_t pid) {
+  auto it = client_data_.find(pid);
+  if (it == client_data_.end()) {
+    PERFETTO_DLOG("Not releasing client %d, it disconnected.", pid);
+    return;
+  }
+  ClientData& client_data = it->second;
+  if (!client_data.sock->is_connected()) {
+    // OnDisconnect is pending, which would get lost if we released the socket.
+    PERFETTO_DLOG("Not releasing client %d, it is disconnecting.", pid);
+    return;
+  }
+  MigrationData data{
+      client_data.data_source_instance_id,
+      client_data.sock->ReleaseSocket(),
+      std::move(client_data.metadata),
+      std::move(client_data.shmem),
+      std::move(client_data.client_config),
+  };
+  client_data_.erase(it);
+  delegate_->PostClientReleased(std::move(data));
+}
+
+void UnwindingWorker::PostAdoptClient(MigrationData migration_data) {
+  // Even with C++14, this cannot be moved, as std::function has to be
+  // copyable, which MigrationData is not.
+  MigrationData* raw_data = new MigrationData(std::move(migration_data));
+  // We do not need to use a WeakPtr here because the task runner will not
+  // outlive its UnwindingWorker.
+  thread_task_runner_.get()->PostTask([this, raw_data] {
+    MigrationData data = std::move(*raw_data);
+    delete raw_data;
+    HandleAdoptClient(std::move(data));
+  });
+}
+
+void UnwindingWorker::HandleAdoptClient(MigrationData migration_data) {
+  auto sock = base::UnixSocket::AdoptConnected(
+      migration_data.sock.ReleaseFd(), this, this->thread_task_runner_.get(),
+      base::SockFamily::kUnix, base::SockType::kStream);
+  pid_t peer_pid = sock->peer_pid();
+
+  ClientData client_data{
+      migration_data.data_source_instance_id,
+      std::move(sock),
+      std::move(migration_data.metadata),
+      std::move(migration_data.shmem),
+      std::move(migration_data.client_config),
+  };
+  client_data_.emplace(peer_pid, std::move(client_data));
+  // The notifications for records written before the migration might have
+  // been consumed by the previous worker.
+  HandleUnwindBatch(peer_pid);
+}
+
 void UnwindingWorker::HandleDisconnectSocket(pid_t pid) {
   auto it = client_data_.find(pid);
   if (it == client_data_.end()) {
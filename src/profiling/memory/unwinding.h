@@ -19,6 +19,11 @@
 
 #include "perfetto/base/build_config.h"
 
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include <unwindstack/Maps.h>
 #include <unwindstack/Unwinder.h>
 
@@ -41,6 +46,13 @@ std::unique_ptr<unwindstack::Regs> CreateRegsFromRawData(
     unwindstack::ArchEnum arch,
     void* raw_data);
 
+// Returns the values of the registers of |regs|, other than pc and sp, that
+// the unwinder can use to recover the frames of the callers: the frame
+// pointer, the link register and the other callee-saved registers. Argument
+// and scratch registers are not preserved across calls, so they are never
+// used to unwind the callers.
+std::vector<uint64_t> GetUnwindingRegs(unwindstack::Regs* regs);
+
 // Read /proc/[pid]/maps from an open file descriptor.
 // TODO(fmayer): Figure out deduplication to other maps.
 class FileDescriptorMaps : public unwindstack::Maps {
@@ -79,6 +91,57 @@ class FDMemory : public unwindstack::Memory {
   base::ScopedFile mem_fd_;
 };
 
+// Range of the stack of a client read by the unwinder.
+struct StackRead {
+  uint64_t addr;
+  uint64_t size;
+};
+
+// Caches the frames unwound from stack samples of a process. Most samples are
+// taken at a handful of callsites, so we would otherwise do the same unwinds
+// over and over again.
+//
+// Entries are keyed on the pc and sp of the sample, and remember the
+// registers returned by GetUnwindingRegs as well as all the parts of the stack
+// the unwinder read. An entry is only reused if those are the same in the new
+// sample, in which case the unwinder would have returned the same frames. The
+// other registers (e.g. the arguments of malloc) usually differ between
+// samples at the same callsite and are not compared.
+class UnwindingCache {
+ public:
+  const std::vector<FrameData>* Lookup(uint64_t pc,
+                                       uint64_t sp,
+                                       const std::vector<uint64_t>& regs,
+                                       uint64_t stack_base,
+                                       const uint8_t* stack,
+                                       size_t stack_size) const;
+  void Insert(uint64_t pc,
+              uint64_t sp,
+              std::vector<uint64_t> regs,
+              std::vector<StackRead> reads,
+              uint64_t stack_base,
+              const uint8_t* stack,
+              size_t stack_size,
+              std::vector<FrameData> frames);
+  void Clear();
+
+  size_t size() const { return num_entries_; }
+
+ private:
+  struct Entry {
+    // Registers of the sample returned by GetUnwindingRegs.
+    std::vector<uint64_t> regs;
+    // Sorted and non-overlapping.
+    std::vector<StackRead> reads;
+    // Concatenated contents of the stack in reads.
+    std::string contents;
+    std::vector<FrameData> frames;
+  };
+
+  std::map<std::pair<uint64_t, uint64_t>, std::vector<Entry>> entries_;
+  size_t num_entries_ = 0;
+};
+
 // Overlays size bytes pointed to by stack for addresses in [sp, sp + size).
 // Addresses outside of that range are read from mem_fd, which should be an fd
 // that opened /proc/[pid]/mem.
@@ -90,11 +153,18 @@ class StackOverlayMemory : public unwindstack::Memory {
                      size_t size);
   size_t Read(uint64_t addr, void* dst, size_t size) override;
 
+  // Parts of the overlay that were read so far.
+  const std::vector<StackRead>& stack_reads() const { return stack_reads_; }
+  // Whether anything outside of the overlay was read.
+  bool read_other_memory() const { return read_other_memory_; }
+
  private:
   std::shared_ptr<unwindstack::Memory> mem_;
   uint64_t sp_;
   uint64_t stack_end_;
   uint8_t* stack_;
+  std::vector<StackRead> stack_reads_;
+  bool read_other_memory_ = false;
 };
 
 struct UnwindingMetadata {
@@ -117,6 +187,8 @@ struct UnwindingMetadata {
     reparses++;
     maps.Reset();
     maps.Parse();
+    // The cached frames might refer to maps that no longer exist.
+    unwinding_cache.Clear();
 #if PERFETTO_BUILDFLAG(PERFETTO_ANDROID_BUILD)
     jit_debug = std::unique_ptr<unwindstack::JitDebug>(
         new unwindstack::JitDebug(fd_mem));
@@ -129,6 +201,7 @@ struct UnwindingMetadata {
   // The API of libunwindstack expects shared_ptr for Memory.
   std::shared_ptr<unwindstack::Memory> fd_mem;
   uint64_t reparses = 0;
+  UnwindingCache unwinding_cache;
 #if PERFETTO_BUILDFLAG(PERFETTO_ANDROID_BUILD)
   std::unique_ptr<unwindstack::JitDebug> jit_debug;
   std::unique_ptr<unwindstack::DexFiles> dex_files;
@@ -139,6 +212,16 @@ bool DoUnwind(WireMessage*, UnwindingMetadata* metadata, AllocRecord* out);
 
 class UnwindingWorker : public base::UnixSocket::EventListener {
  public:
+  // A client released by a worker, to be adopted by another one. Keeps the
+  // already parsed maps of the client.
+  struct MigrationData {
+    DataSourceInstanceID data_source_instance_id;
+    base::UnixSocketRaw sock;
+    UnwindingMetadata metadata;
+    SharedRingBuffer shmem;
+    ClientConfiguration client_config;
+  };
+
   class Delegate {
    public:
     virtual void PostAllocRecord(AllocRecord) = 0;
@@ -146,6 +229,7 @@ class UnwindingWorker : public base::UnixSocket::EventListener {
     virtual void PostSocketDisconnected(DataSourceInstanceID,
                                         pid_t pid,
                                         SharedRingBuffer::Stats stats) = 0;
+    virtual void PostClientReleased(MigrationData) = 0;
     virtual ~Delegate();
   };
 
@@ -165,6 +249,10 @@ class UnwindingWorker : public base::UnixSocket::EventListener {
   // Public API safe to call from other threads.
   void PostDisconnectSocket(pid_t pid);
   void PostHandoffSocket(HandoffData);
+  // Stops handling the client |pid|, and passes it to
+  // Delegate::PostClientReleased so it can be adopted by another worker.
+  void PostReleaseClient(pid_t pid);
+  void PostAdoptClient(MigrationData);
 
   // Implementation of UnixSocket::EventListener.
   // Do not call explicitly.
@@ -186,6 +274,8 @@ class UnwindingWorker : public base::UnixSocket::EventListener {
  private:
   void HandleHandoffSocket(HandoffData data);
   void HandleDisconnectSocket(pid_t pid);
+  void HandleReleaseClient(pid_t pid);
+  void HandleAdoptClient(MigrationData data);
 
   void HandleUnwindBatch(pid_t);
 
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <memory>
+
+#include <benchmark/benchmark.h>
+#include <unwindstack/RegsGetLocal.h>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/ext/base/file_utils.h"
+#include "src/profiling/memory/client.h"
+#include "src/profiling/memory/shared_ring_buffer.h"
+#include "src/profiling/memory/unwinding.h"
+#include "src/profiling/memory/wire_protocol.h"
+
+namespace {
+
+using perfetto::profiling::AllocMetadata;
+using perfetto::profiling::AllocRecord;
+using perfetto::profiling::DataSourceInstanceID;
+using perfetto::profiling::FreeRecord;
+using perfetto::profiling::SharedRingBuffer;
+using perfetto::profiling::UnwindingMetadata;
+using perfetto::profiling::UnwindingWorker;
+using perfetto::profiling::WireMessage;
+
+class CountingDelegate : public UnwindingWorker::Delegate {
+ public:
+  void PostAllocRecord(AllocRecord rec) override {
+    benchmark::DoNotOptimize(rec.frames.data());
+    ++alloc_records;
+  }
+  void PostFreeRecord(FreeRecord) override {}
+  void PostSocketDisconnected(DataSourceInstanceID,
+                              pid_t,
+                              SharedRingBuffer::Stats) override {}
+  void PostClientReleased(UnwindingWorker::MigrationData) override {}
+
+  uint64_t alloc_records = 0;
+};
+
+// ASAN thinks copying the whole stack is a buffer underrun.
+void __attribute__((noinline))
+UnsafeMemcpy(void* dst, const void* src, size_t n)
+    __attribute__((no_sanitize("address", "hwaddress", "memory"))) {
+  const uint8_t* from = reinterpret_cast<const uint8_t*>(src);
+  uint8_t* to = reinterpret_cast<uint8_t*>(dst);
+  for (size_t i = 0; i < n; ++i)
+    to[i] = from[i];
+}
+
+// Writes a malloc record for the calling thread's current stack into |shmem|,
+// the same way Client::RecordMalloc does.
+void __attribute__((noinline)) WriteRecord(SharedRingBuffer* shmem) {
+  AllocMetadata metadata = {};
+  const char* stackbase = perfetto::profiling::GetThreadStackBase();
+  const char* stacktop = reinterpret_cast<char*>(__builtin_frame_address(0));
+  PERFETTO_CHECK(stackbase > stacktop);
+  unwindstack::AsmGetRegs(metadata.register_data);
+
+  size_t stack_size = static_cast<size_t>(stackbase - stacktop);
+  std::unique_ptr<char[]> stack(new char[stack_size]);
+  UnsafeMemcpy(stack.get(), stacktop, stack_size);
+
+  metadata.alloc_size = 10;
+  metadata.alloc_address = 0x10;
+  metadata.stack_pointer = reinterpret_cast<uint64_t>(stacktop);
+  metadata.stack_pointer_offset = sizeof(AllocMetadata);
+  metadata.arch = unwindstack::Regs::CurrentArch();
+  metadata.sequence_number = 1;
+
+  WireMessage msg = {};
+  msg.record_type = perfetto::profiling::RecordType::Malloc;
+  msg.alloc_header = &metadata;
+  msg.payload = stack.get();
+  msg.payload_size = stack_size;
+  PERFETTO_CHECK(perfetto::profiling::SendWireMessage(shmem, msg));
+}
+
+// Each thread plays the role of one unwinder thread of heapprofd, handling
+// malloc records of a client with its own UnwindingMetadata. As the workers
+// share no state, this shows how the unwinding throughput of heapprofd scales
+// with the size of its unwinder pool on this machine.
+//
+// With state.range(0) == 0, the UnwindingCache is cleared before every record,
+// so each of them gets fully unwound.
+static void BM_UnwindingWorker_HandleBuffer(benchmark::State& state) {
+  const bool use_cache = state.range(0) != 0;
+  auto shmem = SharedRingBuffer::Create(1024 * 1024);
+  PERFETTO_CHECK(shmem);
+  WriteRecord(&*shmem);
+  SharedRingBuffer::Buffer buf = shmem->BeginRead();
+  PERFETTO_CHECK(buf);
+
+  UnwindingMetadata metadata(
+      getpid(), perfetto::base::OpenFile("/proc/self/maps", O_RDONLY),
+      perfetto::base::OpenFile("/proc/self/mem", O_RDONLY));
+  CountingDelegate delegate;
+
+  for (auto _ : state) {
+    if (!use_cache)
+      metadata.unwinding_cache.Clear();
+    UnwindingWorker::HandleBuffer(buf, &metadata, 0, getpid(), &delegate);
+  }
+  PERFETTO_CHECK(delegate.alloc_records > 0);
+
+  shmem->EndRead(std::move(buf));
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+}  // namespace
+
+BENCHMARK(BM_UnwindingWorker_HandleBuffer)
+    ->Arg(0)
+    ->Arg(1)
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
@@ -33,6 +33,7 @@ class NopDelegate : public UnwindingWorker::Delegate {
   void PostSocketDisconnected(DataSourceInstanceID,
                               pid_t,
                               SharedRingBuffer::Stats) override {}
+  void PostClientReleased(UnwindingWorker::MigrationData) override {}
 };
 
 int FuzzUnwinding(const uint8_t* data, size_t size) {
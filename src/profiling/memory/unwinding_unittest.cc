@@ -20,6 +20,10 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unwindstack/MachineArm.h>
+#include <unwindstack/MachineArm64.h>
+#include <unwindstack/MachineX86.h>
+#include <unwindstack/MachineX86_64.h>
 #include <unwindstack/RegsGetLocal.h>
 
 #include "perfetto/ext/base/scoped_file.h"
@@ -41,6 +45,8 @@ TEST(UnwindingTest, StackOverlayMemoryOverlay) {
   uint8_t buf[1] = {};
   ASSERT_EQ(memory.Read(0u, buf, 1), 1u);
   ASSERT_EQ(buf[0], 120);
+  EXPECT_EQ(memory.stack_reads().size(), 1u);
+  EXPECT_FALSE(memory.read_other_memory());
 }
 
 TEST(UnwindingTest, StackOverlayMemoryNonOverlay) {
@@ -55,6 +61,8 @@ TEST(UnwindingTest, StackOverlayMemoryNonOverlay) {
   uint8_t buf[1] = {1};
   ASSERT_EQ(memory.Read(reinterpret_cast<uint64_t>(&value), buf, 1), 1u);
   ASSERT_EQ(buf[0], value);
+  EXPECT_TRUE(memory.stack_reads().empty());
+  EXPECT_TRUE(memory.read_other_memory());
 }
 
 TEST(UnwindingTest, FileDescriptorMapsParse) {
@@ -178,6 +186,180 @@ TEST(UnwindingTest, DoUnwindReparse) {
                "namespace)::GetRecord(perfetto::profiling::WireMessage*)");
 }
 
+TEST(UnwindingTest, DoUnwindCached) {
+  base::ScopedFile proc_maps(base::OpenFile("/proc/self/maps", O_RDONLY));
+  base::ScopedFile proc_mem(base::OpenFile("/proc/self/mem", O_RDONLY));
+  UnwindingMetadata metadata(getpid(), std::move(proc_maps),
+                             std::move(proc_mem));
+  WireMessage msg;
+  auto record = GetRecord(&msg);
+  AllocRecord out;
+  ASSERT_TRUE(DoUnwind(&msg, &metadata, &out));
+  AllocRecord cached_out;
+  ASSERT_TRUE(DoUnwind(&msg, &metadata, &cached_out));
+  EXPECT_FALSE(out.unwinding_cache_hit);
+  EXPECT_GT(metadata.unwinding_cache.size(), 0u);
+  EXPECT_TRUE(cached_out.unwinding_cache_hit);
+  ASSERT_EQ(cached_out.frames.size(), out.frames.size());
+  for (size_t i = 0; i < out.frames.size(); ++i) {
+    EXPECT_EQ(cached_out.frames[i].frame.pc, out.frames[i].frame.pc);
+    EXPECT_EQ(cached_out.frames[i].frame.function_name,
+              out.frames[i].frame.function_name);
+  }
+  metadata.ReparseMaps();
+  EXPECT_EQ(metadata.unwinding_cache.size(), 0u);
+}
+
+// Adds one to the register |reg| of the sample in |metadata|.
+void IncrementRegister(AllocMetadata* metadata, uint16_t reg) {
+  auto regs = CreateRegsFromRawData(metadata->arch, metadata->register_data);
+  if (regs->Is32Bit()) {
+    uint32_t value;
+    memcpy(&value, metadata->register_data + reg * sizeof(value),
+           sizeof(value));
+    value++;
+    memcpy(metadata->register_data + reg * sizeof(value), &value,
+           sizeof(value));
+  } else {
+    uint64_t value;
+    memcpy(&value, metadata->register_data + reg * sizeof(value),
+           sizeof(value));
+    value++;
+    memcpy(metadata->register_data + reg * sizeof(value), &value,
+           sizeof(value));
+  }
+}
+
+TEST(UnwindingTest, DoUnwindCachedIgnoresScratchRegisters) {
+  // An argument register and a callee-saved register of the current
+  // architecture.
+  uint16_t scratch_reg = 0;
+  uint16_t callee_saved_reg = 0;
+  switch (unwindstack::Regs::CurrentArch()) {
+    case unwindstack::ARCH_X86:
+      scratch_reg = unwindstack::X86_REG_EAX;
+      callee_saved_reg = unwindstack::X86_REG_EBX;
+      break;
+    case unwindstack::ARCH_X86_64:
+      scratch_reg = unwindstack::X86_64_REG_RDI;
+      callee_saved_reg = unwindstack::X86_64_REG_RBX;
+      break;
+    case unwindstack::ARCH_ARM:
+      scratch_reg = unwindstack::ARM_REG_R0;
+      callee_saved_reg = unwindstack::ARM_REG_R4;
+      break;
+    case unwindstack::ARCH_ARM64:
+      scratch_reg = unwindstack::ARM64_REG_R0;
+      callee_saved_reg = unwindstack::ARM64_REG_R19;
+      break;
+    case unwindstack::ARCH_MIPS:
+    case unwindstack::ARCH_MIPS64:
+    case unwindstack::ARCH_UNKNOWN:
+      return;
+  }
+
+  base::ScopedFile proc_maps(base::OpenFile("/proc/self/maps", O_RDONLY));
+  base::ScopedFile proc_mem(base::OpenFile("/proc/self/mem", O_RDONLY));
+  UnwindingMetadata metadata(getpid(), std::move(proc_maps),
+                             std::move(proc_mem));
+  WireMessage msg;
+  auto record = GetRecord(&msg);
+  AllocRecord out;
+  ASSERT_TRUE(DoUnwind(&msg, &metadata, &out));
+  EXPECT_FALSE(out.unwinding_cache_hit);
+
+  // Samples at the same callsite differ in the arguments of malloc.
+  IncrementRegister(msg.alloc_header, scratch_reg);
+  AllocRecord scratch_out;
+  ASSERT_TRUE(DoUnwind(&msg, &metadata, &scratch_out));
+  EXPECT_TRUE(scratch_out.unwinding_cache_hit);
+  EXPECT_EQ(scratch_out.frames.size(), out.frames.size());
+
+  // The callers might be unwound from callee-saved registers.
+  IncrementRegister(msg.alloc_header, callee_saved_reg);
+  AllocRecord callee_saved_out;
+  ASSERT_TRUE(DoUnwind(&msg, &metadata, &callee_saved_out));
+  EXPECT_FALSE(callee_saved_out.unwinding_cache_hit);
+}
+
+std::vector<FrameData> MakeFrames(const char* function_name) {
+  unwindstack::FrameData frame{};
+  frame.function_name = function_name;
+  std::vector<FrameData> frames;
+  frames.emplace_back(frame, "");
+  return frames;
+}
+
+TEST(UnwindingCacheTest, Lookup) {
+  std::vector<uint64_t> regs = {2, 3};
+  uint8_t stack[64] = {};
+  UnwindingCache cache;
+  // Overlapping and adjacent reads get merged.
+  cache.Insert(1, 0x1000, regs,
+               {{0x1010, 8}, {0x1008, 8}, {0x1030, 4}, {0x1032, 4}}, 0x1000,
+               stack, sizeof(stack), MakeFrames("fun"));
+  const std::vector<FrameData>* frames =
+      cache.Lookup(1, 0x1000, regs, 0x1000, stack, sizeof(stack));
+  ASSERT_NE(frames, nullptr);
+  ASSERT_EQ(frames->size(), 1u);
+  EXPECT_EQ((*frames)[0].frame.function_name, "fun");
+
+  EXPECT_EQ(cache.Lookup(2, 0x1000, regs, 0x1000, stack, sizeof(stack)),
+            nullptr);
+  EXPECT_EQ(cache.Lookup(1, 0x1008, regs, 0x1000, stack, sizeof(stack)),
+            nullptr);
+  // The stack sample does not cover all of the reads.
+  EXPECT_EQ(cache.Lookup(1, 0x1000, regs, 0x1000, stack, 0x34), nullptr);
+  EXPECT_EQ(cache.Lookup(1, 0x1000, regs, 0x1010, stack, sizeof(stack)),
+            nullptr);
+
+  // The registers have to match as well: the unwinder can use the
+  // callee-saved ones to recover the frames of the callers.
+  regs[0] = 4;
+  EXPECT_EQ(cache.Lookup(1, 0x1000, regs, 0x1000, stack, sizeof(stack)),
+            nullptr);
+  regs[0] = 2;
+
+  // Memory that was not read can change.
+  stack[0x20] = 1;
+  EXPECT_NE(cache.Lookup(1, 0x1000, regs, 0x1000, stack, sizeof(stack)),
+            nullptr);
+  // Memory that was read cannot.
+  stack[0x17] = 1;
+  EXPECT_EQ(cache.Lookup(1, 0x1000, regs, 0x1000, stack, sizeof(stack)),
+            nullptr);
+  stack[0x17] = 0;
+  stack[0x35] = 1;
+  EXPECT_EQ(cache.Lookup(1, 0x1000, regs, 0x1000, stack, sizeof(stack)),
+            nullptr);
+}
+
+TEST(UnwindingCacheTest, MultipleEntriesPerKey) {
+  std::vector<uint64_t> regs = {2, 3};
+  uint8_t stack[8] = {};
+  UnwindingCache cache;
+  for (uint8_t i = 0; i < 5; ++i) {
+    stack[0] = i;
+    cache.Insert(1, 0x1000, regs, {{0x1000, 1}}, 0x1000, stack, sizeof(stack),
+                 MakeFrames(std::to_string(i).c_str()));
+  }
+  // Only the newest entries are kept.
+  EXPECT_EQ(cache.size(), 4u);
+  stack[0] = 0;
+  EXPECT_EQ(cache.Lookup(1, 0x1000, regs, 0x1000, stack, sizeof(stack)),
+            nullptr);
+  stack[0] = 3;
+  const std::vector<FrameData>* frames =
+      cache.Lookup(1, 0x1000, regs, 0x1000, stack, sizeof(stack));
+  ASSERT_NE(frames, nullptr);
+  EXPECT_EQ((*frames)[0].frame.function_name, "3");
+
+  cache.Clear();
+  EXPECT_EQ(cache.size(), 0u);
+  EXPECT_EQ(cache.Lookup(1, 0x1000, regs, 0x1000, stack, sizeof(stack)),
+            nullptr);
+}
+
 }  // namespace
 }  // namespace profiling
 }  // namespace perfetto
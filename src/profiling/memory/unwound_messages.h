@@ -39,6 +39,7 @@ struct AllocRecord {
   pid_t pid;
   bool error = false;
   bool reparsed_map = false;
+  bool unwinding_cache_hit = false;
   uint64_t unwinding_time_us = 0;
   uint64_t data_source_instance_id;
   uint64_t timestamp;
@@ -170,8 +170,31 @@ void Message::BeginNestedMessageInternal(uint32_t field_id, Message* message) {
 }
 
 void Message::EndNestedMessage() {
-  size_ += nested_message_->Finalize();
+  // Finalize() clears the size field, so grab it beforehand.
+  uint8_t* size_field = nested_message_->size_field_;
+  uint32_t nested_size = nested_message_->Finalize();
+  size_ += nested_size;
+  if (stream_writer_->compact_nested_messages() && size_field)
+    size_ -= CompactNestedMessage(size_field, nested_size);
   nested_message_ = nullptr;
 }
 
+uint32_t Message::CompactNestedMessage(uint8_t* size_field, uint32_t size) {
+  // If the stream moved to a new buffer since the nested message began, its
+  // contents are not contiguous (and the size field might have been moved
+  // into a patch by the delegate), so leave it as is.
+  if (!stream_writer_->IsInCurrentRange(size_field))
+    return 0;
+
+  uint8_t* contents = size_field + proto_utils::kMessageLengthFieldSize;
+  PERFETTO_DCHECK(contents + size == stream_writer_->write_ptr());
+  uint8_t* new_contents = proto_utils::WriteVarInt(size, size_field);
+  const uint32_t saved = static_cast<uint32_t>(contents - new_contents);
+  if (saved) {
+    memmove(new_contents, contents, size);
+    stream_writer_->Rewind(saved);
+  }
+  return saved;
+}
+
 }  // namespace protozero
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+
+#include <benchmark/benchmark.h>
+
+#include "perfetto/protozero/message.h"
+#include "perfetto/protozero/scattered_heap_buffer.h"
+#include "perfetto/protozero/static_buffer.h"
+
+namespace {
+
+constexpr size_t kEventsPerIteration = 64;
+
+// Writes |kEventsPerIteration| nested messages shaped like a typical track
+// event: a few varints, an interned name and a couple of nested debug
+// annotations.
+void WriteEvents(protozero::Message* root) {
+  for (uint32_t i = 0; i < kEventsPerIteration; i++) {
+    auto* event = root->BeginNestedMessage<protozero::Message>(1);
+    event->AppendVarInt(1, 1000000000ull + i);
+    event->AppendVarInt(2, 42);
+    event->AppendTinyVarInt(3, 1);
+    for (uint32_t j = 0; j < 2; j++) {
+      auto* annotation = event->BeginNestedMessage<protozero::Message>(4);
+      annotation->AppendTinyVarInt(1, static_cast<int32_t>(j));
+      annotation->AppendString(2, "value");
+    }
+    auto* args = event->BeginNestedMessage<protozero::Message>(5);
+    args->AppendVarInt(1, i);
+  }
+}
+
+// The argument is 1 to encode nested message sizes minimally, 0 otherwise.
+static void BM_ProtozeroMessage_StaticBuffer(benchmark::State& state) {
+  const bool compact = state.range(0) != 0;
+  std::unique_ptr<uint8_t[]> buf(new uint8_t[64 * 1024]);
+  size_t size = 0;
+  for (auto _ : state) {
+    protozero::StaticBuffered<protozero::Message> msg(buf.get(), 64 * 1024);
+    msg.set_compact_nested_messages(compact);
+    WriteEvents(msg.get());
+    size = msg.Finalize();
+    benchmark::DoNotOptimize(buf.get());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(kEventsPerIteration));
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(size));
+  state.counters["bytes_per_event"] =
+      static_cast<double>(size) / kEventsPerIteration;
+}
+
+// Same as above, but writing into 4KB heap slices. Nested messages which
+// straddle two slices keep their redundant size field.
+static void BM_ProtozeroMessage_HeapBuffer(benchmark::State& state) {
+  const bool compact = state.range(0) != 0;
+  protozero::HeapBuffered<protozero::Message> msg(4096, 4096);
+  size_t size = 0;
+  for (auto _ : state) {
+    msg.Reset();
+    msg.set_compact_nested_messages(compact);
+    WriteEvents(msg.get());
+    size = msg->Finalize();
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(kEventsPerIteration));
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(size));
+  state.counters["bytes_per_event"] =
+      static_cast<double>(size) / kEventsPerIteration;
+}
+
+}  // namespace
+
+BENCHMARK(BM_ProtozeroMessage_StaticBuffer)->Arg(0)->Arg(1);
+BENCHMARK(BM_ProtozeroMessage_HeapBuffer)->Arg(0)->Arg(1);
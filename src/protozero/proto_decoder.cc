@@ -237,4 +237,38 @@ void TypedProtoDecoderBase::ExpandHeapStorage() {
   capacity_ = new_capacity;
 }
 
+void SpecializedProtoDecoderBase::ParseAllFields() {
+  const uint8_t* cur = begin_;
+  ParseFieldResult res;
+  for (;;) {
+    const uint8_t* field_begin = cur;
+    res = ParseOneField(cur, end_);
+    PERFETTO_DCHECK(res.parse_res != ParseFieldResult::kOk || res.next != cur);
+    cur = res.next;
+    if (PERFETTO_UNLIKELY(res.parse_res == ParseFieldResult::kSkip)) {
+      continue;
+    } else if (PERFETTO_UNLIKELY(res.parse_res == ParseFieldResult::kAbort)) {
+      break;
+    }
+    PERFETTO_DCHECK(res.parse_res == ParseFieldResult::kOk);
+    PERFETTO_DCHECK(res.field.valid());
+    auto field_id = res.field.id();
+    if (PERFETTO_UNLIKELY(field_id > max_field_id_))
+      continue;
+    uint32_t slot = field_slots_[field_id];
+    if (PERFETTO_UNLIKELY(slot == 0))
+      continue;
+
+    // As in TypedProtoDecoderBase, Get() returns the last value of repeated
+    // fields. GetRepeated() needs the first one instead, to start scanning
+    // from it.
+    PERFETTO_DCHECK(slot <= num_fields_);
+    Field* fld = &fields_[slot];
+    if (!fld->valid())
+      first_occurrences_[slot] = field_begin;
+    *fld = std::move(res.field);
+  }
+  read_ptr_ = res.next;
+}
+
 }  // namespace protozero
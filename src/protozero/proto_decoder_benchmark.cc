@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "perfetto/ext/base/file_utils.h"
+#include "perfetto/protozero/proto_decoder.h"
+#include "src/base/test/utils.h"
+
+#include "protos/perfetto/trace/ftrace/ftrace_event.pbzero.h"
+#include "protos/perfetto/trace/ftrace/ftrace_event_bundle.pbzero.h"
+#include "protos/perfetto/trace/ftrace/sched.pbzero.h"
+#include "protos/perfetto/trace/trace.pbzero.h"
+#include "protos/perfetto/trace/trace_packet.pbzero.h"
+
+namespace {
+
+using perfetto::protos::pbzero::FtraceEvent;
+using perfetto::protos::pbzero::FtraceEventBundle;
+using perfetto::protos::pbzero::SchedSwitchFtraceEvent;
+using perfetto::protos::pbzero::TracePacket;
+
+// Decodes all the packets of |trace| and the ftrace events within them, like
+// the trace processor does when ingesting a trace. Returns a checksum of the
+// decoded values, to prevent the compiler from optimizing the decoding away.
+uint64_t DecodeTrace(const std::string& trace) {
+  uint64_t checksum = 0;
+  protozero::ProtoDecoder trace_decoder(trace.data(), trace.size());
+  for (auto packet_field = trace_decoder.ReadField(); packet_field.valid();
+       packet_field = trace_decoder.ReadField()) {
+    TracePacket::Decoder packet(packet_field.data(), packet_field.size());
+    checksum += packet.timestamp() + packet.trusted_packet_sequence_id();
+    if (!packet.has_ftrace_events())
+      continue;
+
+    FtraceEventBundle::Decoder bundle(packet.ftrace_events());
+    checksum += bundle.cpu();
+    for (auto it = bundle.event(); it; ++it) {
+      FtraceEvent::Decoder event(*it);
+      checksum += event.timestamp() + event.pid();
+      if (!event.has_sched_switch())
+        continue;
+
+      SchedSwitchFtraceEvent::Decoder sched_switch(event.sched_switch());
+      checksum += static_cast<uint64_t>(sched_switch.prev_pid()) +
+                  static_cast<uint64_t>(sched_switch.next_pid()) +
+                  static_cast<uint64_t>(sched_switch.prev_state());
+    }
+  }
+  return checksum;
+}
+
+static void BM_ProtoDecoder_DecodeTrace(benchmark::State& state) {
+  std::string trace;
+  if (!perfetto::base::ReadFile(
+          perfetto::base::GetTestDataPath("test/data/android_sched_and_ps.pb"),
+          &trace)) {
+    state.SkipWithError("Test data missing, run tools/install-build-deps");
+    return;
+  }
+
+  for (auto _ : state)
+    benchmark::DoNotOptimize(DecodeTrace(trace));
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(trace.size()));
+}
+
+}  // namespace
+
+BENCHMARK(BM_ProtoDecoder_DecodeTrace)->Unit(benchmark::kMillisecond);
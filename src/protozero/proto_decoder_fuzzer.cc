@@ -19,11 +19,45 @@
 
 #include "perfetto/base/logging.h"
 #include "perfetto/protozero/proto_decoder.h"
+#include "perfetto/protozero/proto_utils.h"
 
 namespace protozero {
 namespace {
 
+// Reference byte-by-byte implementation of proto_utils::ParseVarInt(), used to
+// check its word-at-a-time fastpath.
+const uint8_t* ParseVarIntByteByByte(const uint8_t* start,
+                                     const uint8_t* end,
+                                     uint64_t* out_value) {
+  const uint8_t* pos = start;
+  uint64_t value = 0;
+  for (uint32_t shift = 0; pos < end && shift < 64u; shift += 7) {
+    uint8_t cur_byte = *pos++;
+    value |= static_cast<uint64_t>(cur_byte & 0x7f) << shift;
+    if ((cur_byte & 0x80) == 0) {
+      *out_value = value;
+      return pos;
+    }
+  }
+  *out_value = 0;
+  return start;
+}
+
+void FuzzParseVarInt(const uint8_t* data, size_t size) {
+  const uint8_t* end = data + size;
+  for (const uint8_t* pos = data; pos < end; pos++) {
+    uint64_t value = 0;
+    uint64_t expected_value = 0;
+    const uint8_t* next = proto_utils::ParseVarInt(pos, end, &value);
+    const uint8_t* expected_next =
+        ParseVarIntByteByByte(pos, end, &expected_value);
+    PERFETTO_CHECK(next == expected_next);
+    PERFETTO_CHECK(value == expected_value);
+  }
+}
+
 int FuzzProtoDecoder(const uint8_t* data, size_t size) {
+  FuzzParseVarInt(data, size);
   volatile uint64_t value = 0;
   ProtoDecoder dec(data, size);
   for (auto field = dec.ReadField(); field.valid(); field = dec.ReadField()) {
@@ -620,5 +620,83 @@ TEST(ProtoDecoderTest, OneBigFieldIdOnly) {
   ASSERT_FALSE(field.valid());
 }
 
+// A decoder for a message declaring the fields 2, 5 (repeated) and 7, as
+// generated by the pbzero plugin for messages in kSpecializedDecoderMessages.
+class SpecializedTestDecoder : public SpecializedProtoDecoder<3> {
+ public:
+  SpecializedTestDecoder(const uint8_t* data, size_t len)
+      : SpecializedProtoDecoder(FieldSlots(), /*max_field_id=*/7, data, len) {}
+  bool has_f2() const { return at_slot<1>().valid(); }
+  int32_t f2() const { return at_slot<1>().as_int32(); }
+  ScanningRepeatedFieldIterator<int32_t> f5() const {
+    return GetRepeated<int32_t>(5);
+  }
+  bool has_f7() const { return at_slot<3>().valid(); }
+  ConstChars f7() const { return at_slot<3>().as_string(); }
+
+ private:
+  static const uint16_t* FieldSlots() {
+    static const uint16_t kFieldSlots[] = {0, 0, 1, 0, 0, 2, 0, 3};
+    return kFieldSlots;
+  }
+};
+
+TEST(ProtoDecoderTest, SpecializedProtoDecoder) {
+  HeapBuffered<Message> message;
+  message->AppendVarInt(/*field_id=*/5, 10);
+  message->AppendVarInt(/*field_id=*/1, 1);  // Not declared, ignored.
+  message->AppendString(/*field_id=*/7, "foo");
+  message->AppendVarInt(/*field_id=*/5, 11);
+  message->AppendVarInt(/*field_id=*/900, 2);  // Above max_field_id, ignored.
+  message->AppendVarInt(/*field_id=*/5, 12);
+  message->AppendString(/*field_id=*/7, "bar");
+  std::vector<uint8_t> data = message.SerializeAsArray();
+
+  SpecializedTestDecoder decoder(data.data(), data.size());
+  EXPECT_FALSE(decoder.has_f2());
+  EXPECT_EQ(decoder.f2(), 0);
+  EXPECT_FALSE(decoder.Get(1).valid());
+  EXPECT_FALSE(decoder.Get(900).valid());
+
+  // Like TypedProtoDecoder, Get() returns the last value of repeated fields.
+  ASSERT_TRUE(decoder.has_f7());
+  EXPECT_EQ(decoder.f7().ToStdString(), "bar");
+  EXPECT_EQ(decoder.Get(5).as_int32(), 12);
+
+  // GetRepeated() iterates in FIFO order.
+  auto it = decoder.f5();
+  ASSERT_TRUE(it);
+  EXPECT_EQ(*it, 10);
+  EXPECT_EQ(it->id(), 5u);
+  ASSERT_TRUE(++it);
+  EXPECT_EQ(*it, 11);
+  ASSERT_TRUE(++it);
+  EXPECT_EQ(*it, 12);
+  ASSERT_FALSE(++it);
+
+  auto it7 = decoder.GetRepeated<ConstChars>(7);
+  ASSERT_TRUE(it7);
+  EXPECT_EQ((*it7).ToStdString(), "foo");
+  ASSERT_TRUE(++it7);
+  EXPECT_EQ((*it7).ToStdString(), "bar");
+  ASSERT_FALSE(++it7);
+
+  EXPECT_FALSE(decoder.GetRepeated<int32_t>(2));
+  EXPECT_FALSE(decoder.GetRepeated<int32_t>(1));
+  EXPECT_FALSE(decoder.GetRepeated<int32_t>(900));
+
+  // The moved-to decoder must not point to the moved-from storage.
+  SpecializedTestDecoder moved(std::move(decoder));
+  EXPECT_EQ(moved.f7().ToStdString(), "bar");
+  EXPECT_EQ(*moved.f5(), 10);
+}
+
+TEST(ProtoDecoderTest, SpecializedProtoDecoderEmpty) {
+  SpecializedTestDecoder decoder(nullptr, 0);
+  EXPECT_FALSE(decoder.has_f2());
+  EXPECT_FALSE(decoder.has_f7());
+  EXPECT_FALSE(decoder.f5());
+}
+
 }  // namespace
 }  // namespace protozero
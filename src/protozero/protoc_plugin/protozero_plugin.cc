@@ -19,6 +19,7 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <vector>
 
 #include <google/protobuf/compiler/code_generator.h>
 #include <google/protobuf/compiler/plugin.h>
@@ -52,6 +53,16 @@ using perfetto::base::Uppercase;
 // Not worth an extra dependency.
 constexpr int kMaxDecoderFieldId = 999;
 
+// Messages decoded often enough (e.g. once per trace packet or per ftrace
+// event) to be worth a specialized decoder, see GenerateSpecializedDecoder().
+const char* const kSpecializedDecoderMessages[] = {
+    "perfetto.protos.FtraceEvent",
+    "perfetto.protos.FtraceEventBundle",
+    "perfetto.protos.SchedSwitchFtraceEvent",
+    "perfetto.protos.TracePacket",
+    "perfetto.protos.TrackEvent",
+};
+
 void Assert(bool condition) {
   if (!condition)
     __builtin_trap();
@@ -571,6 +582,65 @@ class GeneratorJob {
     }
   }
 
+  // Returns the Field accessor and the C++ type used by the decoders to return
+  // the value of |field|. Returns false if the field type is not supported.
+  bool GetDecoderGetterAndCppType(const FieldDescriptor* field,
+                                  std::string* getter,
+                                  std::string* cpp_type) {
+    switch (field->type()) {
+      case FieldDescriptor::TYPE_BOOL:
+        *getter = "as_bool";
+        *cpp_type = "bool";
+        break;
+      case FieldDescriptor::TYPE_SFIXED32:
+      case FieldDescriptor::TYPE_SINT32:
+      case FieldDescriptor::TYPE_INT32:
+        *getter = "as_int32";
+        *cpp_type = "int32_t";
+        break;
+      case FieldDescriptor::TYPE_SFIXED64:
+      case FieldDescriptor::TYPE_SINT64:
+      case FieldDescriptor::TYPE_INT64:
+        *getter = "as_int64";
+        *cpp_type = "int64_t";
+        break;
+      case FieldDescriptor::TYPE_FIXED32:
+      case FieldDescriptor::TYPE_UINT32:
+        *getter = "as_uint32";
+        *cpp_type = "uint32_t";
+        break;
+      case FieldDescriptor::TYPE_FIXED64:
+      case FieldDescriptor::TYPE_UINT64:
+        *getter = "as_uint64";
+        *cpp_type = "uint64_t";
+        break;
+      case FieldDescriptor::TYPE_FLOAT:
+        *getter = "as_float";
+        *cpp_type = "float";
+        break;
+      case FieldDescriptor::TYPE_DOUBLE:
+        *getter = "as_double";
+        *cpp_type = "double";
+        break;
+      case FieldDescriptor::TYPE_ENUM:
+        *getter = "as_int32";
+        *cpp_type = "int32_t";
+        break;
+      case FieldDescriptor::TYPE_STRING:
+        *getter = "as_string";
+        *cpp_type = "::protozero::ConstChars";
+        break;
+      case FieldDescriptor::TYPE_MESSAGE:
+      case FieldDescriptor::TYPE_BYTES:
+        *getter = "as_bytes";
+        *cpp_type = "::protozero::ConstBytes";
+        break;
+      case FieldDescriptor::TYPE_GROUP:
+        return false;
+    }
+    return true;
+  }
+
   void GenerateDecoder(const Descriptor* message) {
     int max_field_id = 0;
     bool has_nonpacked_repeated_fields = false;
@@ -615,57 +685,8 @@ class GeneratorJob {
       }
       std::string getter;
       std::string cpp_type;
-      switch (field->type()) {
-        case FieldDescriptor::TYPE_BOOL:
-          getter = "as_bool";
-          cpp_type = "bool";
-          break;
-        case FieldDescriptor::TYPE_SFIXED32:
-        case FieldDescriptor::TYPE_SINT32:
-        case FieldDescriptor::TYPE_INT32:
-          getter = "as_int32";
-          cpp_type = "int32_t";
-          break;
-        case FieldDescriptor::TYPE_SFIXED64:
-        case FieldDescriptor::TYPE_SINT64:
-        case FieldDescriptor::TYPE_INT64:
-          getter = "as_int64";
-          cpp_type = "int64_t";
-          break;
-        case FieldDescriptor::TYPE_FIXED32:
-        case FieldDescriptor::TYPE_UINT32:
-          getter = "as_uint32";
-          cpp_type = "uint32_t";
-          break;
-        case FieldDescriptor::TYPE_FIXED64:
-        case FieldDescriptor::TYPE_UINT64:
-          getter = "as_uint64";
-          cpp_type = "uint64_t";
-          break;
-        case FieldDescriptor::TYPE_FLOAT:
-          getter = "as_float";
-          cpp_type = "float";
-          break;
-        case FieldDescriptor::TYPE_DOUBLE:
-          getter = "as_double";
-          cpp_type = "double";
-          break;
-        case FieldDescriptor::TYPE_ENUM:
-          getter = "as_int32";
-          cpp_type = "int32_t";
-          break;
-        case FieldDescriptor::TYPE_STRING:
-          getter = "as_string";
-          cpp_type = "::protozero::ConstChars";
-          break;
-        case FieldDescriptor::TYPE_MESSAGE:
-        case FieldDescriptor::TYPE_BYTES:
-          getter = "as_bytes";
-          cpp_type = "::protozero::ConstBytes";
-          break;
-        case FieldDescriptor::TYPE_GROUP:
-          continue;
-      }
+      if (!GetDecoderGetterAndCppType(field, &getter, &cpp_type))
+        continue;
 
       stub_h_->Print("bool has_$name$() const { return at<$id$>().valid(); }\n",
                      "name", field->lowercase_name(), "id",
@@ -700,6 +721,138 @@ class GeneratorJob {
     stub_h_->Print("};\n\n");
   }
 
+  bool IsSpecializedDecoderMessage(const Descriptor* message) {
+    for (const char* name : kSpecializedDecoderMessages) {
+      if (message->full_name() == name)
+        return true;
+    }
+    return false;
+  }
+
+  // Generates a decoder based on SpecializedProtoDecoder, which only stores the
+  // fields declared in the message rather than one entry per possible id. The
+  // public interface is the same as the TypedProtoDecoder-based decoders,
+  // except that non-packed repeated fields are returned as a
+  // ScanningRepeatedFieldIterator.
+  void GenerateSpecializedDecoder(const Descriptor* message) {
+    // Fields are stored starting from slot 1, slot 0 is for unknown ids.
+    std::vector<const FieldDescriptor*> fields;
+    std::vector<const FieldDescriptor*> omitted_fields;
+    std::map<int, size_t> slots;
+    int max_field_id = 0;
+    for (int i = 0; i < message->field_count(); ++i) {
+      const FieldDescriptor* field = message->field(i);
+      if (field->type() == FieldDescriptor::TYPE_GROUP)
+        continue;
+      if (field->number() > kMaxDecoderFieldId) {
+        omitted_fields.push_back(field);
+        continue;
+      }
+      fields.push_back(field);
+      slots[field->number()] = fields.size();
+      max_field_id = std::max(max_field_id, field->number());
+    }
+
+    std::string class_name = GetCppClassName(message) + "_Decoder";
+    std::map<std::string, std::string> vars;
+    vars["name"] = class_name;
+    vars["num"] = std::to_string(fields.size());
+    vars["max"] = std::to_string(max_field_id);
+    stub_h_->Print(vars,
+                   "class $name$ : public "
+                   "::protozero::SpecializedProtoDecoder</*NUM_FIELDS=*/$num$> "
+                   "{\n");
+    stub_h_->Print(" public:\n");
+    stub_h_->Indent();
+    stub_h_->Print(vars,
+                   "$name$(const uint8_t* data, size_t len) "
+                   ": SpecializedProtoDecoder(FieldSlots(), "
+                   "/*max_field_id=*/$max$, data, len) {}\n");
+    stub_h_->Print(vars,
+                   "explicit $name$(const std::string& raw) : "
+                   "SpecializedProtoDecoder(FieldSlots(), "
+                   "/*max_field_id=*/$max$, "
+                   "reinterpret_cast<const uint8_t*>(raw.data()), "
+                   "raw.size()) {}\n");
+    stub_h_->Print(vars,
+                   "explicit $name$(const ::protozero::ConstBytes& raw) : "
+                   "SpecializedProtoDecoder(FieldSlots(), "
+                   "/*max_field_id=*/$max$, raw.data, raw.size) {}\n");
+    stub_h_->Print(vars,
+                   "template <uint32_t FIELD_ID>\n"
+                   "const ::protozero::Field& at() const {\n"
+                   "  static_assert(FIELD_ID <= $max$, \"FIELD_ID > "
+                   "MAX_FIELD_ID\");\n"
+                   "  return Get(FIELD_ID);\n"
+                   "}\n");
+
+    for (const FieldDescriptor* field : omitted_fields) {
+      stub_h_->Print("// field $name$ omitted because its id is too high\n",
+                     "name", field->name());
+    }
+    for (size_t i = 0; i < fields.size(); ++i) {
+      const FieldDescriptor* field = fields[i];
+      std::string getter;
+      std::string cpp_type;
+      GetDecoderGetterAndCppType(field, &getter, &cpp_type);
+      std::map<std::string, std::string> field_vars;
+      field_vars["name"] = field->lowercase_name();
+      field_vars["id"] = std::to_string(field->number());
+      field_vars["slot"] = std::to_string(i + 1);
+      field_vars["getter"] = getter;
+      field_vars["cpp_type"] = cpp_type;
+
+      stub_h_->Print(field_vars,
+                     "bool has_$name$() const { return "
+                     "at_slot<$slot$>().valid(); }\n");
+      if (field->is_packed()) {
+        field_vars["wire_type"] = FieldTypeToProtozeroWireType(field->type());
+        stub_h_->Print(
+            field_vars,
+            "::protozero::PackedRepeatedFieldIterator<$wire_type$, $cpp_type$> "
+            "$name$(bool* parse_error_ptr) const { return "
+            "GetPackedRepeated<$wire_type$, $cpp_type$>($id$, "
+            "parse_error_ptr); }\n");
+      } else if (field->is_repeated()) {
+        stub_h_->Print(
+            field_vars,
+            "::protozero::ScanningRepeatedFieldIterator<$cpp_type$> $name$() "
+            "const { return GetRepeated<$cpp_type$>($id$); }\n");
+      } else {
+        stub_h_->Print(field_vars,
+                       "$cpp_type$ $name$() const { return "
+                       "at_slot<$slot$>().$getter$(); }\n");
+      }
+    }
+
+    // Maps field ids to their slot, see SpecializedProtoDecoderBase.
+    stub_h_->Outdent();
+    stub_h_->Print("\n private:\n");
+    stub_h_->Indent();
+    stub_h_->Print("static const uint16_t* FieldSlots() {\n");
+    stub_h_->Indent();
+    stub_h_->Print("static const uint16_t kFieldSlots[] = {\n");
+    stub_h_->Indent();
+    std::string line;
+    for (int id = 0; id <= max_field_id; ++id) {
+      auto it = slots.find(id);
+      line += std::to_string(it == slots.end() ? 0 : it->second) + ",";
+      if (id == max_field_id || id % 16 == 15) {
+        stub_h_->Print("$line$\n", "line", line);
+        line.clear();
+      } else {
+        line += " ";
+      }
+    }
+    stub_h_->Outdent();
+    stub_h_->Print("};\n");
+    stub_h_->Print("return kFieldSlots;\n");
+    stub_h_->Outdent();
+    stub_h_->Print("}\n");
+    stub_h_->Outdent();
+    stub_h_->Print("};\n\n");
+  }
+
   void GenerateConstantsForMessageFields(const Descriptor* message) {
     const bool has_fields = (message->field_count() > 0);
 
@@ -720,7 +873,11 @@ class GeneratorJob {
   }
 
   void GenerateMessageDescriptor(const Descriptor* message) {
-    GenerateDecoder(message);
+    if (IsSpecializedDecoderMessage(message)) {
+      GenerateSpecializedDecoder(message);
+    } else {
+      GenerateDecoder(message);
+    }
 
     stub_h_->Print(
         "class $name$ : public ::protozero::Message {\n"
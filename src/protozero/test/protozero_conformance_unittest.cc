@@ -21,6 +21,7 @@
 #include "perfetto/protozero/message_handle.h"
 #include "perfetto/protozero/packed_repeated_fields.h"
 #include "perfetto/protozero/scattered_heap_buffer.h"
+#include "perfetto/protozero/static_buffer.h"
 #include "test/gtest_and_gmock.h"
 
 // Autogenerated headers in out/*/gen/
@@ -116,6 +117,58 @@ TEST(ProtoZeroConformanceTest, NestedMessages) {
   EXPECT_EQ(1000, gold_msg_a.super_nested().value_c());
 }
 
+void BuildNestedA(pbtest::NestedA* msg_a) {
+  pbtest::NestedA::NestedB* msg_b = msg_a->add_repeated_a();
+  pbtest::NestedA::NestedB::NestedC* msg_c = msg_b->set_value_b();
+  msg_c->set_value_c(321);
+  msg_b = msg_a->add_repeated_a();
+  msg_c = msg_a->set_super_nested();
+  msg_c->set_value_c(1000);
+}
+
+void CheckNestedA(const std::string& serialized) {
+  pbgold::NestedA gold_msg_a;
+  ASSERT_TRUE(gold_msg_a.ParseFromString(serialized));
+  EXPECT_EQ(2, gold_msg_a.repeated_a_size());
+  EXPECT_EQ(321, gold_msg_a.repeated_a(0).value_b().value_c());
+  EXPECT_FALSE(gold_msg_a.repeated_a(1).has_value_b());
+  EXPECT_EQ(1000, gold_msg_a.super_nested().value_c());
+}
+
+TEST(ProtoZeroConformanceTest, CompactNestedMessagesStaticBuffer) {
+  uint8_t buf[64];
+  StaticBuffered<pbtest::NestedA> msg_a(buf, sizeof(buf));
+  msg_a.set_compact_nested_messages(true);
+  BuildNestedA(msg_a.get());
+  size_t size = msg_a.Finalize();
+
+  // Same as NestedMessages above, minus 3 bytes for each of the 4 nested
+  // messages.
+  EXPECT_EQ(size, 14u);
+  CheckNestedA(std::string(reinterpret_cast<const char*>(buf), size));
+}
+
+TEST(ProtoZeroConformanceTest, CompactNestedMessagesHeapBuffer) {
+  HeapBuffered<pbtest::NestedA> msg_a{kChunkSize, kChunkSize};
+  msg_a.set_compact_nested_messages(true);
+  BuildNestedA(msg_a.get());
+  std::string serialized = msg_a.SerializeAsString();
+  EXPECT_EQ(serialized.size(), 14u);
+  CheckNestedA(serialized);
+}
+
+// Nested messages which span several slices can't be compacted and must keep
+// their redundant size field.
+TEST(ProtoZeroConformanceTest, CompactNestedMessagesAcrossSlices) {
+  HeapBuffered<pbtest::NestedA> msg_a{8, 8};
+  msg_a.set_compact_nested_messages(true);
+  BuildNestedA(msg_a.get());
+  std::string serialized = msg_a.SerializeAsString();
+  EXPECT_GT(serialized.size(), 14u);
+  EXPECT_LT(serialized.size(), 26u);
+  CheckNestedA(serialized);
+}
+
 TEST(ProtoZeroConformanceTest, Import) {
   // Test the includes for indirect public import: library.pbzero.h ->
   // library_internals/galaxies.pbzero.h -> upper_import.pbzero.h .
@@ -24,6 +24,7 @@
 
 #include "perfetto/trace_processor/basic_types.h"
 #include "perfetto/trace_processor/status.h"
+#include "src/trace_processor/trace_blob_view.h"
 
 namespace perfetto {
 namespace trace_processor {
@@ -37,8 +38,9 @@ class ChunkedTraceReader {
   // Pushes more data into the trace parser. There is no requirement for the
   // caller to match line/protos boundaries. The parser class has to deal with
   // intermediate buffering lines/protos that span across different chunks.
-  // The buffer size is guaranteed to be > 0.
-  virtual util::Status Parse(std::unique_ptr<uint8_t[]>, size_t) = 0;
+  // The buffer size is guaranteed to be > 0. Implementations can retain
+  // slices of the buffer (rather than copying it) past the end of the call.
+  virtual util::Status Parse(TraceBlobView) = 0;
 };
 
 }  // namespace trace_processor
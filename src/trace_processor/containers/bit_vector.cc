@@ -69,5 +69,18 @@ void BitVector::UpdateSetBits(const BitVector& other) {
   PERFETTO_DCHECK(GetNumBitsSet() == other.GetNumBitsSet());
 }
 
+void BitVector::And(const BitVector& other) {
+  uint32_t other_blocks = static_cast<uint32_t>(other.blocks_.size());
+  for (uint32_t i = 0; i < blocks_.size(); ++i) {
+    for (uint32_t j = 0; j < Block::kWords; ++j) {
+      uint64_t other_word =
+          i < other_blocks ? other.blocks_[i].word(j).GetWord() : 0;
+      BitWord* word = blocks_[i].mutable_word(j);
+      word->SetWord(word->GetWord() & other_word);
+    }
+  }
+  UpdateCounts();
+}
+
 }  // namespace trace_processor
 }  // namespace perfetto
@@ -45,6 +45,8 @@ class BitVector {
   using AllBitsIterator = internal::AllBitsIterator;
   using SetBitsIterator = internal::SetBitsIterator;
 
+  class Builder;
+
   // Creates an empty bitvector.
   BitVector();
 
@@ -74,6 +76,13 @@ class BitVector {
   // Returns the number of set bits in the bitvector.
   uint32_t GetNumBitsSet() const { return GetNumBitsSet(size()); }
 
+  // Returns the approximate number of bytes of heap memory used by this
+  // BitVector.
+  size_t GetMemoryUsage() const {
+    return blocks_.capacity() * sizeof(Block) +
+           counts_.capacity() * sizeof(uint32_t);
+  }
+
   // Returns the number of set bits between the start of the bitvector
   // (inclusive) and the index |end| (exclusive).
   uint32_t GetNumBitsSet(uint32_t end) const {
@@ -280,6 +289,16 @@ class BitVector {
   // TODO(lalitm): investigate whether we should just change this to And.
   void UpdateSetBits(const BitVector& other);
 
+  // Clears every bit of this bitvector which is not also set in |other|. Bits
+  // past the end of |other| are treated as not set.
+  //
+  // For example suppose the following:
+  // this:  1 1 0 1 1 0 1
+  // other: 0 1 1 1 0
+  // This will change this to the following:
+  // this:  0 1 0 1 0 0 0
+  void And(const BitVector& other);
+
   // Iterate all the bits in the BitVector.
   //
   // Usage:
@@ -347,6 +366,12 @@ class BitVector {
     // Clears all the bits (i.e. sets the atom to zero).
     void ClearAll() { word = 0; }
 
+    // Returns all the bits of the atom.
+    uint64_t GetWord() const { return word; }
+
+    // Replaces all the bits of the atom with the bits of |value|.
+    void SetWord(uint64_t value) { word = value; }
+
     // Returns the index of the nth set bit.
     // Undefined if |n| >= |GetNumBitsSet()|.
     uint16_t IndexOfNthSet(uint32_t n) const {
@@ -533,6 +558,15 @@ class BitVector {
       PERFETTO_FATAL("Index out of bounds");
     }
 
+    // Gets the number of set bits within the whole block.
+    uint32_t GetNumBitsSet() const {
+      uint32_t count = 0;
+      for (uint32_t i = 0; i < kWords; ++i) {
+        count += words_[i].GetNumBitsSet();
+      }
+      return count;
+    }
+
     // Gets the number of set bits within a block up to and including the bit
     // at the given address.
     uint32_t GetNumBitsSet(const BlockOffset& addr) const {
@@ -589,6 +623,16 @@ class BitVector {
       words_[end.word_idx].Set(0, end.bit_idx);
     }
 
+    // Returns the word at the index |word_idx|.
+    const BitWord& word(uint32_t word_idx) const {
+      PERFETTO_DCHECK(word_idx < kWords);
+      return words_[word_idx];
+    }
+    BitWord* mutable_word(uint32_t word_idx) {
+      PERFETTO_DCHECK(word_idx < kWords);
+      return &words_[word_idx];
+    }
+
    private:
     std::array<BitWord, kWords> words_{};
   };
@@ -631,6 +675,16 @@ class BitVector {
     blocks_[end.block_idx].Set(kFirstBlockOffset, end.block_offset);
   }
 
+  // Recomputes the cumulative counts of set bits from the contents of the
+  // blocks.
+  void UpdateCounts() {
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < blocks_.size(); ++i) {
+      counts_[i] = count;
+      count += blocks_[i].GetNumBitsSet();
+    }
+  }
+
   static Address IndexToAddress(uint32_t idx) {
     Address a;
     a.block_idx = idx / Block::kBits;
@@ -652,6 +706,47 @@ class BitVector {
   std::vector<Block> blocks_;
 };
 
+// Builds a BitVector of a known size by setting 64 bits at a time.
+//
+// This is much faster than calling AppendTrue/AppendFalse for every bit when
+// the bits are computed in bulk (e.g. by the filter kernels of db::Column) as
+// the counts of set bits are only computed once, in Build().
+//
+// Usage:
+// BitVector::Builder builder(size);
+// for (uint32_t i = 0; i < size; i += 64)
+//   builder.AppendWord(ComputeBits(i, std::min(i + 64, size)));
+// BitVector bv = builder.Build();
+class BitVector::Builder {
+ public:
+  // Creates a builder for a bitvector of |size| bits, all initially unset.
+  explicit Builder(uint32_t size) : bv_(size, false) {}
+
+  // Sets the next 64 bits of the bitvector to the bits of |word|: the least
+  // significant bit of |word| is the bit with the lowest index. The bits of
+  // the last word past |size| must be zero.
+  void AppendWord(uint64_t word) {
+    PERFETTO_DCHECK(word_idx_ * BitWord::kBits < bv_.size());
+    Block& block = bv_.blocks_[word_idx_ / Block::kWords];
+    block.mutable_word(word_idx_ % Block::kWords)->SetWord(word);
+    word_idx_++;
+  }
+
+  // Skips the next |count| words, leaving all their bits unset.
+  void SkipWords(uint32_t count) { word_idx_ += count; }
+
+  // Returns the built bitvector. The builder should not be used after calling
+  // this method.
+  BitVector Build() {
+    bv_.UpdateCounts();
+    return std::move(bv_);
+  }
+
+ private:
+  BitVector bv_;
+  uint32_t word_idx_ = 0;
+};
+
 }  // namespace trace_processor
 }  // namespace perfetto
 
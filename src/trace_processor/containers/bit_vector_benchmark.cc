@@ -234,3 +234,57 @@ static void BM_BitVectorUpdateSetBits(benchmark::State& state) {
   }
 }
 BENCHMARK(BM_BitVectorUpdateSetBits)->Apply(BitVectorArgs);
+
+static void BM_BitVectorBuilder(benchmark::State& state) {
+  static constexpr uint32_t kRandomSeed = 42;
+  std::minstd_rand0 rnd_engine(kRandomSeed);
+
+  uint32_t size = static_cast<uint32_t>(state.range(0));
+  uint32_t words = (size + 63) / 64;
+
+  std::vector<uint64_t> word_pool(words);
+  for (uint32_t i = 0; i < words; ++i)
+    word_pool[i] = (static_cast<uint64_t>(rnd_engine()) << 32) | rnd_engine();
+  if (size % 64 != 0)
+    word_pool.back() &= (1ull << (size % 64)) - 1;
+
+  for (auto _ : state) {
+    BitVector::Builder builder(size);
+    for (uint64_t word : word_pool)
+      builder.AppendWord(word);
+    benchmark::DoNotOptimize(builder.Build());
+  }
+}
+BENCHMARK(BM_BitVectorBuilder)->Apply(BitVectorArgs);
+
+static void BM_BitVectorAnd(benchmark::State& state) {
+  static constexpr uint32_t kRandomSeed = 42;
+  std::minstd_rand0 rnd_engine(kRandomSeed);
+
+  uint32_t size = static_cast<uint32_t>(state.range(0));
+
+  BitVector bv;
+  BitVector other;
+  for (uint32_t i = 0; i < size; ++i) {
+    if (rnd_engine() % 2) {
+      bv.AppendTrue();
+    } else {
+      bv.AppendFalse();
+    }
+    if (rnd_engine() % 2) {
+      other.AppendTrue();
+    } else {
+      other.AppendFalse();
+    }
+  }
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    BitVector copy = bv.Copy();
+    state.ResumeTiming();
+
+    copy.And(other);
+    benchmark::ClobberMemory();
+  }
+}
+BENCHMARK(BM_BitVectorAnd)->Apply(BitVectorArgs);
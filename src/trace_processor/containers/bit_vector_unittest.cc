@@ -383,6 +383,67 @@ TEST(BitVectorUnittest, IterateSetBitsStartsCorrectly) {
   ASSERT_FALSE(it);
 }
 
+TEST(BitVectorUnittest, Builder) {
+  BitVector::Builder builder(200);
+  builder.AppendWord(0x5);
+  builder.SkipWords(1);
+  builder.AppendWord(~0ull);
+  builder.AppendWord(0x80);
+  BitVector bv = builder.Build();
+
+  ASSERT_EQ(bv.size(), 200u);
+  ASSERT_EQ(bv.GetNumBitsSet(), 67u);
+  ASSERT_TRUE(bv.IsSet(0));
+  ASSERT_FALSE(bv.IsSet(1));
+  ASSERT_TRUE(bv.IsSet(2));
+  ASSERT_FALSE(bv.IsSet(64));
+  ASSERT_TRUE(bv.IsSet(128));
+  ASSERT_TRUE(bv.IsSet(191));
+  ASSERT_TRUE(bv.IsSet(199));
+  ASSERT_EQ(bv.IndexOfNthSet(2), 128u);
+  ASSERT_EQ(bv.IndexOfNthSet(66), 199u);
+}
+
+TEST(BitVectorUnittest, BuilderMultipleBlocks) {
+  static constexpr uint32_t kCount = 2000;
+  BitVector::Builder builder(kCount);
+  for (uint32_t i = 0; i < kCount; i += 64)
+    builder.AppendWord(i < kCount - 64 ? 0x1 : 0x3);
+  BitVector bv = builder.Build();
+
+  ASSERT_EQ(bv.GetNumBitsSet(), 33u);
+  for (uint32_t i = 0; i < 32; ++i)
+    ASSERT_EQ(bv.IndexOfNthSet(i), i * 64);
+  ASSERT_EQ(bv.IndexOfNthSet(32), 1985u);
+}
+
+TEST(BitVectorUnittest, And) {
+  BitVector bv{true, true, false, true, true, false, true};
+  bv.And(BitVector{false, true, true, true, false});
+
+  ASSERT_EQ(bv.size(), 7u);
+  ASSERT_EQ(bv.GetNumBitsSet(), 2u);
+  ASSERT_EQ(bv.IndexOfNthSet(0), 1u);
+  ASSERT_EQ(bv.IndexOfNthSet(1), 3u);
+}
+
+TEST(BitVectorUnittest, AndMultipleBlocks) {
+  BitVector bv(2000, true);
+  BitVector other(1500, false);
+  other.Set(10);
+  other.Set(1000);
+  bv.And(other);
+
+  ASSERT_EQ(bv.size(), 2000u);
+  ASSERT_EQ(bv.GetNumBitsSet(), 2u);
+  ASSERT_EQ(bv.IndexOfNthSet(0), 10u);
+  ASSERT_EQ(bv.IndexOfNthSet(1), 1000u);
+
+  bv.AppendTrue();
+  ASSERT_EQ(bv.GetNumBitsSet(), 3u);
+  ASSERT_EQ(bv.IndexOfNthSet(2), 2000u);
+}
+
 TEST(BitVectorUnittest, QueryStressTest) {
   BitVector bv;
   std::vector<bool> bool_vec;
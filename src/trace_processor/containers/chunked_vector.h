@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_CONTAINERS_CHUNKED_VECTOR_H_
+#define SRC_TRACE_PROCESSOR_CONTAINERS_CHUNKED_VECTOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "perfetto/base/logging.h"
+
+namespace perfetto {
+namespace trace_processor {
+namespace chunked_vector_internal {
+
+constexpr uint32_t Log2Floor(size_t n) {
+  return n <= 1 ? 0 : 1 + Log2Floor(n / 2);
+}
+
+}  // namespace chunked_vector_internal
+
+// An append-mostly container used as the backing storage of columns.
+//
+// Elements are stored in fixed-size chunks of contiguous memory. The number of
+// elements in each chunk is a power of two, chosen so that a chunk takes
+// roughly kTargetChunkBytes, which makes indexing a shift and a mask.
+// Compared to std::deque (whose blocks are 512 bytes in libc++ and libstdc++)
+// this has a much lower per-block overhead, better locality on scans and gives
+// access to contiguous spans of elements (see chunk_data()) for tight loops
+// over the data.
+//
+// To keep small vectors (e.g. the columns of small tables) small, the first
+// chunk starts with room for a few elements and grows geometrically up to
+// kChunkSize: until it is full, emplace_back() and resize() can invalidate
+// references to its elements. All the other chunks are allocated with their
+// full size and never reallocated so, once the vector holds kChunkSize
+// elements, references to elements are never invalidated, like in std::deque.
+template <typename T>
+class ChunkedVector {
+ public:
+  // Size of a chunk, in bytes, the element count per chunk is derived from.
+  static constexpr size_t kTargetChunkBytes = 64 * 1024;
+
+  // Number of elements in each chunk (a power of two).
+  static constexpr uint32_t kChunkShift =
+      chunked_vector_internal::Log2Floor(kTargetChunkBytes / sizeof(T));
+  static constexpr size_t kChunkSize = static_cast<size_t>(1) << kChunkShift;
+  static constexpr size_t kChunkMask = kChunkSize - 1;
+
+  // Number of elements the first chunk initially has room for.
+  static constexpr size_t kMinChunkSize = kChunkSize < 16 ? kChunkSize : 16;
+
+  template <typename Vector, typename Value>
+  class IteratorT {
+   public:
+    using difference_type = ptrdiff_t;
+    using value_type = T;
+    using pointer = Value*;
+    using reference = Value&;
+    using iterator_category = std::random_access_iterator_tag;
+
+    IteratorT() = default;
+    IteratorT(Vector* vector, size_t pos) : vector_(vector), pos_(pos) {}
+
+    reference operator*() const { return (*vector_)[pos_]; }
+    pointer operator->() const { return &(*vector_)[pos_]; }
+    reference operator[](difference_type i) const { return *(*this + i); }
+
+    IteratorT& operator++() {
+      pos_++;
+      return *this;
+    }
+    IteratorT operator++(int) {
+      IteratorT ret = *this;
+      pos_++;
+      return ret;
+    }
+    IteratorT& operator--() {
+      pos_--;
+      return *this;
+    }
+    IteratorT operator--(int) {
+      IteratorT ret = *this;
+      pos_--;
+      return ret;
+    }
+    IteratorT& operator+=(difference_type offset) {
+      pos_ = static_cast<size_t>(static_cast<difference_type>(pos_) + offset);
+      return *this;
+    }
+    IteratorT& operator-=(difference_type offset) { return *this += -offset; }
+
+    friend IteratorT operator+(IteratorT it, difference_type offset) {
+      return it += offset;
+    }
+    friend IteratorT operator+(difference_type offset, IteratorT it) {
+      return it += offset;
+    }
+    friend IteratorT operator-(IteratorT it, difference_type offset) {
+      return it -= offset;
+    }
+    friend difference_type operator-(const IteratorT& a, const IteratorT& b) {
+      return static_cast<difference_type>(a.pos_) -
+             static_cast<difference_type>(b.pos_);
+    }
+
+    friend bool operator==(const IteratorT& a, const IteratorT& b) {
+      return a.pos_ == b.pos_;
+    }
+    friend bool operator!=(const IteratorT& a, const IteratorT& b) {
+      return a.pos_ != b.pos_;
+    }
+    friend bool operator<(const IteratorT& a, const IteratorT& b) {
+      return a.pos_ < b.pos_;
+    }
+    friend bool operator>(const IteratorT& a, const IteratorT& b) {
+      return a.pos_ > b.pos_;
+    }
+    friend bool operator<=(const IteratorT& a, const IteratorT& b) {
+      return a.pos_ <= b.pos_;
+    }
+    friend bool operator>=(const IteratorT& a, const IteratorT& b) {
+      return a.pos_ >= b.pos_;
+    }
+
+    size_t pos() const { return pos_; }
+
+   private:
+    Vector* vector_ = nullptr;
+    size_t pos_ = 0;
+  };
+
+  using value_type = T;
+  using iterator = IteratorT<ChunkedVector, T>;
+  using const_iterator = IteratorT<const ChunkedVector, const T>;
+
+  ChunkedVector() = default;
+  ~ChunkedVector() = default;
+
+  ChunkedVector(ChunkedVector&&) noexcept = default;
+  ChunkedVector& operator=(ChunkedVector&&) = default;
+
+  template <typename... Args>
+  T& emplace_back(Args&&... args) {
+    if (PERFETTO_UNLIKELY((size_ & kChunkMask) == 0))
+      AddChunk();
+    std::vector<T>& chunk = chunks_.back();
+    if (PERFETTO_UNLIKELY(chunk.size() == chunk.capacity()))
+      GrowFirstChunk();
+    chunk.emplace_back(std::forward<Args>(args)...);
+    size_++;
+    return chunk.back();
+  }
+
+  void push_back(T value) { emplace_back(std::move(value)); }
+
+  // Grows (default constructing the new elements) or shrinks the vector to
+  // |size| elements. Chunks which become empty are freed.
+  void resize(size_t size) {
+    while (size_ < size)
+      emplace_back();
+    while (size_ > size) {
+      chunks_.back().pop_back();
+      if (chunks_.back().empty())
+        chunks_.pop_back();
+      size_--;
+    }
+  }
+
+  void clear() {
+    chunks_.clear();
+    size_ = 0;
+  }
+
+  // Inserts |value| before |pos|. This is O(size() - pos) as all the
+  // following elements are shifted by one: prefer emplace_back() whenever
+  // possible.
+  iterator insert(const_iterator pos, T value) {
+    size_t idx = pos.pos();
+    PERFETTO_DCHECK(idx <= size_);
+    emplace_back(std::move(value));
+    for (size_t i = size_ - 1; i > idx; i--)
+      std::swap((*this)[i], (*this)[i - 1]);
+    return iterator(this, idx);
+  }
+  iterator insert(iterator pos, T value) {
+    return insert(const_iterator(this, pos.pos()), std::move(value));
+  }
+
+  T& operator[](size_t idx) {
+    PERFETTO_DCHECK(idx < size_);
+    return chunks_[idx >> kChunkShift][idx & kChunkMask];
+  }
+
+  const T& operator[](size_t idx) const {
+    PERFETTO_DCHECK(idx < size_);
+    return chunks_[idx >> kChunkShift][idx & kChunkMask];
+  }
+
+  T& front() { return (*this)[0]; }
+  const T& front() const { return (*this)[0]; }
+  T& back() { return chunks_.back().back(); }
+  const T& back() const { return chunks_.back().back(); }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  iterator begin() { return iterator(this, 0); }
+  iterator end() { return iterator(this, size_); }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, size_); }
+
+  // Returns the number of chunks. All the chunks but the last one hold
+  // exactly kChunkSize elements.
+  size_t chunk_count() const { return chunks_.size(); }
+
+  // Returns a pointer to the |chunk_size(chunk)| contiguous elements of the
+  // given chunk, which are the elements
+  // [chunk * kChunkSize, chunk * kChunkSize + chunk_size(chunk)).
+  const T* chunk_data(size_t chunk) const { return chunks_[chunk].data(); }
+  T* chunk_data(size_t chunk) { return chunks_[chunk].data(); }
+  size_t chunk_size(size_t chunk) const { return chunks_[chunk].size(); }
+
+ private:
+  ChunkedVector(const ChunkedVector&) = delete;
+  ChunkedVector& operator=(const ChunkedVector&) = delete;
+
+  void AddChunk() {
+    chunks_.emplace_back();
+    // Reserving the whole chunk upfront guarantees that the chunk is never
+    // reallocated and, hence, that references to elements stay valid. Only
+    // the first chunk is grown on demand (see GrowFirstChunk()).
+    chunks_.back().reserve(chunks_.size() == 1 ? kMinChunkSize : kChunkSize);
+  }
+
+  // Called when the last chunk is full but holds fewer than kChunkSize
+  // elements, which can only happen for the first chunk.
+  void GrowFirstChunk() {
+    std::vector<T>& chunk = chunks_.back();
+    PERFETTO_DCHECK(chunks_.size() == 1 && chunk.size() < kChunkSize);
+    chunk.reserve(std::min(kChunkSize, 2 * chunk.capacity()));
+  }
+
+  std::vector<std::vector<T>> chunks_;
+  size_t size_ = 0;
+};
+
+template <typename T>
+constexpr size_t ChunkedVector<T>::kChunkSize;
+template <typename T>
+constexpr size_t ChunkedVector<T>::kMinChunkSize;
+
+}  // namespace trace_processor
+}  // namespace perfetto
+
+#endif  // SRC_TRACE_PROCESSOR_CONTAINERS_CHUNKED_VECTOR_H_
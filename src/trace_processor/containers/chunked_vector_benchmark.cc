@@ -0,0 +1,123 @@
+// Copyright (C) 2020 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <deque>
+#include <random>
+
+#include <benchmark/benchmark.h>
+
+#include "src/trace_processor/containers/chunked_vector.h"
+
+namespace {
+
+static constexpr uint32_t kSize = 1024 * 1024;
+
+template <typename Container>
+void FillContainer(Container* container) {
+  static constexpr uint32_t kRandomSeed = 42;
+  std::minstd_rand0 rnd_engine(kRandomSeed);
+  for (uint32_t i = 0; i < kSize; i++)
+    container->emplace_back(static_cast<int64_t>(rnd_engine()));
+}
+
+template <typename Container>
+void BM_Append(benchmark::State& state) {
+  for (auto _ : state) {
+    Container container;
+    for (uint32_t i = 0; i < kSize; i++)
+      container.emplace_back(static_cast<int64_t>(i));
+    benchmark::DoNotOptimize(container);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * kSize);
+}
+
+template <typename Container>
+void BM_IndexedScan(benchmark::State& state) {
+  Container container;
+  FillContainer(&container);
+
+  for (auto _ : state) {
+    int64_t sum = 0;
+    for (uint32_t i = 0; i < kSize; i++)
+      sum += container[i];
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * kSize);
+}
+
+template <typename Container>
+void BM_IteratorScan(benchmark::State& state) {
+  Container container;
+  FillContainer(&container);
+
+  for (auto _ : state) {
+    int64_t sum = 0;
+    for (int64_t value : container)
+      sum += value;
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * kSize);
+}
+
+}  // namespace
+
+using perfetto::trace_processor::ChunkedVector;
+
+static void BM_ChunkedVectorAppend(benchmark::State& state) {
+  BM_Append<ChunkedVector<int64_t>>(state);
+}
+BENCHMARK(BM_ChunkedVectorAppend);
+
+static void BM_DequeAppend(benchmark::State& state) {
+  BM_Append<std::deque<int64_t>>(state);
+}
+BENCHMARK(BM_DequeAppend);
+
+static void BM_ChunkedVectorIndexedScan(benchmark::State& state) {
+  BM_IndexedScan<ChunkedVector<int64_t>>(state);
+}
+BENCHMARK(BM_ChunkedVectorIndexedScan);
+
+static void BM_DequeIndexedScan(benchmark::State& state) {
+  BM_IndexedScan<std::deque<int64_t>>(state);
+}
+BENCHMARK(BM_DequeIndexedScan);
+
+static void BM_ChunkedVectorIteratorScan(benchmark::State& state) {
+  BM_IteratorScan<ChunkedVector<int64_t>>(state);
+}
+BENCHMARK(BM_ChunkedVectorIteratorScan);
+
+static void BM_ChunkedVectorChunkScan(benchmark::State& state) {
+  ChunkedVector<int64_t> container;
+  FillContainer(&container);
+
+  for (auto _ : state) {
+    int64_t sum = 0;
+    for (size_t c = 0; c < container.chunk_count(); c++) {
+      const int64_t* data = container.chunk_data(c);
+      size_t size = container.chunk_size(c);
+      for (size_t i = 0; i < size; i++)
+        sum += data[i];
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * kSize);
+}
+BENCHMARK(BM_ChunkedVectorChunkScan);
+
+static void BM_DequeIteratorScan(benchmark::State& state) {
+  BM_IteratorScan<std::deque<int64_t>>(state);
+}
+BENCHMARK(BM_DequeIteratorScan);
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/containers/chunked_vector.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto {
+namespace trace_processor {
+namespace {
+
+using CV = ChunkedVector<int64_t>;
+
+// Enough elements to span a few chunks.
+const size_t kNumElements = 3 * CV::kChunkSize + 123;
+
+TEST(ChunkedVector, EmplaceBackAndIndex) {
+  CV cv;
+  ASSERT_TRUE(cv.empty());
+  for (size_t i = 0; i < kNumElements; i++)
+    cv.emplace_back(static_cast<int64_t>(i * 2));
+
+  ASSERT_EQ(cv.size(), kNumElements);
+  ASSERT_EQ(cv.chunk_count(), 4u);
+  ASSERT_EQ(cv.front(), 0);
+  ASSERT_EQ(cv.back(), static_cast<int64_t>((kNumElements - 1) * 2));
+  for (size_t i = 0; i < kNumElements; i++)
+    ASSERT_EQ(cv[i], static_cast<int64_t>(i * 2));
+}
+
+TEST(ChunkedVector, ReferencesStable) {
+  // References are stable once the first chunk is full.
+  CV cv;
+  cv.resize(CV::kChunkSize);
+  cv[0] = 42;
+  const int64_t* first = &cv[0];
+  cv.emplace_back(43);
+  const int64_t* second_chunk = &cv.back();
+  for (size_t i = CV::kChunkSize + 1; i < kNumElements; i++)
+    cv.emplace_back(0);
+  ASSERT_EQ(first, &cv[0]);
+  ASSERT_EQ(*first, 42);
+  ASSERT_EQ(second_chunk, &cv[CV::kChunkSize]);
+  ASSERT_EQ(*second_chunk, 43);
+}
+
+TEST(ChunkedVector, FirstChunkGrows) {
+  CV cv;
+  for (size_t i = 0; i < CV::kChunkSize + 1; i++) {
+    cv.emplace_back(static_cast<int64_t>(i));
+    ASSERT_EQ(cv.chunk_count(), i / CV::kChunkSize + 1);
+  }
+  ASSERT_EQ(cv.chunk_size(0), CV::kChunkSize);
+  for (size_t i = 0; i < cv.size(); i++)
+    ASSERT_EQ(cv[i], static_cast<int64_t>(i));
+}
+
+TEST(ChunkedVector, ChunkData) {
+  CV cv;
+  for (size_t i = 0; i < kNumElements; i++)
+    cv.emplace_back(static_cast<int64_t>(i));
+
+  size_t idx = 0;
+  for (size_t c = 0; c < cv.chunk_count(); c++) {
+    const int64_t* data = cv.chunk_data(c);
+    for (size_t i = 0; i < cv.chunk_size(c); i++, idx++)
+      ASSERT_EQ(data[i], static_cast<int64_t>(idx));
+  }
+  ASSERT_EQ(idx, kNumElements);
+}
+
+TEST(ChunkedVector, Resize) {
+  CV cv;
+  cv.resize(kNumElements);
+  ASSERT_EQ(cv.size(), kNumElements);
+  ASSERT_EQ(cv[kNumElements - 1], 0);
+
+  cv.resize(10);
+  ASSERT_EQ(cv.size(), 10u);
+  ASSERT_EQ(cv.chunk_count(), 1u);
+
+  cv.emplace_back(5);
+  ASSERT_EQ(cv[10], 5);
+
+  cv.resize(0);
+  ASSERT_TRUE(cv.empty());
+  ASSERT_EQ(cv.chunk_count(), 0u);
+}
+
+TEST(ChunkedVector, Insert) {
+  CV cv;
+  for (size_t i = 0; i < kNumElements; i++)
+    cv.emplace_back(static_cast<int64_t>(i));
+
+  cv.insert(cv.begin() + 1, -1);
+  cv.insert(cv.end(), -2);
+
+  ASSERT_EQ(cv.size(), kNumElements + 2);
+  ASSERT_EQ(cv[0], 0);
+  ASSERT_EQ(cv[1], -1);
+  ASSERT_EQ(cv[2], 1);
+  ASSERT_EQ(cv[kNumElements], static_cast<int64_t>(kNumElements - 1));
+  ASSERT_EQ(cv[kNumElements + 1], -2);
+}
+
+TEST(ChunkedVector, Iterators) {
+  CV cv;
+  for (size_t i = 0; i < kNumElements; i++)
+    cv.emplace_back(static_cast<int64_t>(i * 3));
+
+  ASSERT_EQ(static_cast<size_t>(cv.end() - cv.begin()), kNumElements);
+
+  const CV& const_cv = cv;
+  auto it = std::lower_bound(const_cv.begin(), const_cv.end(), 3000);
+  ASSERT_EQ(it.pos(), 1000u);
+  it = std::upper_bound(const_cv.begin(), const_cv.end(), 3000);
+  ASSERT_EQ(it.pos(), 1001u);
+
+  std::vector<int64_t> copy(cv.begin(), cv.end());
+  ASSERT_EQ(copy.size(), kNumElements);
+  ASSERT_EQ(copy.back(), cv.back());
+
+  for (auto& value : cv)
+    value++;
+  ASSERT_EQ(cv[10], 31);
+}
+
+}  // namespace
+}  // namespace trace_processor
+}  // namespace perfetto
@@ -0,0 +1,294 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_CONTAINERS_PACKED_VECTOR_H_
+#define SRC_TRACE_PROCESSOR_CONTAINERS_PACKED_VECTOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "perfetto/base/logging.h"
+#include "src/trace_processor/containers/chunked_vector.h"
+
+namespace perfetto {
+namespace trace_processor {
+namespace packed_vector_internal {
+
+// Converts values to and from their 64 bit representation used for packing.
+// Integers are sign or zero extended so that close values have close
+// representations; other types (e.g. StringPool::Id) are copied bitwise.
+template <typename T, bool is_integral = std::is_integral<T>::value>
+struct Bits {
+  static_assert(sizeof(T) <= sizeof(uint64_t), "T is too large to be packed");
+  static_assert(std::is_trivially_copyable<T>::value,
+                "T should be trivially copyable to be packed");
+
+  static uint64_t From(T value) {
+    uint64_t bits = 0;
+    memcpy(&bits, &value, sizeof(T));
+    return bits;
+  }
+  static T To(uint64_t bits) {
+    T value;
+    memcpy(&value, &bits, sizeof(T));
+    return value;
+  }
+};
+
+template <typename T>
+struct Bits<T, true> {
+  using Wide =
+      typename std::conditional<std::is_signed<T>::value, int64_t, uint64_t>::
+          type;
+
+  static uint64_t From(T value) {
+    return static_cast<uint64_t>(static_cast<Wide>(value));
+  }
+  static T To(uint64_t bits) {
+    return static_cast<T>(static_cast<Wide>(bits));
+  }
+};
+
+}  // namespace packed_vector_internal
+
+// An immutable, compressed copy of a ChunkedVector which still allows O(1)
+// random access.
+//
+// Values are split in blocks of kBlockSize values. In each block, value i is
+// stored as the difference between the value and a linear prediction
+// |base + i * step|, bit-packed with the minimal number of bits for the block.
+// This works well for the data found in traces:
+//  * sorted timestamps are close to the line between the first and last
+//    timestamp of the block, so only their jitter is stored.
+//  * low cardinality columns (cpu, depth, track ids...) only need a few bits
+//    per value.
+//  * runs of the same value need zero bits per value.
+//
+// Each block also stores the min and max of its values which allows
+// filtering to skip blocks where all the values (or none) match.
+template <typename T>
+class PackedVector {
+ public:
+  static constexpr uint32_t kBlockShift = 7;
+  static constexpr uint32_t kBlockSize = 1u << kBlockShift;
+
+  struct Block {
+    // Value i of the block is |base + i * step + packed[i]| where packed[i] is
+    // the |width| bits starting at bit |i * width| of the words of the block.
+    // All the arithmetic is done modulo 2^64.
+    uint64_t base;
+    uint64_t step;
+    uint32_t word_offset;
+    uint32_t width;
+
+    T min;
+    T max;
+  };
+
+  PackedVector() = default;
+  explicit PackedVector(const ChunkedVector<T>& data);
+
+  PackedVector(PackedVector&&) noexcept = default;
+  PackedVector& operator=(PackedVector&&) = default;
+
+  T Get(size_t idx) const {
+    PERFETTO_DCHECK(idx < size_);
+    const Block& block = blocks_[idx >> kBlockShift];
+    uint64_t offset = idx & (kBlockSize - 1);
+    uint64_t packed = Unpack(&words_[block.word_offset], offset * block.width,
+                             Mask(block.width));
+    return Bits::To(block.base + offset * block.step + packed);
+  }
+
+  // Writes the |count| values starting at |idx| to |out|. The values should
+  // all be in the same block.
+  void Decode(size_t idx, uint32_t count, T* out) const {
+    PERFETTO_DCHECK(idx + count <= size_);
+    PERFETTO_DCHECK(idx >> kBlockShift == (idx + count - 1) >> kBlockShift);
+    // Copy the fields of the block to locals as they could otherwise alias
+    // |out| and be reloaded after every store.
+    const Block& block = blocks_[idx >> kBlockShift];
+    const uint64_t step = block.step;
+    const uint32_t width = block.width;
+    uint64_t offset = idx & (kBlockSize - 1);
+    uint64_t value = block.base + offset * step;
+    if (width == 0) {
+      for (uint32_t i = 0; i < count; ++i, value += step)
+        out[i] = Bits::To(value);
+      return;
+    }
+    const uint64_t* words = &words_[block.word_offset];
+    const uint64_t mask = Mask(width);
+    const uint64_t bit = offset * width;
+    for (uint32_t i = 0; i < count; ++i) {
+      uint64_t packed = Unpack(words, bit + i * width, mask);
+      out[i] = Bits::To(value + i * step + packed);
+    }
+  }
+
+  // Returns the block containing the value at |idx|.
+  const Block& block_for(size_t idx) const {
+    return blocks_[idx >> kBlockShift];
+  }
+
+  size_t size() const { return size_; }
+
+  // Returns the number of bytes used to store the values.
+  size_t memory_bytes() const {
+    return blocks_.capacity() * sizeof(Block) +
+           words_.capacity() * sizeof(uint64_t);
+  }
+
+ private:
+  using Bits = packed_vector_internal::Bits<T>;
+
+  PackedVector(const PackedVector&) = delete;
+  PackedVector& operator=(const PackedVector&) = delete;
+
+  static uint64_t Mask(uint32_t width) {
+    return width == 64 ? ~0ull : (1ull << width) - 1;
+  }
+
+  // Returns the value stored in the bits [bit, bit + popcount(mask)) of
+  // |words|. This always reads two words, without branching on whether the
+  // value straddles them (or on the width being zero): |words_| has two
+  // padding words at the end to allow this. Shifting the second word in two
+  // steps makes its contribution zero when |bit| is a multiple of 64.
+  static uint64_t Unpack(const uint64_t* words, uint64_t bit, uint64_t mask) {
+    const uint64_t* w = words + (bit >> 6);
+    uint32_t shift = bit & 63;
+    return ((w[0] >> shift) | ((w[1] << 1) << (63 - shift))) & mask;
+  }
+
+  // Returns the values of the block starting at |bits| (of which there are
+  // |count|) minus |base + i * step|, with |base| chosen so that all the
+  // results are as small as possible. Returns the bits needed to store the
+  // largest of them.
+  static uint32_t ComputeResiduals(const uint64_t* bits,
+                                   uint32_t count,
+                                   uint64_t step,
+                                   uint64_t* base,
+                                   uint64_t* residuals);
+
+  std::vector<Block> blocks_;
+  std::vector<uint64_t> words_;
+  size_t size_ = 0;
+};
+
+template <typename T>
+constexpr uint32_t PackedVector<T>::kBlockShift;
+template <typename T>
+constexpr uint32_t PackedVector<T>::kBlockSize;
+
+template <typename T>
+PackedVector<T>::PackedVector(const ChunkedVector<T>& data)
+    : size_(data.size()) {
+  blocks_.reserve((size_ + kBlockSize - 1) / kBlockSize);
+
+  uint64_t bits[kBlockSize];
+  uint64_t residuals[kBlockSize];
+  uint64_t linear_residuals[kBlockSize];
+  for (size_t start = 0; start < size_; start += kBlockSize) {
+    uint32_t count = static_cast<uint32_t>(
+        std::min(static_cast<size_t>(kBlockSize), size_ - start));
+
+    Block block;
+    block.min = data[start];
+    block.max = data[start];
+    for (uint32_t i = 0; i < count; ++i) {
+      T value = data[start + i];
+      block.min = std::min(block.min, value);
+      block.max = std::max(block.max, value);
+      bits[i] = Bits::From(value);
+    }
+
+    // Try both a constant prediction (frame of reference) and a linear one
+    // going through the first and last values and keep the narrowest.
+    block.step = 0;
+    block.width =
+        ComputeResiduals(bits, count, block.step, &block.base, residuals);
+    if (count > 1 && block.width > 0) {
+      int64_t delta = static_cast<int64_t>(bits[count - 1] - bits[0]);
+      uint64_t step = static_cast<uint64_t>(delta / (count - 1));
+      uint64_t base = 0;
+      uint32_t width =
+          ComputeResiduals(bits, count, step, &base, linear_residuals);
+      if (width < block.width) {
+        block.step = step;
+        block.base = base;
+        block.width = width;
+        std::copy(linear_residuals, linear_residuals + count, residuals);
+      }
+    }
+
+    // Pack the residuals: a full block takes exactly 2 * width words.
+    block.word_offset = static_cast<uint32_t>(words_.size());
+    PERFETTO_CHECK(words_.size() + 2 * block.width <=
+                   std::numeric_limits<uint32_t>::max());
+    words_.resize(words_.size() + 2 * block.width, 0);
+    uint64_t* words = words_.data() + block.word_offset;
+    for (uint32_t i = 0; i < count && block.width > 0; ++i) {
+      uint64_t bit = static_cast<uint64_t>(i) * block.width;
+      uint32_t shift = bit & 63;
+      words[bit >> 6] |= residuals[i] << shift;
+      if (shift + block.width > 64)
+        words[(bit >> 6) + 1] |= residuals[i] >> (64 - shift);
+    }
+    blocks_.emplace_back(block);
+  }
+  words_.resize(words_.size() + 2, 0);
+  words_.shrink_to_fit();
+}
+
+// static
+template <typename T>
+uint32_t PackedVector<T>::ComputeResiduals(const uint64_t* bits,
+                                           uint32_t count,
+                                           uint64_t step,
+                                           uint64_t* base,
+                                           uint64_t* residuals) {
+  // The differences with the prediction are compared as signed values to find
+  // the smallest one, which becomes the base. If the values are too far apart
+  // for this to be meaningful, the result is still exact as everything is
+  // computed modulo 2^64: the residuals just need 64 bits.
+  int64_t min_diff = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    residuals[i] = bits[i] - bits[0] - i * step;
+    min_diff = std::min(min_diff, static_cast<int64_t>(residuals[i]));
+  }
+  uint64_t max_residual = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    residuals[i] -= static_cast<uint64_t>(min_diff);
+    max_residual = std::max(max_residual, residuals[i]);
+  }
+  *base = bits[0] + static_cast<uint64_t>(min_diff);
+
+  uint32_t width = 0;
+  while (width < 64 && (max_residual >> width) != 0)
+    width++;
+  return width;
+}
+
+}  // namespace trace_processor
+}  // namespace perfetto
+
+#endif  // SRC_TRACE_PROCESSOR_CONTAINERS_PACKED_VECTOR_H_
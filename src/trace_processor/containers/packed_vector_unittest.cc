@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/containers/packed_vector.h"
+
+#include <limits>
+#include <random>
+
+#include "src/trace_processor/containers/string_pool.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto {
+namespace trace_processor {
+namespace {
+
+// Enough values to span a few blocks, with a partial last block.
+const size_t kNumValues = 3 * PackedVector<int64_t>::kBlockSize + 57;
+
+template <typename T>
+void CheckValues(const ChunkedVector<T>& data, const PackedVector<T>& packed) {
+  ASSERT_EQ(packed.size(), data.size());
+  for (size_t i = 0; i < data.size(); ++i)
+    ASSERT_EQ(packed.Get(i), data[i]) << "index " << i;
+
+  T values[PackedVector<T>::kBlockSize];
+  for (size_t i = 0; i < data.size(); i += PackedVector<T>::kBlockSize) {
+    uint32_t count = static_cast<uint32_t>(std::min(
+        static_cast<size_t>(PackedVector<T>::kBlockSize), data.size() - i));
+    packed.Decode(i, count, values);
+    for (uint32_t j = 0; j < count; ++j)
+      ASSERT_EQ(values[j], data[i + j]) << "index " << i + j;
+
+    const auto& block = packed.block_for(i);
+    for (uint32_t j = 0; j < count; ++j) {
+      ASSERT_FALSE(data[i + j] < block.min);
+      ASSERT_FALSE(block.max < data[i + j]);
+    }
+  }
+}
+
+TEST(PackedVector, Empty) {
+  ChunkedVector<int64_t> data;
+  PackedVector<int64_t> packed(data);
+  ASSERT_EQ(packed.size(), 0u);
+}
+
+TEST(PackedVector, SortedTimestamps) {
+  std::minstd_rand0 rnd_engine(42);
+  ChunkedVector<int64_t> data;
+  int64_t ts = 1234567890123;
+  for (size_t i = 0; i < kNumValues; ++i) {
+    ts += 1000 + static_cast<int64_t>(rnd_engine() % 1000);
+    data.emplace_back(ts);
+  }
+  PackedVector<int64_t> packed(data);
+  CheckValues(data, packed);
+
+  // Only the jitter around the average delta should be stored.
+  ASSERT_LT(packed.memory_bytes() * 3, kNumValues * sizeof(int64_t));
+}
+
+TEST(PackedVector, SmallValues) {
+  ChunkedVector<uint32_t> data;
+  for (size_t i = 0; i < kNumValues; ++i)
+    data.emplace_back(static_cast<uint32_t>(i * 7919 % 8));
+  PackedVector<uint32_t> packed(data);
+  CheckValues(data, packed);
+  ASSERT_LT(packed.memory_bytes() * 4, kNumValues * sizeof(uint32_t));
+}
+
+TEST(PackedVector, Runs) {
+  ChunkedVector<int64_t> data;
+  for (size_t i = 0; i < kNumValues; ++i)
+    data.emplace_back(i < 200 ? -5 : 1ll << 40);
+  PackedVector<int64_t> packed(data);
+  CheckValues(data, packed);
+
+  // Only the block containing both values needs any bits.
+  ASSERT_EQ(packed.block_for(0).width, 0u);
+  ASSERT_GT(packed.block_for(128).width, 0u);
+  ASSERT_EQ(packed.block_for(256).width, 0u);
+  ASSERT_EQ(packed.block_for(kNumValues - 1).width, 0u);
+}
+
+TEST(PackedVector, Extremes) {
+  ChunkedVector<int64_t> data;
+  for (size_t i = 0; i < kNumValues; ++i) {
+    data.emplace_back(i % 2 ? std::numeric_limits<int64_t>::max()
+                            : std::numeric_limits<int64_t>::min());
+  }
+  data.emplace_back(0);
+  data.emplace_back(-1);
+  PackedVector<int64_t> packed(data);
+  CheckValues(data, packed);
+
+  ChunkedVector<int32_t> small_data;
+  for (size_t i = 0; i < kNumValues; ++i) {
+    small_data.emplace_back(i % 3 ? std::numeric_limits<int32_t>::max()
+                                  : -static_cast<int32_t>(i));
+  }
+  PackedVector<int32_t> small_packed(small_data);
+  CheckValues(small_data, small_packed);
+}
+
+TEST(PackedVector, Random) {
+  std::minstd_rand0 rnd_engine(42);
+  ChunkedVector<int64_t> data;
+  for (size_t i = 0; i < kNumValues; ++i) {
+    uint64_t value = static_cast<uint64_t>(rnd_engine()) << 32 | rnd_engine();
+    data.emplace_back(static_cast<int64_t>(value));
+  }
+  PackedVector<int64_t> packed(data);
+  CheckValues(data, packed);
+
+  ChunkedVector<uint32_t> small_data;
+  for (size_t i = 0; i < kNumValues; ++i)
+    small_data.emplace_back(static_cast<uint32_t>(rnd_engine()));
+  PackedVector<uint32_t> small_packed(small_data);
+  CheckValues(small_data, small_packed);
+}
+
+TEST(PackedVector, StringIds) {
+  ChunkedVector<StringPool::Id> data;
+  for (uint32_t i = 0; i < kNumValues; ++i)
+    data.emplace_back(StringPool::Id(i % 5 == 0 ? 0u : 100u + i % 3));
+  PackedVector<StringPool::Id> packed(data);
+  CheckValues(data, packed);
+}
+
+}  // namespace
+}  // namespace trace_processor
+}  // namespace perfetto
@@ -242,6 +242,20 @@ class RowMap {
     PERFETTO_FATAL("For GCC");
   }
 
+  // Returns the approximate number of bytes of heap memory used by this
+  // RowMap.
+  size_t GetMemoryUsage() const {
+    switch (mode_) {
+      case Mode::kRange:
+        return 0;
+      case Mode::kBitVector:
+        return bit_vector_.GetMemoryUsage();
+      case Mode::kIndexVector:
+        return index_vector_.capacity() * sizeof(uint32_t);
+    }
+    PERFETTO_FATAL("For GCC");
+  }
+
   // Returns the row at index |row|.
   uint32_t Get(uint32_t idx) const {
     PERFETTO_DCHECK(idx < size());
@@ -391,6 +405,14 @@ class RowMap {
       return;
     }
 
+    if (mode_ == Mode::kBitVector && other.mode_ == Mode::kBitVector) {
+      // If both RowMaps are BitVectors, we can intersect a whole word of rows
+      // at a time. This is common when multiple constraints are filtered with
+      // the bulk filter kernels of Column.
+      bit_vector_.And(other.bit_vector_);
+      return;
+    }
+
     // TODO(lalitm): improve efficiency of this if we end up needing it.
     RemoveIf([&other](uint32_t row) { return !other.Contains(row); });
   }
@@ -513,7 +535,10 @@ class RowMap {
       case Mode::kRange: {
         // TODO(lalitm): investigate whether we can reuse the data inside
         // out->bit_vector_ at some point.
-        BitVector bv(out->end_idx_, false);
+        // Note: the BitVector needs to cover all the rows of |this| (and not
+        // just up to |out->end_idx_|) as it is later used as a selector on
+        // RowMaps of the same size as |this|.
+        BitVector bv(size(), false);
         for (auto out_it = bv.IterateAllBits(); it; it.Next(), out_it.Next()) {
           uint32_t ordinal = it.ordinal();
           if (ordinal < out->start_idx_)
@@ -289,6 +289,15 @@ TEST(RowMapUnittest, IntersectMany) {
   ASSERT_EQ(rm.Get(2u), 3u);
 }
 
+TEST(RowMapUnittest, IntersectBitVectorWithBitVector) {
+  RowMap rm(BitVector{true, false, true, true, false, true});
+  rm.Intersect(RowMap(BitVector{true, true, false, true}));
+
+  ASSERT_EQ(rm.size(), 2u);
+  ASSERT_EQ(rm.Get(0u), 0u);
+  ASSERT_EQ(rm.Get(1u), 3u);
+}
+
 TEST(RowMapUnittest, FilterIntoEmptyOutput) {
   RowMap rm(0, 10000);
   RowMap filter(4, 4);
@@ -330,6 +339,23 @@ TEST(RowMapUnittest, FilterIntoRangeWithRange) {
   ASSERT_EQ(filter.Get(1u), 5u);
 }
 
+TEST(RowMapUnittest, FilterIntoRangeWithRangeBeforeEnd) {
+  RowMap rm(10, 20);
+  RowMap filter(2, 5);
+  rm.FilterInto(&filter, [](uint32_t row) { return row == 13u || row == 14u; });
+
+  ASSERT_EQ(filter.size(), 2u);
+  ASSERT_EQ(filter.Get(0u), 3u);
+  ASSERT_EQ(filter.Get(1u), 4u);
+
+  // The result should select rows of |rm| even though |filter| stopped before
+  // its end.
+  RowMap selected = rm.SelectRows(filter);
+  ASSERT_EQ(selected.size(), 2u);
+  ASSERT_EQ(selected.Get(0u), 13u);
+  ASSERT_EQ(selected.Get(1u), 14u);
+}
+
 TEST(RowMapUnittest, FilterIntoBitVectorWithRange) {
   RowMap rm(
       BitVector{true, false, false, true, false, true, false, true, true});
@@ -19,10 +19,12 @@
 
 #include <stdint.h>
 
-#include <deque>
+#include <memory>
 
 #include "perfetto/base/logging.h"
 #include "perfetto/ext/base/optional.h"
+#include "src/trace_processor/containers/chunked_vector.h"
+#include "src/trace_processor/containers/packed_vector.h"
 #include "src/trace_processor/containers/row_map.h"
 
 namespace perfetto {
@@ -30,11 +32,15 @@ namespace trace_processor {
 
 // A data structure which compactly stores a list of possibly nullable data.
 //
-// Internally, this class is implemented using a combination of a std::deque
+// Internally, this class is implemented using a combination of a ChunkedVector
 // with a BitVector used to store whether each index is null or not.
 // For each null value, it only uses a single bit inside the BitVector at
-// a slight cost (searching the BitVector to find the index into the std::deque)
-// when looking up the data.
+// a slight cost (searching the BitVector to find the index into the
+// ChunkedVector) when looking up the data.
+//
+// Once no more values are expected to be added, the non-null values can be
+// compressed into a PackedVector by calling |Compress()|. Modifying the
+// SparseVector afterwards is still possible but decompresses it first.
 template <typename T>
 class SparseVector {
  public:
@@ -44,7 +50,7 @@ class SparseVector {
   // Returns the optional value at |idx| or base::nullopt if the value is null.
   base::Optional<T> Get(uint32_t idx) const {
     auto opt_idx = valid_.IndexOf(idx);
-    return opt_idx ? base::Optional<T>(data_[*opt_idx]) : base::nullopt;
+    return opt_idx ? base::Optional<T>(GetNonNull(*opt_idx)) : base::nullopt;
   }
 
   // Returns the non-null value at |ordinal| where |ordinal| gives the index
@@ -58,18 +64,28 @@ class SparseVector {
   // GetNoNull(2) = 4
   // ...
   T GetNonNull(uint32_t ordinal) const {
+    if (PERFETTO_UNLIKELY(packed_)) {
+      PERFETTO_DCHECK(ordinal < packed_->size());
+      return packed_->Get(ordinal);
+    }
     PERFETTO_DCHECK(ordinal < data_.size());
     return data_[ordinal];
   }
 
   // Adds the given value to the SparseVector.
   void Append(T val) {
+    if (PERFETTO_UNLIKELY(packed_))
+      Decompress();
     data_.emplace_back(val);
     valid_.Insert(size_++);
+    generation_++;
   }
 
   // Adds a null value to the SparseVector.
-  void AppendNull() { size_++; }
+  void AppendNull() {
+    size_++;
+    generation_++;
+  }
 
   // Adds the given optional value to the SparseVector.
   void Append(base::Optional<T> val) {
@@ -82,6 +98,10 @@ class SparseVector {
 
   // Sets the value at |idx| to the given |val|.
   void Set(uint32_t idx, T val) {
+    if (PERFETTO_UNLIKELY(packed_))
+      Decompress();
+    generation_++;
+
     auto opt_idx = valid_.IndexOf(idx);
 
     // Generally, we will be setting a null row to non-null so optimize for that
@@ -100,6 +120,39 @@ class SparseVector {
   // Returns the size of the SparseVector; this includes any null values.
   uint32_t size() const { return size_; }
 
+  // Returns the number of non-null values.
+  uint32_t non_null_size() const {
+    return static_cast<uint32_t>(packed_ ? packed_->size() : data_.size());
+  }
+
+  // Returns the storage of the non-null values: the value returned by
+  // |GetNonNull(ordinal)| is |non_null_data()[ordinal]|. This allows scanning
+  // the values in bulk. Should only be called if the SparseVector is not
+  // compressed.
+  const ChunkedVector<T>& non_null_data() const {
+    PERFETTO_DCHECK(!packed_);
+    return data_;
+  }
+
+  // Returns the compressed storage of the non-null values or nullptr if the
+  // SparseVector is not compressed.
+  const PackedVector<T>* packed_data() const { return packed_.get(); }
+
+  // Compresses the non-null values to reduce the memory used by the
+  // SparseVector. This does not change the values so the generation is
+  // unchanged.
+  void Compress() {
+    if (packed_ || data_.size() == 0)
+      return;
+    packed_.reset(new PackedVector<T>(data_));
+    data_.clear();
+  }
+
+  // Returns a counter which is incremented every time the SparseVector is
+  // modified. This allows caching data derived from the contents of the
+  // SparseVector (e.g. indexes) and detecting when it becomes stale.
+  uint32_t generation() const { return generation_; }
+
  private:
   explicit SparseVector(const SparseVector&) = delete;
   SparseVector& operator=(const SparseVector&) = delete;
@@ -107,9 +160,17 @@ class SparseVector {
   SparseVector(SparseVector&&) = delete;
   SparseVector& operator=(SparseVector&&) noexcept = delete;
 
-  std::deque<T> data_;
+  void Decompress() {
+    for (size_t i = 0; i < packed_->size(); ++i)
+      data_.emplace_back(packed_->Get(i));
+    packed_.reset();
+  }
+
+  ChunkedVector<T> data_;
+  std::unique_ptr<PackedVector<T>> packed_;
   RowMap valid_;
   uint32_t size_ = 0;
+  uint32_t generation_ = 0;
 };
 
 }  // namespace trace_processor
@@ -69,6 +69,37 @@ TEST(SparseVector, SetNonNull) {
   ASSERT_EQ(sv.Get(3), base::Optional<int64_t>(4));
 }
 
+TEST(SparseVector, Compress) {
+  SparseVector<int64_t> sv;
+  for (int64_t i = 0; i < 1000; ++i) {
+    if (i % 3 == 0) {
+      sv.AppendNull();
+    } else {
+      sv.Append(i * 10);
+    }
+  }
+  uint32_t generation = sv.generation();
+
+  sv.Compress();
+  ASSERT_NE(sv.packed_data(), nullptr);
+  ASSERT_EQ(sv.generation(), generation);
+  ASSERT_EQ(sv.non_null_size(), 666u);
+  ASSERT_EQ(sv.Get(0), base::nullopt);
+  ASSERT_EQ(sv.Get(1), base::Optional<int64_t>(10));
+  ASSERT_EQ(sv.Get(998), base::Optional<int64_t>(9980));
+  ASSERT_EQ(sv.GetNonNull(1), 20);
+
+  // Modifying the SparseVector decompresses it.
+  sv.Set(0, 5);
+  sv.Append(7);
+  ASSERT_EQ(sv.packed_data(), nullptr);
+  ASSERT_EQ(sv.Get(0), base::Optional<int64_t>(5));
+  ASSERT_EQ(sv.Get(1), base::Optional<int64_t>(10));
+  ASSERT_EQ(sv.Get(998), base::Optional<int64_t>(9980));
+  ASSERT_EQ(sv.Get(1000), base::Optional<int64_t>(7));
+  ASSERT_EQ(sv.non_null_size(), 668u);
+}
+
 }  // namespace
 }  // namespace trace_processor
 }  // namespace perfetto
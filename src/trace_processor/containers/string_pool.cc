@@ -24,9 +24,17 @@
 namespace perfetto {
 namespace trace_processor {
 
+namespace {
+
+// The initial number of slots of the index (as a power of two).
+constexpr uint32_t kInitialIndexLog2Capacity = 10;
+
+}  // namespace
+
 StringPool::StringPool(size_t block_size_bytes)
     : block_size_bytes_(block_size_bytes > 0 ? block_size_bytes
-                                             : kDefaultBlockSize) {
+                                             : kDefaultBlockSize),
+      string_index_(new Index()) {
   blocks_.emplace_back(block_size_bytes_);
 
   // Reserve a slot for the null string.
@@ -64,10 +72,82 @@ StringPool::Id StringPool::InsertString(base::StringView str, uint64_t hash) {
   // Finish by computing the id of the pointer and adding a mapping from the
   // hash to the string_id.
   Id string_id = PtrToId(ptr);
-  string_index_.emplace(hash, string_id);
+  string_index_->Insert(hash, string_id);
   return string_id;
 }
 
+StringPool::MemoryUsage StringPool::GetMemoryUsage() const {
+  MemoryUsage usage;
+  for (const Block& block : blocks_)
+    usage.strings_bytes += block.pos();
+  usage.index_bytes = string_index_->memory_bytes();
+  return usage;
+}
+
+constexpr StringPool::StringHash StringPool::Index::kEmptyKey;
+
+StringPool::Index::Index() : size_(0), readers_(0) {
+  tables_.emplace_back(new Table(kInitialIndexLog2Capacity));
+  table_.store(tables_.back().get(), std::memory_order_release);
+}
+
+StringPool::Index::~Index() = default;
+
+StringPool::Index::Table::Table(uint32_t log2)
+    : log2_capacity(log2),
+      shift(64 - log2),
+      mask((size_t(1) << log2) - 1),
+      keys(new std::atomic<StringHash>[size_t(1) << log2]()),
+      ids(new std::atomic<uint32_t>[size_t(1) << log2]()) {}
+
+void StringPool::Index::Insert(StringHash hash, Id id) {
+  // Keep the load factor under 3/4 to keep the probe sequences short.
+  Table* table = tables_.back().get();
+  size_t size = size_.load(std::memory_order_relaxed);
+  if ((size + 1) * 4 > table->capacity() * 3) {
+    std::unique_ptr<Table> new_table(new Table(table->log2_capacity + 1));
+    for (size_t i = 0; i < table->capacity(); ++i) {
+      StringHash key = table->keys[i].load(std::memory_order_relaxed);
+      if (key != kEmptyKey) {
+        InsertInto(new_table.get(), key,
+                   table->ids[i].load(std::memory_order_relaxed));
+      }
+    }
+    table = new_table.get();
+    tables_.emplace_back(std::move(new_table));
+    table_.store(table, std::memory_order_seq_cst);
+
+    // Any lookup starting after this point sees the new table so, if no lookup
+    // is running, nobody can be using the old ones anymore.
+    if (readers_.load(std::memory_order_seq_cst) == 0)
+      tables_.erase(tables_.begin(), tables_.end() - 1);
+  }
+  InsertInto(table, ToKey(hash), id.id);
+  size_.store(size + 1, std::memory_order_relaxed);
+}
+
+// static
+void StringPool::Index::InsertInto(Table* table, StringHash key, uint32_t id) {
+  for (size_t i = table->SlotFor(key);; i = (i + 1) & table->mask) {
+    if (table->keys[i].load(std::memory_order_relaxed) == kEmptyKey) {
+      // The id needs to be visible to readers before the key is.
+      table->ids[i].store(id, std::memory_order_relaxed);
+      table->keys[i].store(key, std::memory_order_release);
+      return;
+    }
+    PERFETTO_DCHECK(table->keys[i].load(std::memory_order_relaxed) != key);
+  }
+}
+
+size_t StringPool::Index::memory_bytes() const {
+  size_t bytes = 0;
+  for (const auto& table : tables_) {
+    bytes += table->capacity() *
+             (sizeof(std::atomic<StringHash>) + sizeof(std::atomic<uint32_t>));
+  }
+  return bytes;
+}
+
 const uint8_t* StringPool::Block::TryInsert(base::StringView str) {
   auto str_size = str.size();
   size_t max_pos = static_cast<size_t>(pos_) + str_size + kMaxMetadataSize;
@@ -20,7 +20,9 @@
 #include <stddef.h>
 #include <stdint.h>
 
-#include <unordered_map>
+#include <atomic>
+#include <limits>
+#include <memory>
 #include <vector>
 
 #include "perfetto/ext/base/optional.h"
@@ -42,6 +44,9 @@ constexpr size_t kDefaultBlockSize =
 
 // Interns strings in a string pool and hands out compact StringIds which can
 // be used to retrieve the string in O(1).
+//
+// Strings are interned by a single thread but |GetId| and |Get| can be called
+// from other threads at the same time without any locking.
 class StringPool {
  public:
   struct Id {
@@ -85,32 +90,44 @@ class StringPool {
   StringPool(const StringPool&) = delete;
   StringPool& operator=(const StringPool&) = delete;
 
+  // Memory used by the pool, see |GetMemoryUsage|.
+  struct MemoryUsage {
+    // Bytes used by the strings themselves (including their metadata).
+    size_t strings_bytes = 0;
+
+    // Bytes used by the hash index over the strings.
+    size_t index_bytes = 0;
+  };
+
   Id InternString(base::StringView str) {
     if (str.data() == nullptr)
       return Id(0);
 
     auto hash = str.Hash();
-    auto id_it = string_index_.find(hash);
-    if (id_it != string_index_.end()) {
-      PERFETTO_DCHECK(Get(id_it->second) == str);
-      return id_it->second;
+    base::Optional<Id> id = string_index_->Find(hash);
+    if (id) {
+      PERFETTO_DCHECK(Get(*id) == str);
+      return *id;
     }
     return InsertString(str, hash);
   }
 
+  // Can be called concurrently with |InternString|.
   base::Optional<Id> GetId(base::StringView str) const {
     if (str.data() == nullptr)
       return Id(0u);
 
     auto hash = str.Hash();
-    auto id_it = string_index_.find(hash);
-    if (id_it != string_index_.end()) {
-      PERFETTO_DCHECK(Get(id_it->second) == str);
-      return id_it->second;
+    base::Optional<Id> id = string_index_->ConcurrentFind(hash);
+    if (id) {
+      PERFETTO_DCHECK(Get(*id) == str);
+      return *id;
     }
     return base::nullopt;
   }
 
+  // Can be called concurrently with |InternString| for any id returned by
+  // |InternString| or |GetId|.
   NullTermStringView Get(Id id) const {
     if (id.id == 0)
       return NullTermStringView();
@@ -119,11 +136,106 @@ class StringPool {
 
   Iterator CreateIterator() const { return Iterator(this); }
 
-  size_t size() const { return string_index_.size(); }
+  size_t size() const { return string_index_->size(); }
+
+  // Returns the memory used by the pool. Should only be called by the thread
+  // interning strings.
+  MemoryUsage GetMemoryUsage() const;
 
  private:
   using StringHash = uint64_t;
 
+  // Open addressing hash table mapping the hashes of the strings to their ids.
+  // The hashes are stored in their own array and slots are found by linear
+  // probing so lookups scan a contiguous array of 8 byte entries rather than
+  // chasing the nodes of a std::unordered_map.
+  //
+  // Lookups can run concurrently with insertions from a single thread: the id
+  // of a slot (and the string it points to) is written before the hash of the
+  // slot is published with a release store. When growing, the entries are
+  // copied to a new table which is then published atomically. The old tables
+  // are only freed once no concurrent lookup is running.
+  class Index {
+   public:
+    Index();
+    ~Index();
+
+    // Should only be called by the thread interning strings.
+    base::Optional<Id> Find(StringHash hash) const {
+      return FindIn(table_.load(std::memory_order_relaxed), hash);
+    }
+
+    // Same as |Find| but can be called from any thread.
+    base::Optional<Id> ConcurrentFind(StringHash hash) const {
+      // Prevents the tables from being freed while the lookup runs (see
+      // |Insert|).
+      readers_.fetch_add(1, std::memory_order_seq_cst);
+      base::Optional<Id> id =
+          FindIn(table_.load(std::memory_order_seq_cst), hash);
+      readers_.fetch_sub(1, std::memory_order_release);
+      return id;
+    }
+
+    // Should only be called by the thread interning strings.
+    void Insert(StringHash hash, Id id);
+
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+    // Should only be called by the thread interning strings.
+    size_t memory_bytes() const;
+
+   private:
+    struct Table {
+      explicit Table(uint32_t log2_capacity);
+
+      size_t SlotFor(StringHash key) const {
+        // Fibonacci hashing to spread the hashes over the slots.
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> shift);
+      }
+
+      size_t capacity() const { return mask + 1; }
+
+      uint32_t log2_capacity;
+      uint32_t shift;
+      size_t mask;
+      std::unique_ptr<std::atomic<StringHash>[]> keys;
+      std::unique_ptr<std::atomic<uint32_t>[]> ids;
+    };
+
+    static base::Optional<Id> FindIn(const Table* table, StringHash hash) {
+      StringHash key = ToKey(hash);
+      for (size_t i = table->SlotFor(key);; i = (i + 1) & table->mask) {
+        StringHash slot_key = table->keys[i].load(std::memory_order_acquire);
+        if (slot_key == key)
+          return Id(table->ids[i].load(std::memory_order_relaxed));
+        if (slot_key == kEmptyKey)
+          return base::nullopt;
+      }
+    }
+
+    // A slot is empty if its key is zero: the (unlikely) hash of zero is
+    // remapped to another value.
+    static constexpr StringHash kEmptyKey = 0;
+    static StringHash ToKey(StringHash hash) {
+      return hash == kEmptyKey ? 1 : hash;
+    }
+
+    static void InsertInto(Table* table, StringHash key, uint32_t id);
+
+    Index(const Index&) = delete;
+    Index& operator=(const Index&) = delete;
+
+    std::atomic<const Table*> table_;
+    std::atomic<size_t> size_;
+
+    // The number of running |ConcurrentFind| calls.
+    mutable std::atomic<uint32_t> readers_;
+
+    // The current table (last) and the old ones which could not be freed yet
+    // because of concurrent lookups.
+    std::vector<std::unique_ptr<Table>> tables_;
+  };
+
   struct Block {
     explicit Block(size_t size)
         : mem_(base::PagedMemory::Allocate(size,
@@ -227,10 +339,9 @@ class StringPool {
   // The actual memory storing the strings.
   std::vector<Block> blocks_;
 
-  // Maps hashes of strings to the Id in the string pool.
-  // TODO(lalitm): At some point we should benchmark just using a static
-  // hashtable of 1M elements, we can afford paying a fixed 8MB here
-  std::unordered_map<StringHash, Id> string_index_;
+  // Maps hashes of strings to the Id in the string pool. Held by pointer to
+  // keep the pool movable.
+  std::unique_ptr<Index> string_index_;
 };
 
 }  // namespace trace_processor
@@ -0,0 +1,117 @@
+// Copyright (C) 2020 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "src/trace_processor/containers/string_pool.h"
+
+namespace {
+
+using perfetto::trace_processor::StringPool;
+
+// Creates |count| distinct strings looking like the values of args (e.g. file
+// paths or names with an id).
+std::vector<std::string> CreateStrings(uint32_t count) {
+  static constexpr uint32_t kRandomSeed = 42;
+  std::minstd_rand0 rnd_engine(kRandomSeed);
+  std::vector<std::string> strs;
+  strs.reserve(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    strs.emplace_back("/system/lib64/libfoo_" + std::to_string(i) + "_" +
+                      std::to_string(rnd_engine()) + ".so");
+  }
+  return strs;
+}
+
+void SetMemoryCounters(benchmark::State& state, const StringPool& pool) {
+  StringPool::MemoryUsage usage = pool.GetMemoryUsage();
+  state.counters["strings_bytes"] =
+      benchmark::Counter(static_cast<double>(usage.strings_bytes));
+  state.counters["index_bytes"] =
+      benchmark::Counter(static_cast<double>(usage.index_bytes));
+  state.counters["index_bytes_per_string"] =
+      benchmark::Counter(static_cast<double>(usage.index_bytes) /
+                         static_cast<double>(pool.size()));
+}
+
+}  // namespace
+
+// Interns |state.range(0)| new strings in an empty pool.
+static void BM_StringPoolInternNew(benchmark::State& state) {
+  std::vector<std::string> strs =
+      CreateStrings(static_cast<uint32_t>(state.range(0)));
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::unique_ptr<StringPool> pool(new StringPool());
+    state.ResumeTiming();
+
+    for (const std::string& str : strs) {
+      benchmark::DoNotOptimize(
+          pool->InternString(perfetto::base::StringView(str)));
+    }
+
+    state.PauseTiming();
+    SetMemoryCounters(state, *pool);
+    pool.reset();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          state.range(0));
+}
+BENCHMARK(BM_StringPoolInternNew)
+    ->RangeMultiplier(16)
+    ->Range(1024, 1024 * 1024);
+
+// Interns strings which are already in a pool of |state.range(0)| strings.
+static void BM_StringPoolInternExisting(benchmark::State& state) {
+  std::vector<std::string> strs =
+      CreateStrings(static_cast<uint32_t>(state.range(0)));
+  StringPool pool;
+  for (const std::string& str : strs)
+    pool.InternString(perfetto::base::StringView(str));
+
+  size_t idx = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        pool.InternString(perfetto::base::StringView(strs[idx])));
+    idx = (idx + 1) % strs.size();
+  }
+  SetMemoryCounters(state, pool);
+}
+BENCHMARK(BM_StringPoolInternExisting)
+    ->RangeMultiplier(16)
+    ->Range(1024, 1024 * 1024);
+
+// Looks up strings, half of which are not in a pool of |state.range(0)|
+// strings.
+static void BM_StringPoolGetId(benchmark::State& state) {
+  std::vector<std::string> strs =
+      CreateStrings(static_cast<uint32_t>(state.range(0)) * 2);
+  StringPool pool;
+  for (size_t i = 0; i < strs.size(); i += 2)
+    pool.InternString(perfetto::base::StringView(strs[i]));
+
+  size_t idx = 0;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(pool.GetId(perfetto::base::StringView(strs[idx])));
+    idx = (idx + 1) % strs.size();
+  }
+}
+BENCHMARK(BM_StringPoolGetId)->RangeMultiplier(16)->Range(1024, 1024 * 1024);
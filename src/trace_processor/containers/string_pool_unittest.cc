@@ -16,7 +16,11 @@
 
 #include "src/trace_processor/containers/string_pool.h"
 
+#include <atomic>
 #include <random>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "test/gtest_and_gmock.h"
 
@@ -143,6 +147,62 @@ TEST(StringPoolTest, BigString) {
   ASSERT_EQ(str2.get(), pool.Get(id2));
 }
 
+TEST(StringPoolTest, ManyStrings) {
+  StringPool pool;
+  constexpr uint32_t kCount = 100000;
+  std::vector<StringPool::Id> ids;
+  for (uint32_t i = 0; i < kCount; ++i)
+    ids.emplace_back(pool.InternString(base::StringView(std::to_string(i))));
+  ASSERT_EQ(pool.size(), kCount);
+
+  for (uint32_t i = 0; i < kCount; ++i) {
+    std::string str = std::to_string(i);
+    ASSERT_EQ(pool.Get(ids[i]), base::StringView(str));
+    ASSERT_EQ(pool.InternString(base::StringView(str)), ids[i]);
+    ASSERT_EQ(pool.GetId(base::StringView(str)), ids[i]);
+  }
+  ASSERT_EQ(pool.size(), kCount);
+  ASSERT_FALSE(pool.GetId("not interned"));
+
+  StringPool::MemoryUsage usage = pool.GetMemoryUsage();
+  ASSERT_GT(usage.strings_bytes, kCount * 2);
+  ASSERT_LT(usage.strings_bytes, kCount * 8);
+  ASSERT_GT(usage.index_bytes, kCount * 12);
+  ASSERT_LT(usage.index_bytes, kCount * 12 * 4);
+}
+
+TEST(StringPoolTest, ConcurrentLookups) {
+  StringPool pool;
+  constexpr uint32_t kCount = 50000;
+  std::vector<std::string> strs;
+  for (uint32_t i = 0; i < kCount; ++i)
+    strs.emplace_back("str_" + std::to_string(i));
+
+  // The reader checks that any string it finds is the one it looked up while
+  // the strings are interned.
+  std::atomic<bool> done(false);
+  std::atomic<uint32_t> found(0);
+  std::thread reader([&pool, &strs, &done, &found] {
+    while (!done.load()) {
+      for (const std::string& str : strs) {
+        base::Optional<StringPool::Id> id = pool.GetId(base::StringView(str));
+        if (!id)
+          continue;
+        ASSERT_EQ(pool.Get(*id), base::StringView(str));
+        found++;
+      }
+    }
+  });
+
+  for (const std::string& str : strs)
+    pool.InternString(base::StringView(str));
+  done.store(true);
+  reader.join();
+
+  ASSERT_EQ(pool.size(), kCount);
+  ASSERT_GT(found.load(), 0u);
+}
+
 }  // namespace
 }  // namespace trace_processor
 }  // namespace perfetto
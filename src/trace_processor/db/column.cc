@@ -16,11 +16,345 @@
 
 #include "src/trace_processor/db/column.h"
 
+#include <algorithm>
+#include <limits>
+
+#include "src/trace_processor/containers/bit_vector.h"
+#include "src/trace_processor/containers/chunked_vector.h"
+#include "src/trace_processor/containers/packed_vector.h"
 #include "src/trace_processor/db/compare.h"
 #include "src/trace_processor/db/table.h"
 
 namespace perfetto {
 namespace trace_processor {
+namespace {
+
+constexpr uint32_t kBitsPerWord = 64;
+
+// Returns a word with bit i set iff |p(data[i])| is true for i in [0, count).
+//
+// The filter kernels below are written so that this loop is branch-free: this
+// allows the compiler to vectorize it with whichever SIMD instruction set the
+// target is built for (e.g. SSE/AVX on x86, NEON on ARM).
+template <typename T, typename Predicate>
+PERFETTO_ALWAYS_INLINE uint64_t FilterWord(const T* data,
+                                           uint32_t count,
+                                           Predicate p) {
+  uint64_t word = 0;
+  for (uint32_t i = 0; i < count; ++i)
+    word |= static_cast<uint64_t>(p(data[i])) << i;
+  return word;
+}
+
+// Same as above but for a full word. Having the count be a constant allows the
+// compiler to fully unroll and vectorize the loop.
+template <typename T, typename Predicate>
+PERFETTO_ALWAYS_INLINE uint64_t FilterFullWord(const T* data, Predicate p) {
+  uint64_t word = 0;
+  for (uint32_t i = 0; i < kBitsPerWord; ++i)
+    word |= static_cast<uint64_t>(p(data[i])) << i;
+  return word;
+}
+
+// Returns a BitVector of size |end| where bit i is set iff i >= |start| and
+// |p(data[i])| is true.
+template <typename T, typename Predicate>
+BitVector FilterDense(const ChunkedVector<T>& data,
+                      uint32_t start,
+                      uint32_t end,
+                      Predicate p) {
+  // Words never straddle chunks so every word can be computed from a
+  // contiguous run of values.
+  static_assert(ChunkedVector<T>::kChunkSize % kBitsPerWord == 0,
+                "Chunks should contain a whole number of words");
+  PERFETTO_DCHECK(end <= data.size());
+
+  BitVector::Builder builder(end);
+  uint32_t word_start = start - start % kBitsPerWord;
+  builder.SkipWords(word_start / kBitsPerWord);
+  for (uint32_t i = word_start; i < end; i += kBitsPerWord) {
+    const T* ptr = &data[i];
+    uint32_t count = std::min(kBitsPerWord, end - i);
+    uint64_t word = count == kBitsPerWord ? FilterFullWord(ptr, p)
+                                          : FilterWord(ptr, count, p);
+    if (i < start)
+      word &= ~0ull << (start - i);
+    builder.AppendWord(word);
+  }
+  return builder.Build();
+}
+
+// Same as above but for compressed data. The min and max of each block of
+// |data| are checked first with |p.MatchesRange|: the values only need to be
+// decoded if some of them match |p| and some do not.
+template <typename T, typename Predicate>
+BitVector FilterDense(const PackedVector<T>& data,
+                      uint32_t start,
+                      uint32_t end,
+                      Predicate p) {
+  static_assert(PackedVector<T>::kBlockSize % kBitsPerWord == 0,
+                "Blocks should contain a whole number of words");
+  PERFETTO_DCHECK(end <= data.size());
+
+  BitVector::Builder builder(end);
+  uint32_t word_start = start - start % kBitsPerWord;
+  builder.SkipWords(word_start / kBitsPerWord);
+  T values[kBitsPerWord];
+  for (uint32_t i = word_start; i < end; i += kBitsPerWord) {
+    uint32_t count = std::min(kBitsPerWord, end - i);
+    const auto& block = data.block_for(i);
+    base::Optional<bool> all_match = p.MatchesRange(block.min, block.max);
+    uint64_t word;
+    if (all_match) {
+      uint64_t mask = count == kBitsPerWord ? ~0ull : (1ull << count) - 1;
+      word = *all_match ? mask : 0;
+    } else {
+      data.Decode(i, count, values);
+      word = count == kBitsPerWord ? FilterFullWord(values, p)
+                                   : FilterWord(values, count, p);
+    }
+    if (i < start)
+      word &= ~0ull << (start - i);
+    builder.AppendWord(word);
+  }
+  return builder.Build();
+}
+
+// Predicates used by the dense filter kernels. |MatchesRange| returns whether
+// all the values in [min, max] match the predicate (true), none of them do
+// (false) or whether this depends on the value (nullopt).
+//
+// All comparisons are derived from < and > only to exactly match the
+// semantics of compare::Numeric (e.g. for NaN) which is used by the slow path.
+template <typename T>
+struct LtPredicate {
+  bool operator()(T v) const { return v < value; }
+  base::Optional<bool> MatchesRange(T min, T max) const {
+    if (max < value)
+      return true;
+    if (!(min < value))
+      return false;
+    return base::nullopt;
+  }
+  T value;
+};
+
+template <typename T>
+struct GtPredicate {
+  bool operator()(T v) const { return v > value; }
+  base::Optional<bool> MatchesRange(T min, T max) const {
+    if (min > value)
+      return true;
+    if (!(max > value))
+      return false;
+    return base::nullopt;
+  }
+  T value;
+};
+
+template <typename T>
+struct EqPredicate {
+  bool operator()(T v) const { return !((v < value) | (v > value)); }
+  base::Optional<bool> MatchesRange(T min, T max) const {
+    if (value < min || value > max)
+      return false;
+    if (!(min < value) && !(max > value))
+      return true;
+    return base::nullopt;
+  }
+  T value;
+};
+
+template <typename T>
+struct NePredicate {
+  bool operator()(T v) const { return (v < value) | (v > value); }
+  base::Optional<bool> MatchesRange(T min, T max) const {
+    base::Optional<bool> eq = EqPredicate<T>{value}.MatchesRange(min, max);
+    return eq ? base::make_optional(!*eq) : base::nullopt;
+  }
+  T value;
+};
+
+template <typename T>
+struct LePredicate {
+  bool operator()(T v) const { return !(v > value); }
+  base::Optional<bool> MatchesRange(T min, T max) const {
+    if (!(max > value))
+      return true;
+    if (min > value)
+      return false;
+    return base::nullopt;
+  }
+  T value;
+};
+
+template <typename T>
+struct GePredicate {
+  bool operator()(T v) const { return !(v < value); }
+  base::Optional<bool> MatchesRange(T min, T max) const {
+    if (!(min < value))
+      return true;
+    if (max < value)
+      return false;
+    return base::nullopt;
+  }
+  T value;
+};
+
+// Predicates comparing StringPool::Ids; null strings never match.
+struct StringEqPredicate {
+  bool operator()(StringPool::Id v) const {
+    return (v.id == id) & (v.id != 0u);
+  }
+  base::Optional<bool> MatchesRange(StringPool::Id min,
+                                    StringPool::Id max) const {
+    if (id == 0u || id < min.id || id > max.id)
+      return false;
+    if (min.id == id && max.id == id)
+      return true;
+    return base::nullopt;
+  }
+  uint32_t id;
+};
+
+struct StringNePredicate {
+  bool operator()(StringPool::Id v) const {
+    return (v.id != id) & (v.id != 0u);
+  }
+  base::Optional<bool> MatchesRange(StringPool::Id min,
+                                    StringPool::Id max) const {
+    if (max.id == 0u || (min.id == id && max.id == id))
+      return false;
+    if (min.id != 0u && (id < min.id || id > max.id))
+      return true;
+    return base::nullopt;
+  }
+  uint32_t id;
+};
+
+// Converts |value| to the type of a numeric column, returning false if this
+// is not possible without changing the result of comparisons (e.g. comparing
+// an integer column with a double or with a long out of the range of the
+// column type). These cases are left to the slow path.
+template <typename T>
+bool ToColumnValue(const SqlValue& value, T* out) {
+  if (value.type != SqlValue::Type::kLong)
+    return false;
+  if (value.long_value < static_cast<int64_t>(std::numeric_limits<T>::min()) ||
+      value.long_value > static_cast<int64_t>(std::numeric_limits<T>::max())) {
+    return false;
+  }
+  *out = static_cast<T>(value.long_value);
+  return true;
+}
+
+bool ToColumnValue(const SqlValue& value, double* out) {
+  if (value.type != SqlValue::Type::kDouble)
+    return false;
+  *out = value.double_value;
+  return true;
+}
+
+// Returns a BitVector of the rows in [start, end) of |data| (either a
+// ChunkedVector<T> or a PackedVector<T>) which satisfy the constraint |op|
+// against |value|.
+template <typename Data, typename T>
+base::Optional<BitVector> FilterNumericDense(const Data& data,
+                                             FilterOp op,
+                                             T value,
+                                             uint32_t start,
+                                             uint32_t end) {
+  switch (op) {
+    case FilterOp::kLt:
+      return FilterDense(data, start, end, LtPredicate<T>{value});
+    case FilterOp::kGt:
+      return FilterDense(data, start, end, GtPredicate<T>{value});
+    case FilterOp::kEq:
+      return FilterDense(data, start, end, EqPredicate<T>{value});
+    case FilterOp::kNe:
+      return FilterDense(data, start, end, NePredicate<T>{value});
+    case FilterOp::kLe:
+      return FilterDense(data, start, end, LePredicate<T>{value});
+    case FilterOp::kGe:
+      return FilterDense(data, start, end, GePredicate<T>{value});
+    case FilterOp::kLike:
+    case FilterOp::kIsNull:
+    case FilterOp::kIsNotNull:
+      return base::nullopt;
+  }
+  PERFETTO_FATAL("For GCC");
+}
+
+// Returns the key used to order the values of type |T| in a column index.
+template <typename T>
+T IndexKey(T value) {
+  return value;
+}
+
+uint32_t IndexKey(StringPool::Id value) {
+  return value.id;
+}
+
+// Converts |value| to a value which can be looked up in the index of a column
+// of type |T|. Returns false if this is not possible (in which case the
+// constraint is left to the other filter methods). If the value cannot be
+// present in the column, |out| is set to nullopt.
+template <typename T>
+bool ToIndexValue(const SqlValue& value,
+                  const StringPool&,
+                  base::Optional<T>* out) {
+  T column_value;
+  if (!ToColumnValue(value, &column_value))
+    return false;
+  *out = column_value;
+  return true;
+}
+
+bool ToIndexValue(const SqlValue& value,
+                  const StringPool& pool,
+                  base::Optional<StringPool::Id>* out) {
+  if (value.type != SqlValue::Type::kString)
+    return false;
+
+  // As strings are interned, a string which is not in the pool cannot be
+  // present in the column.
+  *out = pool.GetId(value.string_value);
+  return true;
+}
+
+// Returns whether |value| should be stored in the index: the null string id is
+// never stored as it represents a null value.
+template <typename T>
+bool IsIndexedValue(T) {
+  return true;
+}
+
+bool IsIndexedValue(StringPool::Id value) {
+  return !value.is_null();
+}
+
+// Rebuilds |sorted_idx| with the indices of all the non-null values of |sv|,
+// sorted by value and then by index.
+template <typename T>
+void BuildIndex(const SparseVector<T>& sv, std::vector<uint32_t>* sorted_idx) {
+  using Key = decltype(IndexKey(std::declval<T>()));
+
+  std::vector<std::pair<Key, uint32_t>> entries;
+  entries.reserve(sv.non_null_size());
+  for (uint32_t i = 0; i < sv.size(); ++i) {
+    base::Optional<T> value = sv.Get(i);
+    if (value && IsIndexedValue(*value))
+      entries.emplace_back(IndexKey(*value), i);
+  }
+  std::sort(entries.begin(), entries.end());
+
+  sorted_idx->clear();
+  sorted_idx->reserve(entries.size());
+  for (const auto& entry : entries)
+    sorted_idx->emplace_back(entry.second);
+}
+
+}  // namespace
 
 Column::Column(const Column& column,
                Table* table,
@@ -32,7 +366,10 @@ Column::Column(const Column& column,
              table,
              col_idx,
              row_map_idx,
-             column.sparse_vector_) {}
+             column.sparse_vector_) {
+  index_ = column.index_;
+  overlap_index_ = column.overlap_index_;
+}
 
 Column::Column(const char* name,
                ColumnType type,
@@ -63,6 +400,293 @@ void Column::StableSort(bool desc, std::vector<uint32_t>* idx) const {
   }
 }
 
+bool Column::FilterIntoDense(FilterOp op, SqlValue value, RowMap* rm) const {
+  PERFETTO_DCHECK(row_map().IsRange());
+
+  if (rm->size() <= 1) {
+    // The slow path already special cases empty and single row RowMaps.
+    return false;
+  }
+
+  // If |rm| is a range, we only need to look at the rows inside it and the
+  // result can directly replace |rm|. Otherwise, we filter the whole column
+  // and intersect the result with |rm|.
+  uint32_t start = rm->IsRange() ? rm->Get(0) : 0;
+  uint32_t end = rm->IsRange() ? start + rm->size() : row_map().size();
+
+  base::Optional<BitVector> bv;
+  switch (type_) {
+    case ColumnType::kInt32:
+      bv = FilterIntoNumericDense<int32_t>(op, value, start, end);
+      break;
+    case ColumnType::kUint32:
+      bv = FilterIntoNumericDense<uint32_t>(op, value, start, end);
+      break;
+    case ColumnType::kInt64:
+      bv = FilterIntoNumericDense<int64_t>(op, value, start, end);
+      break;
+    case ColumnType::kDouble:
+      bv = FilterIntoNumericDense<double>(op, value, start, end);
+      break;
+    case ColumnType::kString:
+      bv = FilterIntoStringDense(op, value, start, end);
+      break;
+    case ColumnType::kId:
+      break;
+  }
+  if (!bv)
+    return false;
+
+  if (rm->IsRange()) {
+    // RowMaps of filtered rows are expected to cover the whole column (see
+    // RowMap::SelectRows) but |bv| stops at the end of |rm|.
+    bv->Resize(row_map().size(), false);
+    *rm = RowMap(std::move(*bv));
+  } else {
+    rm->Intersect(RowMap(std::move(*bv)));
+  }
+  return true;
+}
+
+bool Column::FilterIntoIndexed(SqlValue value, RowMap* rm) const {
+  PERFETTO_DCHECK(IsIndexed());
+  PERFETTO_DCHECK(row_map().IsRange());
+
+  switch (type_) {
+    case ColumnType::kInt32:
+      return FilterIntoIndexedTyped<int32_t>(value, rm);
+    case ColumnType::kUint32:
+      return FilterIntoIndexedTyped<uint32_t>(value, rm);
+    case ColumnType::kInt64:
+      return FilterIntoIndexedTyped<int64_t>(value, rm);
+    case ColumnType::kString:
+      return FilterIntoIndexedTyped<StringPool::Id>(value, rm);
+    case ColumnType::kDouble:
+    case ColumnType::kId:
+      return false;
+  }
+  PERFETTO_FATAL("For GCC");
+}
+
+void Column::FilterIntoOverlapping(const Column& dur,
+                                   int64_t min_end,
+                                   int64_t max_start,
+                                   RowMap* rm) const {
+  PERFETTO_DCHECK(type_ == ColumnType::kInt64);
+  PERFETTO_DCHECK(dur.type_ == ColumnType::kInt64);
+
+  const IntervalIndex* index = GetOverlapIndex(dur);
+  if (index) {
+    std::vector<uint32_t> rows;
+    index->Query(min_end, max_start, &rows);
+    std::sort(rows.begin(), rows.end());
+
+    if (rm->IsRange()) {
+      // If |rm| is a range, the result is just the matching rows inside it.
+      uint32_t start_row = rm->size() == 0 ? 0 : rm->Get(0);
+      uint32_t end_row = start_row + rm->size();
+      auto first = std::lower_bound(rows.begin(), rows.end(), start_row);
+      auto last = std::lower_bound(first, rows.end(), end_row);
+      rows.erase(last, rows.end());
+      rows.erase(rows.begin(), first);
+      *rm = RowMap(std::move(rows));
+      return;
+    }
+
+    BitVector bv(row_map().size(), false);
+    for (uint32_t row : rows) {
+      if (row < row_map().size())
+        bv.Set(row);
+    }
+    rm->Intersect(RowMap(std::move(bv)));
+    return;
+  }
+
+  const auto& sv = sparse_vector<int64_t>();
+  const auto& dur_sv = dur.sparse_vector<int64_t>();
+  std::vector<uint32_t> rows;
+  for (auto it = rm->IterateRows(); it; it.Next()) {
+    uint32_t row = it.row();
+    base::Optional<int64_t> ts_value = sv.Get(row_map().Get(row));
+    base::Optional<int64_t> dur_value = dur_sv.Get(dur.row_map().Get(row));
+    if (ts_value && dur_value && *ts_value <= max_start &&
+        *ts_value + *dur_value >= min_end) {
+      rows.push_back(row);
+    }
+  }
+  *rm = RowMap(std::move(rows));
+}
+
+void Column::Compress() {
+  switch (type_) {
+    case ColumnType::kInt32:
+      mutable_sparse_vector<int32_t>()->Compress();
+      break;
+    case ColumnType::kUint32:
+      mutable_sparse_vector<uint32_t>()->Compress();
+      break;
+    case ColumnType::kInt64:
+      mutable_sparse_vector<int64_t>()->Compress();
+      break;
+    case ColumnType::kString:
+      mutable_sparse_vector<StringPool::Id>()->Compress();
+      break;
+    case ColumnType::kDouble:
+      // Doubles rarely have low entropy bit patterns so are not worth
+      // compressing this way.
+    case ColumnType::kId:
+      break;
+  }
+}
+
+const IntervalIndex* Column::GetOverlapIndex(const Column& dur) const {
+  // The index is built on the storage of the columns so can only be used if
+  // row i of both columns is stored at index i of their storage.
+  auto is_dense = [](const Column& col) {
+    return col.row_map().IsRange() &&
+           (col.row_map().size() == 0 || col.row_map().Get(0) == 0);
+  };
+  if (!is_dense(*this) || !is_dense(dur))
+    return nullptr;
+
+  const SparseVector<int64_t>& sv = sparse_vector<int64_t>();
+  const SparseVector<int64_t>& dur_sv = dur.sparse_vector<int64_t>();
+  if (!overlap_index_ || overlap_index_->dur != &dur_sv) {
+    overlap_index_.reset(new OverlapIndex());
+    overlap_index_->dur = &dur_sv;
+  }
+
+  OverlapIndex* oi = overlap_index_.get();
+  if (oi->generation != sv.generation() ||
+      oi->dur_generation != dur_sv.generation()) {
+    uint32_t size = std::min(sv.size(), dur_sv.size());
+    std::vector<IntervalIndex::Interval> intervals;
+    intervals.reserve(size);
+    for (uint32_t i = 0; i < size; ++i) {
+      base::Optional<int64_t> ts_value = sv.Get(i);
+      base::Optional<int64_t> dur_value = dur_sv.Get(i);
+      if (ts_value && dur_value) {
+        intervals.emplace_back(
+            IntervalIndex::Interval{*ts_value, *ts_value + *dur_value, i});
+      }
+    }
+    oi->index = IntervalIndex(std::move(intervals));
+    oi->generation = sv.generation();
+    oi->dur_generation = dur_sv.generation();
+  }
+  return &oi->index;
+}
+
+template <typename T>
+bool Column::FilterIntoIndexedTyped(SqlValue value, RowMap* rm) const {
+  PERFETTO_DCHECK(type_ == ToColumnType<T>());
+
+  base::Optional<T> index_value;
+  if (!ToIndexValue(value, *string_pool_, &index_value))
+    return false;
+
+  if (!index_value) {
+    rm->Intersect(RowMap());
+    return true;
+  }
+
+  const SparseVector<T>& sv = sparse_vector<T>();
+  if (index_->generation != sv.generation()) {
+    BuildIndex(sv, &index_->sorted_idx);
+    index_->generation = sv.generation();
+  }
+
+  // Find the run of indices whose value is |index_value|. As each run is
+  // sorted by index, the matching rows are also sorted.
+  using Key = decltype(IndexKey(std::declval<T>()));
+  Key key = IndexKey(*index_value);
+  auto value_less = [&sv](uint32_t idx, Key k) {
+    return IndexKey(*sv.Get(idx)) < k;
+  };
+  auto less_value = [&sv](Key k, uint32_t idx) {
+    return k < IndexKey(*sv.Get(idx));
+  };
+  const std::vector<uint32_t>& sorted_idx = index_->sorted_idx;
+  auto begin = std::lower_bound(sorted_idx.begin(), sorted_idx.end(), key,
+                                value_less);
+  auto end = std::upper_bound(begin, sorted_idx.end(), key, less_value);
+
+  if (rm->IsRange()) {
+    // If |rm| is a range, the result is just the matching rows inside it.
+    uint32_t start_row = rm->size() == 0 ? 0 : rm->Get(0);
+    uint32_t end_row = start_row + rm->size();
+    auto first = std::lower_bound(begin, end, start_row);
+    auto last = std::lower_bound(first, end, end_row);
+    *rm = RowMap(std::vector<uint32_t>(first, last));
+    return true;
+  }
+
+  // Otherwise, go through a BitVector as intersecting with it only needs a
+  // constant time lookup for each row in |rm|.
+  // The index covers the whole storage, which can be shared with other tables
+  // (e.g. the table this one was filtered from), so only keep the indices
+  // which are rows of this table: as the row map is a range starting at 0,
+  // these are the ones below its size.
+  end = std::lower_bound(begin, end, row_map().size());
+  BitVector bv(row_map().size(), false);
+  for (auto it = begin; it != end; ++it)
+    bv.Set(*it);
+  rm->Intersect(RowMap(std::move(bv)));
+  return true;
+}
+
+template <typename T>
+base::Optional<BitVector> Column::FilterIntoNumericDense(FilterOp op,
+                                                         SqlValue value,
+                                                         uint32_t start,
+                                                         uint32_t end) const {
+  PERFETTO_DCHECK(type_ == ToColumnType<T>());
+
+  // Nullable columns store only the non-null values so row i is not at index i
+  // of the storage.
+  if (IsNullable())
+    return base::nullopt;
+
+  T column_value;
+  if (!ToColumnValue(value, &column_value))
+    return base::nullopt;
+
+  const SparseVector<T>& sv = sparse_vector<T>();
+  if (const PackedVector<T>* packed = sv.packed_data())
+    return FilterNumericDense(*packed, op, column_value, start, end);
+  return FilterNumericDense(sv.non_null_data(), op, column_value, start, end);
+}
+
+base::Optional<BitVector> Column::FilterIntoStringDense(FilterOp op,
+                                                        SqlValue value,
+                                                        uint32_t start,
+                                                        uint32_t end) const {
+  PERFETTO_DCHECK(type_ == ColumnType::kString);
+
+  if (value.type != SqlValue::Type::kString)
+    return base::nullopt;
+  if (op != FilterOp::kEq && op != FilterOp::kNe)
+    return base::nullopt;
+
+  // As strings are interned, two strings are equal iff they have the same id
+  // so we can compare the ids without looking at the strings.
+  // If the string is not in the pool, no row can be equal to it; we use the
+  // null id in this case as null rows never match the constraint anyway.
+  base::Optional<StringPool::Id> opt_id =
+      string_pool_->GetId(value.string_value);
+  uint32_t id = opt_id ? opt_id->id : 0u;
+
+  const SparseVector<StringPool::Id>& sv = sparse_vector<StringPool::Id>();
+  if (const PackedVector<StringPool::Id>* packed = sv.packed_data()) {
+    if (op == FilterOp::kEq)
+      return FilterDense(*packed, start, end, StringEqPredicate{id});
+    return FilterDense(*packed, start, end, StringNePredicate{id});
+  }
+  if (op == FilterOp::kEq)
+    return FilterDense(sv.non_null_data(), start, end, StringEqPredicate{id});
+  return FilterDense(sv.non_null_data(), start, end, StringNePredicate{id});
+}
+
 void Column::FilterIntoSlow(FilterOp op, SqlValue value, RowMap* rm) const {
   switch (type_) {
     case ColumnType::kInt32: {
@@ -19,13 +19,18 @@
 
 #include <stdint.h>
 
+#include <memory>
+#include <vector>
+
 #include "perfetto/base/logging.h"
 #include "perfetto/ext/base/optional.h"
 #include "perfetto/trace_processor/basic_types.h"
+#include "src/trace_processor/containers/bit_vector.h"
 #include "src/trace_processor/containers/row_map.h"
 #include "src/trace_processor/containers/sparse_vector.h"
 #include "src/trace_processor/containers/string_pool.h"
 #include "src/trace_processor/db/compare.h"
+#include "src/trace_processor/db/interval_index.h"
 
 namespace perfetto {
 namespace trace_processor {
@@ -84,6 +89,17 @@ class Column {
     // This is used to speed up filters as we can safely index SparseVector
     // directly if this flag is set.
     kNonNull = 1 << 1,
+
+    // Indicates that an index should be kept for the data in this column to
+    // speed up equality filters. This is useful for columns which are not
+    // sorted but are frequently filtered on (e.g. utid, track_id or
+    // arg_set_id).
+    //
+    // The index is built lazily on the first equality filter which can use it
+    // and is rebuilt if the column was modified since; this means this flag
+    // should only be set on columns which are not modified after the trace
+    // has been loaded. Only integer and string columns support indexes.
+    kIndexed = 1 << 2,
   };
 
   template <typename T>
@@ -99,7 +115,12 @@ class Column {
                table,
                col_idx_in_table,
                row_map_idx,
-               storage) {}
+               storage) {
+    if (flags & Flag::kIndexed) {
+      PERFETTO_DCHECK(type_ != ColumnType::kDouble);
+      index_.reset(new Index());
+    }
+  }
 
   // Create a Column has the same name and is backed by the same data as
   // |column| but is associated to a different table.
@@ -174,9 +195,46 @@ class Column {
         return;
     }
 
+    if (row_map().IsRange() &&
+        (row_map().size() == 0 || row_map().Get(0) == 0)) {
+      // If the column is indexed, an equality constraint can be answered by
+      // looking up the matching rows in the index.
+      if (IsIndexed() && op == FilterOp::kEq) {
+        bool handled = FilterIntoIndexed(value, rm);
+        if (handled)
+          return;
+      }
+
+      // If the rows of the column map one-to-one to the backing storage (as
+      // is the case for all the columns of root tables), we can evaluate the
+      // constraint over contiguous chunks of the storage.
+      bool handled = FilterIntoDense(op, value, rm);
+      if (handled)
+        return;
+    }
+
     FilterIntoSlow(op, value, rm);
   }
 
+  // Updates the given RowMap by only keeping the rows whose interval, which
+  // starts at the value of this column and lasts the value of |dur|, starts
+  // at or before |max_start| and ends at or after |min_end|. Rows where
+  // either value is null are removed. Both columns should be int64 columns.
+  //
+  // If the rows of both columns map one-to-one to their backing storage, this
+  // uses an interval index over the two columns which is built on the first
+  // call and rebuilt if either column was modified since; the same caveats as
+  // Flag::kIndexed apply. Otherwise, this does a full table scan.
+  void FilterIntoOverlapping(const Column& dur,
+                             int64_t min_end,
+                             int64_t max_start,
+                             RowMap* rm) const;
+
+  // Compresses the backing storage of this column (see
+  // SparseVector::Compress()). This only reduces the memory used by the column
+  // and does not change its contents; id and double columns are left as is.
+  void Compress();
+
   // Returns the minimum value in this column. Returns nullopt if this column
   // is empty.
   base::Optional<SqlValue> Min() const {
@@ -208,12 +266,18 @@ class Column {
   // Returns true if this column is considered an id column.
   bool IsId() const { return type_ == ColumnType::kId; }
 
+  // Returns true if this column stores int64 values.
+  bool IsInt64() const { return type_ == ColumnType::kInt64; }
+
   // Returns true if this column is a nullable column.
   bool IsNullable() const { return (flags_ & Flag::kNonNull) == 0; }
 
   // Returns true if this column is a sorted column.
   bool IsSorted() const { return (flags_ & Flag::kSorted) != 0; }
 
+  // Returns true if this column has an index to speed up equality filters.
+  bool IsIndexed() const { return index_ != nullptr; }
+
   // Returns the backing RowMap for this Column.
   // This function is defined out of line because of a circular dependency
   // between |Table| and |Column|.
@@ -367,6 +431,16 @@ class Column {
     uint32_t row_ = 0;
   };
 
+  // Index over the non-null values of a column; see Flag::kIndexed.
+  struct Index {
+    // The indices into the storage of all the non-null values, sorted by value
+    // and then by storage index.
+    std::vector<uint32_t> sorted_idx;
+
+    // The generation of the storage when |sorted_idx| was built.
+    base::Optional<uint32_t> generation;
+  };
+
   friend class Table;
 
   // Base constructor for this class which all other constructors call into.
@@ -410,6 +484,26 @@ class Column {
     PERFETTO_FATAL("For GCC");
   }
 
+  // Returns the generation of the backing storage of this column (see
+  // SparseVector::generation()) or 0 for id columns which have no storage.
+  uint32_t storage_generation() const {
+    switch (type_) {
+      case ColumnType::kInt32:
+        return sparse_vector<int32_t>().generation();
+      case ColumnType::kUint32:
+        return sparse_vector<uint32_t>().generation();
+      case ColumnType::kInt64:
+        return sparse_vector<int64_t>().generation();
+      case ColumnType::kDouble:
+        return sparse_vector<double>().generation();
+      case ColumnType::kString:
+        return sparse_vector<StringPool::Id>().generation();
+      case ColumnType::kId:
+        return 0;
+    }
+    PERFETTO_FATAL("For GCC");
+  }
+
   // Optimized filter method for sorted columns.
   // Returns whether the constraint was handled by the method.
   bool FilterIntoSorted(FilterOp op, SqlValue value, RowMap* rm) const {
@@ -460,6 +554,52 @@ class Column {
     return false;
   }
 
+  // Optimized filter method for columns whose row i is stored at index i of
+  // the backing storage: evaluates the constraint 64 rows at a time over
+  // contiguous chunks of the storage, producing a BitVector directly.
+  // Returns whether the constraint was handled by the method.
+  bool FilterIntoDense(FilterOp op, SqlValue value, RowMap* rm) const;
+
+  // Dense filter method for numerics: returns the BitVector of the rows in
+  // [start, end) matching the constraint or nullopt if the constraint cannot
+  // be handled by the method.
+  template <typename T>
+  base::Optional<BitVector> FilterIntoNumericDense(FilterOp op,
+                                                   SqlValue value,
+                                                   uint32_t start,
+                                                   uint32_t end) const;
+
+  // Dense filter method for strings; only handles (in)equality constraints
+  // which can be evaluated by comparing StringPool::Ids.
+  base::Optional<BitVector> FilterIntoStringDense(FilterOp op,
+                                                  SqlValue value,
+                                                  uint32_t start,
+                                                  uint32_t end) const;
+
+  // Optimized filter method for equality constraints on indexed columns whose
+  // row i is stored at index i of the backing storage.
+  // Returns whether the constraint was handled by the method.
+  bool FilterIntoIndexed(SqlValue value, RowMap* rm) const;
+
+  // Looks up the rows equal to |value| in the index of this column, building
+  // the index first if necessary. |T| should match the type of this column.
+  // Returns whether the constraint was handled by the method.
+  template <typename T>
+  bool FilterIntoIndexedTyped(SqlValue value, RowMap* rm) const;
+
+  // Interval index over this column and a duration column; see
+  // FilterIntoOverlapping.
+  struct OverlapIndex {
+    const SparseVector<int64_t>* dur = nullptr;
+    base::Optional<uint32_t> generation;
+    base::Optional<uint32_t> dur_generation;
+    IntervalIndex index;
+  };
+
+  // Returns the interval index of this column over |dur|, building it if
+  // necessary. Returns null if the index cannot be used with these columns.
+  const IntervalIndex* GetOverlapIndex(const Column& dur) const;
+
   // Slow path filter method which will perform a full table scan.
   void FilterIntoSlow(FilterOp op, SqlValue value, RowMap* rm) const;
 
@@ -516,6 +656,14 @@ class Column {
   uint32_t col_idx_in_table_ = 0;
   uint32_t row_map_idx_ = 0;
   const StringPool* string_pool_ = nullptr;
+
+  // The index of this column if it is indexed. This is shared between all the
+  // columns backed by the same storage as the index is built on the storage.
+  std::shared_ptr<Index> index_;
+
+  // The interval index of this column, if it was ever filtered with
+  // FilterIntoOverlapping. Shared in the same way as |index_|.
+  mutable std::shared_ptr<OverlapIndex> overlap_index_;
 };
 
 }  // namespace trace_processor
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/db/interval_index.h"
+
+#include <algorithm>
+#include <tuple>
+
+#include "perfetto/base/logging.h"
+
+namespace perfetto {
+namespace trace_processor {
+
+IntervalIndex::IntervalIndex() = default;
+IntervalIndex::~IntervalIndex() = default;
+IntervalIndex::IntervalIndex(IntervalIndex&&) noexcept = default;
+IntervalIndex& IntervalIndex::operator=(IntervalIndex&&) = default;
+
+IntervalIndex::IntervalIndex(std::vector<Interval> intervals) {
+  std::sort(intervals.begin(), intervals.end(),
+            [](const Interval& a, const Interval& b) {
+              return std::tie(a.start, a.id) < std::tie(b.start, b.id);
+            });
+  nodes_.reserve(intervals.size());
+  for (const Interval& interval : intervals)
+    nodes_.emplace_back(
+        Node{interval.start, interval.end, interval.end, interval.id});
+
+  // Compute the max end of each subtree bottom up, one level at a time. As
+  // the number of nodes is not necessarily a power of two, the right child of
+  // a node can be missing: in that case, the right subtree is made of the
+  // nodes after the node (if any), whose max end is tracked in |last|.
+  int64_t n = static_cast<int64_t>(nodes_.size());
+  if (n == 0)
+    return;
+
+  int64_t last_i = 0;
+  int64_t last = 0;
+  for (int64_t i = 0; i < n; i += 2) {
+    last_i = i;
+    last = nodes_[static_cast<size_t>(i)].max_end;
+  }
+
+  uint32_t level = 1;
+  for (; (int64_t(1) << level) <= n; ++level) {
+    int64_t x = int64_t(1) << (level - 1);
+    int64_t step = x << 2;
+    for (int64_t i = (x << 1) - 1; i < n; i += step) {
+      int64_t left = nodes_[static_cast<size_t>(i - x)].max_end;
+      int64_t right = i + x < n ? nodes_[static_cast<size_t>(i + x)].max_end
+                                : last;
+      Node& node = nodes_[static_cast<size_t>(i)];
+      node.max_end = std::max(node.end, std::max(left, right));
+    }
+
+    // Move |last_i| to its parent.
+    last_i = (last_i >> level & 1) ? last_i - x : last_i + x;
+    if (last_i < n)
+      last = std::max(last, nodes_[static_cast<size_t>(last_i)].max_end);
+  }
+  root_level_ = level - 1;
+}
+
+void IntervalIndex::Query(int64_t min_end,
+                          int64_t max_start,
+                          std::vector<uint32_t>* out) const {
+  int64_t n = static_cast<int64_t>(nodes_.size());
+  if (n == 0)
+    return;
+
+  // Small subtrees are scanned linearly rather than walked.
+  constexpr uint32_t kScanLevel = 3;
+
+  struct StackEntry {
+    int64_t node;
+    uint32_t level;
+
+    // Whether the left subtree of the node has already been visited.
+    bool left_done;
+  };
+
+  // The tree has at most 32 levels and each level adds at most two entries.
+  StackEntry stack[64];
+  size_t size = 0;
+  stack[size++] = StackEntry{(int64_t(1) << root_level_) - 1, root_level_,
+                             false};
+  while (size > 0) {
+    StackEntry e = stack[--size];
+    if (e.level <= kScanLevel) {
+      int64_t begin = e.node >> e.level << e.level;
+      int64_t end = std::min(begin + (int64_t(1) << (e.level + 1)) - 1, n);
+      for (int64_t i = begin; i < end; ++i) {
+        const Node& node = nodes_[static_cast<size_t>(i)];
+        if (node.start > max_start)
+          break;
+        if (node.end >= min_end)
+          out->push_back(node.id);
+      }
+    } else if (!e.left_done) {
+      stack[size++] = StackEntry{e.node, e.level, true};
+
+      // The left child can be past the end if the tree is not complete: its
+      // subtree can still contain nodes so it needs to be visited.
+      int64_t left = e.node - (int64_t(1) << (e.level - 1));
+      if (left >= n || nodes_[static_cast<size_t>(left)].max_end >= min_end)
+        stack[size++] = StackEntry{left, e.level - 1, false};
+    } else if (e.node < n &&
+               nodes_[static_cast<size_t>(e.node)].start <= max_start) {
+      // Only visit the node and its right subtree if they can start before
+      // |max_start|: as nodes are sorted by start, this is the case iff the
+      // node itself does.
+      const Node& node = nodes_[static_cast<size_t>(e.node)];
+      if (node.end >= min_end)
+        out->push_back(node.id);
+      int64_t right = e.node + (int64_t(1) << (e.level - 1));
+      stack[size++] = StackEntry{right, e.level - 1, false};
+    }
+    PERFETTO_DCHECK(size <= 64);
+  }
+}
+
+}  // namespace trace_processor
+}  // namespace perfetto
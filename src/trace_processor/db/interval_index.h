@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_DB_INTERVAL_INDEX_H_
+#define SRC_TRACE_PROCESSOR_DB_INTERVAL_INDEX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+namespace perfetto {
+namespace trace_processor {
+
+// Index over a set of intervals to find the ones overlapping a given interval
+// in O(log(n) + k) time, where k is the number of intervals returned.
+//
+// This is an implicit augmented interval tree: the intervals are sorted by
+// start and the sorted array is seen as a complete binary search tree, where
+// the node at position i is at the level given by the number of trailing ones
+// of i (i.e. leaves are at even positions). Each node also stores the
+// maximum end of the intervals in its subtree, which allows skipping whole
+// subtrees which end before the queried interval starts. Compared to a
+// pointer based tree, this only needs a single allocation and is cache
+// friendly as subtrees are contiguous.
+class IntervalIndex {
+ public:
+  struct Interval {
+    int64_t start;
+    int64_t end;
+
+    // Opaque id returned by Query (e.g. the row of the interval).
+    uint32_t id;
+  };
+
+  IntervalIndex();
+  explicit IntervalIndex(std::vector<Interval> intervals);
+  ~IntervalIndex();
+
+  IntervalIndex(IntervalIndex&&) noexcept;
+  IntervalIndex& operator=(IntervalIndex&&);
+
+  // Appends to |out| the ids of the intervals with start <= |max_start| and
+  // end >= |min_end|, in no particular order.
+  void Query(int64_t min_end,
+             int64_t max_start,
+             std::vector<uint32_t>* out) const;
+
+  // Returns the number of intervals in the index.
+  size_t size() const { return nodes_.size(); }
+
+ private:
+  struct Node {
+    int64_t start;
+    int64_t end;
+
+    // The maximum end of all the intervals in the subtree of this node.
+    int64_t max_end;
+    uint32_t id;
+  };
+
+  IntervalIndex(const IntervalIndex&) = delete;
+  IntervalIndex& operator=(const IntervalIndex&) = delete;
+
+  std::vector<Node> nodes_;
+
+  // The level of the root of the tree.
+  uint32_t root_level_ = 0;
+};
+
+}  // namespace trace_processor
+}  // namespace perfetto
+
+#endif  // SRC_TRACE_PROCESSOR_DB_INTERVAL_INDEX_H_
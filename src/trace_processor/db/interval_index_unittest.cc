@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/db/interval_index.h"
+
+#include <algorithm>
+#include <random>
+
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto {
+namespace trace_processor {
+namespace {
+
+using Interval = IntervalIndex::Interval;
+
+std::vector<uint32_t> Query(const IntervalIndex& index,
+                            int64_t min_end,
+                            int64_t max_start) {
+  std::vector<uint32_t> ids;
+  index.Query(min_end, max_start, &ids);
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+TEST(IntervalIndexUnittest, Empty) {
+  IntervalIndex index;
+  ASSERT_THAT(Query(index, 0, 100), testing::IsEmpty());
+
+  index = IntervalIndex(std::vector<Interval>());
+  ASSERT_THAT(Query(index, 0, 100), testing::IsEmpty());
+}
+
+TEST(IntervalIndexUnittest, Simple) {
+  IntervalIndex index({Interval{0, 100, 0}, Interval{10, 20, 1},
+                       Interval{15, 50, 2}, Interval{60, 60, 3},
+                       Interval{70, 80, 4}});
+  ASSERT_EQ(index.size(), 5u);
+
+  ASSERT_THAT(Query(index, 0, 5), testing::ElementsAre(0));
+  ASSERT_THAT(Query(index, 20, 20), testing::ElementsAre(0, 1, 2));
+  ASSERT_THAT(Query(index, 55, 65), testing::ElementsAre(0, 3));
+  ASSERT_THAT(Query(index, 60, 60), testing::ElementsAre(0, 3));
+  ASSERT_THAT(Query(index, 101, 200), testing::IsEmpty());
+  ASSERT_THAT(Query(index, -10, -1), testing::IsEmpty());
+}
+
+TEST(IntervalIndexUnittest, UnsortedAndNested) {
+  // Intervals nested in each other, like the slices of a thread.
+  IntervalIndex index({Interval{5, 6, 0}, Interval{0, 10, 1},
+                       Interval{2, 8, 2}, Interval{3, 4, 3}});
+
+  ASSERT_THAT(Query(index, 5, 5), testing::ElementsAre(0, 1, 2));
+  ASSERT_THAT(Query(index, 9, 100), testing::ElementsAre(1));
+  ASSERT_THAT(Query(index, 3, 3), testing::ElementsAre(1, 2, 3));
+}
+
+TEST(IntervalIndexUnittest, MatchesBruteForce) {
+  std::minstd_rand0 rnd_engine(42);
+  for (uint32_t size : {1u, 2u, 3u, 7u, 8u, 9u, 31u, 100u, 1000u, 4097u}) {
+    std::vector<Interval> intervals;
+    for (uint32_t i = 0; i < size; ++i) {
+      int64_t start = static_cast<int64_t>(rnd_engine() % 10000);
+      // Include a few long intervals which overlap most queries and a few
+      // intervals with negative durations.
+      int64_t dur = rnd_engine() % 50 == 0
+                        ? static_cast<int64_t>(rnd_engine() % 10000)
+                        : static_cast<int64_t>(rnd_engine() % 100) - 5;
+      intervals.emplace_back(Interval{start, start + dur, i});
+    }
+    IntervalIndex index(intervals);
+
+    for (uint32_t i = 0; i < 200; ++i) {
+      int64_t min_end = static_cast<int64_t>(rnd_engine() % 11000);
+      int64_t max_start = min_end + static_cast<int64_t>(rnd_engine() % 500);
+
+      std::vector<uint32_t> expected;
+      for (const Interval& interval : intervals) {
+        if (interval.start <= max_start && interval.end >= min_end)
+          expected.push_back(interval.id);
+      }
+      ASSERT_EQ(Query(index, min_end, max_start), expected)
+          << "size " << size << " query " << min_end << " " << max_start;
+    }
+  }
+}
+
+}  // namespace
+}  // namespace trace_processor
+}  // namespace perfetto
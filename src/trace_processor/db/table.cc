@@ -43,6 +43,21 @@ Table& Table::operator=(Table&& other) noexcept {
   return *this;
 }
 
+uint64_t Table::generation() const {
+  // The generation of the storage of each column only ever increases so their
+  // sum changes whenever any of them changes. Inserting rows always changes
+  // the row count, even for tables whose only column is the id column.
+  uint64_t generation = row_count_;
+  for (const Column& col : columns_)
+    generation += col.storage_generation();
+  return generation;
+}
+
+void Table::Compress() {
+  for (Column& col : columns_)
+    col.Compress();
+}
+
 Table Table::Copy() const {
   Table table = CopyExceptRowMaps();
   for (const RowMap& rm : row_maps_) {
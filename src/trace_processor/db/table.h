@@ -91,6 +91,26 @@ class Table {
     return rm;
   }
 
+  // Same as |FilterToRowMap| but also only keeps the rows whose interval,
+  // starting at the value of column |ts_col_idx| and lasting the value of
+  // column |dur_col_idx|, starts at or before |max_start| and ends at or after
+  // |min_end|. This is answered using an interval index over the two columns
+  // (see Column::FilterIntoOverlapping) in O(log(n) + k) time, before the
+  // other constraints are applied on the matching rows.
+  RowMap FilterOverlappingToRowMap(uint32_t ts_col_idx,
+                                   uint32_t dur_col_idx,
+                                   int64_t min_end,
+                                   int64_t max_start,
+                                   const std::vector<Constraint>& cs) const {
+    RowMap rm(0, row_count_);
+    columns_[ts_col_idx].FilterIntoOverlapping(columns_[dur_col_idx], min_end,
+                                               max_start, &rm);
+    for (const Constraint& c : cs) {
+      columns_[c.col_idx].FilterInto(c.op, c.value, &rm);
+    }
+    return rm;
+  }
+
   // Applies the given RowMap to the current table by picking out the rows
   // specified in the RowMap to be present in the output table.
   // Note: the RowMap should not reorder this table; this is guaranteed if the
@@ -145,6 +165,16 @@ class Table {
   // Returns an iterator into the Table.
   Iterator IterateRows() const { return Iterator(this); }
 
+  // Returns a number which changes every time rows are inserted in the table
+  // or values in the table are changed. This allows caching data derived from
+  // the contents of the table and detecting when it becomes stale.
+  uint64_t generation() const;
+
+  // Compresses the storage of all the columns of the table. This should be
+  // called once all the rows have been inserted: the table can still be
+  // modified afterwards but this decompresses the modified columns.
+  void Compress();
+
   uint32_t row_count() const { return row_count_; }
   const std::vector<RowMap>& row_maps() const { return row_maps_; }
 
@@ -42,7 +42,7 @@ class ForwardingTraceParser : public ChunkedTraceReader {
   ~ForwardingTraceParser() override;
 
   // ChunkedTraceReader implementation
-  util::Status Parse(std::unique_ptr<uint8_t[]>, size_t) override;
+  util::Status Parse(TraceBlobView) override;
 
  private:
   TraceProcessorContext* const context_;
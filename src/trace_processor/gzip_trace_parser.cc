@@ -41,17 +41,17 @@ GzipTraceParser::~GzipTraceParser() {
   inflateEnd(z_stream_.get());
 }
 
-util::Status GzipTraceParser::Parse(std::unique_ptr<uint8_t[]> data,
-                                    size_t size) {
-  uint8_t* start = data.get();
-  size_t len = size;
+util::Status GzipTraceParser::Parse(TraceBlobView blob) {
+  // zlib doesn't modify the input buffer, but takes a non-const pointer to it.
+  uint8_t* start = const_cast<uint8_t*>(blob.data());
+  size_t len = blob.length();
 
   if (!inner_) {
     inner_.reset(new ForwardingTraceParser(context_));
 
     // .ctrace files begin with: "TRACE:\n" or "done. TRACE:\n" strip this if
     // present.
-    base::StringView beginning(reinterpret_cast<char*>(start), size);
+    base::StringView beginning(reinterpret_cast<char*>(start), len);
 
     static const char* kSystraceFileHeader = "TRACE:\n";
     size_t offset = Find(kSystraceFileHeader, beginning);
@@ -84,7 +84,8 @@ util::Status GzipTraceParser::Parse(std::unique_ptr<uint8_t[]> data,
     }
 
     size_t read = kUncompressedBufferSize - z_stream_->avail_out;
-    util::Status status = inner_->Parse(std::move(buffer), read);
+    util::Status status =
+        inner_->Parse(TraceBlobView(std::move(buffer), 0, read));
     if (!status.ok())
       return status;
   }
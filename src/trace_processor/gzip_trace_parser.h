@@ -32,7 +32,7 @@ class GzipTraceParser : public ChunkedTraceReader {
   ~GzipTraceParser() override;
 
   // ChunkedTraceReader implementation
-  util::Status Parse(std::unique_ptr<uint8_t[]>, size_t) override;
+  util::Status Parse(TraceBlobView) override;
 
  private:
   TraceProcessorContext* const context_;
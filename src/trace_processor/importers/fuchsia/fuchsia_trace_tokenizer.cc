@@ -70,8 +70,10 @@ FuchsiaTraceTokenizer::FuchsiaTraceTokenizer(TraceProcessorContext* context)
 
 FuchsiaTraceTokenizer::~FuchsiaTraceTokenizer() = default;
 
-util::Status FuchsiaTraceTokenizer::Parse(std::unique_ptr<uint8_t[]> data,
-                                          size_t size) {
+util::Status FuchsiaTraceTokenizer::Parse(TraceBlobView blob) {
+  const uint8_t* data = blob.data();
+  size_t size = blob.length();
+
   // The relevant internal state is |leftover_bytes_|. Each call to Parse should
   // maintain the following properties, unless a fatal error occurs in which
   // case it should return false and no assumptions should be made about the
@@ -95,8 +97,8 @@ util::Status FuchsiaTraceTokenizer::Parse(std::unique_ptr<uint8_t[]> data,
   if (leftover_bytes_.size() + size < 8) {
     // Even with the new bytes, we can't even read the header of the next
     // record, so just add the new bytes to |leftover_bytes_| and return.
-    leftover_bytes_.insert(leftover_bytes_.end(), data.get() + byte_offset,
-                           data.get() + size);
+    leftover_bytes_.insert(leftover_bytes_.end(), data + byte_offset,
+                           data + size);
     return util::OkStatus();
   }
   if (leftover_bytes_.size() > 0) {
@@ -106,8 +108,8 @@ util::Status FuchsiaTraceTokenizer::Parse(std::unique_ptr<uint8_t[]> data,
       // Copy bytes into |leftover_bytes_| so that the whole header is present,
       // and update |byte_offset| and |size| accordingly.
       size_t needed_bytes = 8 - leftover_bytes_.size();
-      leftover_bytes_.insert(leftover_bytes_.end(), data.get() + byte_offset,
-                             data.get() + needed_bytes);
+      leftover_bytes_.insert(leftover_bytes_.end(), data + byte_offset,
+                             data + needed_bytes);
       byte_offset += needed_bytes;
       size -= needed_bytes;
     }
@@ -140,13 +142,13 @@ util::Status FuchsiaTraceTokenizer::Parse(std::unique_ptr<uint8_t[]> data,
     } else {
       // There are not enough bytes for the full record. Add all the bytes we
       // have to leftover_bytes_ and wait for more.
-      leftover_bytes_.insert(leftover_bytes_.end(), data.get() + byte_offset,
-                             data.get() + byte_offset + size);
+      leftover_bytes_.insert(leftover_bytes_.end(), data + byte_offset,
+                             data + byte_offset + size);
       return util::OkStatus();
     }
   }
 
-  TraceBlobView full_view(std::move(data), byte_offset, size);
+  TraceBlobView full_view = blob.slice(blob.offset() + byte_offset, size);
 
   // |record_offset| is a number of bytes past |byte_offset| where the record
   // under consideration starts. As a result, it must always be in the range [0,
@@ -165,7 +167,7 @@ util::Status FuchsiaTraceTokenizer::Parse(std::unique_ptr<uint8_t[]> data,
       break;
 
     TraceBlobView record =
-        full_view.slice(byte_offset + record_offset, record_len_bytes);
+        full_view.slice(full_view.offset() + record_offset, record_len_bytes);
     ParseRecord(std::move(record));
 
     record_offset += record_len_bytes;
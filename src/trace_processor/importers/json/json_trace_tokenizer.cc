@@ -102,9 +102,8 @@ JsonTraceTokenizer::JsonTraceTokenizer(TraceProcessorContext* ctx)
     : context_(ctx) {}
 JsonTraceTokenizer::~JsonTraceTokenizer() = default;
 
-util::Status JsonTraceTokenizer::Parse(std::unique_ptr<uint8_t[]> data,
-                                       size_t size) {
-  buffer_.insert(buffer_.end(), data.get(), data.get() + size);
+util::Status JsonTraceTokenizer::Parse(TraceBlobView blob) {
+  buffer_.insert(buffer_.end(), blob.data(), blob.data() + blob.length());
   const char* buf = buffer_.data();
   const char* next = buf;
   const char* end = buf + buffer_.size();
@@ -47,7 +47,7 @@ class JsonTraceTokenizer : public ChunkedTraceReader {
   ~JsonTraceTokenizer() override;
 
   // ChunkedTraceReader implementation.
-  util::Status Parse(std::unique_ptr<uint8_t[]>, size_t) override;
+  util::Status Parse(TraceBlobView) override;
 
  private:
   TraceProcessorContext* const context_;
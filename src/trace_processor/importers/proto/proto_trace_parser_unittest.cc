@@ -252,8 +252,8 @@ class ProtoTraceParserTest : public ::testing::Test {
     std::unique_ptr<uint8_t[]> raw_trace(new uint8_t[trace_bytes.size()]);
     memcpy(raw_trace.get(), trace_bytes.data(), trace_bytes.size());
     context_.chunk_reader.reset(new ProtoTraceTokenizer(&context_));
-    auto status =
-        context_.chunk_reader->Parse(std::move(raw_trace), trace_bytes.size());
+    auto status = context_.chunk_reader->Parse(
+        TraceBlobView(std::move(raw_trace), 0, trace_bytes.size()));
 
     ResetTraceBuffers();
     return status;
@@ -1693,6 +1693,110 @@ TEST_F(ProtoTraceParserTest, TrackEventMultipleSequences) {
   context_.sorter->ExtractEventsForced();
 }
 
+TEST_F(ProtoTraceParserTest, TrackEventCoalescedPackets) {
+  context_.sorter.reset(new TraceSorter(
+      &context_, std::numeric_limits<int64_t>::max() /*window size*/));
+
+  // Coalesced packets are written by the producer without any trusted fields.
+  protozero::HeapBuffered<protos::pbzero::Trace> coalesced;
+  {
+    auto* packet = coalesced->add_packet();
+    packet->set_incremental_state_cleared(true);
+    auto* thread_desc = packet->set_thread_descriptor();
+    thread_desc->set_pid(15);
+    thread_desc->set_tid(16);
+    thread_desc->set_reference_timestamp_us(1000);
+    thread_desc->set_reference_thread_time_us(2000);
+  }
+  {
+    auto* packet = coalesced->add_packet();
+    auto* event = packet->set_track_event();
+    event->set_timestamp_delta_us(10);   // absolute: 1010.
+    event->set_thread_time_delta_us(5);  // absolute: 2005.
+    event->add_category_iids(1);
+    auto* legacy_event = event->set_legacy_event();
+    legacy_event->set_name_iid(1);
+    legacy_event->set_phase('B');
+
+    auto* interned_data = packet->set_interned_data();
+    auto cat1 = interned_data->add_event_categories();
+    cat1->set_iid(1);
+    cat1->set_name("cat1");
+    auto ev1 = interned_data->add_event_names();
+    ev1->set_iid(1);
+    ev1->set_name("ev1");
+  }
+  std::vector<uint8_t> first_batch = coalesced.SerializeAsArray();
+  coalesced.Reset();
+  {
+    auto* packet = coalesced->add_packet();
+    // The sequence id of the enclosing packet takes precedence over the one
+    // written by the producer.
+    packet->set_trusted_packet_sequence_id(2);
+    auto* event = packet->set_track_event();
+    event->set_timestamp_delta_us(10);   // absolute: 1020.
+    event->set_thread_time_delta_us(5);  // absolute: 2010.
+    event->add_category_iids(1);
+    auto* legacy_event = event->set_legacy_event();
+    legacy_event->set_name_iid(1);
+    legacy_event->set_phase('E');
+  }
+  std::vector<uint8_t> second_batch = coalesced.SerializeAsArray();
+
+  {
+    auto* packet = trace_.add_packet();
+    packet->set_trusted_packet_sequence_id(1);
+    packet->set_coalesced_packets(first_batch.data(), first_batch.size());
+  }
+  {
+    auto* packet = trace_.add_packet();
+    packet->set_trusted_packet_sequence_id(1);
+    packet->set_coalesced_packets(second_batch.data(), second_batch.size());
+  }
+
+  Tokenize();
+
+  EXPECT_CALL(*process_, UpdateThread(16, 15))
+      .Times(2)
+      .WillRepeatedly(Return(1));
+
+  TraceStorage::Thread thread(16);
+  thread.upid = 1u;
+  EXPECT_CALL(*storage_, GetThread(1))
+      .Times(2)
+      .WillRepeatedly(testing::ReturnRef(thread));
+
+  EXPECT_CALL(*storage_, InternString(base::StringView("cat1")))
+      .WillRepeatedly(Return(1));
+  EXPECT_CALL(*storage_, InternString(base::StringView("ev1")))
+      .WillRepeatedly(Return(2));
+
+  constexpr TrackId track{0u};
+  InSequence in_sequence;  // Below slices should be sorted by timestamp.
+
+  EXPECT_CALL(*slice_, Begin(1010000, track, StringId(1), StringId(2), _));
+  EXPECT_CALL(*slice_, End(1020000, track, StringId(1), StringId(2), _));
+
+  context_.sorter->ExtractEventsForced();
+}
+
+TEST_F(ProtoTraceParserTest, NestedCoalescedPacketsRejected) {
+  protozero::HeapBuffered<protos::pbzero::Trace> inner;
+  inner->add_packet()->set_timestamp(1000);
+  std::vector<uint8_t> inner_batch = inner.SerializeAsArray();
+
+  protozero::HeapBuffered<protos::pbzero::Trace> outer;
+  outer->add_packet()->set_coalesced_packets(inner_batch.data(),
+                                             inner_batch.size());
+  std::vector<uint8_t> outer_batch = outer.SerializeAsArray();
+
+  auto* packet = trace_.add_packet();
+  packet->set_trusted_packet_sequence_id(1);
+  packet->set_coalesced_packets(outer_batch.data(), outer_batch.size());
+
+  ASSERT_FALSE(Tokenize().ok());
+}
+
 TEST_F(ProtoTraceParserTest, TrackEventWithDebugAnnotations) {
   context_.sorter.reset(new TraceSorter(
       &context_, std::numeric_limits<int64_t>::max() /*window size*/));
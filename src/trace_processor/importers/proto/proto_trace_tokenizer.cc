@@ -45,8 +45,11 @@
 namespace perfetto {
 namespace trace_processor {
 
+using protozero::proto_utils::kMaxSimpleFieldEncodedSize;
 using protozero::proto_utils::MakeTagLengthDelimited;
+using protozero::proto_utils::MakeTagVarInt;
 using protozero::proto_utils::ParseVarInt;
+using protozero::proto_utils::WriteVarInt;
 
 namespace {
 
@@ -88,9 +91,9 @@ ProtoTraceTokenizer::ProtoTraceTokenizer(TraceProcessorContext* ctx)
     : context_(ctx) {}
 ProtoTraceTokenizer::~ProtoTraceTokenizer() = default;
 
-util::Status ProtoTraceTokenizer::Parse(std::unique_ptr<uint8_t[]> owned_buf,
-                                        size_t size) {
-  uint8_t* data = &owned_buf[0];
+util::Status ProtoTraceTokenizer::Parse(TraceBlobView blob) {
+  const uint8_t* data = blob.data();
+  size_t size = blob.length();
   if (!partial_buf_.empty()) {
     // It takes ~5 bytes for a proto preamble + the varint size.
     const size_t kHeaderBytes = 5;
@@ -139,9 +142,8 @@ util::Status ProtoTraceTokenizer::Parse(std::unique_ptr<uint8_t[]> owned_buf,
       data += size_missing;
       size -= size_missing;
       partial_buf_.clear();
-      uint8_t* buf_start = &buf[0];  // Note that buf is std::moved below.
       util::Status status =
-          ParseInternal(std::move(buf), buf_start, size_incl_header);
+          ParseInternal(TraceBlobView(std::move(buf), 0, size_incl_header));
       if (PERFETTO_UNLIKELY(!status.ok()))
         return status;
     } else {
@@ -149,19 +151,12 @@ util::Status ProtoTraceTokenizer::Parse(std::unique_ptr<uint8_t[]> owned_buf,
       return util::OkStatus();
     }
   }
-  return ParseInternal(std::move(owned_buf), data, size);
+  return ParseInternal(blob.slice(blob.offset_of(data), size));
 }
 
-util::Status ProtoTraceTokenizer::ParseInternal(
-    std::unique_ptr<uint8_t[]> owned_buf,
-    uint8_t* data,
-    size_t size) {
-  PERFETTO_DCHECK(data >= &owned_buf[0]);
-  const uint8_t* start = &owned_buf[0];
-  const size_t data_off = static_cast<size_t>(data - start);
-  TraceBlobView whole_buf(std::move(owned_buf), data_off, size);
-
-  protos::pbzero::Trace::Decoder decoder(data, size);
+util::Status ProtoTraceTokenizer::ParseInternal(TraceBlobView whole_buf) {
+  const uint8_t* data = whole_buf.data();
+  protos::pbzero::Trace::Decoder decoder(data, whole_buf.length());
   for (auto it = decoder.packet(); it; ++it) {
     protozero::ConstBytes packet = *it;
     size_t field_offset = whole_buf.offset_of(packet.data);
@@ -336,6 +331,14 @@ util::Status ProtoTraceTokenizer::ParsePacket(TraceBlobView packet) {
     return util::OkStatus();
   }
 
+  if (decoder.has_coalesced_packets()) {
+    // Producers only coalesce the packets they write, which never contain
+    // coalesced packets themselves: don't recurse on corrupt traces.
+    if (PERFETTO_UNLIKELY(parsing_coalesced_packets_))
+      return util::ErrStatus("Coalesced packets cannot be nested");
+    return ParseCoalescedPackets(decoder, decoder.coalesced_packets());
+  }
+
   // If we're not forcing a full sort and this is a write_into_file trace, then
   // use flush_period_ms as an indiciator for how big the sliding window for the
   // sorter should be.
@@ -371,6 +374,65 @@ util::Status ProtoTraceTokenizer::ParsePacket(TraceBlobView packet) {
   return util::OkStatus();
 }
 
+util::Status ProtoTraceTokenizer::ParseCoalescedPackets(
+    const protos::pbzero::TracePacket_Decoder& packet_decoder,
+    ConstBytes packets) {
+  // The coalesced packets were written by the producer, so they lack the
+  // trusted fields which the service appends to each packet. Copy them over
+  // from the enclosing packet. Like the service does, append them after the
+  // fields of each packet so that they take precedence over any (untrusted)
+  // values written by the producer.
+  uint8_t trusted_fields[2 * kMaxSimpleFieldEncodedSize];
+  uint8_t* wptr = trusted_fields;
+  if (packet_decoder.has_trusted_uid()) {
+    wptr = WriteVarInt(
+        MakeTagVarInt(protos::pbzero::TracePacket::kTrustedUidFieldNumber),
+        wptr);
+    wptr = WriteVarInt(packet_decoder.trusted_uid(), wptr);
+  }
+  if (packet_decoder.has_trusted_packet_sequence_id()) {
+    wptr = WriteVarInt(
+        MakeTagVarInt(
+            protos::pbzero::TracePacket::kTrustedPacketSequenceIdFieldNumber),
+        wptr);
+    wptr = WriteVarInt(packet_decoder.trusted_packet_sequence_id(), wptr);
+  }
+  const size_t trusted_fields_size = static_cast<size_t>(wptr - trusted_fields);
+
+  protos::pbzero::Trace::Decoder trace(packets.data, packets.size);
+  if (PERFETTO_UNLIKELY(trace.bytes_left())) {
+    return util::ErrStatus(
+        "Failed to parse coalesced packets; the trace is probably corrupt.");
+  }
+
+  // Copy all the packets into a single buffer, each followed by the trusted
+  // fields, and tokenize them like any other packet of the sequence.
+  size_t total_size = 0;
+  for (auto it = trace.packet(); it; ++it)
+    total_size += (*it).size + trusted_fields_size;
+
+  std::unique_ptr<uint8_t[]> buf(new uint8_t[total_size]);
+  uint8_t* dst = buf.get();
+  for (auto it = trace.packet(); it; ++it) {
+    protozero::ConstBytes packet = *it;
+    memcpy(dst, packet.data, packet.size);
+    memcpy(dst + packet.size, trusted_fields, trusted_fields_size);
+    dst += packet.size + trusted_fields_size;
+  }
+
+  TraceBlobView whole_buf(std::move(buf), 0, total_size);
+  size_t offset = 0;
+  util::Status status = util::OkStatus();
+  parsing_coalesced_packets_ = true;
+  for (auto it = trace.packet(); it && status.ok(); ++it) {
+    size_t size = (*it).size + trusted_fields_size;
+    status = ParsePacket(whole_buf.slice(offset, size));
+    offset += size;
+  }
+  parsing_coalesced_packets_ = false;
+  return status;
+}
+
 void ProtoTraceTokenizer::HandleIncrementalStateCleared(
     const protos::pbzero::TracePacket::Decoder& packet_decoder) {
   if (PERFETTO_UNLIKELY(!packet_decoder.has_trusted_packet_sequence_id())) {
@@ -55,14 +55,14 @@ class ProtoTraceTokenizer : public ChunkedTraceReader {
   ~ProtoTraceTokenizer() override;
 
   // ChunkedTraceReader implementation.
-  util::Status Parse(std::unique_ptr<uint8_t[]>, size_t size) override;
+  util::Status Parse(TraceBlobView) override;
 
  private:
   using ConstBytes = protozero::ConstBytes;
-  util::Status ParseInternal(std::unique_ptr<uint8_t[]> owned_buf,
-                             uint8_t* data,
-                             size_t size);
+  util::Status ParseInternal(TraceBlobView whole_buf);
   util::Status ParsePacket(TraceBlobView);
+  util::Status ParseCoalescedPackets(const protos::pbzero::TracePacket_Decoder&,
+                                     ConstBytes packets);
   util::Status ParseClockSnapshot(ConstBytes blob, uint32_t seq_id);
   void HandleIncrementalStateCleared(
       const protos::pbzero::TracePacket_Decoder&);
@@ -88,6 +88,10 @@ class ProtoTraceTokenizer : public ChunkedTraceReader {
   // timestamp given is latest_timestamp_.
   int64_t latest_timestamp_ = 0;
 
+  // Whether the packets being parsed come from the coalesced_packets field of
+  // another packet.
+  bool parsing_coalesced_packets_ = false;
+
   // Stores incremental state and references to interned data, e.g. for track
   // event protos.
   std::unique_ptr<ProtoIncrementalState> incremental_state;
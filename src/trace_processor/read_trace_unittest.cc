@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "perfetto/trace_processor/read_trace.h"
+
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "perfetto/ext/base/file_utils.h"
+#include "perfetto/ext/base/scoped_file.h"
+#include "perfetto/ext/base/temp_file.h"
+#include "perfetto/protozero/scattered_heap_buffer.h"
+#include "perfetto/trace_processor/trace_processor.h"
+#include "test/gtest_and_gmock.h"
+
+#include "protos/perfetto/trace/ftrace/ftrace_event.pbzero.h"
+#include "protos/perfetto/trace/ftrace/ftrace_event_bundle.pbzero.h"
+#include "protos/perfetto/trace/ftrace/power.pbzero.h"
+#include "protos/perfetto/trace/test_event.pbzero.h"
+#include "protos/perfetto/trace/trace.pbzero.h"
+#include "protos/perfetto/trace/trace_packet.pbzero.h"
+
+namespace perfetto {
+namespace trace_processor {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::Pair;
+
+// ReadTrace() maps the trace file in slices of this size.
+constexpr size_t kMmapSliceSize = 32 * 1024 * 1024;
+
+void AddCpuFrequency(protos::pbzero::Trace* trace, int64_t ts, uint32_t freq) {
+  auto* bundle = trace->add_packet()->set_ftrace_events();
+  bundle->set_cpu(0);
+  auto* event = bundle->add_event();
+  event->set_timestamp(static_cast<uint64_t>(ts));
+  event->set_pid(1);
+  auto* cpu_frequency = event->set_cpu_frequency();
+  cpu_frequency->set_cpu_id(0);
+  cpu_frequency->set_state(freq);
+}
+
+// Returns a trace with two cpu frequency changes. If |padding| is not zero,
+// they are separated by a packet of about |padding| bytes which is ignored by
+// the trace processor.
+std::vector<uint8_t> MakeTrace(size_t padding) {
+  protozero::HeapBuffered<protos::pbzero::Trace> trace;
+  AddCpuFrequency(trace.get(), 1000, 100);
+  if (padding > 0) {
+    std::string str(padding, 'x');
+    trace->add_packet()->set_for_testing()->set_str(str);
+  }
+  AddCpuFrequency(trace.get(), 2000, 200);
+  return trace.SerializeAsArray();
+}
+
+// Returns the (ts, value) pairs of the counter table.
+std::vector<std::pair<int64_t, double>> GetCounters(TraceProcessor* tp) {
+  auto it = tp->ExecuteQuery("select ts, value from counter order by ts");
+  std::vector<std::pair<int64_t, double>> counters;
+  while (it.Next())
+    counters.emplace_back(it.Get(0).long_value, it.Get(1).double_value);
+  EXPECT_TRUE(it.Status().ok());
+  return counters;
+}
+
+void WriteFile(const std::string& path, const std::vector<uint8_t>& data) {
+  base::ScopedFile fd(base::OpenFile(path, O_WRONLY | O_CREAT | O_TRUNC, 0600));
+  ASSERT_TRUE(fd);
+  ASSERT_EQ(base::WriteAll(*fd, data.data(), data.size()),
+            static_cast<ssize_t>(data.size()));
+}
+
+TEST(ReadTraceTest, ExternalBufferReleasedOnce) {
+  std::vector<uint8_t> trace = MakeTrace(0);
+  std::unique_ptr<TraceProcessor> tp = TraceProcessor::CreateInstance(Config());
+  int release_count = 0;
+  util::Status status = tp->ParseExternalBuffer(
+      trace.data(), trace.size(), [&release_count] { release_count++; });
+  ASSERT_TRUE(status.ok());
+
+  // The sorter still refers to the packets of the buffer.
+  ASSERT_EQ(release_count, 0);
+  tp->NotifyEndOfFile();
+  ASSERT_EQ(release_count, 1);
+  ASSERT_THAT(GetCounters(tp.get()),
+              ElementsAre(Pair(1000, 100), Pair(2000, 200)));
+
+  tp.reset();
+  ASSERT_EQ(release_count, 1);
+}
+
+TEST(ReadTraceTest, ExternalBufferReleasedOnError) {
+  // Nested coalesced packets are an unrecoverable error.
+  protozero::HeapBuffered<protos::pbzero::Trace> inner;
+  inner->add_packet()->set_timestamp(1000);
+  std::vector<uint8_t> inner_packets = inner.SerializeAsArray();
+  protozero::HeapBuffered<protos::pbzero::Trace> outer;
+  outer->add_packet()->set_coalesced_packets(inner_packets.data(),
+                                             inner_packets.size());
+  std::vector<uint8_t> outer_packets = outer.SerializeAsArray();
+  protozero::HeapBuffered<protos::pbzero::Trace> invalid;
+  invalid->add_packet()->set_coalesced_packets(outer_packets.data(),
+                                               outer_packets.size());
+  std::vector<uint8_t> invalid_trace = invalid.SerializeAsArray();
+
+  std::unique_ptr<TraceProcessor> tp = TraceProcessor::CreateInstance(Config());
+  int invalid_release_count = 0;
+  util::Status status = tp->ParseExternalBuffer(
+      invalid_trace.data(), invalid_trace.size(),
+      [&invalid_release_count] { invalid_release_count++; });
+  ASSERT_FALSE(status.ok());
+  ASSERT_EQ(invalid_release_count, 1);
+
+  // Buffers are dropped after an unrecoverable error.
+  std::vector<uint8_t> trace = MakeTrace(0);
+  int release_count = 0;
+  status = tp->ParseExternalBuffer(trace.data(), trace.size(),
+                                   [&release_count] { release_count++; });
+  ASSERT_FALSE(status.ok());
+  ASSERT_EQ(release_count, 1);
+}
+
+TEST(ReadTraceTest, PacketsAcrossMmapSlices) {
+  // Make the second cpu frequency packet (which takes more than 5 bytes)
+  // straddle the boundary between the first two slices of the mapping by
+  // ending the trace 5 bytes after it. The padding is adjusted once as the
+  // size of its encoding depends on its length.
+  const size_t target_size = kMmapSliceSize + 5;
+  size_t padding = kMmapSliceSize;
+  padding -= MakeTrace(padding).size() - target_size;
+  std::vector<uint8_t> trace = MakeTrace(padding);
+  ASSERT_EQ(trace.size(), target_size);
+
+  base::TempFile file = base::TempFile::Create();
+  WriteFile(file.path(), trace);
+
+  std::unique_ptr<TraceProcessor> tp = TraceProcessor::CreateInstance(Config());
+  std::vector<uint64_t> progress;
+  util::Status status =
+      ReadTrace(tp.get(), file.path().c_str(),
+                [&progress](uint64_t size) { progress.push_back(size); });
+  ASSERT_TRUE(status.ok());
+  ASSERT_THAT(progress, ElementsAre(0u, kMmapSliceSize, trace.size()));
+  ASSERT_THAT(GetCounters(tp.get()),
+              ElementsAre(Pair(1000, 100), Pair(2000, 200)));
+}
+
+TEST(ReadTraceTest, FallbackToReadWhenMmapFails) {
+  // Pipes cannot be mapped so ReadTrace() has to read() them.
+  base::TempDir dir = base::TempDir::Create();
+  std::string path = dir.path() + "/trace_fifo";
+  ASSERT_EQ(mkfifo(path.c_str(), 0600), 0);
+
+  std::vector<uint8_t> trace = MakeTrace(0);
+  std::thread writer([&path, &trace] { WriteFile(path, trace); });
+
+  std::unique_ptr<TraceProcessor> tp = TraceProcessor::CreateInstance(Config());
+  util::Status status = ReadTrace(tp.get(), path.c_str());
+  writer.join();
+  unlink(path.c_str());
+
+  ASSERT_TRUE(status.ok()) << status.message();
+  ASSERT_THAT(GetCounters(tp.get()),
+              ElementsAre(Pair(1000, 100), Pair(2000, 200)));
+}
+
+}  // namespace
+}  // namespace trace_processor
+}  // namespace perfetto
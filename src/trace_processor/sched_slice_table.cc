@@ -93,8 +93,8 @@ uint32_t SchedSliceTable::EstimateQueryCost(const QueryConstraints& qc) {
 
 SchedSliceTable::EndStateColumn::EndStateColumn(
     std::string col_name,
-    const std::deque<ftrace_utils::TaskState>* deque)
-    : StorageColumn(col_name, false), deque_(deque) {
+    const ChunkedVector<ftrace_utils::TaskState>* data)
+    : StorageColumn(col_name, false), data_(data) {
   for (uint16_t i = 0; i < state_strings_.size(); i++) {
     state_strings_[i] = ftrace_utils::TaskState(i).ToString();
   }
@@ -103,7 +103,7 @@ SchedSliceTable::EndStateColumn::~EndStateColumn() = default;
 
 void SchedSliceTable::EndStateColumn::ReportResult(sqlite3_context* ctx,
                                                    uint32_t row) const {
-  const auto& state = (*deque_)[row];
+  const auto& state = (*data_)[row];
   if (state.is_valid()) {
     PERFETTO_CHECK(state.raw_state() < state_strings_.size());
     sqlite3_result_text(ctx, state_strings_[state.raw_state()].data(), -1,
@@ -121,7 +121,7 @@ void SchedSliceTable::EndStateColumn::Filter(int op,
     case SQLITE_INDEX_CONSTRAINT_ISNOTNULL: {
       bool non_nulls = op == SQLITE_INDEX_CONSTRAINT_ISNOTNULL;
       index->FilterRows([this, non_nulls](uint32_t row) {
-        const auto& state = (*deque_)[row];
+        const auto& state = (*data_)[row];
         return state.is_valid() == non_nulls;
       });
       break;
@@ -156,17 +156,17 @@ void SchedSliceTable::EndStateColumn::FilterOnState(
   uint16_t raw_state = compare.raw_state();
   if (op == SQLITE_INDEX_CONSTRAINT_EQ) {
     index->FilterRows([this, raw_state](uint32_t row) {
-      const auto& state = (*deque_)[row];
+      const auto& state = (*data_)[row];
       return state.is_valid() && state.raw_state() == raw_state;
     });
   } else if (op == SQLITE_INDEX_CONSTRAINT_NE) {
     index->FilterRows([this, raw_state](uint32_t row) {
-      const auto& state = (*deque_)[row];
+      const auto& state = (*data_)[row];
       return state.is_valid() && state.raw_state() != raw_state;
     });
   } else if (op == SQLITE_INDEX_CONSTRAINT_MATCH) {
     index->FilterRows([this, compare](uint32_t row) {
-      const auto& state = (*deque_)[row];
+      const auto& state = (*data_)[row];
       if (!state.is_valid())
         return false;
       return (state.raw_state() & compare.raw_state()) == compare.raw_state();
@@ -180,8 +180,8 @@ StorageColumn::Comparator SchedSliceTable::EndStateColumn::Sort(
     const QueryConstraints::OrderBy& ob) const {
   if (ob.desc) {
     return [this](uint32_t f, uint32_t s) {
-      const auto& a = (*deque_)[f];
-      const auto& b = (*deque_)[s];
+      const auto& a = (*data_)[f];
+      const auto& b = (*data_)[s];
       if (!a.is_valid()) {
         return !b.is_valid() ? 0 : 1;
       } else if (!b.is_valid()) {
@@ -191,8 +191,8 @@ StorageColumn::Comparator SchedSliceTable::EndStateColumn::Sort(
     };
   }
   return [this](uint32_t f, uint32_t s) {
-    const auto& a = (*deque_)[f];
-    const auto& b = (*deque_)[s];
+    const auto& a = (*data_)[f];
+    const auto& b = (*data_)[s];
     if (!a.is_valid()) {
       return !b.is_valid() ? 0 : -1;
     } else if (!b.is_valid()) {
@@ -17,6 +17,7 @@
 #ifndef SRC_TRACE_PROCESSOR_SCHED_SLICE_TABLE_H_
 #define SRC_TRACE_PROCESSOR_SCHED_SLICE_TABLE_H_
 
+#include "src/trace_processor/containers/chunked_vector.h"
 #include "src/trace_processor/ftrace_utils.h"
 #include "src/trace_processor/storage_table.h"
 
@@ -42,7 +43,7 @@ class SchedSliceTable : public StorageTable {
   class EndStateColumn : public StorageColumn {
    public:
     EndStateColumn(std::string col_name,
-                   const std::deque<ftrace_utils::TaskState>* deque);
+                   const ChunkedVector<ftrace_utils::TaskState>* data);
     ~EndStateColumn() override;
 
     void ReportResult(sqlite3_context*, uint32_t row) const override;
@@ -63,7 +64,7 @@ class SchedSliceTable : public StorageTable {
                        sqlite3_value* value,
                        FilteredRowIndex* index) const;
 
-    const std::deque<ftrace_utils::TaskState>* deque_ = nullptr;
+    const ChunkedVector<ftrace_utils::TaskState>* data_ = nullptr;
   };
 
   const TraceStorage* const storage_;
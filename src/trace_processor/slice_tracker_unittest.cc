@@ -97,7 +97,7 @@ TEST(SliceTrackerTest, OneSliceWithArgs) {
   EXPECT_EQ(slices.depth()[0], 0u);
   auto set_id = slices.arg_set_id()[0];
 
-  auto args = context.storage->args();
+  const auto& args = context.storage->args();
   EXPECT_EQ(args.set_ids()[0], set_id);
   EXPECT_EQ(args.flat_keys()[0], 1u);
   EXPECT_EQ(args.keys()[0], 2u);
@@ -0,0 +1,161 @@
+// Copyright (C) 2020 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <sqlite3.h>
+
+#include <random>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "perfetto/base/logging.h"
+#include "src/trace_processor/db/table.h"
+#include "src/trace_processor/span_join_operator_table.h"
+#include "src/trace_processor/sqlite/db_sqlite_table.h"
+#include "src/trace_processor/sqlite/scoped_db.h"
+
+namespace {
+
+using perfetto::trace_processor::Column;
+using perfetto::trace_processor::DbSqliteTable;
+using perfetto::trace_processor::ScopedDb;
+using perfetto::trace_processor::ScopedStmt;
+using perfetto::trace_processor::SpanJoinOperatorTable;
+using perfetto::trace_processor::SparseVector;
+using perfetto::trace_processor::StringPool;
+using perfetto::trace_processor::Table;
+
+constexpr uint32_t kNumCpus = 8;
+
+// A db table of back to back cpu frequency spans on each cpu, sorted by ts
+// like the counter table.
+class FreqTable : public Table {
+ public:
+  FreqTable(StringPool* pool, uint32_t spans_per_cpu)
+      : Table(pool, nullptr) {
+    std::minstd_rand0 rnd_engine(476);
+    for (uint32_t i = 0; i < spans_per_cpu; ++i) {
+      for (uint32_t cpu = 0; cpu < kNumCpus; ++cpu) {
+        ts_.Append(static_cast<int64_t>(i) * 10000 + cpu);
+        dur_.Append(10000);
+        cpu_.Append(cpu);
+        freq_.Append(static_cast<int64_t>(rnd_engine() % 2000000));
+      }
+    }
+    row_count_ = ts_.size();
+    row_maps_.emplace_back(0, row_count_);
+    columns_.emplace_back(Column::IdColumn(this, 0u, 0u));
+    columns_.emplace_back(
+        Column("ts", &ts_, Column::Flag::kSorted, this, 1u, 0u));
+    columns_.emplace_back(
+        Column("dur", &dur_, Column::Flag::kNonNull, this, 2u, 0u));
+    columns_.emplace_back(
+        Column("cpu", &cpu_, Column::Flag::kNonNull, this, 3u, 0u));
+    columns_.emplace_back(
+        Column("freq", &freq_, Column::Flag::kNonNull, this, 4u, 0u));
+  }
+
+ private:
+  SparseVector<int64_t> ts_;
+  SparseVector<int64_t> dur_;
+  SparseVector<uint32_t> cpu_;
+  SparseVector<int64_t> freq_;
+};
+
+// Creates a SQLite table called sched with back to back slices of random
+// durations on each cpu.
+void CreateSchedTable(sqlite3* db, uint32_t slices_per_cpu) {
+  PERFETTO_CHECK(sqlite3_exec(db,
+                              "CREATE TABLE sched(ts BIG INT, dur BIG INT, "
+                              "cpu UNSIGNED INT, utid UNSIGNED INT)",
+                              nullptr, nullptr, nullptr) == SQLITE_OK);
+
+  sqlite3_stmt* raw_stmt = nullptr;
+  PERFETTO_CHECK(sqlite3_prepare_v2(db, "INSERT INTO sched VALUES(?, ?, ?, ?)",
+                                    -1, &raw_stmt, nullptr) == SQLITE_OK);
+  ScopedStmt stmt(raw_stmt);
+  std::minstd_rand0 rnd_engine(42);
+  sqlite3_exec(db, "BEGIN", nullptr, nullptr, nullptr);
+  for (uint32_t cpu = 0; cpu < kNumCpus; ++cpu) {
+    int64_t ts = 0;
+    for (uint32_t i = 0; i < slices_per_cpu; ++i) {
+      int64_t dur = 1000 + rnd_engine() % 18000;
+      sqlite3_bind_int64(*stmt, 1, ts);
+      sqlite3_bind_int64(*stmt, 2, dur);
+      sqlite3_bind_int64(*stmt, 3, cpu);
+      sqlite3_bind_int64(*stmt, 4, rnd_engine() % 1024);
+      PERFETTO_CHECK(sqlite3_step(*stmt) == SQLITE_DONE);
+      sqlite3_reset(*stmt);
+      ts += dur;
+    }
+  }
+  sqlite3_exec(db, "COMMIT", nullptr, nullptr, nullptr);
+}
+
+// Joins sched slices with cpu frequency spans, as done by metrics to get the
+// frequency of the cpu during each slice. |freq_input| is either the native
+// freq table or a view over it, which SPAN_JOIN has to query through SQLite.
+void SpanJoinFreqSched(benchmark::State& state, const char* freq_input) {
+  StringPool pool;
+  uint32_t spans_per_cpu = static_cast<uint32_t>(state.range(0));
+  FreqTable freq(&pool, spans_per_cpu);
+
+  sqlite3* raw_db = nullptr;
+  PERFETTO_CHECK(sqlite3_open(":memory:", &raw_db) == SQLITE_OK);
+  ScopedDb db(raw_db);
+
+  SpanJoinOperatorTable::NativeTables native_tables;
+  native_tables["freq"] = &freq;
+  SpanJoinOperatorTable::RegisterTable(*db, &native_tables);
+  DbSqliteTable::RegisterTable(*db, nullptr, &freq, "freq");
+  PERFETTO_CHECK(sqlite3_exec(*db,
+                              "CREATE VIEW freq_view AS SELECT * FROM freq",
+                              nullptr, nullptr, nullptr) == SQLITE_OK);
+  CreateSchedTable(*db, spans_per_cpu);
+
+  std::string create = std::string(
+                           "CREATE VIRTUAL TABLE sched_freq USING "
+                           "SPAN_JOIN(sched PARTITIONED cpu, ") +
+                       freq_input + " PARTITIONED cpu)";
+  PERFETTO_CHECK(sqlite3_exec(*db, create.c_str(), nullptr, nullptr,
+                              nullptr) == SQLITE_OK);
+
+  sqlite3_stmt* raw_stmt = nullptr;
+  PERFETTO_CHECK(sqlite3_prepare_v2(
+                     *db, "SELECT ts, dur, cpu, utid, freq FROM sched_freq",
+                     -1, &raw_stmt, nullptr) == SQLITE_OK);
+  ScopedStmt stmt(raw_stmt);
+
+  uint32_t rows = 0;
+  for (auto _ : state) {
+    rows = 0;
+    while (sqlite3_step(*stmt) == SQLITE_ROW)
+      rows++;
+    sqlite3_reset(*stmt);
+    benchmark::DoNotOptimize(rows);
+  }
+  state.counters["rows"] = rows;
+}
+
+static void BM_SpanJoinNativeInput(benchmark::State& state) {
+  SpanJoinFreqSched(state, "freq");
+}
+BENCHMARK(BM_SpanJoinNativeInput)->RangeMultiplier(8)->Range(1024, 64 * 1024);
+
+static void BM_SpanJoinSqliteInput(benchmark::State& state) {
+  SpanJoinFreqSched(state, "freq_view");
+}
+BENCHMARK(BM_SpanJoinSqliteInput)->RangeMultiplier(8)->Range(1024, 64 * 1024);
+
+}  // namespace
@@ -27,6 +27,7 @@
 #include "perfetto/ext/base/string_splitter.h"
 #include "perfetto/ext/base/string_utils.h"
 #include "perfetto/ext/base/string_view.h"
+#include "src/trace_processor/sqlite/db_sqlite_table.h"
 #include "src/trace_processor/sqlite/sqlite_utils.h"
 
 namespace perfetto {
@@ -52,22 +53,45 @@ base::Optional<std::string> HasDuplicateColumns(
   return base::nullopt;
 }
 
+// Fills |native_cols| with the index in |table| of each of |cols|. Returns
+// false if |cols| cannot all be read directly from |table|.
+bool ComputeNativeColumns(const Table& table,
+                          const std::vector<SqliteTable::Column>& cols,
+                          uint32_t partition_idx,
+                          std::vector<uint32_t>* native_cols) {
+  for (uint32_t i = 0; i < cols.size(); ++i) {
+    const auto* col = table.GetColumnByName(cols[i].name().c_str());
+
+    // Partitions are read as integers: leave converting any other type to
+    // SQLite.
+    if (!col || (i == partition_idx && col->type() != SqlValue::Type::kLong)) {
+      native_cols->clear();
+      return false;
+    }
+    native_cols->push_back(col->index_in_table());
+  }
+  return true;
+}
+
 }  // namespace
 
-SpanJoinOperatorTable::SpanJoinOperatorTable(sqlite3* db, const TraceStorage*)
-    : db_(db) {}
+SpanJoinOperatorTable::SpanJoinOperatorTable(sqlite3* db,
+                                             const NativeTables* native_tables)
+    : db_(db), native_tables_(native_tables) {}
 
 void SpanJoinOperatorTable::RegisterTable(sqlite3* db,
-                                          const TraceStorage* storage) {
-  SqliteTable::Register<SpanJoinOperatorTable>(db, storage, "span_join",
+                                          const NativeTables* native_tables) {
+  SqliteTable::Register<SpanJoinOperatorTable>(db, native_tables, "span_join",
                                                /* read_write */ false,
                                                /* requires_args */ true);
 
-  SqliteTable::Register<SpanJoinOperatorTable>(db, storage, "span_left_join",
+  SqliteTable::Register<SpanJoinOperatorTable>(db, native_tables,
+                                               "span_left_join",
                                                /* read_write */ false,
                                                /* requires_args */ true);
 
-  SqliteTable::Register<SpanJoinOperatorTable>(db, storage, "span_outer_join",
+  SqliteTable::Register<SpanJoinOperatorTable>(db, native_tables,
+                                               "span_outer_join",
                                                /* read_write */ false,
                                                /* requires_args */ true);
 }
@@ -228,6 +252,38 @@ SpanJoinOperatorTable::ComputeSqlConstraintsForDefinition(
   return constraints;
 }
 
+std::vector<Constraint>
+SpanJoinOperatorTable::ComputeNativeConstraintsForDefinition(
+    const TableDefinition& defn,
+    const QueryConstraints& qc,
+    sqlite3_value** argv) {
+  const Table* table = defn.native_table();
+  std::vector<Constraint> constraints;
+  for (size_t i = 0; i < qc.constraints().size(); i++) {
+    const auto& cs = qc.constraints()[i];
+    auto col_name = GetNameForGlobalColumnIndex(defn, cs.column);
+    if (col_name == "")
+      continue;
+
+    if (col_name == kTsColumnName || col_name == kDurColumnName) {
+      // Allow SQLite handle any constraints on ts or duration.
+      continue;
+    }
+    const auto* col = table->GetColumnByName(col_name.c_str());
+    constraints.push_back(Constraint{
+        col->index_in_table(), DbSqliteTable::SqliteOpToFilterOp(cs.op),
+        DbSqliteTable::SqliteValueToSqlValue(argv[i])});
+  }
+
+  // Rows with null partitions never take part in the join.
+  if (defn.IsPartitioned()) {
+    constraints.push_back(
+        Constraint{defn.native_col_idx(defn.partition_idx()),
+                   FilterOp::kIsNotNull, SqlValue()});
+  }
+  return constraints;
+}
+
 util::Status SpanJoinOperatorTable::CreateTableDefinition(
     const TableDescriptor& desc,
     EmitShadowType emit_shadow_type,
@@ -277,8 +333,19 @@ util::Status SpanJoinOperatorTable::CreateTableDefinition(
   PERFETTO_DCHECK(ts_idx < cols.size());
   PERFETTO_DCHECK(dur_idx < cols.size());
 
+  const Table* native_table = nullptr;
+  std::vector<uint32_t> native_cols;
+  if (native_tables_) {
+    auto it = native_tables_->find(desc.name);
+    if (it != native_tables_->end() &&
+        ComputeNativeColumns(*it->second, cols, partition_idx, &native_cols)) {
+      native_table = it->second;
+    }
+  }
+
   *defn = TableDefinition(desc.name, desc.partition_col, std::move(cols),
-                          emit_shadow_type, ts_idx, dur_idx, partition_idx);
+                          emit_shadow_type, ts_idx, dur_idx, partition_idx,
+                          native_table, std::move(native_cols));
   return util::OkStatus();
 }
 
@@ -505,8 +572,24 @@ util::Status SpanJoinOperatorTable::Query::Initialize(
     const QueryConstraints& qc,
     sqlite3_value** argv) {
   *this = Query(table_, definition(), db_);
-  sql_query_ = CreateSqlQuery(
-      table_->ComputeSqlConstraintsForDefinition(*defn_, qc, argv));
+  if (const Table* native_table = defn_->native_table()) {
+    std::vector<Order> orders;
+    if (defn_->IsPartitioned())
+      orders.push_back(Order{defn_->native_col_idx(defn_->partition_idx()),
+                             false});
+
+    // Both filtering and sorting are stable so there is no need to sort on
+    // ts if the table is already sorted on it (e.g. counters).
+    uint32_t ts_col_idx = defn_->native_col_idx(defn_->ts_idx());
+    if (!native_table->GetColumn(ts_col_idx).IsSorted())
+      orders.push_back(Order{ts_col_idx, false});
+
+    auto cs = table_->ComputeNativeConstraintsForDefinition(*defn_, qc, argv);
+    native_rows_.reset(new Table(native_table->Filter(cs).Sort(orders)));
+  } else {
+    sql_query_ = CreateSqlQuery(
+        table_->ComputeSqlConstraintsForDefinition(*defn_, qc, argv));
+  }
   return Rewind();
 }
 
@@ -628,15 +711,29 @@ util::Status SpanJoinOperatorTable::Query::NextSliceState() {
 }
 
 util::Status SpanJoinOperatorTable::Query::Rewind() {
-  sqlite3_stmt* stmt = nullptr;
-  int res =
-      sqlite3_prepare_v2(db_, sql_query_.c_str(),
-                         static_cast<int>(sql_query_.size()), &stmt, nullptr);
-  stmt_.reset(stmt);
+  if (native_rows_) {
+    // The rows were already filtered and sorted by Initialize(): just start
+    // iterating them again from the first one.
+    native_it_ = base::nullopt;
+  } else {
+    int res;
+    if (stmt_) {
+      // The unpartitioned query of a mixed partition join is rewound once per
+      // partition of the other table: reuse the statement instead of
+      // preparing it again each time.
+      res = sqlite3_reset(stmt_.get());
+    } else {
+      sqlite3_stmt* stmt = nullptr;
+      res = sqlite3_prepare_v2(db_, sql_query_.c_str(),
+                               static_cast<int>(sql_query_.size()), &stmt,
+                               nullptr);
+      stmt_.reset(stmt);
+    }
 
-  cursor_eof_ = res != SQLITE_OK;
-  if (res != SQLITE_OK)
-    return util::ErrStatus("%s", sqlite3_errmsg(db_));
+    cursor_eof_ = res != SQLITE_OK;
+    if (res != SQLITE_OK)
+      return util::ErrStatus("%s", sqlite3_errmsg(db_));
+  }
 
   util::Status status = CursorNext();
   if (!status.ok())
@@ -663,6 +760,16 @@ util::Status SpanJoinOperatorTable::Query::Rewind() {
 }
 
 util::Status SpanJoinOperatorTable::Query::CursorNext() {
+  if (native_rows_) {
+    if (native_it_) {
+      native_it_->Next();
+    } else {
+      native_it_ = native_rows_->IterateRows();
+    }
+    cursor_eof_ = !*native_it_;
+    return util::OkStatus();
+  }
+
   auto* stmt = stmt_.get();
   int res;
   if (defn_->IsPartitioned()) {
@@ -710,6 +817,29 @@ void SpanJoinOperatorTable::Query::ReportSqliteResult(sqlite3_context* context,
     return;
   }
 
+  if (native_rows_) {
+    uint32_t col_idx = defn_->native_col_idx(static_cast<uint32_t>(index));
+    SqlValue value = native_it_->Get(col_idx);
+    switch (value.type) {
+      case SqlValue::Type::kLong:
+        sqlite3_result_int64(context, value.long_value);
+        break;
+      case SqlValue::Type::kDouble:
+        sqlite3_result_double(context, value.double_value);
+        break;
+      case SqlValue::Type::kString:
+        // Strings of native tables come from the string pool which outlives
+        // the query.
+        sqlite3_result_text(context, value.string_value, -1,
+                            sqlite_utils::kSqliteStatic);
+        break;
+      case SqlValue::Type::kBytes:
+      case SqlValue::Type::kNull:
+        break;
+    }
+    return;
+  }
+
   sqlite3_stmt* stmt = stmt_.get();
   int idx = static_cast<int>(index);
   switch (sqlite3_column_type(stmt, idx)) {
@@ -739,14 +869,18 @@ SpanJoinOperatorTable::TableDefinition::TableDefinition(
     EmitShadowType emit_shadow_type,
     uint32_t ts_idx,
     uint32_t dur_idx,
-    uint32_t partition_idx)
+    uint32_t partition_idx,
+    const Table* native_table,
+    std::vector<uint32_t> native_cols)
     : emit_shadow_type_(emit_shadow_type),
       name_(std::move(name)),
       partition_col_(std::move(partition_col)),
       cols_(std::move(cols)),
       ts_idx_(ts_idx),
       dur_idx_(dur_idx),
-      partition_idx_(partition_idx) {}
+      partition_idx_(partition_idx),
+      native_table_(native_table),
+      native_cols_(std::move(native_cols)) {}
 
 util::Status SpanJoinOperatorTable::TableDescriptor::Parse(
     const std::string& raw_descriptor,
@@ -28,8 +28,10 @@
 #include <unordered_map>
 #include <vector>
 
+#include "perfetto/ext/base/optional.h"
 #include "perfetto/trace_processor/basic_types.h"
 #include "perfetto/trace_processor/status.h"
+#include "src/trace_processor/db/table.h"
 #include "src/trace_processor/sqlite/scoped_db.h"
 #include "src/trace_processor/sqlite/sqlite_table.h"
 
@@ -68,8 +70,15 @@ namespace trace_processor {
 //
 // All other columns apart from timestamp (ts), duration (dur) and the join key
 // are passed through unchanged.
+//
+// Child tables which are native db tables are read directly from their columns
+// instead of being queried through SQLite.
 class SpanJoinOperatorTable : public SqliteTable {
  public:
+  // The native db tables which can be read directly by the operator, keyed by
+  // the name they are registered with in SQLite.
+  using NativeTables = std::unordered_map<std::string, const Table*>;
+
   // Enum indicating whether the queries on the two inner tables should
   // emit shadows.
   enum class EmitShadowType {
@@ -96,7 +105,9 @@ class SpanJoinOperatorTable : public SqliteTable {
                     EmitShadowType emit_shadow_type,
                     uint32_t ts_idx,
                     uint32_t dur_idx,
-                    uint32_t partition_idx);
+                    uint32_t partition_idx,
+                    const Table* native_table,
+                    std::vector<uint32_t> native_cols);
 
     // Returns whether this table should emit present partition shadow slices.
     bool ShouldEmitPresentPartitionShadow() const {
@@ -120,6 +131,14 @@ class SpanJoinOperatorTable : public SqliteTable {
     uint32_t dur_idx() const { return dur_idx_; }
     uint32_t partition_idx() const { return partition_idx_; }
 
+    // Returns the native db table backing this table or nullptr if this table
+    // has to be queried through SQLite.
+    const Table* native_table() const { return native_table_; }
+
+    // Returns the index in |native_table()| of the column at |idx| in
+    // |columns()|.
+    uint32_t native_col_idx(uint32_t idx) const { return native_cols_[idx]; }
+
    private:
     EmitShadowType emit_shadow_type_ = EmitShadowType::kNone;
 
@@ -130,6 +149,9 @@ class SpanJoinOperatorTable : public SqliteTable {
     uint32_t ts_idx_ = std::numeric_limits<uint32_t>::max();
     uint32_t dur_idx_ = std::numeric_limits<uint32_t>::max();
     uint32_t partition_idx_ = std::numeric_limits<uint32_t>::max();
+
+    const Table* native_table_ = nullptr;
+    std::vector<uint32_t> native_cols_;
   };
 
   // Stores information about a single subquery into one of the two child
@@ -267,21 +289,28 @@ class SpanJoinOperatorTable : public SqliteTable {
 
     int64_t CursorTs() const {
       PERFETTO_DCHECK(!cursor_eof_);
-      auto ts_idx = static_cast<int>(defn_->ts_idx());
-      return sqlite3_column_int64(stmt_.get(), ts_idx);
+      return CursorLong(defn_->ts_idx());
     }
 
     int64_t CursorDur() const {
       PERFETTO_DCHECK(!cursor_eof_);
-      auto dur_idx = static_cast<int>(defn_->dur_idx());
-      return sqlite3_column_int64(stmt_.get(), dur_idx);
+      return CursorLong(defn_->dur_idx());
     }
 
     int64_t CursorPartition() const {
       PERFETTO_DCHECK(!cursor_eof_);
       PERFETTO_DCHECK(defn_->IsPartitioned());
-      auto partition_idx = static_cast<int>(defn_->partition_idx());
-      return sqlite3_column_int64(stmt_.get(), partition_idx);
+      return CursorLong(defn_->partition_idx());
+    }
+
+    // Returns the value of the column at |idx| in the current row of the
+    // cursor as an integer (with nulls as 0, like sqlite3_column_int64).
+    int64_t CursorLong(uint32_t idx) const {
+      if (native_rows_) {
+        SqlValue value = native_it_->Get(defn_->native_col_idx(idx));
+        return value.is_null() ? 0 : value.long_value;
+      }
+      return sqlite3_column_int64(stmt_.get(), static_cast<int>(idx));
     }
 
     State state_ = State::kMissingPartitionShadow;
@@ -301,6 +330,12 @@ class SpanJoinOperatorTable : public SqliteTable {
     std::string sql_query_;
     ScopedStmt stmt_;
 
+    // Only set for native tables: the rows of the table matching the
+    // constraints, sorted by partition and ts, and the current row. Null
+    // partitions are filtered out.
+    std::unique_ptr<Table> native_rows_;
+    base::Optional<Table::Iterator> native_it_;
+
     const TableDefinition* defn_ = nullptr;
     sqlite3* db_ = nullptr;
     SpanJoinOperatorTable* table_ = nullptr;
@@ -343,9 +378,10 @@ class SpanJoinOperatorTable : public SqliteTable {
     SpanJoinOperatorTable* table_;
   };
 
-  SpanJoinOperatorTable(sqlite3*, const TraceStorage*);
+  SpanJoinOperatorTable(sqlite3*, const NativeTables*);
 
-  static void RegisterTable(sqlite3* db, const TraceStorage* storage);
+  // |native_tables| can be null if no table should be read natively.
+  static void RegisterTable(sqlite3* db, const NativeTables* native_tables);
 
   // Table implementation.
   util::Status Init(int, const char* const*, SqliteTable::Schema*) override;
@@ -408,6 +444,11 @@ class SpanJoinOperatorTable : public SqliteTable {
       const QueryConstraints& qc,
       sqlite3_value** argv);
 
+  std::vector<Constraint> ComputeNativeConstraintsForDefinition(
+      const TableDefinition& defn,
+      const QueryConstraints& qc,
+      sqlite3_value** argv);
+
   std::string GetNameForGlobalColumnIndex(const TableDefinition& defn,
                                           int global_column);
 
@@ -420,6 +461,7 @@ class SpanJoinOperatorTable : public SqliteTable {
   std::unordered_map<size_t, ColumnLocator> global_index_to_column_locator_;
 
   sqlite3* const db_;
+  const NativeTables* const native_tables_;
 };
 
 }  // namespace trace_processor
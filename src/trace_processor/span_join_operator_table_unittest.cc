@@ -16,14 +16,49 @@
 
 #include "src/trace_processor/span_join_operator_table.h"
 
-#include "src/trace_processor/trace_processor_context.h"
-#include "src/trace_processor/trace_storage.h"
+#include <algorithm>
+#include <random>
+
+#include "src/trace_processor/sqlite/db_sqlite_table.h"
 #include "test/gtest_and_gmock.h"
 
 namespace perfetto {
 namespace trace_processor {
 namespace {
 
+// A db table of spans with an optional cpu, in no particular order.
+class NativeSpanTable : public Table {
+ public:
+  NativeSpanTable() : Table(&pool_, nullptr) {
+    row_maps_.emplace_back();
+    columns_.emplace_back(Column::IdColumn(this, 0u, 0u));
+    columns_.emplace_back(
+        Column("ts", &ts_, Column::Flag::kNonNull, this, 1u, 0u));
+    columns_.emplace_back(
+        Column("dur", &dur_, Column::Flag::kNonNull, this, 2u, 0u));
+    columns_.emplace_back(
+        Column("cpu", &cpu_, Column::Flag::kNoFlag, this, 3u, 0u));
+    columns_.emplace_back(
+        Column("n_val", &val_, Column::Flag::kNonNull, this, 4u, 0u));
+  }
+
+  void Insert(int64_t ts, int64_t dur, base::Optional<uint32_t> cpu,
+              int64_t val) {
+    ts_.Append(ts);
+    dur_.Append(dur);
+    cpu_.Append(cpu);
+    val_.Append(val);
+    row_maps_.back().Insert(row_count_++);
+  }
+
+ private:
+  StringPool pool_;
+  SparseVector<int64_t> ts_;
+  SparseVector<int64_t> dur_;
+  SparseVector<uint32_t> cpu_;
+  SparseVector<int64_t> val_;
+};
+
 class SpanJoinOperatorTableTest : public ::testing::Test {
  public:
   SpanJoinOperatorTableTest() {
@@ -32,9 +67,29 @@ class SpanJoinOperatorTableTest : public ::testing::Test {
     PERFETTO_CHECK(sqlite3_open(":memory:", &db) == SQLITE_OK);
     db_.reset(db);
 
-    context_.storage.reset(new TraceStorage());
+    SpanJoinOperatorTable::RegisterTable(db_.get(), &native_tables_);
+  }
 
-    SpanJoinOperatorTable::RegisterTable(db_.get(), context_.storage.get());
+  // Registers |table| as a db table which SPAN_JOIN can read directly.
+  void RegisterNativeTable(const Table* table, const std::string& name) {
+    DbSqliteTable::RegisterTable(*db_, nullptr, table, name);
+    native_tables_[name] = table;
+  }
+
+  // Returns all the rows returned by |sql|, with nulls as -1.
+  std::vector<std::vector<int64_t>> QueryRows(const std::string& sql) {
+    PrepareValidStatement(sql);
+    std::vector<std::vector<int64_t>> rows;
+    int column_count = sqlite3_column_count(stmt_.get());
+    while (sqlite3_step(stmt_.get()) == SQLITE_ROW) {
+      std::vector<int64_t> row;
+      for (int i = 0; i < column_count; ++i) {
+        bool is_null = sqlite3_column_type(stmt_.get(), i) == SQLITE_NULL;
+        row.push_back(is_null ? -1 : sqlite3_column_int64(stmt_.get(), i));
+      }
+      rows.push_back(std::move(row));
+    }
+    return rows;
   }
 
   void PrepareValidStatement(const std::string& sql) {
@@ -59,7 +114,7 @@ class SpanJoinOperatorTableTest : public ::testing::Test {
   }
 
  protected:
-  TraceProcessorContext context_;
+  SpanJoinOperatorTable::NativeTables native_tables_;
   ScopedDb db_;
   ScopedStmt stmt_;
 };
@@ -259,6 +314,100 @@ TEST_F(SpanJoinOperatorTableTest, NoPartitioning) {
   ASSERT_EQ(sqlite3_step(stmt_.get()), SQLITE_DONE);
 }
 
+TEST_F(SpanJoinOperatorTableTest, NativeTableMatchesView) {
+  struct Span {
+    int64_t ts;
+    int64_t dur;
+    base::Optional<uint32_t> cpu;
+  };
+  std::minstd_rand0 rnd_engine(42);
+
+  // Back to back spans on each cpu (and on no cpu), inserted in no particular
+  // order.
+  std::vector<Span> spans;
+  for (uint32_t cpu = 0; cpu < 5; ++cpu) {
+    int64_t ts = 0;
+    for (uint32_t i = 0; i < 100; ++i) {
+      int64_t dur = static_cast<int64_t>(rnd_engine() % 100);
+      spans.push_back(
+          Span{ts, dur, cpu < 4 ? base::make_optional(cpu) : base::nullopt});
+      ts += dur + static_cast<int64_t>(rnd_engine() % 10);
+    }
+  }
+  std::shuffle(spans.begin(), spans.end(), rnd_engine);
+
+  // The native table is read directly while the view over it is queried
+  // through SQLite: both need to give the same results.
+  NativeSpanTable native;
+  for (const Span& span : spans) {
+    native.Insert(span.ts, span.dur, span.cpu,
+                  static_cast<int64_t>(rnd_engine() % 1000));
+  }
+  RegisterNativeTable(&native, "native");
+  RunStatement("CREATE VIEW native_view AS SELECT * FROM native;");
+
+  RunStatement(
+      "CREATE TEMP TABLE s("
+      "ts BIG INT PRIMARY KEY, "
+      "dur BIG INT, "
+      "cpu UNSIGNED INT, "
+      "s_val BIG INT"
+      ");");
+  RunStatement(
+      "CREATE TEMP TABLE u("
+      "ts BIG INT PRIMARY KEY, "
+      "dur BIG INT, "
+      "u_val BIG INT"
+      ");");
+  int64_t ts = 0;
+  for (uint32_t i = 0; i < 200; ++i) {
+    int64_t dur = static_cast<int64_t>(rnd_engine() % 100);
+    RunStatement("INSERT INTO s VALUES(" + std::to_string(ts) + ", " +
+                 std::to_string(dur) + ", " +
+                 std::to_string(rnd_engine() % 4) + ", " +
+                 std::to_string(i) + ");");
+    RunStatement("INSERT INTO u VALUES(" + std::to_string(ts) + ", " +
+                 std::to_string(dur) + ", " + std::to_string(i) + ");");
+    ts += dur + 1;
+  }
+
+  struct Join {
+    const char* args;
+    const char* cols;
+  };
+  const Join kJoins[] = {
+      {"span_join(%s PARTITIONED cpu, s PARTITIONED cpu)", "cpu, s_val"},
+      {"span_left_join(%s PARTITIONED cpu, s PARTITIONED cpu)", "cpu, s_val"},
+      {"span_outer_join(%s PARTITIONED cpu, s PARTITIONED cpu)", "cpu, s_val"},
+      {"span_join(%s PARTITIONED cpu, u)", "cpu, u_val"},
+      {"span_left_join(u, %s PARTITIONED cpu)", "cpu, u_val"},
+      {"span_join(%s, u)", "cpu, u_val"},
+  };
+  for (const Join& join : kJoins) {
+    char native_args[128];
+    snprintf(native_args, sizeof(native_args), join.args, "native");
+    char view_args[128];
+    snprintf(view_args, sizeof(view_args), join.args, "native_view");
+
+    RunStatement(std::string("CREATE VIRTUAL TABLE sp_native USING ") +
+                 native_args);
+    RunStatement(std::string("CREATE VIRTUAL TABLE sp_view USING ") +
+                 view_args);
+
+    for (const char* where : {"", " WHERE n_val > 500"}) {
+      std::string select =
+          std::string("SELECT ts, dur, n_val, ") + join.cols + " FROM ";
+      auto native_rows = QueryRows(select + "sp_native" + where);
+      auto view_rows = QueryRows(select + "sp_view" + where);
+      ASSERT_FALSE(native_rows.empty()) << native_args << where;
+      ASSERT_EQ(native_rows, view_rows) << native_args << where;
+    }
+
+    RunStatement("DROP TABLE sp_native;");
+    RunStatement("DROP TABLE sp_view;");
+  }
+}
+
 }  // namespace
 }  // namespace trace_processor
 }  // namespace perfetto
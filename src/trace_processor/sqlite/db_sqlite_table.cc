@@ -16,6 +16,9 @@
 
 #include "src/trace_processor/sqlite/db_sqlite_table.h"
 
+#include <algorithm>
+#include <limits>
+
 #include "src/trace_processor/sqlite/sqlite_utils.h"
 
 namespace perfetto {
@@ -23,7 +26,32 @@ namespace trace_processor {
 
 namespace {
 
-FilterOp SqliteOpToFilterOp(int sqlite_op) {
+// Returns true if |column| is a hidden column which is not backed by a column
+// of |table| (i.e. ts_end).
+bool IsHiddenColumn(const Table& table, int column) {
+  return static_cast<uint32_t>(column) >= table.GetColumnCount();
+}
+
+bool IsIndexedConstraint(const Table& table,
+                         const QueryConstraints::Constraint& c) {
+  return !IsHiddenColumn(table, c.column) &&
+         table.GetColumn(static_cast<uint32_t>(c.column)).IsIndexed();
+}
+
+// Returns true if |c| is a lower bound on the end of intervals which can be
+// answered using the interval index.
+bool IsIntervalEndLowerBound(
+    const base::Optional<DbSqliteTable::IntervalColumns>& interval_cols,
+    const QueryConstraints::Constraint& c) {
+  return interval_cols &&
+         static_cast<uint32_t>(c.column) == interval_cols->ts_end &&
+         (sqlite_utils::IsOpGt(c.op) || sqlite_utils::IsOpGe(c.op));
+}
+
+}  // namespace
+
+// static
+FilterOp DbSqliteTable::SqliteOpToFilterOp(int sqlite_op) {
   switch (sqlite_op) {
     case SQLITE_INDEX_CONSTRAINT_EQ:
     case SQLITE_INDEX_CONSTRAINT_IS:
@@ -50,7 +78,8 @@ FilterOp SqliteOpToFilterOp(int sqlite_op) {
   }
 }
 
-SqlValue SqliteValueToSqlValue(sqlite3_value* sqlite_val) {
+// static
+SqlValue DbSqliteTable::SqliteValueToSqlValue(sqlite3_value* sqlite_val) {
   auto col_type = sqlite3_value_type(sqlite_val);
   SqlValue value;
   switch (col_type) {
@@ -79,15 +108,18 @@ SqlValue SqliteValueToSqlValue(sqlite3_value* sqlite_val) {
   return value;
 }
 
-}  // namespace
-
-DbSqliteTable::DbSqliteTable(sqlite3*, const Table* table) : table_(table) {}
+DbSqliteTable::DbSqliteTable(sqlite3*, Context context)
+    : cache_(context.cache),
+      table_(context.table),
+      interval_cols_(GetIntervalColumns(*context.table)) {}
 DbSqliteTable::~DbSqliteTable() = default;
 
 void DbSqliteTable::RegisterTable(sqlite3* db,
+                                  QueryCache* cache,
                                   const Table* table,
                                   const std::string& name) {
-  SqliteTable::Register<DbSqliteTable, const Table*>(db, table, name);
+  SqliteTable::Register<DbSqliteTable, Context>(db, Context{cache, table},
+                                                name);
 }
 
 util::Status DbSqliteTable::Init(int, const char* const*, Schema* schema) {
@@ -96,6 +128,10 @@ util::Status DbSqliteTable::Init(int, const char* const*, Schema* schema) {
     const auto& col = table_->GetColumn(i);
     schema_cols.emplace_back(i, col.name(), col.type());
   }
+  if (interval_cols_) {
+    schema_cols.emplace_back(interval_cols_->ts_end, "ts_end",
+                             SqlValue::Type::kLong, /* hidden */ true);
+  }
   // TODO(lalitm): this is hardcoded to be the id column but change this to be
   // more generic in the future.
   const auto* col = table_->GetColumnByName("id");
@@ -113,39 +149,55 @@ util::Status DbSqliteTable::Init(int, const char* const*, Schema* schema) {
   return util::OkStatus();
 }
 
-int DbSqliteTable::BestIndex(const QueryConstraints& qc, BestIndexInfo* info) {
-  // TODO(lalitm): investigate SQLITE_INDEX_SCAN_UNIQUE for id columns.
-  auto cost_and_rows = EstimateCost(*table_, qc);
-  info->estimated_cost = cost_and_rows.cost;
-  info->estimated_rows = cost_and_rows.rows;
-  return SQLITE_OK;
-}
-
-int DbSqliteTable::ModifyConstraints(QueryConstraints* qc) {
+// static
+void DbSqliteTable::SortConstraints(const Table& table, QueryConstraints* qc) {
   using C = QueryConstraints::Constraint;
 
   // Reorder constraints to consider the constraints on columns which are
-  // cheaper to filter first.
-  auto* cs = qc->mutable_constraints();
-  std::sort(cs->begin(), cs->end(), [this](const C& a, const C& b) {
-    uint32_t a_idx = static_cast<uint32_t>(a.column);
-    uint32_t b_idx = static_cast<uint32_t>(b.column);
-    const auto& a_col = table_->GetColumn(a_idx);
-    const auto& b_col = table_->GetColumn(b_idx);
+  // cheaper to filter first. Each constraint is given a rank (lower is
+  // cheaper) so that the comparison is a strict weak ordering.
+  auto rank = [&table](const C& c) {
+    // Constraints on hidden columns are handled separately when filtering so
+    // just put them last.
+    if (IsHiddenColumn(table, c.column))
+      return 4;
 
     // Id columns are always very cheap to filter on so try and get them
     // first.
-    if (a_col.IsId() && !b_col.IsId())
-      return true;
+    const auto& col = table.GetColumn(static_cast<uint32_t>(c.column));
+    if (col.IsId())
+      return 0;
 
     // Sorted columns are also quite cheap to filter so order them after
     // any id columns.
-    if (a_col.IsSorted() && !b_col.IsSorted())
-      return true;
+    if (col.IsSorted())
+      return 1;
+
+    // Equality constraints on indexed columns only need a lookup in the index
+    // so order them after any sorted columns.
+    if (col.IsIndexed() && sqlite_utils::IsOpEq(c.op))
+      return 2;
 
     // TODO(lalitm): introduce more orderings here based on empirical data.
-    return false;
+    return 3;
+  };
+  auto* cs = qc->mutable_constraints();
+  std::stable_sort(cs->begin(), cs->end(), [&rank](const C& a, const C& b) {
+    return rank(a) < rank(b);
   });
+}
+
+int DbSqliteTable::BestIndex(const QueryConstraints& qc, BestIndexInfo* info) {
+  // TODO(lalitm): investigate SQLITE_INDEX_SCAN_UNIQUE for id columns.
+  auto cost_and_rows = EstimateCost(*table_, qc);
+  info->estimated_cost = cost_and_rows.cost;
+  info->estimated_rows = cost_and_rows.rows;
+  return SQLITE_OK;
+}
+
+int DbSqliteTable::ModifyConstraints(QueryConstraints* qc) {
+  SortConstraints(*table_, qc);
+  auto* cs = qc->mutable_constraints();
 
   // Remove any order by constraints which also have an equality constraint.
   auto* ob = qc->mutable_order_by();
@@ -165,6 +217,8 @@ int DbSqliteTable::ModifyConstraints(QueryConstraints* qc) {
   // descending order.
   {
     auto p = [this](const QueryConstraints::OrderBy& o) {
+      if (IsHiddenColumn(*table_, o.iColumn))
+        return true;
       const auto& col = table_->GetColumn(static_cast<uint32_t>(o.iColumn));
       return o.desc || !col.IsSorted();
     };
@@ -176,6 +230,19 @@ int DbSqliteTable::ModifyConstraints(QueryConstraints* qc) {
   return SQLITE_OK;
 }
 
+// static
+base::Optional<DbSqliteTable::IntervalColumns>
+DbSqliteTable::GetIntervalColumns(const Table& table) {
+  const auto* ts = table.GetColumnByName("ts");
+  const auto* dur = table.GetColumnByName("dur");
+  if (!ts || !dur || !ts->IsInt64() || !dur->IsInt64() ||
+      table.GetColumnByName("ts_end")) {
+    return base::nullopt;
+  }
+  return IntervalColumns{ts->index_in_table(), dur->index_in_table(),
+                         table.GetColumnCount()};
+}
+
 DbSqliteTable::QueryCost DbSqliteTable::EstimateCost(
     const Table& table,
     const QueryConstraints& qc) {
@@ -200,18 +267,53 @@ DbSqliteTable::QueryCost DbSqliteTable::EstimateCost(
   if (current_row_count == 0)
     return QueryCost{kFixedQueryCost, 0};
 
+  // If the query is for the intervals overlapping a window of time, the
+  // interval index finds them in O(log(n) + k) time. Model this like an
+  // equality constraint on an indexed column; the upper bound on ts is then
+  // free as it is also handled by the index.
+  auto interval_cols = GetIntervalColumns(table);
+  const auto& cs = qc.constraints();
+  bool has_interval_index =
+      std::any_of(cs.begin(), cs.end(),
+                  [&interval_cols](const QueryConstraints::Constraint& c) {
+                    return IsIntervalEndLowerBound(interval_cols, c);
+                  });
+
   // Setup the variables for estimating the cost of filtering.
   double filter_cost = 0.0;
-  const auto& cs = qc.constraints();
   for (const auto& c : cs) {
     if (current_row_count < 2)
       break;
+    if (IsIntervalEndLowerBound(interval_cols, c)) {
+      double estimated_rows = current_row_count / log2(current_row_count);
+      filter_cost += log2(current_row_count) + estimated_rows;
+      current_row_count = std::max(static_cast<uint32_t>(estimated_rows), 1u);
+      continue;
+    }
+    if (IsHiddenColumn(table, c.column)) {
+      // Other constraints on hidden columns are only checked by SQLite.
+      continue;
+    }
+    if (has_interval_index &&
+        static_cast<uint32_t>(c.column) == interval_cols->ts &&
+        (sqlite_utils::IsOpLt(c.op) || sqlite_utils::IsOpLe(c.op))) {
+      continue;
+    }
     const auto& col = table.GetColumn(static_cast<uint32_t>(c.column));
     if (sqlite_utils::IsOpEq(c.op) && col.IsId()) {
       // If we have an id equality constraint, it's a bit expensive to find
       // the exact row but it filters down to a single row.
       filter_cost += 100;
       current_row_count = 1;
+    } else if (sqlite_utils::IsOpEq(c.op) && col.IsIndexed()) {
+      // If we have an equality constraint on an indexed column, we binary
+      // search the index and then only need to look at the matching rows.
+      double estimated_rows = current_row_count / log2(current_row_count);
+      filter_cost += log2(current_row_count) + estimated_rows;
+
+      // Like below, we assume that an equality constraint will cut down the
+      // number of rows by approximately the log of the number of rows.
+      current_row_count = std::max(static_cast<uint32_t>(estimated_rows), 1u);
     } else if (sqlite_utils::IsOpEq(c.op)) {
       // If there is only a single equality constraint, we have special logic
       // to sort by that column and then binary search if we see the constraint
@@ -254,7 +356,10 @@ std::unique_ptr<SqliteTable::Cursor> DbSqliteTable::CreateCursor() {
 }
 
 DbSqliteTable::Cursor::Cursor(DbSqliteTable* table)
-    : SqliteTable::Cursor(table), initial_db_table_(table->table_) {}
+    : SqliteTable::Cursor(table),
+      initial_db_table_(table->table_),
+      cache_(table->cache_),
+      interval_cols_(table->interval_cols_) {}
 
 int DbSqliteTable::Cursor::Filter(const QueryConstraints& qc,
                                   sqlite3_value** argv,
@@ -263,8 +368,12 @@ int DbSqliteTable::Cursor::Filter(const QueryConstraints& qc,
   // before the table's destructor.
   iterator_ = base::nullopt;
 
+  // Equality constraints on indexed columns are already answered using the
+  // index so they do not need the sorted table below.
   if (history == FilterHistory::kSame && qc.constraints().size() == 1 &&
-      sqlite_utils::IsOpEq(qc.constraints().front().op)) {
+      sqlite_utils::IsOpEq(qc.constraints().front().op) &&
+      !IsHiddenColumn(*initial_db_table_, qc.constraints().front().column) &&
+      !IsIndexedConstraint(*initial_db_table_, qc.constraints().front())) {
     // If we've seen the same constraint set with a single equality constraint
     // more than |kRepeatedThreshold| times, we assume we will see it more
     // in the future and thus cache a table sorted on the column. That way,
@@ -281,8 +390,14 @@ int DbSqliteTable::Cursor::Filter(const QueryConstraints& qc,
     repeated_cache_count_ = 0;
   }
 
+  // Lower bound on the end of the intervals of the table, if any: in this
+  // case, the interval index is used to find the rows overlapping
+  // [min_end, max_start].
+  base::Optional<int64_t> min_end;
+  int64_t max_start = std::numeric_limits<int64_t>::max();
+
   // We reuse this vector to reduce memory allocations on nested subqueries.
-  constraints_.resize(qc.constraints().size());
+  constraints_.clear();
   for (size_t i = 0; i < qc.constraints().size(); ++i) {
     const auto& cs = qc.constraints()[i];
     uint32_t col = static_cast<uint32_t>(cs.column);
@@ -290,20 +405,69 @@ int DbSqliteTable::Cursor::Filter(const QueryConstraints& qc,
     FilterOp op = SqliteOpToFilterOp(cs.op);
     SqlValue value = SqliteValueToSqlValue(argv[i]);
 
-    constraints_[i] = Constraint{col, op, value};
+    // SQLite double checks all the constraints so constraints on hidden
+    // columns which cannot use the interval index are simply skipped.
+    if (IsHiddenColumn(*initial_db_table_, cs.column)) {
+      if (IsIntervalEndLowerBound(interval_cols_, cs) &&
+          value.type == SqlValue::Type::kLong &&
+          value.long_value < std::numeric_limits<int64_t>::max()) {
+        int64_t bound =
+            op == FilterOp::kGt ? value.long_value + 1 : value.long_value;
+        min_end = std::max(min_end.value_or(bound), bound);
+      }
+      continue;
+    }
+    constraints_.push_back(Constraint{col, op, value});
+  }
+
+  // Upper bounds on ts are also handled by the interval index.
+  if (min_end) {
+    auto it = std::remove_if(
+        constraints_.begin(), constraints_.end(),
+        [this, &max_start](const Constraint& c) {
+          if (c.col_idx != interval_cols_->ts ||
+              c.value.type != SqlValue::Type::kLong ||
+              (c.op != FilterOp::kLt && c.op != FilterOp::kLe) ||
+              c.value.long_value == std::numeric_limits<int64_t>::min()) {
+            return false;
+          }
+          int64_t bound = c.op == FilterOp::kLt ? c.value.long_value - 1
+                                                : c.value.long_value;
+          max_start = std::min(max_start, bound);
+          return true;
+        });
+    constraints_.erase(it, constraints_.end());
   }
 
   // We reuse this vector to reduce memory allocations on nested subqueries.
-  orders_.resize(qc.order_by().size());
+  orders_.clear();
   for (size_t i = 0; i < qc.order_by().size(); ++i) {
     const auto& ob = qc.order_by()[i];
+
+    // SQLite will sort the rows itself as ModifyConstraints never removes
+    // orders on hidden columns.
+    if (IsHiddenColumn(*initial_db_table_, ob.iColumn))
+      continue;
     uint32_t col = static_cast<uint32_t>(ob.iColumn);
-    orders_[i] = Order{col, static_cast<bool>(ob.desc)};
+    orders_.push_back(Order{col, static_cast<bool>(ob.desc)});
   }
 
   // Attempt to filter into a RowMap first - we'll figure out whether to apply
   // this to the table or we should use the RowMap directly.
-  RowMap filter_map = SourceTable()->FilterToRowMap(constraints_);
+  // The cache is only used for the initial table as the sorted table only
+  // lives as long as this cursor. Queries using the interval index are not
+  // cached: they are already cheap and their bounds change as the UI pans.
+  RowMap filter_map;
+  if (min_end) {
+    PERFETTO_DCHECK(!sorted_cache_table_);
+    filter_map = initial_db_table_->FilterOverlappingToRowMap(
+        interval_cols_->ts, interval_cols_->dur, *min_end, max_start,
+        constraints_);
+  } else if (cache_ && !sorted_cache_table_) {
+    filter_map = cache_->FilterToRowMap(*initial_db_table_, constraints_);
+  } else {
+    filter_map = SourceTable()->FilterToRowMap(constraints_);
+  }
 
   // If we have no order by constraints and it's cheap for us to use the
   // RowMap, just use the RowMap directoy.
@@ -351,11 +515,22 @@ int DbSqliteTable::Cursor::Eof() {
   return eof_;
 }
 
+SqlValue DbSqliteTable::Cursor::GetValue(uint32_t column) const {
+  if (interval_cols_ && column == interval_cols_->ts_end) {
+    SqlValue ts = GetValue(interval_cols_->ts);
+    SqlValue dur = GetValue(interval_cols_->dur);
+    if (ts.is_null() || dur.is_null())
+      return SqlValue();
+    return SqlValue::Long(ts.long_value + dur.long_value);
+  }
+  return mode_ == Mode::kSingleRow
+             ? SourceTable()->GetColumn(column).Get(*single_row_)
+             : iterator_->Get(column);
+}
+
 int DbSqliteTable::Cursor::Column(sqlite3_context* ctx, int raw_col) {
   uint32_t column = static_cast<uint32_t>(raw_col);
-  SqlValue value = mode_ == Mode::kSingleRow
-                       ? SourceTable()->GetColumn(column).Get(*single_row_)
-                       : iterator_->Get(column);
+  SqlValue value = GetValue(column);
   switch (value.type) {
     case SqlValue::Type::kLong:
       sqlite3_result_int64(ctx, value.long_value);
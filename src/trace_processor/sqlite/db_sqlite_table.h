@@ -18,14 +18,30 @@
 #define SRC_TRACE_PROCESSOR_SQLITE_DB_SQLITE_TABLE_H_
 
 #include "src/trace_processor/db/table.h"
+#include "src/trace_processor/sqlite/query_cache.h"
 #include "src/trace_processor/sqlite/sqlite_table.h"
 
 namespace perfetto {
 namespace trace_processor {
 
 // Implements the SQLite table interface for db tables.
+//
+// Tables with int64 "ts" and "dur" columns (e.g. slices) also have a hidden
+// "ts_end" column, equal to ts + dur. Queries for the rows overlapping a
+// window of time (i.e. |ts_end > start AND ts < end|) are answered using an
+// interval index over ts and dur instead of scanning all the rows starting
+// before the end of the window.
 class DbSqliteTable : public SqliteTable {
  public:
+  // The columns of a table with intervals.
+  struct IntervalColumns {
+    uint32_t ts;
+    uint32_t dur;
+
+    // The index of the hidden ts_end column in the SQLite table.
+    uint32_t ts_end;
+  };
+
   class Cursor final : public SqliteTable::Cursor {
    public:
     explicit Cursor(DbSqliteTable* table);
@@ -47,6 +63,10 @@ class DbSqliteTable : public SqliteTable {
       kTable,
     };
 
+    // Returns the value of |column| (which can be the hidden ts_end column)
+    // for the current row.
+    SqlValue GetValue(uint32_t column) const;
+
     const Table* SourceTable() const {
       // Try and use the sorted cache table (if it exists) to speed up the
       // sorting. Otherwise, just use the original table.
@@ -57,6 +77,8 @@ class DbSqliteTable : public SqliteTable {
     Cursor& operator=(const Cursor&) = delete;
 
     const Table* initial_db_table_ = nullptr;
+    QueryCache* cache_ = nullptr;
+    base::Optional<IntervalColumns> interval_cols_;
 
     // Only valid for Mode::kSingleRow.
     base::Optional<uint32_t> single_row_;
@@ -85,12 +107,19 @@ class DbSqliteTable : public SqliteTable {
     double cost;
     uint32_t rows;
   };
+  struct Context {
+    QueryCache* cache;
+    const Table* table;
+  };
 
+  // |cache| is used to cache the results of filtering |table| and can be
+  // shared between tables. It can be null to disable caching.
   static void RegisterTable(sqlite3* db,
+                            QueryCache* cache,
                             const Table* table,
                             const std::string& name);
 
-  DbSqliteTable(sqlite3*, const Table* table);
+  DbSqliteTable(sqlite3*, Context context);
   virtual ~DbSqliteTable() override;
 
   // Table implementation.
@@ -104,8 +133,24 @@ class DbSqliteTable : public SqliteTable {
   // static for testing.
   static QueryCost EstimateCost(const Table& table, const QueryConstraints& qc);
 
+  // Orders the constraints of |qc| from the cheapest to the most expensive to
+  // filter |table| with. Static for testing.
+  static void SortConstraints(const Table& table, QueryConstraints* qc);
+
+  // Converts the SQLite constraint operator |sqlite_op| to a FilterOp.
+  static FilterOp SqliteOpToFilterOp(int sqlite_op);
+
+  // Converts |sqlite_val| to a SqlValue. Strings and bytes point into the
+  // memory owned by |sqlite_val|.
+  static SqlValue SqliteValueToSqlValue(sqlite3_value* sqlite_val);
+
+  // Returns the columns of |table| describing intervals, if any.
+  static base::Optional<IntervalColumns> GetIntervalColumns(const Table& table);
+
  private:
+  QueryCache* cache_ = nullptr;
   const Table* table_ = nullptr;
+  base::Optional<IntervalColumns> interval_cols_;
 };
 
 }  // namespace trace_processor
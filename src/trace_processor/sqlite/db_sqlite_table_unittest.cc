@@ -16,6 +16,9 @@
 
 #include "src/trace_processor/sqlite/db_sqlite_table.h"
 
+#include <random>
+
+#include "src/trace_processor/sqlite/scoped_db.h"
 #include "test/gtest_and_gmock.h"
 
 namespace perfetto {
@@ -33,14 +36,57 @@ class TestTable : public Table {
         Column("a", &a_, Column::Flag::kNoFlag, this, 1u, 0u));
     columns_.emplace_back(
         Column("sorted", &sorted_, Column::Flag::kSorted, this, 2u, 0u));
+    columns_.emplace_back(
+        Column("indexed", &indexed_, Column::Flag::kIndexed, this, 3u, 0u));
   }
 
  private:
   StringPool pool_;
   SparseVector<uint32_t> a_;
   SparseVector<uint32_t> sorted_;
+  SparseVector<uint32_t> indexed_;
+};
+
+class IntervalTestTable : public Table {
+ public:
+  IntervalTestTable() : Table(&pool_, nullptr) {
+    row_maps_.emplace_back();
+    columns_.emplace_back(Column::IdColumn(this, 0u, 0u));
+    columns_.emplace_back(
+        Column("ts", &ts_, Column::Flag::kSorted, this, 1u, 0u));
+    columns_.emplace_back(Column("dur", &dur_, Column::Flag::kNoFlag, this,
+                                 2u, 0u));
+    columns_.emplace_back(
+        Column("depth", &depth_, Column::Flag::kNoFlag, this, 3u, 0u));
+  }
+
+  void Insert(int64_t ts, base::Optional<int64_t> dur, uint32_t depth) {
+    ts_.Append(ts);
+    dur_.Append(dur);
+    depth_.Append(depth);
+    row_maps_.back().Insert(row_count_++);
+  }
+
+ private:
+  StringPool pool_;
+  SparseVector<int64_t> ts_;
+  SparseVector<int64_t> dur_;
+  SparseVector<uint32_t> depth_;
 };
 
+// Returns the ids of the rows returned by |sql|.
+std::vector<int64_t> QueryIds(sqlite3* db, const std::string& sql) {
+  sqlite3_stmt* raw_stmt = nullptr;
+  int ret = sqlite3_prepare_v2(db, sql.c_str(), -1, &raw_stmt, nullptr);
+  PERFETTO_CHECK(ret == SQLITE_OK);
+  ScopedStmt stmt(raw_stmt);
+
+  std::vector<int64_t> ids;
+  while (sqlite3_step(*stmt) == SQLITE_ROW)
+    ids.push_back(sqlite3_column_int64(*stmt, 0));
+  return ids;
+}
+
 TEST(DbSqliteTable, IdEqCheaperThanOtherEq) {
   TestTable table(1234);
 
@@ -95,6 +141,139 @@ TEST(DbSqliteTable, SingleEqCheaperThanMultipleConstraint) {
   ASSERT_GT(single_cost.rows, multi_cost.rows);
 }
 
+TEST(DbSqliteTable, IndexedEqCheaperThanOtherEq) {
+  TestTable table(1234);
+
+  QueryConstraints indexed_eq;
+  indexed_eq.AddConstraint(3u, SQLITE_INDEX_CONSTRAINT_EQ, 0u);
+
+  auto indexed_cost = DbSqliteTable::EstimateCost(table, indexed_eq);
+
+  QueryConstraints a_eq;
+  a_eq.AddConstraint(1u, SQLITE_INDEX_CONSTRAINT_EQ, 1u);
+
+  auto a_cost = DbSqliteTable::EstimateCost(table, a_eq);
+
+  // Both constraints should filter the same number of rows but the indexed
+  // one should be cheaper as it does not need to scan the table.
+  ASSERT_LT(indexed_cost.cost, a_cost.cost);
+  ASSERT_EQ(indexed_cost.rows, a_cost.rows);
+}
+
+TEST(DbSqliteTable, SortConstraints) {
+  TestTable table(1234);
+
+  // Mix constraints on sorted columns (including the id column) and equality
+  // constraints on the indexed column: the comparison must still be a strict
+  // weak ordering.
+  QueryConstraints qc;
+  for (uint32_t i = 0; i < 8; ++i) {
+    qc.AddConstraint(3, SQLITE_INDEX_CONSTRAINT_EQ, 0u);
+    qc.AddConstraint(1, SQLITE_INDEX_CONSTRAINT_EQ, 0u);
+    qc.AddConstraint(3, SQLITE_INDEX_CONSTRAINT_LT, 0u);
+    qc.AddConstraint(2, SQLITE_INDEX_CONSTRAINT_GT, 0u);
+    qc.AddConstraint(0, SQLITE_INDEX_CONSTRAINT_EQ, 0u);
+  }
+  DbSqliteTable::SortConstraints(table, &qc);
+
+  std::vector<std::pair<int, int>> sorted;
+  for (const auto& c : qc.constraints())
+    sorted.emplace_back(c.column, c.op);
+  std::vector<std::pair<int, int>> expected;
+  expected.insert(expected.end(), 8, {0, SQLITE_INDEX_CONSTRAINT_EQ});
+  expected.insert(expected.end(), 8, {2, SQLITE_INDEX_CONSTRAINT_GT});
+  expected.insert(expected.end(), 8, {3, SQLITE_INDEX_CONSTRAINT_EQ});
+  for (uint32_t i = 0; i < 8; ++i) {
+    expected.emplace_back(1, SQLITE_INDEX_CONSTRAINT_EQ);
+    expected.emplace_back(3, SQLITE_INDEX_CONSTRAINT_LT);
+  }
+  ASSERT_EQ(sorted, expected);
+}
+
+TEST(DbSqliteTable, OverlapCheaperThanTsScan) {
+  IntervalTestTable table;
+  for (uint32_t i = 0; i < 1234; ++i)
+    table.Insert(i, 10, 0);
+
+  QueryConstraints ts_lt;
+  ts_lt.AddConstraint(1u, SQLITE_INDEX_CONSTRAINT_LT, 0u);
+
+  auto ts_cost = DbSqliteTable::EstimateCost(table, ts_lt);
+
+  // Constraint on the hidden ts_end column.
+  QueryConstraints overlap;
+  overlap.AddConstraint(1u, SQLITE_INDEX_CONSTRAINT_LT, 0u);
+  overlap.AddConstraint(4u, SQLITE_INDEX_CONSTRAINT_GT, 1u);
+
+  auto overlap_cost = DbSqliteTable::EstimateCost(table, overlap);
+
+  ASSERT_LT(overlap_cost.cost, ts_cost.cost);
+  ASSERT_LT(overlap_cost.rows, ts_cost.rows);
+}
+
+TEST(DbSqliteTable, OverlapQuery) {
+  IntervalTestTable table;
+  table.Insert(0, 100, 0);
+  table.Insert(10, 20, 1);
+  table.Insert(15, base::nullopt, 2);
+  table.Insert(40, 0, 1);
+  table.Insert(50, -1, 1);
+  table.Insert(120, 10, 0);
+
+  sqlite3* raw_db = nullptr;
+  ASSERT_EQ(sqlite3_open(":memory:", &raw_db), SQLITE_OK);
+  ScopedDb db(raw_db);
+  DbSqliteTable::RegisterTable(*db, nullptr, &table, "interval");
+
+  ASSERT_THAT(QueryIds(*db, "SELECT id FROM interval WHERE ts_end > 35"),
+              testing::ElementsAre(0, 3, 4, 5));
+  ASSERT_THAT(
+      QueryIds(*db, "SELECT id FROM interval WHERE ts < 45 AND ts_end > 35"),
+      testing::ElementsAre(0, 3));
+  ASSERT_THAT(
+      QueryIds(*db, "SELECT id FROM interval WHERE ts <= 40 AND ts_end >= 30"),
+      testing::ElementsAre(0, 1, 3));
+  ASSERT_THAT(QueryIds(*db,
+                       "SELECT id FROM interval WHERE ts < 200 AND "
+                       "ts_end > 0 AND depth = 1"),
+              testing::ElementsAre(1, 3, 4));
+  ASSERT_THAT(QueryIds(*db,
+                       "SELECT id FROM interval WHERE ts < 200 AND "
+                       "ts_end > 0 ORDER BY ts_end DESC"),
+              testing::ElementsAre(5, 0, 4, 3, 1));
+  ASSERT_THAT(QueryIds(*db, "SELECT id FROM interval WHERE ts_end = 30"),
+              testing::ElementsAre(1));
+  ASSERT_THAT(QueryIds(*db, "SELECT id FROM interval WHERE ts_end IS NULL"),
+              testing::ElementsAre(2));
+}
+
+TEST(DbSqliteTable, OverlapQueryMatchesScan) {
+  IntervalTestTable table;
+  std::minstd_rand0 rnd_engine(42);
+  int64_t ts = 0;
+  for (uint32_t i = 0; i < 4096; ++i) {
+    ts += rnd_engine() % 100;
+    table.Insert(ts, static_cast<int64_t>(rnd_engine() % 1000),
+                 rnd_engine() % 4);
+  }
+
+  sqlite3* raw_db = nullptr;
+  ASSERT_EQ(sqlite3_open(":memory:", &raw_db), SQLITE_OK);
+  ScopedDb db(raw_db);
+  DbSqliteTable::RegisterTable(*db, nullptr, &table, "interval");
+
+  for (uint32_t i = 0; i < 100; ++i) {
+    int64_t start = static_cast<int64_t>(rnd_engine() % 200000);
+    int64_t end = start + static_cast<int64_t>(rnd_engine() % 5000);
+    std::string bounds = std::to_string(end) + " AND ts_end > " +
+                         std::to_string(start) + " AND depth = 1";
+    std::string scan = std::to_string(end) + " AND ts + dur > " +
+                       std::to_string(start) + " AND depth = 1";
+    ASSERT_EQ(QueryIds(*db, "SELECT id FROM interval WHERE ts < " + bounds),
+              QueryIds(*db, "SELECT id FROM interval WHERE ts < " + scan));
+  }
+}
+
 TEST(DbSqliteTable, EmptyTableCosting) {
   TestTable table(0u);
 
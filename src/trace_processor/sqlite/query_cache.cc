@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/sqlite/query_cache.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "perfetto/ext/base/hash.h"
+#include "perfetto/ext/base/optional.h"
+
+namespace perfetto {
+namespace trace_processor {
+namespace {
+
+// Filtering tables with fewer rows than this is about as cheap as looking up
+// the cache.
+constexpr uint32_t kMinCachedRowCount = 256;
+
+// The number of entries of a table considered as a starting point when there
+// is no entry for a set of constraints.
+constexpr size_t kMaxSubsetCandidates = 8;
+
+// Returns a string uniquely identifying |c| or nullopt if the constraint
+// should not be cached.
+base::Optional<std::string> SerializeConstraint(const Constraint& c) {
+  std::string out;
+  out.append(reinterpret_cast<const char*>(&c.col_idx), sizeof(c.col_idx));
+  out.push_back(static_cast<char>(c.op));
+  out.push_back(static_cast<char>(c.value.type));
+  switch (c.value.type) {
+    case SqlValue::Type::kNull:
+      break;
+    case SqlValue::Type::kLong:
+      out.append(reinterpret_cast<const char*>(&c.value.long_value),
+                 sizeof(c.value.long_value));
+      break;
+    case SqlValue::Type::kDouble:
+      out.append(reinterpret_cast<const char*>(&c.value.double_value),
+                 sizeof(c.value.double_value));
+      break;
+    case SqlValue::Type::kString:
+      out.append(c.value.string_value);
+      break;
+    case SqlValue::Type::kBytes:
+      // Constraints on blobs are rare enough that they are not worth caching.
+      return base::nullopt;
+  }
+  return base::make_optional(std::move(out));
+}
+
+// Returns whether filtering |table| with |cs| is expensive enough to be worth
+// caching. Small tables and constraints on id and sorted columns (which only
+// need a binary search) are always cheap.
+bool ShouldCache(const Table& table, const std::vector<Constraint>& cs) {
+  if (table.row_count() < kMinCachedRowCount)
+    return false;
+  return std::any_of(cs.begin(), cs.end(), [&table](const Constraint& c) {
+    const Column& col = table.GetColumn(c.col_idx);
+    return !col.IsId() && !col.IsSorted();
+  });
+}
+
+// Returns the key of a sorted list of serialized constraints.
+std::string JoinConstraints(const std::vector<std::string>& constraints) {
+  std::string out;
+  for (const std::string& c : constraints) {
+    uint32_t size = static_cast<uint32_t>(c.size());
+    out.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    out.append(c);
+  }
+  return out;
+}
+
+}  // namespace
+
+size_t QueryCache::KeyHasher::operator()(const Key& key) const {
+  base::Hash hash;
+  hash.Update(reinterpret_cast<uintptr_t>(key.first));
+  hash.Update(key.second.data(), key.second.size());
+  return static_cast<size_t>(hash.digest());
+}
+
+QueryCache::QueryCache(size_t budget_bytes) : budget_bytes_(budget_bytes) {}
+
+QueryCache::~QueryCache() = default;
+
+RowMap QueryCache::FilterToRowMap(const Table& table,
+                                  const std::vector<Constraint>& cs) {
+  if (budget_bytes_ == 0 || !ShouldCache(table, cs))
+    return table.FilterToRowMap(cs);
+
+  // Sort the constraints by their serialized form so the key does not depend
+  // on the order of the constraints. We keep the index of each constraint
+  // to be able to only apply some of them when starting from a subset.
+  std::vector<std::pair<std::string, size_t>> sorted_cs;
+  sorted_cs.reserve(cs.size());
+  for (size_t i = 0; i < cs.size(); ++i) {
+    base::Optional<std::string> serialized = SerializeConstraint(cs[i]);
+    if (!serialized)
+      return table.FilterToRowMap(cs);
+    sorted_cs.emplace_back(std::move(*serialized), i);
+  }
+  std::sort(sorted_cs.begin(), sorted_cs.end());
+
+  std::vector<std::string> constraints;
+  constraints.reserve(sorted_cs.size());
+  for (const auto& c : sorted_cs)
+    constraints.emplace_back(c.first);
+  Key key(&table, JoinConstraints(constraints));
+
+  uint64_t generation = table.generation();
+  auto index_it = index_.find(key);
+  if (index_it != index_.end()) {
+    auto it = index_it->second;
+    if (it->generation == generation) {
+      stats_.hits++;
+      entries_.splice(entries_.begin(), entries_, it);
+      return it->row_map.Copy();
+    }
+    // The table was modified since the entry was cached.
+    Erase(it);
+    stats_.evictions++;
+  }
+
+  auto best_it = FindSubset(table, constraints);
+  RowMap rm;
+  if (best_it != entries_.end()) {
+    stats_.partial_hits++;
+    entries_.splice(entries_.begin(), entries_, best_it);
+
+    // Figure out which constraints are already applied to the cached RowMap.
+    // As both lists are sorted, we can do this with a single pass.
+    const std::vector<std::string>& subset = best_it->constraints;
+    std::vector<bool> applied(cs.size(), false);
+    size_t subset_idx = 0;
+    for (const auto& c : sorted_cs) {
+      if (subset_idx < subset.size() && subset[subset_idx] == c.first) {
+        applied[c.second] = true;
+        subset_idx++;
+      }
+    }
+    PERFETTO_DCHECK(subset_idx == subset.size());
+
+    // Apply the remaining constraints in their original order as it was
+    // chosen to filter the cheapest constraints first.
+    rm = best_it->row_map.Copy();
+    for (size_t i = 0; i < cs.size(); ++i) {
+      if (!applied[i])
+        table.GetColumn(cs[i].col_idx).FilterInto(cs[i].op, cs[i].value, &rm);
+    }
+  } else {
+    stats_.misses++;
+    rm = table.FilterToRowMap(cs);
+  }
+
+  Entry entry;
+  entry.key = std::move(key);
+  entry.generation = generation;
+  entry.constraints = std::move(constraints);
+  entry.row_map = rm.Copy();
+  entry.size_bytes = 0;
+  Insert(std::move(entry));
+  return rm;
+}
+
+QueryCache::EntryList::iterator QueryCache::FindSubset(
+    const Table& table,
+    const std::vector<std::string>& constraints) {
+  auto best_it = entries_.end();
+  auto recent_it = recent_keys_.find(&table);
+  if (recent_it == recent_keys_.end())
+    return best_it;
+
+  uint64_t generation = table.generation();
+  for (const Key& key : recent_it->second) {
+    auto index_it = index_.find(key);
+    if (index_it == index_.end())
+      continue;
+
+    auto it = index_it->second;
+    if (it->generation != generation) {
+      Erase(it);
+      stats_.evictions++;
+      continue;
+    }
+    bool is_subset =
+        std::includes(constraints.begin(), constraints.end(),
+                      it->constraints.begin(), it->constraints.end());
+    if (is_subset && (best_it == entries_.end() ||
+                      it->row_map.size() < best_it->row_map.size())) {
+      best_it = it;
+    }
+  }
+  return best_it;
+}
+
+void QueryCache::Insert(Entry entry) {
+  entry.size_bytes = sizeof(Entry) + entry.row_map.GetMemoryUsage() +
+                     entry.key.second.capacity();
+  for (const std::string& c : entry.constraints)
+    entry.size_bytes += c.capacity();
+
+  // Don't bother trying to cache entries which would evict everything else.
+  if (entry.size_bytes > budget_bytes_ / 2)
+    return;
+
+  std::deque<Key>& recent_keys = recent_keys_[entry.key.first];
+  if (std::find(recent_keys.begin(), recent_keys.end(), entry.key) ==
+      recent_keys.end()) {
+    recent_keys.push_back(entry.key);
+    if (recent_keys.size() > kMaxSubsetCandidates)
+      recent_keys.pop_front();
+  }
+
+  size_bytes_ += entry.size_bytes;
+  entries_.emplace_front(std::move(entry));
+  index_.emplace(entries_.front().key, entries_.begin());
+  while (size_bytes_ > budget_bytes_) {
+    Erase(std::prev(entries_.end()));
+    stats_.evictions++;
+  }
+}
+
+void QueryCache::Erase(EntryList::iterator it) {
+  size_bytes_ -= it->size_bytes;
+  index_.erase(it->key);
+  entries_.erase(it);
+}
+
+}  // namespace trace_processor
+}  // namespace perfetto
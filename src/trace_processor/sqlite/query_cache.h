@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_SQLITE_QUERY_CACHE_H_
+#define SRC_TRACE_PROCESSOR_SQLITE_QUERY_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "src/trace_processor/containers/row_map.h"
+#include "src/trace_processor/db/table.h"
+
+namespace perfetto {
+namespace trace_processor {
+
+// Caches the result of filtering db tables (i.e. the RowMap of the rows
+// matching a set of constraints) so that repeated queries, which are very
+// common when the UI pans and zooms, do not need to filter the table again.
+//
+// Entries are keyed on the table and the set of constraints (the order of the
+// constraints does not matter) and remember the generation of the table so
+// entries are never used once the table is modified. When there is no entry
+// for a set of constraints, the entry with the fewest rows whose constraints
+// are a subset of them is used as a starting point: this makes queries
+// refining a previous query (e.g. adding a constraint on a column) cheaper.
+// To keep lookups cheap, only the few most recently inserted entries of the
+// table are considered for this.
+//
+// The least recently used entries are evicted when the memory used by the
+// RowMaps goes over the budget given at construction. Entries of a table which
+// was modified are removed when they are next looked up and are otherwise
+// evicted like any other entry as they are never used again. The hits, misses
+// and memory usage of the cache are exposed by stats() to be reported in the
+// stats table.
+//
+// Only constraints on tables which live as long as the cache (i.e. the tables
+// in TraceStorage) should be cached.
+class QueryCache {
+ public:
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t partial_hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+  };
+
+  explicit QueryCache(size_t budget_bytes);
+  ~QueryCache();
+
+  // Returns the RowMap of the rows of |table| matching all the constraints in
+  // |cs|, either using the cache or by filtering |table| (in which case the
+  // result is added to the cache if worthwhile).
+  RowMap FilterToRowMap(const Table& table, const std::vector<Constraint>& cs);
+
+  // Returns the number of bytes used by the cached RowMaps.
+  size_t size_bytes() const { return size_bytes_; }
+
+  // Returns the number of cached RowMaps.
+  size_t entry_count() const { return entries_.size(); }
+
+  const Stats& stats() const { return stats_; }
+
+ private:
+  // The table and the serialized constraints of an entry.
+  using Key = std::pair<const Table*, std::string>;
+
+  struct KeyHasher {
+    size_t operator()(const Key& key) const;
+  };
+
+  struct Entry {
+    Key key;
+    uint64_t generation;
+
+    // The serialized constraints of the entry, sorted.
+    std::vector<std::string> constraints;
+
+    RowMap row_map;
+    size_t size_bytes;
+  };
+
+  using EntryList = std::list<Entry>;
+
+  QueryCache(const QueryCache&) = delete;
+  QueryCache& operator=(const QueryCache&) = delete;
+
+  // Returns the cached entry which can be used to filter |table| with
+  // |constraints| with the fewest rows or entries_.end() if there is none.
+  EntryList::iterator FindSubset(const Table& table,
+                                 const std::vector<std::string>& constraints);
+
+  // Inserts an entry at the front of the cache, evicting entries if needed.
+  void Insert(Entry entry);
+
+  // Removes |it| from the cache.
+  void Erase(EntryList::iterator it);
+
+  const size_t budget_bytes_;
+
+  // Entries of the cache, from the most to the least recently used.
+  EntryList entries_;
+  std::unordered_map<Key, EntryList::iterator, KeyHasher> index_;
+  size_t size_bytes_ = 0;
+
+  // The keys of the last few entries inserted for each table, from the oldest
+  // to the newest: these are the candidates for partial hits. Keys of evicted
+  // entries are only removed once they are replaced.
+  std::unordered_map<const Table*, std::deque<Key>> recent_keys_;
+
+  Stats stats_;
+};
+
+}  // namespace trace_processor
+}  // namespace perfetto
+
+#endif  // SRC_TRACE_PROCESSOR_SQLITE_QUERY_CACHE_H_
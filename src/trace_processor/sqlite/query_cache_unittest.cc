@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/sqlite/query_cache.h"
+
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto {
+namespace trace_processor {
+namespace {
+
+class TestTable : public Table {
+ public:
+  TestTable(StringPool* pool) : Table(pool, nullptr) {
+    row_maps_.emplace_back();
+    columns_.emplace_back(Column::IdColumn(this, 0u, 0u));
+    columns_.emplace_back(
+        Column("a", &a_, Column::Flag::kNonNull, this, 1u, 0u));
+    columns_.emplace_back(
+        Column("b", &b_, Column::Flag::kNonNull, this, 2u, 0u));
+  }
+
+  void Insert(uint32_t a, uint32_t b) {
+    a_.Append(a);
+    b_.Append(b);
+    row_maps_.back().Insert(row_count_++);
+  }
+
+  void SetA(uint32_t row, uint32_t a) { a_.Set(row, a); }
+
+  Constraint id_lt(uint32_t v) const {
+    return GetColumn(0).lt_value(SqlValue::Long(v));
+  }
+  Constraint a_eq(uint32_t v) const {
+    return GetColumn(1).eq_value(SqlValue::Long(v));
+  }
+  Constraint b_lt(uint32_t v) const {
+    return GetColumn(2).lt_value(SqlValue::Long(v));
+  }
+
+ private:
+  SparseVector<uint32_t> a_;
+  SparseVector<uint32_t> b_;
+};
+
+std::vector<uint32_t> ToVector(const RowMap& rm) {
+  std::vector<uint32_t> rows;
+  for (uint32_t i = 0; i < rm.size(); ++i)
+    rows.push_back(rm.Get(i));
+  return rows;
+}
+
+class QueryCacheUnittest : public ::testing::Test {
+ protected:
+  QueryCacheUnittest() {
+    for (uint32_t i = 0; i < 1000; ++i)
+      table_.Insert(i % 10, i % 7);
+  }
+
+  // Checks that filtering through the cache gives the same result as directly
+  // filtering the table.
+  void CheckFilter(const std::vector<Constraint>& cs) {
+    ASSERT_EQ(ToVector(cache_.FilterToRowMap(table_, cs)),
+              ToVector(table_.FilterToRowMap(cs)));
+  }
+
+  StringPool pool_;
+  TestTable table_{&pool_};
+  QueryCache cache_{1024 * 1024};
+};
+
+TEST_F(QueryCacheUnittest, RepeatedQueryHits) {
+  CheckFilter({table_.a_eq(3)});
+  ASSERT_EQ(cache_.stats().misses, 1u);
+  ASSERT_EQ(cache_.stats().hits, 0u);
+  ASSERT_EQ(cache_.entry_count(), 1u);
+
+  CheckFilter({table_.a_eq(3)});
+  ASSERT_EQ(cache_.stats().misses, 1u);
+  ASSERT_EQ(cache_.stats().hits, 1u);
+
+  CheckFilter({table_.a_eq(4)});
+  ASSERT_EQ(cache_.stats().misses, 2u);
+  ASSERT_EQ(cache_.entry_count(), 2u);
+}
+
+TEST_F(QueryCacheUnittest, ConstraintOrderIgnored) {
+  CheckFilter({table_.a_eq(3), table_.b_lt(4)});
+  CheckFilter({table_.b_lt(4), table_.a_eq(3)});
+  ASSERT_EQ(cache_.stats().misses, 1u);
+  ASSERT_EQ(cache_.stats().hits, 1u);
+}
+
+TEST_F(QueryCacheUnittest, RefinedQueryPartialHit) {
+  CheckFilter({table_.a_eq(3)});
+  CheckFilter({table_.id_lt(500), table_.a_eq(3), table_.b_lt(4)});
+  ASSERT_EQ(cache_.stats().misses, 1u);
+  ASSERT_EQ(cache_.stats().partial_hits, 1u);
+
+  // The refined query should now be cached too.
+  CheckFilter({table_.a_eq(3), table_.b_lt(4), table_.id_lt(500)});
+  ASSERT_EQ(cache_.stats().hits, 1u);
+}
+
+TEST_F(QueryCacheUnittest, OnlyRecentEntriesUsedForPartialHits) {
+  CheckFilter({table_.a_eq(3)});
+  for (uint32_t i = 0; i < 8; ++i)
+    CheckFilter({table_.b_lt(i)});
+
+  // The entry for a == 3 is still cached but too old to be a candidate.
+  CheckFilter({table_.a_eq(3), table_.id_lt(500)});
+  ASSERT_EQ(cache_.stats().misses, 10u);
+  ASSERT_EQ(cache_.stats().partial_hits, 0u);
+  CheckFilter({table_.a_eq(3)});
+  ASSERT_EQ(cache_.stats().hits, 1u);
+
+  CheckFilter({table_.b_lt(7), table_.id_lt(500)});
+  ASSERT_EQ(cache_.stats().partial_hits, 1u);
+}
+
+TEST_F(QueryCacheUnittest, ModificationInvalidates) {
+  CheckFilter({table_.a_eq(3)});
+
+  table_.SetA(0, 3);
+  CheckFilter({table_.a_eq(3)});
+  ASSERT_EQ(cache_.stats().misses, 2u);
+  ASSERT_EQ(cache_.stats().evictions, 1u);
+
+  table_.Insert(3, 0);
+  CheckFilter({table_.a_eq(3)});
+  ASSERT_EQ(cache_.stats().misses, 3u);
+  ASSERT_EQ(cache_.stats().evictions, 2u);
+  ASSERT_EQ(cache_.entry_count(), 1u);
+}
+
+TEST_F(QueryCacheUnittest, CheapConstraintsNotCached) {
+  CheckFilter({table_.id_lt(10)});
+  ASSERT_EQ(cache_.entry_count(), 0u);
+  ASSERT_EQ(cache_.stats().misses, 0u);
+}
+
+TEST_F(QueryCacheUnittest, SmallTablesNotCached) {
+  TestTable small(&pool_);
+  for (uint32_t i = 0; i < 100; ++i)
+    small.Insert(i % 10, i % 7);
+  cache_.FilterToRowMap(small, {small.a_eq(3)});
+  ASSERT_EQ(cache_.entry_count(), 0u);
+  ASSERT_EQ(cache_.stats().misses, 0u);
+}
+
+TEST_F(QueryCacheUnittest, EvictsLeastRecentlyUsed) {
+  QueryCache cache(1024);
+  for (uint32_t i = 0; i < 10; ++i) {
+    cache.FilterToRowMap(table_, {table_.a_eq(i)});
+    ASSERT_LE(cache.size_bytes(), 1024u);
+  }
+  ASSERT_GT(cache.stats().evictions, 0u);
+  ASSERT_LT(cache.entry_count(), 10u);
+
+  // The most recent entry should still be present.
+  cache.FilterToRowMap(table_, {table_.a_eq(9)});
+  ASSERT_EQ(cache.stats().hits, 1u);
+}
+
+TEST_F(QueryCacheUnittest, ZeroBudgetDisablesCache) {
+  QueryCache cache(0);
+  cache.FilterToRowMap(table_, {table_.a_eq(1)});
+  cache.FilterToRowMap(table_, {table_.a_eq(1)});
+  ASSERT_EQ(cache.entry_count(), 0u);
+  ASSERT_EQ(cache.stats().hits, 0u);
+}
+
+}  // namespace
+}  // namespace trace_processor
+}  // namespace perfetto
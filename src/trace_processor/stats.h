@@ -126,7 +126,12 @@ namespace stats {
   F(sched_waking_out_of_order,                kSingle,  kError,    kAnalysis), \
   F(compact_sched_switch_skipped,             kSingle,  kInfo,     kAnalysis), \
   F(compact_sched_waking_skipped,             kSingle,  kInfo,     kAnalysis), \
-  F(empty_chrome_metadata,                    kSingle,  kError,    kTrace)
+  F(empty_chrome_metadata,                    kSingle,  kError,    kTrace),    \
+  F(query_cache_hits,                         kSingle,  kInfo,     kAnalysis), \
+  F(query_cache_partial_hits,                 kSingle,  kInfo,     kAnalysis), \
+  F(query_cache_misses,                       kSingle,  kInfo,     kAnalysis), \
+  F(query_cache_evictions,                    kSingle,  kInfo,     kAnalysis), \
+  F(query_cache_size_bytes,                   kSingle,  kInfo,     kAnalysis)
 // clang-format on
 
 enum Type {
@@ -23,13 +23,13 @@ StorageColumn::StorageColumn(std::string col_name, bool hidden)
     : col_name_(col_name), hidden_(hidden) {}
 StorageColumn::~StorageColumn() = default;
 
-StringPoolAccessor::StringPoolAccessor(const std::deque<StringId>* deque,
+StringPoolAccessor::StringPoolAccessor(const ChunkedVector<StringId>* data,
                                        const StringPool* string_pool)
-    : deque_(deque), string_pool_(string_pool) {}
+    : data_(data), string_pool_(string_pool) {}
 StringPoolAccessor::~StringPoolAccessor() = default;
 
-TsEndAccessor::TsEndAccessor(const std::deque<int64_t>* ts,
-                             const std::deque<int64_t>* dur)
+TsEndAccessor::TsEndAccessor(const ChunkedVector<int64_t>* ts,
+                             const ChunkedVector<int64_t>* dur)
     : ts_(ts), dur_(dur) {}
 TsEndAccessor::~TsEndAccessor() = default;
 
@@ -17,12 +17,12 @@
 #ifndef SRC_TRACE_PROCESSOR_STORAGE_COLUMNS_H_
 #define SRC_TRACE_PROCESSOR_STORAGE_COLUMNS_H_
 
-#include <deque>
 #include <limits>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "src/trace_processor/containers/chunked_vector.h"
 #include "src/trace_processor/filtered_row_index.h"
 #include "src/trace_processor/sqlite/sqlite_utils.h"
 #include "src/trace_processor/trace_storage.h"
@@ -258,7 +258,7 @@ class NumericStorageColumn : public StorageColumn {
 
 // Defines an accessor for columns.
 // An accessor is a abstraction over the method to retrieve data in a column. As
-// there are many possible types of backing data (std::vector, std::deque,
+// there are many possible types of backing data (std::vector, ChunkedVector,
 // creating on the flight etc.), this class hides this complexity behind an
 // interface to let the column implementation focus on actually interfacing
 // with SQLite and rest of trace processor.
@@ -300,79 +300,79 @@ class Accessor {
   }
 };
 
-// An accessor implementation for string which uses a deque to store offsets
-// into a StringPool.
+// An accessor implementation for string which uses a ChunkedVector to store
+// offsets into a StringPool.
 class StringPoolAccessor : public Accessor<NullTermStringView> {
  public:
-  StringPoolAccessor(const std::deque<StringPool::Id>* deque,
+  StringPoolAccessor(const ChunkedVector<StringPool::Id>* data,
                      const StringPool* string_pool);
   ~StringPoolAccessor() override;
 
   uint32_t Size() const override {
-    return static_cast<uint32_t>(deque_->size());
+    return static_cast<uint32_t>(data_->size());
   }
 
   NullTermStringView Get(uint32_t idx) const override {
-    return string_pool_->Get((*deque_)[idx]);
+    return string_pool_->Get((*data_)[idx]);
   }
 
  private:
-  const std::deque<StringPool::Id>* deque_;
+  const ChunkedVector<StringPool::Id>* data_;
   const StringPool* string_pool_;
 };
 
-// An accessor implementation for string which uses a deque to store indices
-// into a vector of strings.
+// An accessor implementation for string which uses a ChunkedVector to store
+// indices into a vector of strings.
 template <typename Id>
 class StringVectorAccessor : public Accessor<NullTermStringView> {
  public:
-  StringVectorAccessor(const std::deque<Id>* deque,
+  StringVectorAccessor(const ChunkedVector<Id>* data,
                        const std::vector<NullTermStringView>* string_map)
-      : deque_(deque), string_map_(string_map) {}
+      : data_(data), string_map_(string_map) {}
   ~StringVectorAccessor() override = default;
 
   uint32_t Size() const override {
-    return static_cast<uint32_t>(deque_->size());
+    return static_cast<uint32_t>(data_->size());
   }
 
   NullTermStringView Get(uint32_t idx) const override {
-    return (*string_map_)[static_cast<size_t>((*deque_)[idx])];
+    return (*string_map_)[static_cast<size_t>((*data_)[idx])];
   }
 
  private:
-  const std::deque<Id>* deque_;
+  const ChunkedVector<Id>* data_;
   const std::vector<NullTermStringView>* string_map_;
 };
 
-// An accessor implementation for numeric columns which uses a deque as the
-// backing storage with an opitonal index for quick equality filtering.
+// An accessor implementation for numeric columns which uses a ChunkedVector as
+// the backing storage with an opitonal index for quick equality filtering.
 template <typename NumericType>
-class NumericDequeAccessor : public Accessor<NumericType> {
+class NumericVectorAccessor : public Accessor<NumericType> {
  public:
-  NumericDequeAccessor(const std::deque<NumericType>* deque,
-                       const std::deque<std::vector<uint32_t>>* index,
-                       bool has_ordering)
-      : deque_(deque), index_(index), has_ordering_(has_ordering) {}
-  ~NumericDequeAccessor() override = default;
+  NumericVectorAccessor(const ChunkedVector<NumericType>* data,
+                        const ChunkedVector<std::vector<uint32_t>>* index,
+                        bool has_ordering)
+      : data_(data), index_(index), has_ordering_(has_ordering) {}
+  ~NumericVectorAccessor() override = default;
 
   uint32_t Size() const override {
-    return static_cast<uint32_t>(deque_->size());
+    return static_cast<uint32_t>(data_->size());
   }
 
-  NumericType Get(uint32_t idx) const override { return (*deque_)[idx]; }
+  NumericType Get(uint32_t idx) const override { return (*data_)[idx]; }
 
   bool HasOrdering() const override { return has_ordering_; }
 
   uint32_t LowerBoundIndex(NumericType value) const override {
     PERFETTO_DCHECK(HasOrdering());
-    auto it = std::lower_bound(deque_->begin(), deque_->end(), value);
-    return static_cast<uint32_t>(std::distance(deque_->begin(), it));
+    auto it = std::lower_bound(data_->begin(), data_->end(), value);
+    return static_cast<uint32_t>(std::distance(data_->begin(), it));
   }
 
   uint32_t UpperBoundIndex(NumericType value) const override {
     PERFETTO_DCHECK(HasOrdering());
-    auto it = std::upper_bound(deque_->begin(), deque_->end(), value);
-    return static_cast<uint32_t>(std::distance(deque_->begin(), it));
+    auto it = std::upper_bound(data_->begin(), data_->end(), value);
+    return static_cast<uint32_t>(std::distance(data_->begin(), it));
   }
 
   bool CanFindEqualIndices() const override {
@@ -387,14 +387,15 @@ class NumericDequeAccessor : public Accessor<NumericType> {
   }
 
  private:
-  const std::deque<NumericType>* deque_ = nullptr;
-  const std::deque<std::vector<uint32_t>>* index_ = nullptr;
+  const ChunkedVector<NumericType>* data_ = nullptr;
+  const ChunkedVector<std::vector<uint32_t>>* index_ = nullptr;
   bool has_ordering_ = false;
 };
 
 class TsEndAccessor : public Accessor<int64_t> {
  public:
-  TsEndAccessor(const std::deque<int64_t>* ts, const std::deque<int64_t>* dur);
+  TsEndAccessor(const ChunkedVector<int64_t>* ts,
+                const ChunkedVector<int64_t>* dur);
   ~TsEndAccessor() override;
 
   uint32_t Size() const override { return static_cast<uint32_t>(ts_->size()); }
@@ -404,8 +405,8 @@ class TsEndAccessor : public Accessor<int64_t> {
   }
 
  private:
-  const std::deque<int64_t>* ts_ = nullptr;
-  const std::deque<int64_t>* dur_ = nullptr;
+  const ChunkedVector<int64_t>* ts_ = nullptr;
+  const ChunkedVector<int64_t>* dur_ = nullptr;
 };
 
 class RowAccessor : public Accessor<uint32_t> {
@@ -18,7 +18,6 @@
 #define SRC_TRACE_PROCESSOR_STORAGE_SCHEMA_H_
 
 #include <algorithm>
-#include <deque>
 #include <memory>
 #include <string>
 #include <utility>
@@ -52,18 +51,18 @@ class StorageSchema {
     template <class NumericType>
     Builder& AddNumericColumn(
         std::string column_name,
-        const std::deque<NumericType>* vals,
-        const std::deque<std::vector<uint32_t>>* index = nullptr) {
-      NumericDequeAccessor<NumericType> accessor(vals, index,
-                                                 false /* has_ordering */);
+        const ChunkedVector<NumericType>* vals,
+        const ChunkedVector<std::vector<uint32_t>>* index = nullptr) {
+      NumericVectorAccessor<NumericType> accessor(vals, index,
+                                                  false /* has_ordering */);
       return AddGenericNumericColumn(column_name, accessor);
     }
 
     template <class NumericType>
     Builder& AddOrderedNumericColumn(std::string column_name,
-                                     const std::deque<NumericType>* vals) {
-      NumericDequeAccessor<NumericType> accessor(vals, nullptr,
-                                                 true /* has_ordering */);
+                                     const ChunkedVector<NumericType>* vals) {
+      NumericVectorAccessor<NumericType> accessor(vals, nullptr,
+                                                  true /* has_ordering */);
       return AddGenericNumericColumn(column_name, accessor);
     }
 
@@ -78,7 +77,7 @@ class StorageSchema {
     template <class Id>
     Builder& AddStringColumn(
         std::string column_name,
-        const std::deque<Id>* ids,
+        const ChunkedVector<Id>* ids,
         const std::vector<NullTermStringView>* string_map) {
       StringVectorAccessor<Id> accessor(ids, string_map);
       columns_.emplace_back(
@@ -87,7 +86,7 @@ class StorageSchema {
     }
 
     Builder& AddStringColumn(std::string column_name,
-                             const std::deque<StringPool::Id>* ids,
+                             const ChunkedVector<StringPool::Id>* ids,
                              const StringPool* string_pool) {
       StringPoolAccessor accessor(ids, string_pool);
       columns_.emplace_back(
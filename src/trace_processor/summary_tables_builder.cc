@@ -0,0 +1,384 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/summary_tables_builder.h"
+
+#include <algorithm>
+#include <limits>
+#include <queue>
+#include <tuple>
+#include <vector>
+
+#include "perfetto/base/logging.h"
+#include "src/trace_processor/trace_storage.h"
+
+namespace perfetto {
+namespace trace_processor {
+
+namespace {
+
+// Buckets are never larger than 2^kMaxLevel ns to avoid overflows.
+constexpr uint32_t kMaxLevel = 62;
+
+// An event to add to the summaries.
+struct Event {
+  // The cpu or track of the event.
+  uint32_t key;
+
+  // The event covers [start_ns, end_ns); instant events have
+  // |end_ns| == |start_ns| and only cover the bucket they are in.
+  int64_t start_ns;
+  int64_t end_ns;
+
+  // Whether the event adds to the busy duration of the buckets it overlaps.
+  bool busy;
+
+  uint32_t depth;
+  double value;
+};
+
+struct Bucket {
+  // The cpu or track the bucket belongs to.
+  uint32_t key;
+
+  // The bucket covers [index * 2^level, (index + 1) * 2^level).
+  int64_t index;
+
+  uint32_t count;
+  int64_t busy_dur;
+  double min_value;
+  double max_value;
+  uint32_t max_depth;
+};
+
+int64_t BucketStart(int64_t index, uint32_t level) {
+  return static_cast<int64_t>(static_cast<uint64_t>(index) << level);
+}
+
+// Returns the index of the first and last buckets of |level| covered by |e|.
+int64_t FirstBucket(const Event& e, uint32_t level) {
+  return e.start_ns >> level;
+}
+
+int64_t LastBucket(const Event& e, uint32_t level) {
+  return e.end_ns > e.start_ns ? (e.end_ns - 1) >> level : e.start_ns >> level;
+}
+
+void MergeInto(const Bucket& b, Bucket* out) {
+  out->count += b.count;
+  out->busy_dur += b.busy_dur;
+  out->min_value = std::min(out->min_value, b.min_value);
+  out->max_value = std::max(out->max_value, b.max_value);
+  out->max_depth = std::max(out->max_depth, b.max_depth);
+}
+
+// Computes the buckets of every level from |events|: the i-th entry of the
+// result contains the buckets of level |min_level + i|, sorted by key and
+// index. Only the buckets overlapping at least one event are returned and the
+// last level is the first one where each key only has a single bucket.
+//
+// An event is only counted in the bucket it starts in but its depth and busy
+// duration apply to all the buckets it overlaps. Rather than adding each event
+// to each of these buckets, the events of each key are swept in order of start
+// with a heap of the events overlapping the current bucket (for the max depth)
+// and difference arrays (for the busy duration). This keeps the cost
+// proportional to the number of events plus the number of buckets returned.
+std::vector<std::vector<Bucket>> BuildLevels(std::vector<Event> events,
+                                             uint32_t min_level) {
+  std::vector<std::vector<Bucket>> levels;
+  if (events.empty())
+    return levels;
+
+  std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) {
+    return std::tie(a.key, a.start_ns) < std::tie(b.key, b.start_ns);
+  });
+
+  // Find the last level (the first one where the first and last buckets of
+  // each key merge) and the range of buckets covered by the events.
+  int64_t first_index = FirstBucket(events.front(), min_level);
+  int64_t last_index = first_index;
+  uint32_t max_shift = 0;
+  for (size_t i = 0; i < events.size();) {
+    int64_t key_first = FirstBucket(events[i], min_level);
+    int64_t key_last = key_first;
+    size_t j = i;
+    for (; j < events.size() && events[j].key == events[i].key; ++j)
+      key_last = std::max(key_last, LastBucket(events[j], min_level));
+
+    uint32_t shift = 0;
+    while (min_level + shift < kMaxLevel &&
+           (key_first >> shift) != (key_last >> shift)) {
+      shift++;
+    }
+    max_shift = std::max(max_shift, shift);
+    first_index = std::min(first_index, key_first);
+    last_index = std::max(last_index, key_last);
+    i = j;
+  }
+  uint32_t last_level = min_level + max_shift;
+  levels.resize(max_shift + 1);
+
+  // For the bucket at |index|, |tail_busy[index - first_index]| is the busy
+  // duration of the events ending in it (but starting before) and
+  // |full_busy_delta[index - first_index]| the change in the number of events
+  // covering the whole bucket compared to the previous one. Entries are reset
+  // once read so the arrays can be reused for each key.
+  size_t bucket_count = static_cast<size_t>(last_index - first_index + 1);
+  std::vector<int64_t> tail_busy(bucket_count + 1);
+  std::vector<int64_t> full_busy_delta(bucket_count + 1);
+  const int64_t bucket_size = int64_t(1) << min_level;
+
+  // The events overlapping the current bucket, sorted by depth. Events which
+  // ended before the current bucket are only removed once they are on top.
+  struct Active {
+    uint32_t depth;
+    int64_t last_index;
+    bool operator<(const Active& other) const { return depth < other.depth; }
+  };
+  std::priority_queue<Active> active;
+
+  for (size_t i = 0; i < events.size();) {
+    uint32_t key = events[i].key;
+    std::vector<Bucket> buckets;
+    int64_t full_busy = 0;
+    size_t next = i;
+    int64_t index = FirstBucket(events[i], min_level);
+    for (;;) {
+      size_t slot = static_cast<size_t>(index - first_index);
+      full_busy += full_busy_delta[slot];
+      full_busy_delta[slot] = 0;
+
+      Bucket b{};
+      b.key = key;
+      b.index = index;
+      b.busy_dur = tail_busy[slot] + full_busy * bucket_size;
+      b.min_value = std::numeric_limits<double>::max();
+      b.max_value = std::numeric_limits<double>::lowest();
+      tail_busy[slot] = 0;
+
+      int64_t bucket_end = BucketStart(index, min_level) + bucket_size;
+      for (; next < events.size() && events[next].key == key &&
+             FirstBucket(events[next], min_level) == index;
+           ++next) {
+        const Event& e = events[next];
+        int64_t last = LastBucket(e, min_level);
+        b.count++;
+        b.min_value = std::min(b.min_value, e.value);
+        b.max_value = std::max(b.max_value, e.value);
+        if (e.busy && last == index) {
+          b.busy_dur += e.end_ns - e.start_ns;
+        } else if (e.busy) {
+          size_t last_slot = static_cast<size_t>(last - first_index);
+          b.busy_dur += bucket_end - e.start_ns;
+          tail_busy[last_slot] += e.end_ns - BucketStart(last, min_level);
+          full_busy_delta[slot + 1]++;
+          full_busy_delta[last_slot]--;
+        }
+        active.push(Active{e.depth, last});
+      }
+      while (!active.empty() && active.top().last_index < index)
+        active.pop();
+
+      if (!active.empty()) {
+        b.max_depth = active.top().depth;
+        buckets.emplace_back(b);
+        index++;
+      } else if (next < events.size() && events[next].key == key) {
+        // Skip the buckets without events.
+        index = FirstBucket(events[next], min_level);
+      } else {
+        break;
+      }
+    }
+
+    // Merge pairs of buckets to compute the coarser levels of this key.
+    for (uint32_t level = min_level;; ++level) {
+      std::vector<Bucket>& out = levels[level - min_level];
+      out.insert(out.end(), buckets.begin(), buckets.end());
+      if (level == last_level)
+        break;
+
+      std::vector<Bucket> merged;
+      for (const Bucket& bucket : buckets) {
+        int64_t merged_index = bucket.index >> 1;
+        if (!merged.empty() && merged.back().index == merged_index) {
+          MergeInto(bucket, &merged.back());
+        } else {
+          merged.emplace_back(bucket);
+          merged.back().index = merged_index;
+        }
+      }
+      buckets = std::move(merged);
+    }
+    i = next;
+  }
+  return levels;
+}
+
+// Calls |emit| for each bucket of |levels| (see BuildLevels), level by level.
+template <typename Emit>
+void EmitLevels(const std::vector<std::vector<Bucket>>& levels,
+                uint32_t min_level,
+                Emit emit) {
+  for (uint32_t i = 0; i < levels.size(); ++i) {
+    uint32_t level = min_level + i;
+    for (const Bucket& b : levels[i])
+      emit(level, BucketStart(b.index, level), b);
+  }
+}
+
+int64_t EndNs(int64_t ts, int64_t dur, int64_t trace_end_ns) {
+  // Incomplete events have a negative duration: they last until the end of
+  // the trace.
+  if (dur < 0)
+    return std::max(ts, trace_end_ns);
+  return ts + dur;
+}
+
+std::vector<Event> GetCpuEvents(const TraceStorage& storage,
+                                int64_t trace_end_ns) {
+  const auto& slices = storage.slices();
+  std::vector<Event> events;
+  events.reserve(slices.slice_count());
+  for (size_t i = 0; i < slices.slice_count(); ++i) {
+    // Skip the idle thread: only the time spent running threads counts.
+    if (slices.utids()[i] == 0)
+      continue;
+
+    Event event{};
+    event.key = slices.cpus()[i];
+    event.start_ns = slices.start_ns()[i];
+    event.end_ns =
+        EndNs(event.start_ns, slices.durations()[i], trace_end_ns);
+    event.busy = true;
+    events.emplace_back(event);
+  }
+  return events;
+}
+
+std::vector<Event> GetCounterEvents(const TraceStorage& storage) {
+  const auto& counters = storage.counter_table();
+  std::vector<Event> events;
+  events.reserve(counters.row_count());
+  for (uint32_t i = 0; i < counters.row_count(); ++i) {
+    Event event{};
+    event.key = counters.track_id()[i];
+    event.start_ns = counters.ts()[i];
+    event.end_ns = event.start_ns;
+    event.value = counters.value()[i];
+    events.emplace_back(event);
+  }
+  return events;
+}
+
+std::vector<Event> GetSliceEvents(const TraceStorage& storage,
+                                  int64_t trace_end_ns) {
+  const auto& slices = storage.slice_table();
+  std::vector<Event> events;
+  events.reserve(slices.row_count());
+  for (uint32_t i = 0; i < slices.row_count(); ++i) {
+    Event event{};
+    event.key = slices.track_id()[i];
+    event.start_ns = slices.ts()[i];
+    event.end_ns = EndNs(event.start_ns, slices.dur()[i], trace_end_ns);
+    event.depth = slices.depth()[i];
+
+    // Nested slices are covered by their parent so only the top level ones
+    // add to the busy duration.
+    event.busy = event.depth == 0;
+    events.emplace_back(event);
+  }
+  return events;
+}
+
+}  // namespace
+
+constexpr int64_t SummaryTablesBuilder::kMaxBucketCount;
+
+SummaryTablesBuilder::SummaryTablesBuilder(TraceStorage* storage)
+    : storage_(storage) {}
+
+// static
+uint32_t SummaryTablesBuilder::GetMinLevel(int64_t start_ns, int64_t end_ns) {
+  uint32_t level = 0;
+  while (level < kMaxLevel &&
+         (end_ns >> level) - (start_ns >> level) >= kMaxBucketCount) {
+    level++;
+  }
+  return level;
+}
+
+void SummaryTablesBuilder::Build() {
+  PERFETTO_DCHECK(storage_->cpu_summary_table().row_count() == 0);
+  PERFETTO_DCHECK(storage_->counter_summary_table().row_count() == 0);
+  PERFETTO_DCHECK(storage_->slice_summary_table().row_count() == 0);
+
+  auto bounds = storage_->GetTraceTimestampBoundsNs();
+  std::vector<Event> cpu_events = GetCpuEvents(*storage_, bounds.second);
+  std::vector<Event> counter_events = GetCounterEvents(*storage_);
+  std::vector<Event> slice_events = GetSliceEvents(*storage_, bounds.second);
+
+  // The bounds of the trace only consider the start of events: also cover
+  // the end of the events lasting past the last timestamp so that the finest
+  // level never has more than |kMaxBucketCount| buckets.
+  int64_t end_ns = bounds.second;
+  for (const Event& e : cpu_events)
+    end_ns = std::max(end_ns, e.end_ns);
+  for (const Event& e : slice_events)
+    end_ns = std::max(end_ns, e.end_ns);
+  uint32_t min_level = GetMinLevel(bounds.first, end_ns);
+
+  auto* cpu_table = storage_->mutable_cpu_summary_table();
+  EmitLevels(BuildLevels(std::move(cpu_events), min_level), min_level,
+             [cpu_table](uint32_t level, int64_t ts, const Bucket& b) {
+               tables::CpuSummaryTable::Row row;
+               row.level = level;
+               row.cpu = b.key;
+               row.ts = ts;
+               row.count = b.count;
+               row.busy_dur = b.busy_dur;
+               cpu_table->Insert(row);
+             });
+
+  auto* counter_table = storage_->mutable_counter_summary_table();
+  EmitLevels(BuildLevels(std::move(counter_events), min_level), min_level,
+             [counter_table](uint32_t level, int64_t ts, const Bucket& b) {
+               tables::CounterSummaryTable::Row row;
+               row.level = level;
+               row.track_id = b.key;
+               row.ts = ts;
+               row.count = b.count;
+               row.min_value = b.min_value;
+               row.max_value = b.max_value;
+               counter_table->Insert(row);
+             });
+
+  auto* slice_table = storage_->mutable_slice_summary_table();
+  EmitLevels(BuildLevels(std::move(slice_events), min_level), min_level,
+             [slice_table](uint32_t level, int64_t ts, const Bucket& b) {
+               tables::SliceSummaryTable::Row row;
+               row.level = level;
+               row.track_id = b.key;
+               row.ts = ts;
+               row.count = b.count;
+               row.busy_dur = b.busy_dur;
+               row.max_depth = b.max_depth;
+               slice_table->Insert(row);
+             });
+}
+
+}  // namespace trace_processor
+}  // namespace perfetto
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_SUMMARY_TABLES_BUILDER_H_
+#define SRC_TRACE_PROCESSOR_SUMMARY_TABLES_BUILDER_H_
+
+#include <stdint.h>
+
+namespace perfetto {
+namespace trace_processor {
+
+class TraceStorage;
+
+// Builds the multi-resolution summaries of the sched, counter and slice
+// tables (see tables/summary_tables.h) which allow the UI to render zoomed
+// out tracks with a cost proportional to the number of pixels rather than the
+// number of events.
+//
+// The summaries are built like mipmaps: the events are first aggregated in the
+// finest buckets and each coarser level is then computed from the previous
+// one by merging pairs of buckets. The finest level is chosen so that the
+// trace is covered by at most |kMaxBucketCount| buckets: below that, the UI
+// is expected to query the events directly.
+class SummaryTablesBuilder {
+ public:
+  static constexpr int64_t kMaxBucketCount = 1 << 14;
+
+  explicit SummaryTablesBuilder(TraceStorage* storage);
+
+  // Builds the summary tables from the contents of the storage. Should be
+  // called once, after all the events of the trace have been parsed.
+  void Build();
+
+  // Returns the finest level to use for a trace starting at |start_ns| and
+  // ending at |end_ns|.
+  static uint32_t GetMinLevel(int64_t start_ns, int64_t end_ns);
+
+ private:
+  TraceStorage* const storage_;
+};
+
+}  // namespace trace_processor
+}  // namespace perfetto
+
+#endif  // SRC_TRACE_PROCESSOR_SUMMARY_TABLES_BUILDER_H_
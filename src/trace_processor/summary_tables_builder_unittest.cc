@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/trace_processor/summary_tables_builder.h"
+
+#include <tuple>
+#include <vector>
+
+#include "src/trace_processor/trace_storage.h"
+#include "test/gtest_and_gmock.h"
+
+namespace perfetto {
+namespace trace_processor {
+namespace {
+
+using ::testing::ElementsAre;
+
+struct BucketInfo {
+  uint32_t key;
+  int64_t ts;
+  uint32_t count;
+  int64_t busy_dur;
+
+  bool operator==(const BucketInfo& other) const {
+    return std::tie(key, ts, count, busy_dur) ==
+           std::tie(other.key, other.ts, other.count, other.busy_dur);
+  }
+};
+
+std::ostream& operator<<(std::ostream& os, const BucketInfo& b) {
+  return os << "{" << b.key << ", " << b.ts << ", " << b.count << ", "
+            << b.busy_dur << "}";
+}
+
+std::vector<BucketInfo> CpuBuckets(const TraceStorage& storage,
+                                   uint32_t level) {
+  const auto& table = storage.cpu_summary_table();
+  std::vector<BucketInfo> buckets;
+  for (uint32_t i = 0; i < table.row_count(); ++i) {
+    if (table.level()[i] == level) {
+      buckets.emplace_back(BucketInfo{table.cpu()[i], table.ts()[i],
+                                      table.count()[i], table.busy_dur()[i]});
+    }
+  }
+  return buckets;
+}
+
+std::vector<BucketInfo> SliceBuckets(const TraceStorage& storage,
+                                     uint32_t level) {
+  const auto& table = storage.slice_summary_table();
+  std::vector<BucketInfo> buckets;
+  for (uint32_t i = 0; i < table.row_count(); ++i) {
+    if (table.level()[i] == level) {
+      buckets.emplace_back(BucketInfo{table.track_id()[i], table.ts()[i],
+                                      table.count()[i], table.busy_dur()[i]});
+    }
+  }
+  return buckets;
+}
+
+TEST(SummaryTablesBuilderTest, MinLevel) {
+  constexpr int64_t kMaxCount = SummaryTablesBuilder::kMaxBucketCount;
+  ASSERT_EQ(SummaryTablesBuilder::GetMinLevel(0, 100), 0u);
+  ASSERT_EQ(SummaryTablesBuilder::GetMinLevel(0, kMaxCount - 1), 0u);
+  ASSERT_EQ(SummaryTablesBuilder::GetMinLevel(0, kMaxCount), 1u);
+  ASSERT_EQ(SummaryTablesBuilder::GetMinLevel(1000, 1000 + 8 * kMaxCount), 4u);
+
+  // A one hour trace.
+  int64_t start = 1000000000;
+  int64_t end = start + 3600ll * 1000 * 1000 * 1000;
+  uint32_t level = SummaryTablesBuilder::GetMinLevel(start, end);
+  ASSERT_LT((end >> level) - (start >> level), kMaxCount);
+  ASSERT_GE((end >> (level - 1)) - (start >> (level - 1)), kMaxCount);
+}
+
+TEST(SummaryTablesBuilderTest, CpuSummary) {
+  TraceStorage storage;
+  auto* slices = storage.mutable_slices();
+  slices->AddSlice(0, 0, 10, 1, ftrace_utils::TaskState(), 0);
+  slices->AddSlice(1, 5, 20, 3, ftrace_utils::TaskState(), 0);
+  // The idle thread does not count as busy.
+  slices->AddSlice(0, 10, 20, 0, ftrace_utils::TaskState(), 0);
+  slices->AddSlice(0, 30, 10, 2, ftrace_utils::TaskState(), 0);
+
+  SummaryTablesBuilder(&storage).Build();
+
+  ASSERT_EQ(CpuBuckets(storage, 0).size(), 40u);
+  ASSERT_THAT(CpuBuckets(storage, 3),
+              ElementsAre(BucketInfo{0, 0, 1, 8}, BucketInfo{0, 8, 0, 2},
+                          BucketInfo{0, 24, 1, 2}, BucketInfo{0, 32, 0, 8},
+                          BucketInfo{1, 0, 1, 3}, BucketInfo{1, 8, 0, 8},
+                          BucketInfo{1, 16, 0, 8}, BucketInfo{1, 24, 0, 1}));
+  ASSERT_THAT(CpuBuckets(storage, 5),
+              ElementsAre(BucketInfo{0, 0, 2, 12}, BucketInfo{0, 32, 0, 8},
+                          BucketInfo{1, 0, 1, 20}));
+
+  // The last level is the first one where each cpu has a single bucket.
+  ASSERT_THAT(CpuBuckets(storage, 6),
+              ElementsAre(BucketInfo{0, 0, 2, 20}, BucketInfo{1, 0, 1, 20}));
+  ASSERT_THAT(CpuBuckets(storage, 7), ::testing::IsEmpty());
+}
+
+TEST(SummaryTablesBuilderTest, CounterSummary) {
+  TraceStorage storage;
+  auto* counters = storage.mutable_counter_table();
+  counters->Insert(tables::CounterTable::Row(1, 0, 5.0));
+  counters->Insert(tables::CounterTable::Row(3, 0, 2.0));
+  counters->Insert(tables::CounterTable::Row(3, 1, 100.0));
+  counters->Insert(tables::CounterTable::Row(9, 0, 7.0));
+
+  SummaryTablesBuilder(&storage).Build();
+
+  const auto& table = storage.counter_summary_table();
+  std::vector<std::tuple<uint32_t, uint32_t, int64_t, uint32_t, double, double>>
+      rows;
+  for (uint32_t i = 0; i < table.row_count(); ++i) {
+    if (table.level()[i] < 2)
+      continue;
+    rows.emplace_back(table.level()[i], table.track_id()[i], table.ts()[i],
+                      table.count()[i], table.min_value()[i],
+                      table.max_value()[i]);
+  }
+  ASSERT_THAT(rows, ElementsAre(std::make_tuple(2u, 0u, 0, 2u, 2.0, 5.0),
+                                std::make_tuple(2u, 0u, 8, 1u, 7.0, 7.0),
+                                std::make_tuple(2u, 1u, 0, 1u, 100.0, 100.0),
+                                std::make_tuple(3u, 0u, 0, 2u, 2.0, 5.0),
+                                std::make_tuple(3u, 0u, 8, 1u, 7.0, 7.0),
+                                std::make_tuple(3u, 1u, 0, 1u, 100.0, 100.0),
+                                std::make_tuple(4u, 0u, 0, 3u, 2.0, 7.0),
+                                std::make_tuple(4u, 1u, 0, 1u, 100.0, 100.0)));
+}
+
+TEST(SummaryTablesBuilderTest, SliceSummary) {
+  TraceStorage storage;
+  auto* slices = storage.mutable_slice_table();
+  tables::SliceTable::Row row;
+  row.track_id = 0;
+
+  row.ts = 0;
+  row.dur = 20;
+  row.depth = 0;
+  slices->Insert(row);
+
+  row.ts = 5;
+  row.dur = 10;
+  row.depth = 1;
+  slices->Insert(row);
+
+  // Incomplete slices last until the end of the trace.
+  row.ts = 24;
+  row.dur = -1;
+  row.depth = 0;
+  slices->Insert(row);
+
+  row.ts = 30;
+  row.dur = 1;
+  row.track_id = 1;
+  slices->Insert(row);
+
+  SummaryTablesBuilder(&storage).Build();
+
+  ASSERT_THAT(SliceBuckets(storage, 4),
+              ElementsAre(BucketInfo{0, 0, 2, 16}, BucketInfo{0, 16, 1, 10},
+                          BucketInfo{1, 16, 1, 1}));
+  ASSERT_THAT(SliceBuckets(storage, 5),
+              ElementsAre(BucketInfo{0, 0, 3, 26}, BucketInfo{1, 0, 1, 1}));
+
+  const auto& table = storage.slice_summary_table();
+  for (uint32_t i = 0; i < table.row_count(); ++i) {
+    if (table.level()[i] == 4 && table.track_id()[i] == 0) {
+      ASSERT_EQ(table.max_depth()[i], table.ts()[i] == 0 ? 1u : 0u);
+    }
+  }
+}
+
+TEST(SummaryTablesBuilderTest, LongSlice) {
+  TraceStorage storage;
+  auto* slices = storage.mutable_slice_table();
+  tables::SliceTable::Row row;
+  row.depth = 0;
+
+  // An incomplete slice covering the whole trace.
+  row.track_id = 0;
+  row.ts = 0;
+  row.dur = -1;
+  slices->Insert(row);
+
+  row.track_id = 1;
+  row.ts = 1 << 20;
+  row.dur = 1;
+  slices->Insert(row);
+
+  SummaryTablesBuilder(&storage).Build();
+
+  // The finest level is 7 (8192 buckets up to 2^20): the first track has a
+  // bucket for each of them, merged down to a single bucket at level 20. The
+  // second track has a single bucket at each of these 14 levels.
+  const auto& table = storage.slice_summary_table();
+  ASSERT_EQ(table.row_count(), 16383u + 14u);
+  ASSERT_EQ(SliceBuckets(storage, 7).size(), 8192u + 1u);
+  ASSERT_THAT(SliceBuckets(storage, 20),
+              ElementsAre(BucketInfo{0, 0, 1, 1 << 20},
+                          BucketInfo{1, 1 << 20, 1, 1}));
+  ASSERT_THAT(SliceBuckets(storage, 21), ElementsAre());
+}
+
+}  // namespace
+}  // namespace trace_processor
+}  // namespace perfetto
@@ -27,7 +27,7 @@ namespace tables {
   NAME(CounterTable, "counter")                        \
   PERFETTO_TP_ROOT_TABLE(PARENT, C)                    \
   C(int64_t, ts, Column::Flag::kSorted)                \
-  C(uint32_t, track_id)                                \
+  C(uint32_t, track_id, Column::Flag::kIndexed)        \
   C(double, value)                                     \
   C(base::Optional<uint32_t>, arg_set_id)
 
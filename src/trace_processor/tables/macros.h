@@ -46,6 +46,11 @@ namespace trace_processor {
 //   C(uint32_t, arg_set_id)
 // PERFETTO_TP_TABLE(PERFETTO_TP_EVENT_TABLE_DEF);
 //
+// The optional third argument of C gives the flags of the column (see
+// Column::Flag): for example, Column::kSorted marks columns whose data is
+// always appended in sorted order and Column::kIndexed asks for an index to be
+// kept to speed up equality filters on the column.
+//
 // Note the call to PERFETTO_TP_ROOT_TABLE; this macro (defined below) should
 // be called by root tables passing the PARENT and C and allows for correct type
 // checking of root tables.
@@ -318,6 +318,88 @@ static void BM_TableFilterChildNullableEqMatchManyInParent(
 BENCHMARK(BM_TableFilterChildNullableEqMatchManyInParent)
     ->Apply(TableFilterArgs);
 
+static void BM_TableFilterRootNonNullGt(benchmark::State& state) {
+  StringPool pool;
+  RootTestTable root(&pool, nullptr);
+
+  uint32_t size = static_cast<uint32_t>(state.range(0));
+
+  std::minstd_rand0 rnd_engine;
+  for (uint32_t i = 0; i < size; ++i) {
+    RootTestTable::Row row;
+    row.root_non_null = static_cast<uint32_t>(rnd_engine() % 1024);
+    root.Insert(row);
+  }
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(root.Filter({root.root_non_null().gt(512)}));
+  }
+}
+BENCHMARK(BM_TableFilterRootNonNullGt)->Apply(TableFilterArgs);
+
+static void BM_TableFilterRootNonNullGtAndLt(benchmark::State& state) {
+  StringPool pool;
+  RootTestTable root(&pool, nullptr);
+
+  uint32_t size = static_cast<uint32_t>(state.range(0));
+
+  std::minstd_rand0 rnd_engine;
+  for (uint32_t i = 0; i < size; ++i) {
+    RootTestTable::Row row;
+    row.root_non_null = static_cast<uint32_t>(rnd_engine() % 1024);
+    root.Insert(row);
+  }
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(root.Filter(
+        {root.root_non_null().gt(256), root.root_non_null().lt(768)}));
+  }
+}
+BENCHMARK(BM_TableFilterRootNonNullGtAndLt)->Apply(TableFilterArgs);
+
+static void BM_TableFilterRootNonNullEqCompressed(benchmark::State& state) {
+  StringPool pool;
+  RootTestTable root(&pool, nullptr);
+
+  uint32_t size = static_cast<uint32_t>(state.range(0));
+
+  std::minstd_rand0 rnd_engine;
+  for (uint32_t i = 0; i < size; ++i) {
+    RootTestTable::Row row;
+    row.root_non_null = static_cast<uint32_t>(rnd_engine() % 8);
+    root.Insert(row);
+  }
+  root.Compress();
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(root.Filter({root.root_non_null().eq(3)}));
+  }
+}
+BENCHMARK(BM_TableFilterRootNonNullEqCompressed)->Apply(TableFilterArgs);
+
+static void BM_TableFilterRootNonNullGtCompressedRuns(
+    benchmark::State& state) {
+  StringPool pool;
+  RootTestTable root(&pool, nullptr);
+
+  uint32_t size = static_cast<uint32_t>(state.range(0));
+
+  // Values increasing slowly (e.g. depths or ids of long lived tracks) allow
+  // most blocks to be skipped using their min and max.
+  for (uint32_t i = 0; i < size; ++i) {
+    RootTestTable::Row row;
+    row.root_non_null = i / 1024;
+    root.Insert(row);
+  }
+  root.Compress();
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        root.Filter({root.root_non_null().gt(size / 2048)}));
+  }
+}
+BENCHMARK(BM_TableFilterRootNonNullGtCompressedRuns)->Apply(TableFilterArgs);
+
 static void BM_TableFilterParentSortedEq(benchmark::State& state) {
   StringPool pool;
   RootTestTable root(&pool, nullptr);
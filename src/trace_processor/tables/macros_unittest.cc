@@ -50,6 +50,15 @@ PERFETTO_TP_TABLE(PERFETTO_TP_TEST_SLICE_TABLE_DEF);
   C(StringPool::Id, end_state)
 PERFETTO_TP_TABLE(PERFETTO_TP_TEST_CPU_SLICE_TABLE_DEF);
 
+#define PERFETTO_TP_TEST_INDEXED_TABLE_DEF(NAME, PARENT, C)      \
+  NAME(TestIndexedTable, "indexed")                              \
+  PARENT(PERFETTO_TP_ROOT_TABLE_PARENT_DEF, C)                   \
+  C(int64_t, ts)                                                 \
+  C(uint32_t, utid, Column::Flag::kIndexed)                      \
+  C(base::Optional<int64_t>, arg_set_id, Column::Flag::kIndexed) \
+  C(base::Optional<StringPool::Id>, name, Column::Flag::kIndexed)
+PERFETTO_TP_TABLE(PERFETTO_TP_TEST_INDEXED_TABLE_DEF);
+
 class TableMacrosUnittest : public ::testing::Test {
  protected:
   StringPool pool_;
@@ -58,6 +67,7 @@ class TableMacrosUnittest : public ::testing::Test {
   TestCounterTable counter_{&pool_, &event_};
   TestSliceTable slice_{&pool_, &event_};
   TestCpuSliceTable cpu_slice_{&pool_, &slice_};
+  TestIndexedTable indexed_{&pool_, nullptr};
 };
 
 TEST_F(TableMacrosUnittest, Name) {
@@ -419,6 +429,216 @@ TEST_F(TableMacrosUnittest, FilterIdThenOther) {
   ASSERT_STREQ(end_state->Get(0).string_value, "D");
 }
 
+TEST_F(TableMacrosUnittest, FilterManyRows) {
+  static constexpr uint32_t kCount = 1000;
+  for (uint32_t i = 0; i < kCount; ++i) {
+    TestCpuSliceTable::Row row;
+    row.cpu = i % 8;
+    row.priority = static_cast<int64_t>(i);
+    if (i % 3 != 0)
+      row.end_state = pool_.InternString(i % 3 == 1 ? "R" : "D");
+    cpu_slice_.Insert(row);
+  }
+
+  // Start from a range which is not aligned to a multiple of 64 rows.
+  Table out = cpu_slice_.Filter(
+      {cpu_slice_.id().gt(100), cpu_slice_.cpu().eq(3),
+       cpu_slice_.priority().lt(900), cpu_slice_.end_state().ne("R")});
+  const auto* priority = out.GetColumnByName("priority");
+  const auto* end_state = out.GetColumnByName("end_state");
+
+  std::vector<int64_t> expected;
+  for (uint32_t i = 101; i < 900; ++i) {
+    if (i % 8 == 3 && i % 3 == 2)
+      expected.push_back(i);
+  }
+  ASSERT_EQ(out.row_count(), expected.size());
+  for (uint32_t i = 0; i < out.row_count(); ++i) {
+    ASSERT_EQ(priority->Get(i).long_value, expected[i]);
+    ASSERT_STREQ(end_state->Get(i).string_value, "D");
+  }
+
+  out = cpu_slice_.Filter({cpu_slice_.cpu().ge(7)});
+  ASSERT_EQ(out.row_count(), kCount / 8);
+
+  out = cpu_slice_.Filter({cpu_slice_.cpu().eq(1ll << 40)});
+  ASSERT_EQ(out.row_count(), 0u);
+
+  out = cpu_slice_.Filter({cpu_slice_.end_state().eq("S")});
+  ASSERT_EQ(out.row_count(), 0u);
+
+  out = cpu_slice_.Filter({cpu_slice_.end_state().ne("S")});
+  ASSERT_EQ(out.row_count(), 666u);
+}
+
+TEST_F(TableMacrosUnittest, FilterDenseAfterSortedRange) {
+  static constexpr uint32_t kCount = 1000;
+  for (uint32_t i = 0; i < kCount; ++i) {
+    TestEventTable::Row row;
+    row.ts = static_cast<int64_t>(i);
+    row.arg_set_id = static_cast<int64_t>(i % 10);
+    event_.Insert(row);
+  }
+
+  // The constraint on the sorted ts column leaves a range which stops before
+  // the end of the table; the dense filters after it should still produce
+  // RowMaps covering the whole table.
+  Table out = event_.Filter({event_.ts().lt(500), event_.arg_set_id().gt(5),
+                             event_.arg_set_id().ne(7)});
+  std::vector<int64_t> expected;
+  for (uint32_t i = 0; i < 500; ++i) {
+    if (i % 10 > 5 && i % 10 != 7)
+      expected.push_back(i);
+  }
+  const auto* ts = out.GetColumnByName("ts");
+  ASSERT_EQ(out.row_count(), expected.size());
+  for (uint32_t i = 0; i < out.row_count(); ++i)
+    ASSERT_EQ(ts->Get(i).long_value, expected[i]);
+}
+
+TEST_F(TableMacrosUnittest, FilterCompressed) {
+  static constexpr uint32_t kCount = 1000;
+  for (uint32_t i = 0; i < kCount; ++i) {
+    TestCpuSliceTable::Row row;
+    row.ts = static_cast<int64_t>(i) * 1000 + i % 7;
+    row.depth = i < 300 ? 0 : 1;
+    row.cpu = i % 8;
+    row.priority = static_cast<int64_t>(i);
+    row.end_state = pool_.InternString(i < 500 ? "R" : "D");
+    cpu_slice_.Insert(row);
+  }
+
+  std::vector<std::vector<Constraint>> filters = {
+      {cpu_slice_.id().gt(100), cpu_slice_.cpu().eq(3),
+       cpu_slice_.priority().lt(900)},
+      {cpu_slice_.ts().ge(123456), cpu_slice_.depth().ne(1)},
+      {cpu_slice_.depth().le(0), cpu_slice_.cpu().gt(5)},
+      {cpu_slice_.priority().ge(700), cpu_slice_.end_state().eq("D")},
+      {cpu_slice_.end_state().ne("R"), cpu_slice_.cpu().lt(2)},
+      {cpu_slice_.end_state().eq("S")},
+      {cpu_slice_.end_state().ne("S")},
+  };
+  std::vector<RowMap> expected;
+  for (const auto& cs : filters)
+    expected.emplace_back(cpu_slice_.FilterToRowMap(cs));
+
+  cpu_slice_.Compress();
+  for (size_t i = 0; i < filters.size(); ++i) {
+    RowMap rm = cpu_slice_.FilterToRowMap(filters[i]);
+    ASSERT_EQ(rm.size(), expected[i].size()) << "filter " << i;
+    for (uint32_t j = 0; j < rm.size(); ++j)
+      ASSERT_EQ(rm.Get(j), expected[i].Get(j)) << "filter " << i;
+  }
+  ASSERT_EQ(cpu_slice_.priority()[999], 999);
+  ASSERT_EQ(cpu_slice_.end_state().GetString(0), "R");
+
+  // Inserting after compressing should still work.
+  TestCpuSliceTable::Row row;
+  row.cpu = 3;
+  cpu_slice_.Insert(row);
+  ASSERT_EQ(cpu_slice_.Filter({cpu_slice_.cpu().eq(3)}).row_count(),
+            kCount / 8 + 1);
+}
+
+TEST_F(TableMacrosUnittest, FilterIndexed) {
+  static constexpr uint32_t kCount = 1000;
+  for (uint32_t i = 0; i < kCount; ++i) {
+    TestIndexedTable::Row row;
+    row.ts = static_cast<int64_t>(i);
+    row.utid = i % 10;
+    if (i % 2 == 0)
+      row.arg_set_id = static_cast<int64_t>(i % 7);
+    if (i % 3 != 0)
+      row.name = pool_.InternString(i % 3 == 1 ? "foo" : "bar");
+    indexed_.Insert(row);
+  }
+  ASSERT_TRUE(indexed_.utid().IsIndexed());
+  ASSERT_FALSE(indexed_.ts().IsIndexed());
+
+  Table out = indexed_.Filter({indexed_.utid().eq(3)});
+  const auto* ts = out.GetColumnByName("ts");
+  ASSERT_EQ(out.row_count(), kCount / 10);
+  for (uint32_t i = 0; i < out.row_count(); ++i)
+    ASSERT_EQ(ts->Get(i).long_value, static_cast<int64_t>(i * 10 + 3));
+
+  // Check that an indexed constraint after another constraint only keeps the
+  // rows matching both.
+  out = indexed_.Filter({indexed_.ts().lt(500), indexed_.arg_set_id().eq(4),
+                         indexed_.name().eq("bar")});
+  ts = out.GetColumnByName("ts");
+  std::vector<int64_t> expected;
+  for (uint32_t i = 0; i < 500; ++i) {
+    if (i % 2 == 0 && i % 7 == 4 && i % 3 == 2)
+      expected.push_back(i);
+  }
+  ASSERT_EQ(out.row_count(), expected.size());
+  for (uint32_t i = 0; i < out.row_count(); ++i)
+    ASSERT_EQ(ts->Get(i).long_value, expected[i]);
+
+  // Same but with the indexed constraint on a range of rows.
+  out = indexed_.Filter({indexed_.id().ge(15), indexed_.id().lt(45),
+                         indexed_.utid().eq(5)});
+  ASSERT_EQ(out.row_count(), 3u);
+
+  out = indexed_.Filter({indexed_.utid().eq(100)});
+  ASSERT_EQ(out.row_count(), 0u);
+
+  out = indexed_.Filter({indexed_.name().eq("baz")});
+  ASSERT_EQ(out.row_count(), 0u);
+
+  out = indexed_.Filter({indexed_.arg_set_id().eq(1ll << 40)});
+  ASSERT_EQ(out.row_count(), 0u);
+}
+
+TEST_F(TableMacrosUnittest, FilterIndexedPrefixTable) {
+  // Enough rows for the index to contain rows far past the end of the
+  // BitVectors sized for |prefix|.
+  static constexpr uint32_t kCount = 10000;
+  for (uint32_t i = 0; i < kCount; ++i) {
+    TestIndexedTable::Row row;
+    row.ts = static_cast<int64_t>(i);
+    row.utid = i % 2;
+    indexed_.Insert(row);
+  }
+
+  // |prefix| shares the storage (and so the index) of |indexed_| but only
+  // contains its first 5 rows.
+  Table prefix = indexed_.Filter({indexed_.id().lt(5)});
+  ASSERT_EQ(prefix.row_count(), 5u);
+
+  // The constraint on ts leaves a non-range RowMap so the rows matching the
+  // index need to be intersected with it.
+  const Column* ts = prefix.GetColumnByName("ts");
+  const Column* utid = prefix.GetColumnByName("utid");
+  Table out = prefix.Filter(
+      {ts->ne_value(SqlValue::Long(2)), utid->eq_value(SqlValue::Long(1))});
+  ASSERT_EQ(out.row_count(), 2u);
+  ASSERT_EQ(out.GetColumnByName("ts")->Get(0).long_value, 1);
+  ASSERT_EQ(out.GetColumnByName("ts")->Get(1).long_value, 3);
+}
+
+TEST_F(TableMacrosUnittest, FilterIndexedAfterModification) {
+  for (uint32_t i = 0; i < 10; ++i) {
+    TestIndexedTable::Row row;
+    row.utid = i % 2;
+    indexed_.Insert(row);
+  }
+  ASSERT_EQ(indexed_.Filter({indexed_.utid().eq(1)}).row_count(), 5u);
+  ASSERT_EQ(indexed_.Filter({indexed_.arg_set_id().eq(1)}).row_count(), 0u);
+
+  // Both appending rows and changing values should be reflected by the index.
+  TestIndexedTable::Row row;
+  row.utid = 1;
+  indexed_.Insert(row);
+  indexed_.mutable_utid()->Set(0, 1);
+  indexed_.mutable_arg_set_id()->Set(3, 1);
+
+  Table out = indexed_.Filter({indexed_.utid().eq(1)});
+  ASSERT_EQ(out.row_count(), 7u);
+  ASSERT_EQ(out.GetColumnByName("id")->Get(0).long_value, 0);
+  ASSERT_EQ(indexed_.Filter({indexed_.arg_set_id().eq(1)}).row_count(), 1u);
+}
+
 TEST_F(TableMacrosUnittest, Sort) {
   ASSERT_TRUE(event_.ts().IsSorted());
 
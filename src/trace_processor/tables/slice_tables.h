@@ -28,13 +28,13 @@ namespace tables {
   PERFETTO_TP_ROOT_TABLE(PARENT, C)                  \
   C(int64_t, ts, Column::Flag::kSorted)              \
   C(int64_t, dur)                                    \
-  C(uint32_t, track_id)                              \
+  C(uint32_t, track_id, Column::Flag::kIndexed)      \
   C(StringPool::Id, category)                        \
   C(StringPool::Id, name)                            \
   C(uint32_t, depth)                                 \
   C(int64_t, stack_id)                               \
   C(int64_t, parent_stack_id)                        \
-  C(uint32_t, arg_set_id)
+  C(uint32_t, arg_set_id, Column::Flag::kIndexed)
 
 PERFETTO_TP_TABLE(PERFETTO_TP_SLICE_TABLE_DEF);
 
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACE_PROCESSOR_TABLES_SUMMARY_TABLES_H_
+#define SRC_TRACE_PROCESSOR_TABLES_SUMMARY_TABLES_H_
+
+#include "src/trace_processor/tables/macros.h"
+
+namespace perfetto {
+namespace trace_processor {
+namespace tables {
+
+// The summary tables below contain, for each level, the events of the trace
+// aggregated in buckets of 2^level ns: a row covers [ts, ts + 2^level).
+// Only non-empty buckets are present. Rows are sorted by level and then by
+// cpu/track and ts. See SummaryTablesBuilder for details.
+
+// Summary of the sched slices of each cpu (excluding the idle thread).
+// |count| is the number of slices starting in the bucket and |busy_dur| the
+// time spent running a thread during the bucket.
+#define PERFETTO_TP_CPU_SUMMARY_TABLE_DEF(NAME, PARENT, C) \
+  NAME(CpuSummaryTable, "cpu_summary")                     \
+  PERFETTO_TP_ROOT_TABLE(PARENT, C)                        \
+  C(uint32_t, level, Column::Flag::kSorted)                \
+  C(uint32_t, cpu)                                         \
+  C(int64_t, ts)                                           \
+  C(uint32_t, count)                                       \
+  C(int64_t, busy_dur)
+
+PERFETTO_TP_TABLE(PERFETTO_TP_CPU_SUMMARY_TABLE_DEF);
+
+// Summary of the values of each counter track. |count| is the number of
+// values in the bucket and |min_value|/|max_value| their bounds.
+#define PERFETTO_TP_COUNTER_SUMMARY_TABLE_DEF(NAME, PARENT, C) \
+  NAME(CounterSummaryTable, "counter_summary")                 \
+  PERFETTO_TP_ROOT_TABLE(PARENT, C)                            \
+  C(uint32_t, level, Column::Flag::kSorted)                    \
+  C(uint32_t, track_id)                                        \
+  C(int64_t, ts)                                               \
+  C(uint32_t, count)                                           \
+  C(double, min_value)                                         \
+  C(double, max_value)
+
+PERFETTO_TP_TABLE(PERFETTO_TP_COUNTER_SUMMARY_TABLE_DEF);
+
+// Summary of the slices of each track. |count| is the number of slices
+// starting in the bucket, |busy_dur| the time covered by a slice during the
+// bucket and |max_depth| the maximum depth of the slices overlapping it.
+#define PERFETTO_TP_SLICE_SUMMARY_TABLE_DEF(NAME, PARENT, C) \
+  NAME(SliceSummaryTable, "slice_summary")                   \
+  PERFETTO_TP_ROOT_TABLE(PARENT, C)                          \
+  C(uint32_t, level, Column::Flag::kSorted)                  \
+  C(uint32_t, track_id)                                      \
+  C(int64_t, ts)                                             \
+  C(uint32_t, count)                                         \
+  C(int64_t, busy_dur)                                       \
+  C(uint32_t, max_depth)
+
+PERFETTO_TP_TABLE(PERFETTO_TP_SLICE_SUMMARY_TABLE_DEF);
+
+}  // namespace tables
+}  // namespace trace_processor
+}  // namespace perfetto
+
+#endif  // SRC_TRACE_PROCESSOR_TABLES_SUMMARY_TABLES_H_
@@ -41,7 +41,7 @@ PERFETTO_TP_TABLE(PERFETTO_TP_PROCESS_TRACK_TABLE_DEF);
 #define PERFETTO_TP_THREAD_TRACK_TABLE_DEF(NAME, PARENT, C) \
   NAME(ThreadTrackTable, "thread_track")                    \
   PARENT(PERFETTO_TP_TRACK_TABLE_DEF, C)                    \
-  C(uint32_t, utid)
+  C(uint32_t, utid, Column::Flag::kIndexed)
 
 PERFETTO_TP_TABLE(PERFETTO_TP_THREAD_TRACK_TABLE_DEF);
 
@@ -0,0 +1,111 @@
+// Copyright (C) 2020 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/protozero/scattered_heap_buffer.h"
+#include "perfetto/trace_processor/trace_processor.h"
+
+#include "protos/perfetto/trace/ftrace/ftrace_event.pbzero.h"
+#include "protos/perfetto/trace/ftrace/ftrace_event_bundle.pbzero.h"
+#include "protos/perfetto/trace/ftrace/sched.pbzero.h"
+#include "protos/perfetto/trace/trace.pbzero.h"
+#include "protos/perfetto/trace/trace_packet.pbzero.h"
+
+namespace {
+
+using perfetto::trace_processor::Config;
+using perfetto::trace_processor::TraceProcessor;
+
+constexpr uint32_t kNumCpus = 8;
+constexpr uint32_t kEventsPerBundle = 64;
+
+// Roughly 32MB of ftrace sched_switch bundles.
+constexpr uint32_t kNumBundles = 8 * 1024;
+
+// 1MB chunk size, the same used by ReadTrace().
+constexpr size_t kChunkSize = 1024 * 1024;
+
+// Creates a synthetic trace made of ftrace bundles, round-robin across CPUs.
+// Timestamps within a CPU are slightly jittered, so that the queues of the
+// sorter lose ordering and need to be sorted, as happens with real traces.
+const std::vector<uint8_t>& GetSyntheticTrace() {
+  static std::vector<uint8_t>* trace_bytes = [] {
+    static constexpr uint32_t kRandomSeed = 42;
+    std::minstd_rand0 rnd_engine(kRandomSeed);
+
+    protozero::HeapBuffered<perfetto::protos::pbzero::Trace> trace;
+    uint64_t ts[kNumCpus]{};
+    for (uint32_t i = 0; i < kNumBundles; i++) {
+      uint32_t cpu = i % kNumCpus;
+      auto* bundle = trace->add_packet()->set_ftrace_events();
+      bundle->set_cpu(cpu);
+      for (uint32_t j = 0; j < kEventsPerBundle; j++) {
+        ts[cpu] += 1000;
+        auto* event = bundle->add_event();
+        event->set_timestamp(ts[cpu] + rnd_engine() % 5000);
+        event->set_pid(static_cast<uint32_t>(rnd_engine() % 1024));
+        auto* sched_switch = event->set_sched_switch();
+        sched_switch->set_prev_comm("thread_name_1");
+        sched_switch->set_prev_pid(static_cast<int32_t>(rnd_engine() % 1024));
+        sched_switch->set_prev_prio(120);
+        sched_switch->set_prev_state(1);
+        sched_switch->set_next_comm("thread_name_2");
+        sched_switch->set_next_pid(static_cast<int32_t>(rnd_engine() % 1024));
+        sched_switch->set_next_prio(120);
+      }
+    }
+    return new std::vector<uint8_t>(trace.SerializeAsArray());
+  }();
+  return *trace_bytes;
+}
+
+void BM_TraceProcessorIngestSchedTrace(benchmark::State& state) {
+  const std::vector<uint8_t>& trace = GetSyntheticTrace();
+
+  Config config;
+  config.sorting_threads = static_cast<uint32_t>(state.range(0));
+  for (auto _ : state) {
+    std::unique_ptr<TraceProcessor> tp = TraceProcessor::CreateInstance(config);
+    for (size_t off = 0; off < trace.size(); off += kChunkSize) {
+      size_t size = std::min(kChunkSize, trace.size() - off);
+      std::unique_ptr<uint8_t[]> buf(new uint8_t[size]);
+      memcpy(buf.get(), &trace[off], size);
+      PERFETTO_CHECK(tp->Parse(std::move(buf), size).ok());
+    }
+    tp->NotifyEndOfFile();
+
+    state.PauseTiming();
+    tp.reset();
+    state.ResumeTiming();
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          static_cast<int64_t>(trace.size()));
+}
+
+}  // namespace
+
+BENCHMARK(BM_TraceProcessorIngestSchedTrace)
+    ->Unit(benchmark::kMillisecond)
+    ->Arg(1)
+    ->Arg(2)
+    ->Arg(4)
+    ->Arg(8);
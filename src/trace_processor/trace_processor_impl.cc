@@ -32,9 +32,13 @@
 #include "src/trace_processor/span_join_operator_table.h"
 #include "src/trace_processor/sql_stats_table.h"
 #include "src/trace_processor/sqlite/db_sqlite_table.h"
+#include "src/trace_processor/sqlite/query_cache.h"
 #include "src/trace_processor/sqlite/sqlite3_str_split.h"
 #include "src/trace_processor/sqlite/sqlite_table.h"
+#include "src/trace_processor/stats.h"
 #include "src/trace_processor/stats_table.h"
+#include "src/trace_processor/summary_tables_builder.h"
+#include "src/trace_processor/trace_storage.h"
 #include "src/trace_processor/thread_table.h"
 #include "src/trace_processor/window_operator_table.h"
 
@@ -348,10 +352,32 @@ void SetupMetrics(TraceProcessor* tp,
       PERFETTO_ELOG("Error initializing RepeatedField");
   }
 }
+
+void UpdateQueryCacheStats(const QueryCache& cache, TraceStorage* storage) {
+  const QueryCache::Stats& cache_stats = cache.stats();
+  storage->SetStats(stats::query_cache_hits,
+                    static_cast<int64_t>(cache_stats.hits));
+  storage->SetStats(stats::query_cache_partial_hits,
+                    static_cast<int64_t>(cache_stats.partial_hits));
+  storage->SetStats(stats::query_cache_misses,
+                    static_cast<int64_t>(cache_stats.misses));
+  storage->SetStats(stats::query_cache_evictions,
+                    static_cast<int64_t>(cache_stats.evictions));
+  storage->SetStats(stats::query_cache_size_bytes,
+                    static_cast<int64_t>(cache.size_bytes()));
+}
 }  // namespace
 
+template <typename T>
+void TraceProcessorImpl::RegisterDbTable(const T& table) {
+  DbSqliteTable::RegisterTable(*db_, &query_cache_, &table,
+                               table.table_name());
+  native_tables_[table.table_name()] = &table;
+}
+
 TraceProcessorImpl::TraceProcessorImpl(const Config& cfg)
-    : TraceProcessorStorageImpl(cfg) {
+    : TraceProcessorStorageImpl(cfg),
+      query_cache_(cfg.query_cache_size_bytes) {
   RegisterAdditionalModules(&context_);
   sqlite3* db = nullptr;
   PERFETTO_CHECK(sqlite3_initialize() == SQLITE_OK);
@@ -374,7 +400,7 @@ TraceProcessorImpl::TraceProcessorImpl(const Config& cfg)
   SchedSliceTable::RegisterTable(*db_, context_.storage.get());
   SqlStatsTable::RegisterTable(*db_, context_.storage.get());
   ThreadTable::RegisterTable(*db_, context_.storage.get());
-  SpanJoinOperatorTable::RegisterTable(*db_, context_.storage.get());
+  SpanJoinOperatorTable::RegisterTable(*db_, &native_tables_);
   WindowOperatorTable::RegisterTable(*db_, context_.storage.get());
   StatsTable::RegisterTable(*db_, context_.storage.get());
   RawTable::RegisterTable(*db_, context_.storage.get());
@@ -382,76 +408,44 @@ TraceProcessorImpl::TraceProcessorImpl(const Config& cfg)
   // New style db-backed tables.
   const TraceStorage* storage = context_.storage.get();
 
-  DbSqliteTable::RegisterTable(*db_, &storage->slice_table(),
-                               storage->slice_table().table_name());
-  DbSqliteTable::RegisterTable(*db_, &storage->instant_table(),
-                               storage->instant_table().table_name());
-  DbSqliteTable::RegisterTable(*db_, &storage->gpu_slice_table(),
-                               storage->gpu_slice_table().table_name());
-
-  DbSqliteTable::RegisterTable(*db_, &storage->track_table(),
-                               storage->track_table().table_name());
-  DbSqliteTable::RegisterTable(*db_, &storage->thread_track_table(),
-                               storage->thread_track_table().table_name());
-  DbSqliteTable::RegisterTable(*db_, &storage->process_track_table(),
-                               storage->process_track_table().table_name());
-  DbSqliteTable::RegisterTable(*db_, &storage->gpu_track_table(),
-                               storage->gpu_track_table().table_name());
-
-  DbSqliteTable::RegisterTable(*db_, &storage->counter_table(),
-                               storage->counter_table().table_name());
-
-  DbSqliteTable::RegisterTable(*db_, &storage->counter_track_table(),
-                               storage->counter_track_table().table_name());
-  DbSqliteTable::RegisterTable(
-      *db_, &storage->process_counter_track_table(),
-      storage->process_counter_track_table().table_name());
-  DbSqliteTable::RegisterTable(
-      *db_, &storage->thread_counter_track_table(),
-      storage->thread_counter_track_table().table_name());
-  DbSqliteTable::RegisterTable(*db_, &storage->cpu_counter_track_table(),
-                               storage->cpu_counter_track_table().table_name());
-  DbSqliteTable::RegisterTable(*db_, &storage->irq_counter_track_table(),
-                               storage->irq_counter_track_table().table_name());
-  DbSqliteTable::RegisterTable(
-      *db_, &storage->softirq_counter_track_table(),
-      storage->softirq_counter_track_table().table_name());
-  DbSqliteTable::RegisterTable(*db_, &storage->gpu_counter_track_table(),
-                               storage->gpu_counter_track_table().table_name());
-
-  DbSqliteTable::RegisterTable(*db_, &storage->heap_graph_object_table(),
-                               storage->heap_graph_object_table().table_name());
-  DbSqliteTable::RegisterTable(
-      *db_, &storage->heap_graph_reference_table(),
-      storage->heap_graph_reference_table().table_name());
-
-  DbSqliteTable::RegisterTable(*db_, &storage->symbol_table(),
-                               storage->symbol_table().table_name());
-  DbSqliteTable::RegisterTable(
-      *db_, &storage->heap_profile_allocation_table(),
-      storage->heap_profile_allocation_table().table_name());
-  DbSqliteTable::RegisterTable(
-      *db_, &storage->cpu_profile_stack_sample_table(),
-      storage->cpu_profile_stack_sample_table().table_name());
-  DbSqliteTable::RegisterTable(
-      *db_, &storage->stack_profile_callsite_table(),
-      storage->stack_profile_callsite_table().table_name());
-  DbSqliteTable::RegisterTable(
-      *db_, &storage->stack_profile_mapping_table(),
-      storage->stack_profile_mapping_table().table_name());
-  DbSqliteTable::RegisterTable(
-      *db_, &storage->stack_profile_frame_table(),
-      storage->stack_profile_frame_table().table_name());
-
-  DbSqliteTable::RegisterTable(*db_, &storage->android_log_table(),
-                               storage->android_log_table().table_name());
-
-  DbSqliteTable::RegisterTable(
-      *db_, &storage->vulkan_memory_allocations_table(),
-      storage->vulkan_memory_allocations_table().table_name());
-
-  DbSqliteTable::RegisterTable(*db_, &storage->metadata_table(),
-                               storage->metadata_table().table_name());
+  RegisterDbTable(storage->slice_table());
+  RegisterDbTable(storage->instant_table());
+  RegisterDbTable(storage->gpu_slice_table());
+
+  RegisterDbTable(storage->track_table());
+  RegisterDbTable(storage->thread_track_table());
+  RegisterDbTable(storage->process_track_table());
+  RegisterDbTable(storage->gpu_track_table());
+
+  RegisterDbTable(storage->counter_table());
+
+  RegisterDbTable(storage->counter_track_table());
+  RegisterDbTable(storage->process_counter_track_table());
+  RegisterDbTable(storage->thread_counter_track_table());
+  RegisterDbTable(storage->cpu_counter_track_table());
+  RegisterDbTable(storage->irq_counter_track_table());
+  RegisterDbTable(storage->softirq_counter_track_table());
+  RegisterDbTable(storage->gpu_counter_track_table());
+
+  RegisterDbTable(storage->heap_graph_object_table());
+  RegisterDbTable(storage->heap_graph_reference_table());
+
+  RegisterDbTable(storage->symbol_table());
+  RegisterDbTable(storage->heap_profile_allocation_table());
+  RegisterDbTable(storage->cpu_profile_stack_sample_table());
+  RegisterDbTable(storage->stack_profile_callsite_table());
+  RegisterDbTable(storage->stack_profile_mapping_table());
+  RegisterDbTable(storage->stack_profile_frame_table());
+
+  RegisterDbTable(storage->android_log_table());
+
+  RegisterDbTable(storage->vulkan_memory_allocations_table());
+
+  RegisterDbTable(storage->metadata_table());
+
+  RegisterDbTable(storage->cpu_summary_table());
+  RegisterDbTable(storage->counter_summary_table());
+  RegisterDbTable(storage->slice_summary_table());
 }
 
 TraceProcessorImpl::~TraceProcessorImpl() {
@@ -465,6 +459,15 @@ util::Status TraceProcessorImpl::Parse(std::unique_ptr<uint8_t[]> data,
   return TraceProcessorStorageImpl::Parse(std::move(data), size);
 }
 
+util::Status TraceProcessorImpl::ParseExternalBuffer(
+    const uint8_t* data,
+    size_t size,
+    std::function<void()> release) {
+  bytes_parsed_ += size;
+  return TraceProcessorStorageImpl::ParseExternalBuffer(data, size,
+                                                        std::move(release));
+}
+
 std::string TraceProcessorImpl::GetCurrentTraceName() {
   if (current_trace_name_.empty())
     return "";
@@ -483,6 +486,8 @@ void TraceProcessorImpl::NotifyEndOfFile() {
   TraceProcessorStorageImpl::NotifyEndOfFile();
 
   SchedEventTracker::GetOrCreate(&context_)->FlushPendingEvents();
+  SummaryTablesBuilder(context_.storage.get()).Build();
+  context_.storage->CompressEventTables();
   BuildBoundsTable(*db_, context_.storage->GetTraceTimestampBoundsNs());
 
   // Create a snapshot of all tables and views created so far. This is so later
@@ -524,6 +529,10 @@ size_t TraceProcessorImpl::RestoreInitialTables() {
 TraceProcessor::Iterator TraceProcessorImpl::ExecuteQuery(
     const std::string& sql,
     int64_t time_queued) {
+  // Make the state of the query cache after the previous queries visible in
+  // the stats table.
+  UpdateQueryCacheStats(query_cache_, context_.storage.get());
+
   sqlite3_stmt* raw_stmt;
   int err = sqlite3_prepare_v2(*db_, sql.c_str(), static_cast<int>(sql.size()),
                                &raw_stmt, nullptr);
@@ -28,6 +28,8 @@
 #include "perfetto/trace_processor/basic_types.h"
 #include "perfetto/trace_processor/status.h"
 #include "perfetto/trace_processor/trace_processor.h"
+#include "src/trace_processor/span_join_operator_table.h"
+#include "src/trace_processor/sqlite/query_cache.h"
 #include "src/trace_processor/sqlite/scoped_db.h"
 #include "src/trace_processor/trace_processor_storage_impl.h"
 
@@ -48,6 +50,9 @@ class TraceProcessorImpl : public TraceProcessor,
 
   // TraceProcessorStorage implementation:
   util::Status Parse(std::unique_ptr<uint8_t[]>, size_t) override;
+  util::Status ParseExternalBuffer(const uint8_t* data,
+                                   size_t size,
+                                   std::function<void()> release) override;
   void NotifyEndOfFile() override;
 
   // TraceProcessor implementation:
@@ -73,6 +78,17 @@ class TraceProcessorImpl : public TraceProcessor,
   // Needed for iterators to be able to delete themselves from the vector.
   friend class IteratorImpl;
 
+  // Registers the db table |table| with SQLite, under its table name.
+  template <typename T>
+  void RegisterDbTable(const T& table);
+
+  // Shared by all the db tables registered with SQLite so needs to outlive
+  // |db_|.
+  QueryCache query_cache_;
+
+  // The db tables registered with SQLite, which SPAN_JOIN reads directly.
+  SpanJoinOperatorTable::NativeTables native_tables_;
+
   ScopedDb db_;
 
   DescriptorPool pool_;
@@ -34,6 +34,7 @@
 #include "perfetto/ext/base/file_utils.h"
 #include "perfetto/ext/base/scoped_file.h"
 #include "perfetto/ext/base/string_splitter.h"
+#include "perfetto/ext/base/string_utils.h"
 #include "perfetto/trace_processor/read_trace.h"
 #include "perfetto/trace_processor/trace_processor.h"
 #include "src/trace_processor/metrics/metrics.descriptor.h"
@@ -650,6 +651,7 @@ struct CommandLineOptions {
   bool enable_httpd = false;
   bool wide = false;
   bool force_full_sort = false;
+  uint32_t sorting_threads = 1;
 };
 
 #if PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
@@ -727,7 +729,10 @@ Options:
                                       $PATH/metrics-ext.proto.
  --full-sort                          Forces the trace processor into performing
                                       a full sort ignoring any windowing
-                                      logic.)",
+                                      logic.
+ --sorting-threads N                  Sorts the per-CPU event queues using up to
+                                      N threads when loading the trace
+                                      (default: 1).)",
                 argv[0]);
 }
 
@@ -738,6 +743,7 @@ CommandLineOptions ParseCommandLineOptions(int argc, char** argv) {
     OPT_METRICS_OUTPUT,
     OPT_EXTRA_METRICS,
     OPT_FORCE_FULL_SORT,
+    OPT_SORTING_THREADS,
   };
 
   static const struct option long_options[] = {
@@ -754,6 +760,7 @@ CommandLineOptions ParseCommandLineOptions(int argc, char** argv) {
       {"metrics-output", required_argument, nullptr, OPT_METRICS_OUTPUT},
       {"extra-metrics", required_argument, nullptr, OPT_EXTRA_METRICS},
       {"full-sort", no_argument, nullptr, OPT_FORCE_FULL_SORT},
+      {"sorting-threads", required_argument, nullptr, OPT_SORTING_THREADS},
       {nullptr, 0, nullptr, 0}};
 
   bool explicit_interactive = false;
@@ -829,6 +836,16 @@ CommandLineOptions ParseCommandLineOptions(int argc, char** argv) {
       continue;
     }
 
+    if (option == OPT_SORTING_THREADS) {
+      auto sorting_threads = base::CStringToUInt32(optarg);
+      if (!sorting_threads || *sorting_threads == 0) {
+        PERFETTO_ELOG("Invalid value for --sorting-threads: %s", optarg);
+        exit(1);
+      }
+      command_line_options.sorting_threads = *sorting_threads;
+      continue;
+    }
+
     PrintUsage(argv);
     exit(option == 'h' ? 0 : 1);
   }
@@ -901,6 +918,7 @@ int TraceProcessorMain(int argc, char** argv) {
   // Load the trace file into the trace processor.
   Config config;
   config.force_full_sort = options.force_full_sort;
+  config.sorting_threads = options.sorting_threads;
 
   std::unique_ptr<TraceProcessor> tp = TraceProcessor::CreateInstance(config);
   g_tp = tp.get();
@@ -64,6 +64,22 @@ util::Status TraceProcessorStorageImpl::Parse(std::unique_ptr<uint8_t[]> data,
                                               size_t size) {
   if (size == 0)
     return util::OkStatus();
+  return ParseBlob(TraceBlobView(std::move(data), 0, size));
+}
+
+util::Status TraceProcessorStorageImpl::ParseExternalBuffer(
+    const uint8_t* data,
+    size_t size,
+    std::function<void()> release) {
+  // The TraceBlobView takes care of invoking |release| in all cases, including
+  // when the data is dropped because of an error.
+  TraceBlobView blob(data, size, std::move(release));
+  if (size == 0)
+    return util::OkStatus();
+  return ParseBlob(std::move(blob));
+}
+
+util::Status TraceProcessorStorageImpl::ParseBlob(TraceBlobView blob) {
   if (unrecoverable_parse_error_)
     return util::ErrStatus(
         "Failed unrecoverably while parsing in a previous Parse call");
@@ -72,7 +88,7 @@ util::Status TraceProcessorStorageImpl::Parse(std::unique_ptr<uint8_t[]> data,
 
   auto scoped_trace = context_.storage->TraceExecutionTimeIntoStats(
       stats::parse_trace_duration_ns);
-  util::Status status = context_.chunk_reader->Parse(std::move(data), size);
+  util::Status status = context_.chunk_reader->Parse(std::move(blob));
   unrecoverable_parse_error_ |= !status.ok();
   return status;
 }
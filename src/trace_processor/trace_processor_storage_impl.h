@@ -22,6 +22,7 @@
 #include "perfetto/trace_processor/basic_types.h"
 #include "perfetto/trace_processor/status.h"
 #include "perfetto/trace_processor/trace_processor_storage.h"
+#include "src/trace_processor/trace_blob_view.h"
 #include "src/trace_processor/trace_processor_context.h"
 
 namespace perfetto {
@@ -33,11 +34,16 @@ class TraceProcessorStorageImpl : public TraceProcessorStorage {
   ~TraceProcessorStorageImpl() override;
 
   util::Status Parse(std::unique_ptr<uint8_t[]>, size_t) override;
+  util::Status ParseExternalBuffer(const uint8_t* data,
+                                   size_t size,
+                                   std::function<void()> release) override;
   void NotifyEndOfFile() override;
 
   TraceProcessorContext* context() { return &context_; }
 
  protected:
+  util::Status ParseBlob(TraceBlobView);
+
   TraceProcessorContext context_;
   bool unrecoverable_parse_error_ = false;
 };
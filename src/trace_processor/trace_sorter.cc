@@ -17,15 +17,22 @@
 #include <algorithm>
 #include <utility>
 
+#include "perfetto/base/build_config.h"
 #include "perfetto/ext/base/utils.h"
 #include "src/trace_processor/importers/proto/proto_trace_parser.h"
 #include "src/trace_processor/trace_sorter.h"
 
+#if !PERFETTO_BUILDFLAG(PERFETTO_OS_WASM)
+#include <atomic>
+#include <thread>
+#endif
+
 namespace perfetto {
 namespace trace_processor {
 
 TraceSorter::TraceSorter(TraceProcessorContext* context, int64_t window_size_ns)
     : context_(context), window_size_ns_(window_size_ns) {
+  num_sorting_threads_ = std::max(context_->config.sorting_threads, 1u);
   const char* env = getenv("TRACE_PROCESSOR_SORT_ONLY");
   bypass_next_stage_for_testing_ = env && !strcmp(env, "1");
   if (bypass_next_stage_for_testing_)
@@ -55,6 +62,45 @@ void TraceSorter::Queue::Sort() {
   PERFETTO_DCHECK(std::is_sorted(events_.begin(), events_.end()));
 }
 
+// Sorting a queue only moves its events around (TraceBlobView moves never touch
+// the non thread-safe refcount of the shared buffer), so different queues can
+// be safely sorted on different threads.
+void TraceSorter::SortAllQueues() {
+  std::vector<Queue*> queues_to_sort;
+  for (auto& queue : queues_) {
+    if (queue.needs_sorting())
+      queues_to_sort.push_back(&queue);
+  }
+
+#if !PERFETTO_BUILDFLAG(PERFETTO_OS_WASM)
+  size_t num_threads = std::min(num_sorting_threads_, queues_to_sort.size());
+  if (num_threads > 1) {
+    // Sort the biggest queues first to get a better balance between threads.
+    std::sort(queues_to_sort.begin(), queues_to_sort.end(),
+              [](const Queue* a, const Queue* b) {
+                return a->events_.size() > b->events_.size();
+              });
+    std::atomic<size_t> next_queue{0};
+    auto sort_queues = [&queues_to_sort, &next_queue] {
+      for (size_t i = next_queue++; i < queues_to_sort.size();
+           i = next_queue++) {
+        queues_to_sort[i]->Sort();
+      }
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < num_threads; i++)
+      workers.emplace_back(sort_queues);
+    sort_queues();
+    for (auto& worker : workers)
+      worker.join();
+    return;
+  }
+#endif  // !PERFETTO_BUILDFLAG(PERFETTO_OS_WASM)
+
+  for (Queue* queue : queues_to_sort)
+    queue->Sort();
+}
+
 // Removes all the events in |queues_| that are earlier than the given window
 // size and moves them to the next parser stages, respecting global timestamp
 // order. This function is a "extract min from N sorted queues", with some
@@ -63,6 +63,10 @@ class PacketSequenceState;
 // We use a logarithmic bound search operation to figure out what is the index
 // within the first partition where sorting should start, and sort all events
 // from there to the end.
+// When the whole sorter is flushed (e.g. at the end of a trace which does not
+// use a sliding window) all the queues which lost ordering are sorted upfront,
+// independently from each other, using up to |Config::sorting_threads|
+// threads. The merge-extraction into the parser is always single threaded.
 class TraceSorter {
  public:
   TraceSorter(TraceProcessorContext*, int64_t window_size_ns);
@@ -152,6 +156,7 @@ class TraceSorter {
 
   // Extract all events ignoring the window.
   void ExtractEventsForced() {
+    SortAllQueues();
     SortAndExtractEventsBeyondWindow(/*window_size_ns=*/0);
     queues_.resize(0);
   }
@@ -219,6 +224,10 @@ class TraceSorter {
   // parser to be parsed and then stored.
   void SortAndExtractEventsBeyondWindow(int64_t windows_size_ns);
 
+  // Sorts all the queues which need sorting, spreading the work across
+  // |num_sorting_threads_| threads.
+  void SortAllQueues();
+
   inline Queue* GetQueue(size_t index) {
     if (PERFETTO_UNLIKELY(index >= queues_.size()))
       queues_.resize(index + 1);
@@ -247,6 +256,9 @@ class TraceSorter {
   // is larger than this value.
   int64_t window_size_ns_;
 
+  // Max number of threads used by SortAllQueues().
+  size_t num_sorting_threads_ = 1;
+
   // max(e.timestamp for e in queues_).
   int64_t global_max_ts_ = 0;
 
@@ -83,6 +83,8 @@ class TraceSorterTest : public ::testing::Test {
   }
 
  protected:
+  void PushRandomEventsAndCheckOrdering();
+
   TraceProcessorContext context_;
   MockTraceParser* parser_;
   NiceMock<MockTraceStorage>* storage_;
@@ -182,9 +184,9 @@ TEST_F(TraceSorterTest, SetWindowSize) {
 }
 
 // Simulates a random stream of ftrace events happening on random CPUs.
-// Tests that the output of the TraceSorter matches the timestamp order
+// Checks that the output of the TraceSorter matches the timestamp order
 // (% events happening at the same time on different CPUs).
-TEST_F(TraceSorterTest, MultiQueueSorting) {
+void TraceSorterTest::PushRandomEventsAndCheckOrdering() {
   std::minstd_rand0 rnd_engine(0);
   std::map<int64_t /*ts*/, std::vector<uint32_t /*cpu*/>> expectations;
 
@@ -221,6 +223,17 @@ TEST_F(TraceSorterTest, MultiQueueSorting) {
   EXPECT_TRUE(expectations.empty());
 }
 
+TEST_F(TraceSorterTest, MultiQueueSorting) {
+  PushRandomEventsAndCheckOrdering();
+}
+
+TEST_F(TraceSorterTest, MultiQueueSortingMultipleThreads) {
+  context_.config.sorting_threads = 4;
+  context_.sorter.reset(new TraceSorter(
+      &context_, std::numeric_limits<int64_t>::max() /*window_size*/));
+  PushRandomEventsAndCheckOrdering();
+}
+
 }  // namespace
 }  // namespace trace_processor
 }  // namespace perfetto
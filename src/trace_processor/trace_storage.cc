@@ -150,5 +150,24 @@ std::pair<int64_t, int64_t> TraceStorage::GetTraceTimestampBoundsNs() const {
   return std::make_pair(start_ns, end_ns);
 }
 
+void TraceStorage::CompressEventTables() {
+  slice_table_.Compress();
+  gpu_slice_table_.Compress();
+  counter_table_.Compress();
+  instant_table_.Compress();
+  android_log_table_.Compress();
+  stack_profile_mapping_table_.Compress();
+  stack_profile_frame_table_.Compress();
+  stack_profile_callsite_table_.Compress();
+  heap_profile_allocation_table_.Compress();
+  cpu_profile_stack_sample_table_.Compress();
+  heap_graph_object_table_.Compress();
+  heap_graph_reference_table_.Compress();
+  vulkan_memory_allocations_table_.Compress();
+  cpu_summary_table_.Compress();
+  counter_summary_table_.Compress();
+  slice_summary_table_.Compress();
+}
+
 }  // namespace trace_processor
 }  // namespace perfetto
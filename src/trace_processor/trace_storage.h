@@ -32,6 +32,7 @@
 #include "perfetto/ext/base/string_view.h"
 #include "perfetto/ext/base/utils.h"
 #include "perfetto/trace_processor/basic_types.h"
+#include "src/trace_processor/containers/chunked_vector.h"
 #include "src/trace_processor/containers/string_pool.h"
 #include "src/trace_processor/ftrace_utils.h"
 #include "src/trace_processor/metadata.h"
@@ -41,6 +42,7 @@
 #include "src/trace_processor/tables/metadata_tables.h"
 #include "src/trace_processor/tables/profiler_tables.h"
 #include "src/trace_processor/tables/slice_tables.h"
+#include "src/trace_processor/tables/summary_tables.h"
 #include "src/trace_processor/tables/track_tables.h"
 #include "src/trace_processor/variadic.h"
 
@@ -181,10 +183,10 @@ class TraceStorage {
       }
     };
 
-    const std::deque<ArgSetId>& set_ids() const { return set_ids_; }
-    const std::deque<StringId>& flat_keys() const { return flat_keys_; }
-    const std::deque<StringId>& keys() const { return keys_; }
-    const std::deque<Variadic>& arg_values() const { return arg_values_; }
+    const ChunkedVector<ArgSetId>& set_ids() const { return set_ids_; }
+    const ChunkedVector<StringId>& flat_keys() const { return flat_keys_; }
+    const ChunkedVector<StringId>& keys() const { return keys_; }
+    const ChunkedVector<Variadic>& arg_values() const { return arg_values_; }
     uint32_t args_count() const {
       return static_cast<uint32_t>(set_ids_.size());
     }
@@ -219,10 +221,10 @@ class TraceStorage {
    private:
     using ArgSetHash = uint64_t;
 
-    std::deque<ArgSetId> set_ids_;
-    std::deque<StringId> flat_keys_;
-    std::deque<StringId> keys_;
-    std::deque<Variadic> arg_values_;
+    ChunkedVector<ArgSetId> set_ids_;
+    ChunkedVector<StringId> flat_keys_;
+    ChunkedVector<StringId> keys_;
+    ChunkedVector<Variadic> arg_values_;
 
     std::unordered_map<ArgSetHash, uint32_t> arg_row_for_hash_;
   };
@@ -258,36 +260,36 @@ class TraceStorage {
 
     size_t slice_count() const { return start_ns_.size(); }
 
-    const std::deque<uint32_t>& cpus() const { return cpus_; }
+    const ChunkedVector<uint32_t>& cpus() const { return cpus_; }
 
-    const std::deque<int64_t>& start_ns() const { return start_ns_; }
+    const ChunkedVector<int64_t>& start_ns() const { return start_ns_; }
 
-    const std::deque<int64_t>& durations() const { return durations_; }
+    const ChunkedVector<int64_t>& durations() const { return durations_; }
 
-    const std::deque<UniqueTid>& utids() const { return utids_; }
+    const ChunkedVector<UniqueTid>& utids() const { return utids_; }
 
-    const std::deque<ftrace_utils::TaskState>& end_state() const {
+    const ChunkedVector<ftrace_utils::TaskState>& end_state() const {
       return end_states_;
     }
 
-    const std::deque<int32_t>& priorities() const { return priorities_; }
+    const ChunkedVector<int32_t>& priorities() const { return priorities_; }
 
-    const std::deque<std::vector<uint32_t>>& rows_for_utids() const {
+    const ChunkedVector<std::vector<uint32_t>>& rows_for_utids() const {
       return rows_for_utids_;
     }
 
    private:
-    // Each deque below has the same number of entries (the number of slices
+    // Each vector below has the same number of entries (the number of slices
     // in the trace for the CPU).
-    std::deque<uint32_t> cpus_;
-    std::deque<int64_t> start_ns_;
-    std::deque<int64_t> durations_;
-    std::deque<UniqueTid> utids_;
-    std::deque<ftrace_utils::TaskState> end_states_;
-    std::deque<int32_t> priorities_;
+    ChunkedVector<uint32_t> cpus_;
+    ChunkedVector<int64_t> start_ns_;
+    ChunkedVector<int64_t> durations_;
+    ChunkedVector<UniqueTid> utids_;
+    ChunkedVector<ftrace_utils::TaskState> end_states_;
+    ChunkedVector<int32_t> priorities_;
 
     // One row per utid.
-    std::deque<std::vector<uint32_t>> rows_for_utids_;
+    ChunkedVector<std::vector<uint32_t>> rows_for_utids_;
   };
 
   class ThreadSlices {
@@ -309,17 +311,17 @@ class TraceStorage {
       return static_cast<uint32_t>(slice_ids_.size());
     }
 
-    const std::deque<uint32_t>& slice_ids() const { return slice_ids_; }
-    const std::deque<int64_t>& thread_timestamp_ns() const {
+    const ChunkedVector<uint32_t>& slice_ids() const { return slice_ids_; }
+    const ChunkedVector<int64_t>& thread_timestamp_ns() const {
       return thread_timestamp_ns_;
     }
-    const std::deque<int64_t>& thread_duration_ns() const {
+    const ChunkedVector<int64_t>& thread_duration_ns() const {
       return thread_duration_ns_;
     }
-    const std::deque<int64_t>& thread_instruction_counts() const {
+    const ChunkedVector<int64_t>& thread_instruction_counts() const {
       return thread_instruction_counts_;
     }
-    const std::deque<int64_t>& thread_instruction_deltas() const {
+    const ChunkedVector<int64_t>& thread_instruction_deltas() const {
       return thread_instruction_deltas_;
     }
 
@@ -344,11 +346,11 @@ class TraceStorage {
     }
 
    private:
-    std::deque<uint32_t> slice_ids_;
-    std::deque<int64_t> thread_timestamp_ns_;
-    std::deque<int64_t> thread_duration_ns_;
-    std::deque<int64_t> thread_instruction_counts_;
-    std::deque<int64_t> thread_instruction_deltas_;
+    ChunkedVector<uint32_t> slice_ids_;
+    ChunkedVector<int64_t> thread_timestamp_ns_;
+    ChunkedVector<int64_t> thread_duration_ns_;
+    ChunkedVector<int64_t> thread_instruction_counts_;
+    ChunkedVector<int64_t> thread_instruction_deltas_;
   };
 
   class VirtualTrackSlices {
@@ -370,17 +372,17 @@ class TraceStorage {
       return static_cast<uint32_t>(slice_ids_.size());
     }
 
-    const std::deque<uint32_t>& slice_ids() const { return slice_ids_; }
-    const std::deque<int64_t>& thread_timestamp_ns() const {
+    const ChunkedVector<uint32_t>& slice_ids() const { return slice_ids_; }
+    const ChunkedVector<int64_t>& thread_timestamp_ns() const {
       return thread_timestamp_ns_;
     }
-    const std::deque<int64_t>& thread_duration_ns() const {
+    const ChunkedVector<int64_t>& thread_duration_ns() const {
       return thread_duration_ns_;
     }
-    const std::deque<int64_t>& thread_instruction_counts() const {
+    const ChunkedVector<int64_t>& thread_instruction_counts() const {
       return thread_instruction_counts_;
     }
-    const std::deque<int64_t>& thread_instruction_deltas() const {
+    const ChunkedVector<int64_t>& thread_instruction_deltas() const {
       return thread_instruction_deltas_;
     }
 
@@ -405,11 +407,11 @@ class TraceStorage {
     }
 
    private:
-    std::deque<uint32_t> slice_ids_;
-    std::deque<int64_t> thread_timestamp_ns_;
-    std::deque<int64_t> thread_duration_ns_;
-    std::deque<int64_t> thread_instruction_counts_;
-    std::deque<int64_t> thread_instruction_deltas_;
+    ChunkedVector<uint32_t> slice_ids_;
+    ChunkedVector<int64_t> thread_timestamp_ns_;
+    ChunkedVector<int64_t> thread_duration_ns_;
+    ChunkedVector<int64_t> thread_instruction_counts_;
+    ChunkedVector<int64_t> thread_instruction_deltas_;
   };
 
   class SqlStats {
@@ -457,22 +459,22 @@ class TraceStorage {
 
     size_t raw_event_count() const { return timestamps_.size(); }
 
-    const std::deque<int64_t>& timestamps() const { return timestamps_; }
+    const ChunkedVector<int64_t>& timestamps() const { return timestamps_; }
 
-    const std::deque<StringId>& name_ids() const { return name_ids_; }
+    const ChunkedVector<StringId>& name_ids() const { return name_ids_; }
 
-    const std::deque<uint32_t>& cpus() const { return cpus_; }
+    const ChunkedVector<uint32_t>& cpus() const { return cpus_; }
 
-    const std::deque<UniqueTid>& utids() const { return utids_; }
+    const ChunkedVector<UniqueTid>& utids() const { return utids_; }
 
-    const std::deque<ArgSetId>& arg_set_ids() const { return arg_set_ids_; }
+    const ChunkedVector<ArgSetId>& arg_set_ids() const { return arg_set_ids_; }
 
    private:
-    std::deque<int64_t> timestamps_;
-    std::deque<StringId> name_ids_;
-    std::deque<uint32_t> cpus_;
-    std::deque<UniqueTid> utids_;
-    std::deque<ArgSetId> arg_set_ids_;
+    ChunkedVector<int64_t> timestamps_;
+    ChunkedVector<StringId> name_ids_;
+    ChunkedVector<uint32_t> cpus_;
+    ChunkedVector<UniqueTid> utids_;
+    ChunkedVector<ArgSetId> arg_set_ids_;
   };
 
   struct Stats {
@@ -782,6 +784,27 @@ class TraceStorage {
     return &vulkan_memory_allocations_table_;
   }
 
+  const tables::CpuSummaryTable& cpu_summary_table() const {
+    return cpu_summary_table_;
+  }
+  tables::CpuSummaryTable* mutable_cpu_summary_table() {
+    return &cpu_summary_table_;
+  }
+
+  const tables::CounterSummaryTable& counter_summary_table() const {
+    return counter_summary_table_;
+  }
+  tables::CounterSummaryTable* mutable_counter_summary_table() {
+    return &counter_summary_table_;
+  }
+
+  const tables::SliceSummaryTable& slice_summary_table() const {
+    return slice_summary_table_;
+  }
+  tables::SliceSummaryTable* mutable_slice_summary_table() {
+    return &slice_summary_table_;
+  }
+
   const StringPool& string_pool() const { return string_pool_; }
 
   // |unique_processes_| always contains at least 1 element because the 0th ID
@@ -799,6 +822,11 @@ class TraceStorage {
   // Returns (0, 0) if the trace is empty.
   std::pair<int64_t, int64_t> GetTraceTimestampBoundsNs() const;
 
+  // Compresses the columns of the tables whose size grows with the number of
+  // events in the trace (see Table::Compress()). Should be called once the
+  // whole trace has been parsed.
+  void CompressEventTables();
+
   // TODO(lalitm): remove this when we have a better home.
   std::vector<int64_t> FindMappingRow(StringId name, StringId build_id) const {
     auto it = stack_profile_mapping_index_.find(std::make_pair(name, build_id));
@@ -889,6 +917,8 @@ class TraceStorage {
   std::vector<Process> unique_processes_;
 
   // One entry for each UniqueTid, with UniqueTid as the index.
+  // This is a std::deque as pointers to threads are held while adding new
+  // threads (e.g. by ProcessTracker) so they must never be invalidated.
   std::deque<Thread> unique_threads_;
 
   // Slices coming from userspace events (e.g. Chromium TRACE_EVENT macros).
@@ -942,6 +972,12 @@ class TraceStorage {
 
   tables::VulkanMemoryAllocationsTable vulkan_memory_allocations_table_{
       &string_pool_, nullptr};
+
+  // Multi-resolution summaries of the sched, counter and slice tables, built
+  // at the end of the trace (see SummaryTablesBuilder).
+  tables::CpuSummaryTable cpu_summary_table_{&string_pool_, nullptr};
+  tables::CounterSummaryTable counter_summary_table_{&string_pool_, nullptr};
+  tables::SliceSummaryTable slice_summary_table_{&string_pool_, nullptr};
 };
 
 }  // namespace trace_processor
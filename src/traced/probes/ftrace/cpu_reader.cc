@@ -17,6 +17,7 @@
 #include "src/traced/probes/ftrace/cpu_reader.h"
 
 #include <dirent.h>
+#include <fcntl.h>
 #include <signal.h>
 
 #include <utility>
@@ -45,6 +46,10 @@ namespace {
 // TODO(rsavitski): consider making part of compact_sched config.
 constexpr size_t kCompactSchedInternerThreshold = 64;
 
+// Size we try to grow the splice pipe to, so that a whole parsing batch can be
+// spliced at once. This is the default /proc/sys/fs/pipe-max-size.
+constexpr size_t kSplicePipeSize = 1024 * 1024;
+
 // For further documentation of these constants see the kernel source:
 // linux/include/linux/ring_buffer.h
 // Some information about the values of these constants are exposed to user
@@ -140,10 +145,29 @@ using protos::pbzero::GenericFtraceEvent;
 
 CpuReader::CpuReader(size_t cpu,
                      const ProtoTranslationTable* table,
-                     base::ScopedFile trace_fd)
-    : cpu_(cpu), table_(table), trace_fd_(std::move(trace_fd)) {
+                     base::ScopedFile trace_fd,
+                     ReadMode read_mode)
+    : cpu_(cpu),
+      table_(table),
+      trace_fd_(std::move(trace_fd)),
+      read_mode_(read_mode) {
   PERFETTO_CHECK(trace_fd_);
   PERFETTO_CHECK(SetBlocking(*trace_fd_, false));
+
+  if (read_mode_ == ReadMode::kSplice) {
+    splice_pipe_ = base::Pipe::Create(base::Pipe::kBothNonBlock);
+    // Growing the pipe is best effort, it can fail if we're over the per-user
+    // pipe buffer limits. In that case we just splice fewer pages at a time.
+    fcntl(*splice_pipe_.wr, F_SETPIPE_SZ, static_cast<int>(kSplicePipeSize));
+    int pipe_size = fcntl(*splice_pipe_.wr, F_GETPIPE_SZ);
+    if (pipe_size > 0)
+      splice_pipe_pages_ = static_cast<size_t>(pipe_size) / base::kPageSize;
+    if (splice_pipe_pages_ == 0) {
+      PERFETTO_PLOG("[cpu%zu]: can't size the splice pipe", cpu_);
+      read_mode_ = ReadMode::kRead;
+      splice_pipe_ = base::Pipe();
+    }
+  }
 }
 
 CpuReader::~CpuReader() = default;
@@ -193,6 +217,11 @@ size_t CpuReader::ReadAndProcessBatch(
   {
     metatrace::ScopedEvent evt(metatrace::TAG_FTRACE,
                                metatrace::FTRACE_CPU_READ_BATCH);
+    // Move as many full pages as possible in bulk. Whatever is left (i.e. the
+    // page the kernel is writing into) is read() below.
+    if (read_mode_ == ReadMode::kSplice)
+      pages_read = SplicePages(parsing_buf, max_pages);
+
     for (; pages_read < max_pages;) {
       uint8_t* curr_page = parsing_buf + (pages_read * base::kPageSize);
       ssize_t res =
@@ -268,6 +297,34 @@ size_t CpuReader::ReadAndProcessBatch(
   return pages_read;
 }
 
+size_t CpuReader::SplicePages(uint8_t* parsing_buf, size_t max_pages) {
+  size_t max_bytes = std::min(max_pages, splice_pipe_pages_) * base::kPageSize;
+  ssize_t res = PERFETTO_EINTR(splice(*trace_fd_, nullptr, *splice_pipe_.wr,
+                                      nullptr, max_bytes, SPLICE_F_NONBLOCK));
+  if (res < 0) {
+    // EAGAIN means that there are no fully written pages. ENOMEM and EBUSY are
+    // temporary ftrace failures, as in the read() path. Anything else means
+    // that splicing isn't supported, in which case we stick to read().
+    if (errno != EAGAIN && errno != ENOMEM && errno != EBUSY) {
+      PERFETTO_PLOG("[cpu%zu]: splice() from ftrace pipe failed, using read()",
+                    cpu_);
+      read_mode_ = ReadMode::kRead;
+    }
+    return 0;
+  }
+
+  // The kernel only splices whole pages (see |tracing_buffers_splice_read|).
+  size_t bytes = static_cast<size_t>(res);
+  PERFETTO_CHECK(bytes % base::kPageSize == 0);
+  for (size_t off = 0; off < bytes;) {
+    ssize_t rd =
+        PERFETTO_EINTR(read(*splice_pipe_.rd, parsing_buf + off, bytes - off));
+    PERFETTO_CHECK(rd > 0);
+    off += static_cast<size_t>(rd);
+  }
+  return bytes / base::kPageSize;
+}
+
 // static
 bool CpuReader::ProcessPagesForDataSource(
     TraceWriter* trace_writer,
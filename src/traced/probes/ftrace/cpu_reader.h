@@ -63,9 +63,21 @@ class CpuReader {
     bool lost_events;
   };
 
+  // How raw ftrace pages are moved out of the per-cpu kernel buffer.
+  enum class ReadMode {
+    // One read() of trace_pipe_raw per page.
+    kRead,
+    // Fully written pages are spliced into a pipe and read from it in bulk,
+    // which takes two syscalls per batch rather than one per page. The page
+    // the kernel is still writing into is read() as in kRead mode. Falls back
+    // to kRead if the kernel doesn't support splicing from trace_pipe_raw.
+    kSplice,
+  };
+
   CpuReader(size_t cpu,
             const ProtoTranslationTable* table,
-            base::ScopedFile trace_fd);
+            base::ScopedFile trace_fd,
+            ReadMode read_mode = ReadMode::kRead);
   ~CpuReader();
 
   // Reads and parses all ftrace data for this cpu (in batches), until we catch
@@ -235,9 +247,19 @@ class CpuReader {
       bool first_batch_in_cycle,
       const std::set<FtraceDataSource*>& started_data_sources);
 
+  // Splices at most |max_pages| fully written pages of ftrace data into
+  // |parsing_buf|. Returns the number of pages transferred, which is zero if
+  // there are no full pages available.
+  size_t SplicePages(uint8_t* parsing_buf, size_t max_pages);
+
   const size_t cpu_;
   const ProtoTranslationTable* const table_;
   base::ScopedFile trace_fd_;
+  ReadMode read_mode_;
+
+  // Only valid in kSplice mode.
+  base::Pipe splice_pipe_;
+  size_t splice_pipe_pages_ = 0;
 };
 
 }  // namespace perfetto
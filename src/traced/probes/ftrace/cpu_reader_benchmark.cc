@@ -14,6 +14,12 @@
 
 #include <benchmark/benchmark.h>
 
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "perfetto/ext/base/file_utils.h"
+#include "perfetto/ext/base/paged_memory.h"
+#include "perfetto/ext/base/temp_file.h"
 #include "perfetto/ext/base/utils.h"
 #include "perfetto/protozero/scattered_stream_null_delegate.h"
 #include "perfetto/protozero/scattered_stream_writer.h"
@@ -340,3 +346,41 @@ static void BM_ParsePageFullOfSchedSwitch(benchmark::State& state) {
   }
 }
 BENCHMARK(BM_ParsePageFullOfSchedSwitch);
+
+// Benchmark for moving raw pages out of the ftrace pipe, using a file full of
+// sched_switch pages as a fake per-cpu ring buffer. Only the syscall overhead
+// of the two read modes is measured, the pages are not parsed.
+static void BM_ReadCycle(benchmark::State& state) {
+  static constexpr size_t kPages = 256;  // kMaxPagesPerCpuPerReadTick.
+  static constexpr size_t kParsingBufferSizePages = 32;
+  const ExamplePage* test_case = &g_full_page_sched_switch;
+  auto mode = static_cast<CpuReader::ReadMode>(state.range(0));
+
+  ProtoTranslationTable* table = GetTable(test_case->name);
+  auto page = PageFromXxd(test_case->data);
+  perfetto::base::TempFile trace_file = perfetto::base::TempFile::Create();
+  for (size_t i = 0; i < kPages; i++)
+    perfetto::base::WriteAll(trace_file.fd(), page.get(),
+                             perfetto::base::kPageSize);
+
+  // The reader and |fd| share the file offset, which is used to rewind the
+  // fake ring buffer at each iteration.
+  perfetto::base::ScopedFile fd =
+      perfetto::base::OpenFile(trace_file.path(), O_RDONLY);
+  CpuReader reader(0, table, perfetto::base::ScopedFile(dup(*fd)), mode);
+  auto parsing_mem = perfetto::base::PagedMemory::Allocate(
+      perfetto::base::kPageSize * kParsingBufferSizePages);
+  uint8_t* parsing_buf = static_cast<uint8_t*>(parsing_mem.Get());
+
+  size_t pages_read = 0;
+  while (state.KeepRunning()) {
+    lseek(*fd, 0, SEEK_SET);
+    pages_read +=
+        reader.ReadCycle(parsing_buf, kParsingBufferSizePages, kPages, {});
+  }
+  state.counters["pages/s"] = benchmark::Counter(
+      static_cast<double>(pages_read), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_ReadCycle)
+    ->Arg(static_cast<int>(CpuReader::ReadMode::kRead))
+    ->Arg(static_cast<int>(CpuReader::ReadMode::kSplice));
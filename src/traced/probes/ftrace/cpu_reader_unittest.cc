@@ -20,6 +20,8 @@
 #include <sys/stat.h>
 
 #include "perfetto/base/build_config.h"
+#include "perfetto/ext/base/file_utils.h"
+#include "perfetto/ext/base/temp_file.h"
 #include "perfetto/ext/base/utils.h"
 #include "perfetto/protozero/proto_utils.h"
 #include "perfetto/protozero/scattered_heap_buffer.h"
@@ -1646,6 +1648,37 @@ TEST(CpuReaderTest, ParseFullPageSchedSwitch) {
   EXPECT_EQ(bundle->event().size(), 59u);
 }
 
+// Both read modes should move the same pages out of the (fake) ftrace pipe.
+TEST(CpuReaderTest, ReadCycleSplice) {
+  ProtoTranslationTable* table = GetTable(g_full_page_sched_switch.name);
+  auto page = PageFromXxd(g_full_page_sched_switch.data);
+
+  static constexpr size_t kTestPages = 8;
+  base::TempFile trace_file = base::TempFile::Create();
+  for (size_t i = 0; i < kTestPages; i++)
+    base::WriteAll(trace_file.fd(), page.get(), base::kPageSize);
+
+  static constexpr size_t kBufPages = 2 * kTestPages;
+  std::unique_ptr<uint8_t[]> read_buf(new uint8_t[base::kPageSize * kBufPages]);
+  std::unique_ptr<uint8_t[]> splice_buf(
+      new uint8_t[base::kPageSize * kBufPages]);
+
+  CpuReader read_reader(0, table, base::OpenFile(trace_file.path(), O_RDONLY),
+                        CpuReader::ReadMode::kRead);
+  EXPECT_EQ(read_reader.ReadCycle(read_buf.get(), kBufPages, kBufPages, {}),
+            kTestPages);
+
+  CpuReader splice_reader(0, table,
+                          base::OpenFile(trace_file.path(), O_RDONLY),
+                          CpuReader::ReadMode::kSplice);
+  EXPECT_EQ(splice_reader.ReadCycle(splice_buf.get(), kBufPages, kBufPages, {}),
+            kTestPages);
+
+  EXPECT_EQ(memcmp(read_buf.get(), splice_buf.get(),
+                   base::kPageSize * kTestPages),
+            0);
+}
+
 // clang-format off
 // # tracer: nop
 // #
@@ -184,7 +184,8 @@ void FtraceController::StartIfNeeded() {
   size_t period_page_quota = ftrace_config_muxer_->GetPerCpuBufferSizePages();
   for (size_t cpu = 0; cpu < ftrace_procfs_->NumberOfCpus(); cpu++) {
     auto reader = std::unique_ptr<CpuReader>(
-        new CpuReader(cpu, table_.get(), ftrace_procfs_->OpenPipeForCpu(cpu)));
+        new CpuReader(cpu, table_.get(), ftrace_procfs_->OpenPipeForCpu(cpu),
+                      CpuReader::ReadMode::kSplice));
     per_cpu_.emplace_back(std::move(reader), period_page_quota);
   }
 
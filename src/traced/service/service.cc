@@ -23,6 +23,7 @@
 #include "perfetto/ext/tracing/ipc/default_socket.h"
 #include "perfetto/ext/tracing/ipc/service_ipc_host.h"
 #include "src/traced/service/builtin_producer.h"
+#include "src/traced/service/zlib_compressor.h"
 
 #if PERFETTO_BUILDFLAG(PERFETTO_VERSION_GEN)
 #include "perfetto_version.gen.h"
@@ -35,12 +36,16 @@ namespace perfetto {
 int __attribute__((visibility("default"))) ServiceMain(int argc, char** argv) {
   enum LongOption {
     OPT_VERSION = 1000,
+    OPT_FILE_WRITER_THREAD,
   };
 
   static const struct option long_options[] = {
       {"version", no_argument, nullptr, OPT_VERSION},
+      {"file-writer-thread", no_argument, nullptr, OPT_FILE_WRITER_THREAD},
       {nullptr, 0, nullptr, 0}};
 
+  bool file_writer_thread = false;
+
   int option_index;
   for (;;) {
     int option = getopt_long(argc, argv, "", long_options, &option_index);
@@ -50,8 +55,11 @@ int __attribute__((visibility("default"))) ServiceMain(int argc, char** argv) {
       case OPT_VERSION:
         printf("%s\n", PERFETTO_GET_GIT_REVISION());
         return 0;
+      case OPT_FILE_WRITER_THREAD:
+        file_writer_thread = true;
+        break;
       default:
-        PERFETTO_ELOG("Usage: %s [--version]", argv[0]);
+        PERFETTO_ELOG("Usage: %s [--version] [--file-writer-thread]", argv[0]);
         return 1;
     }
   }
@@ -82,6 +90,12 @@ int __attribute__((visibility("default"))) ServiceMain(int argc, char** argv) {
     return 1;
   }
 
+  svc->service()->SetCompressorFn(ZlibCompressFn);
+
+  // Move the writes of write_into_file sessions off the service thread.
+  if (file_writer_thread)
+    svc->service()->SetFileWriterThreadEnabled(true);
+
   BuiltinProducer builtin_producer(&task_runner, /*lazy_stop_delay_ms=*/30000);
   builtin_producer.ConnectInProcess(svc->service());
 
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/traced/service/zlib_compressor.h"
+
+#include <string.h>
+#include <zlib.h>
+
+#include <memory>
+#include <tuple>
+
+#include "perfetto/base/logging.h"
+#include "perfetto/protozero/proto_utils.h"
+
+#include "protos/perfetto/trace/trace_packet.pbzero.h"
+
+namespace perfetto {
+namespace {
+
+using protozero::proto_utils::MakeTagLengthDelimited;
+using protozero::proto_utils::WriteVarInt;
+
+constexpr uint32_t kCompressedPacketsTag = MakeTagLengthDelimited(
+    protos::pbzero::TracePacket::kCompressedPacketsFieldNumber);
+
+// Maximum size of the compressed data of each compressed packet. This is the
+// same limit used by perfetto_cmd when compressing on the consumer side.
+constexpr size_t kMaxCompressedPacketSize = 500 * 1024;
+
+// After every kSyncFlushBytes of input we do a Z_SYNC_FLUSH in the zlib stream.
+constexpr size_t kSyncFlushBytes = 32 * 1024;
+
+// Compresses consecutive packets into compressed packets. The size of the
+// output for the pending input is estimated conservatively (each input byte
+// could turn into two output bytes) to start a new compressed packet before
+// the current one could go over kMaxCompressedPacketSize. As compression
+// usually does much better than that, a Z_SYNC_FLUSH is done every
+// kSyncFlushBytes so that the output buffer reflects the input compressed so
+// far and compressed packets are not underfilled.
+class PacketCompressor {
+ public:
+  explicit PacketCompressor(std::vector<TracePacket>* out)
+      : out_(out), buf_(new uint8_t[kMaxCompressedPacketSize]) {}
+  ~PacketCompressor() { PERFETTO_DCHECK(!is_compressing_); }
+
+  void AddPacket(TracePacket packet);
+
+  // Ends the current compressed packet, if any.
+  void Finish() {
+    if (is_compressing_)
+      EndStream();
+  }
+
+ private:
+  PacketCompressor(const PacketCompressor&) = delete;
+  PacketCompressor& operator=(const PacketCompressor&) = delete;
+
+  void BeginStream();
+  void EndStream();
+  void Deflate(const void* ptr, size_t size);
+  void CheckEq(int actual_code, int expected_code);
+
+  std::vector<TracePacket>* const out_;
+  std::unique_ptr<uint8_t[]> buf_;
+  z_stream stream_{};
+  bool is_compressing_ = false;
+  size_t pending_bytes_ = 0;
+};
+
+void PacketCompressor::AddPacket(TracePacket packet) {
+  static constexpr size_t kMargin = 1024;
+  if (is_compressing_) {
+    if (pending_bytes_ > kSyncFlushBytes) {
+      CheckEq(deflate(&stream_, Z_SYNC_FLUSH), Z_OK);
+      pending_bytes_ = 0;
+    }
+    size_t remaining = stream_.avail_out;
+    if ((pending_bytes_ + packet.size() + kMargin) * 2 > remaining)
+      EndStream();
+  }
+
+  // Packets which could not fit even in an empty compressed packet are left
+  // uncompressed. The checks above guarantee that the current compressed
+  // packet (if any) has been ended so the order of the packets is preserved.
+  if ((packet.size() + kMargin) * 2 > kMaxCompressedPacketSize) {
+    PERFETTO_DCHECK(!is_compressing_);
+    out_->emplace_back(std::move(packet));
+    return;
+  }
+
+  if (!is_compressing_)
+    BeginStream();
+
+  char* preamble;
+  size_t preamble_size;
+  std::tie(preamble, preamble_size) = packet.GetProtoPreamble();
+  Deflate(preamble, preamble_size);
+  for (const Slice& slice : packet.slices())
+    Deflate(slice.start, slice.size);
+}
+
+void PacketCompressor::BeginStream() {
+  PERFETTO_DCHECK(!is_compressing_);
+  memset(&stream_, 0, sizeof(stream_));
+  CheckEq(deflateInit(&stream_, Z_DEFAULT_COMPRESSION), Z_OK);
+  stream_.next_out = buf_.get();
+  stream_.avail_out = static_cast<unsigned int>(kMaxCompressedPacketSize);
+  is_compressing_ = true;
+  pending_bytes_ = 0;
+}
+
+void PacketCompressor::EndStream() {
+  PERFETTO_DCHECK(is_compressing_);
+  CheckEq(deflate(&stream_, Z_FINISH), Z_STREAM_END);
+  size_t size = kMaxCompressedPacketSize - stream_.avail_out;
+  CheckEq(deflateEnd(&stream_), Z_OK);
+  is_compressing_ = false;
+
+  Slice preamble = Slice::Allocate(16);
+  uint8_t* ptr = preamble.own_data();
+  ptr = WriteVarInt(kCompressedPacketsTag, ptr);
+  ptr = WriteVarInt(size, ptr);
+  preamble.size = static_cast<size_t>(ptr - preamble.own_data());
+
+  Slice data = Slice::Allocate(size);
+  memcpy(data.own_data(), buf_.get(), size);
+
+  TracePacket packet;
+  packet.AddSlice(std::move(preamble));
+  packet.AddSlice(std::move(data));
+  out_->emplace_back(std::move(packet));
+}
+
+void PacketCompressor::Deflate(const void* ptr, size_t size) {
+  PERFETTO_DCHECK(is_compressing_);
+  stream_.next_in = static_cast<uint8_t*>(const_cast<void*>(ptr));
+  stream_.avail_in = static_cast<unsigned int>(size);
+  CheckEq(deflate(&stream_, Z_NO_FLUSH), Z_OK);
+  PERFETTO_CHECK(stream_.avail_in == 0);
+  pending_bytes_ += size;
+}
+
+void PacketCompressor::CheckEq(int actual_code, int expected_code) {
+  if (actual_code == expected_code)
+    return;
+  PERFETTO_FATAL("Expected %d got %d: %s", expected_code, actual_code,
+                 stream_.msg);
+}
+
+}  // namespace
+
+void ZlibCompressFn(std::vector<TracePacket>* packets) {
+  if (packets->empty())
+    return;
+
+  std::vector<TracePacket> compressed_packets;
+  PacketCompressor compressor(&compressed_packets);
+  for (TracePacket& packet : *packets)
+    compressor.AddPacket(std::move(packet));
+  compressor.Finish();
+  *packets = std::move(compressed_packets);
+}
+
+}  // namespace perfetto
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACED_SERVICE_ZLIB_COMPRESSOR_H_
+#define SRC_TRACED_SERVICE_ZLIB_COMPRESSOR_H_
+
+#include <vector>
+
+#include "perfetto/ext/tracing/core/trace_packet.h"
+
+namespace perfetto {
+
+// Compresses |packets| in place with zlib, to be passed to
+// TracingService::SetCompressorFn().
+//
+// The packets are replaced by packets which only contain the
+// |compressed_packets| field. Each of them holds an independent zlib stream of
+// consecutive packets (each prefixed by its Trace.packet preamble) and is at
+// most ~500KB, so the resulting trace can be decoded (and seeked into) one
+// compressed packet at a time. Packets too big to fit in a compressed packet
+// are left uncompressed.
+void ZlibCompressFn(std::vector<TracePacket>* packets);
+
+}  // namespace perfetto
+
+#endif  // SRC_TRACED_SERVICE_ZLIB_COMPRESSOR_H_
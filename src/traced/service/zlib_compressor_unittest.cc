@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/traced/service/zlib_compressor.h"
+
+#include <string.h>
+#include <zlib.h>
+
+#include <string>
+#include <tuple>
+
+#include "perfetto/protozero/proto_decoder.h"
+#include "test/gtest_and_gmock.h"
+
+#include "protos/perfetto/trace/trace_packet.pbzero.h"
+
+namespace perfetto {
+namespace {
+
+TracePacket CreatePacket(const std::string& content) {
+  Slice slice = Slice::Allocate(content.size());
+  memcpy(slice.own_data(), content.data(), content.size());
+  TracePacket packet;
+  packet.AddSlice(std::move(slice));
+  return packet;
+}
+
+// Returns the packets serialized as a root Trace proto.
+std::string Serialize(std::vector<TracePacket>* packets) {
+  std::string raw;
+  for (TracePacket& packet : *packets) {
+    char* preamble;
+    size_t preamble_size;
+    std::tie(preamble, preamble_size) = packet.GetProtoPreamble();
+    raw.append(preamble, preamble_size);
+    raw.append(packet.GetRawBytesForTesting());
+  }
+  return raw;
+}
+
+std::string Inflate(const protozero::ConstBytes& data) {
+  z_stream stream{};
+  stream.next_in = const_cast<uint8_t*>(data.data);
+  stream.avail_in = static_cast<unsigned int>(data.size);
+  EXPECT_EQ(inflateInit(&stream), Z_OK);
+
+  std::string out;
+  uint8_t buf[4096];
+  int ret;
+  do {
+    stream.next_out = buf;
+    stream.avail_out = sizeof(buf);
+    ret = inflate(&stream, Z_NO_FLUSH);
+    EXPECT_TRUE(ret == Z_OK || ret == Z_STREAM_END);
+    out.append(reinterpret_cast<char*>(buf), sizeof(buf) - stream.avail_out);
+  } while (ret == Z_OK);
+  inflateEnd(&stream);
+  return out;
+}
+
+// Returns the packets serialized as a root Trace proto, decompressing the
+// compressed packets. Also returns the number of compressed packets.
+std::string Decompress(std::vector<TracePacket>* packets,
+                       size_t* num_compressed) {
+  std::string raw;
+  *num_compressed = 0;
+  for (TracePacket& packet : *packets) {
+    std::string bytes = packet.GetRawBytesForTesting();
+    protozero::ProtoDecoder decoder(bytes.data(), bytes.size());
+    protozero::Field field = decoder.ReadField();
+    if (field.id() !=
+        protos::pbzero::TracePacket::kCompressedPacketsFieldNumber) {
+      std::vector<TracePacket> uncompressed;
+      uncompressed.emplace_back(std::move(packet));
+      raw.append(Serialize(&uncompressed));
+      continue;
+    }
+    EXPECT_FALSE(decoder.ReadField().valid());
+    EXPECT_LE(field.size(), 500u * 1024);
+    raw.append(Inflate(field.as_bytes()));
+    (*num_compressed)++;
+  }
+  return raw;
+}
+
+TEST(ZlibCompressorTest, Empty) {
+  std::vector<TracePacket> packets;
+  ZlibCompressFn(&packets);
+  EXPECT_TRUE(packets.empty());
+}
+
+TEST(ZlibCompressorTest, CompressAndDecompress) {
+  std::vector<TracePacket> packets;
+  std::vector<TracePacket> expected_packets;
+  for (int i = 0; i < 10000; i++) {
+    std::string content = "packet " + std::to_string(i);
+    packets.emplace_back(CreatePacket(content));
+    expected_packets.emplace_back(CreatePacket(content));
+  }
+  std::string expected = Serialize(&expected_packets);
+
+  ZlibCompressFn(&packets);
+
+  size_t num_compressed = 0;
+  size_t compressed_size = 0;
+  for (const TracePacket& packet : packets)
+    compressed_size += packet.size();
+  EXPECT_EQ(Decompress(&packets, &num_compressed), expected);
+  EXPECT_EQ(num_compressed, packets.size());
+  EXPECT_LT(compressed_size, expected.size() / 2);
+}
+
+TEST(ZlibCompressorTest, SplitsIntoMultiplePackets) {
+  // Use content which doesn't compress well to go over the size of a single
+  // compressed packet.
+  std::vector<TracePacket> packets;
+  std::vector<TracePacket> expected_packets;
+  uint32_t seed = 42;
+  for (int i = 0; i < 500; i++) {
+    std::string content(4096, '\0');
+    for (char& c : content) {
+      seed = seed * 1103515245 + 12345;
+      c = static_cast<char>(seed >> 24);
+    }
+    packets.emplace_back(CreatePacket(content));
+    expected_packets.emplace_back(CreatePacket(content));
+  }
+  std::string expected = Serialize(&expected_packets);
+
+  ZlibCompressFn(&packets);
+
+  size_t num_compressed = 0;
+  EXPECT_EQ(Decompress(&packets, &num_compressed), expected);
+  EXPECT_GT(num_compressed, 1u);
+  EXPECT_EQ(num_compressed, packets.size());
+}
+
+TEST(ZlibCompressorTest, BigPacketsLeftUncompressed) {
+  std::vector<TracePacket> packets;
+  std::vector<TracePacket> expected_packets;
+  for (const std::string& content :
+       {std::string("small 1"), std::string(400 * 1024, 'x'),
+        std::string("small 2")}) {
+    packets.emplace_back(CreatePacket(content));
+    expected_packets.emplace_back(CreatePacket(content));
+  }
+  std::string expected = Serialize(&expected_packets);
+
+  ZlibCompressFn(&packets);
+
+  ASSERT_EQ(packets.size(), 3u);
+  size_t num_compressed = 0;
+  EXPECT_EQ(Decompress(&packets, &num_compressed), expected);
+  EXPECT_EQ(num_compressed, 2u);
+}
+
+}  // namespace
+}  // namespace perfetto
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "perfetto/tracing.h"
+#include "protos/perfetto/trace/test_event.pbzero.h"
+#include "protos/perfetto/trace/trace.pbzero.h"
+#include "protos/perfetto/trace/trace_packet.pbzero.h"
+
+PERFETTO_DEFINE_CATEGORIES(PERFETTO_CATEGORY(benchmark));
+PERFETTO_TRACK_EVENT_STATIC_STORAGE();
+
+namespace {
+
+class BenchmarkDataSource : public perfetto::DataSource<BenchmarkDataSource> {
+};
+
+void InitializeTracing() {
+  static bool initialized = [] {
+    perfetto::TracingInitArgs args;
+    args.backends = perfetto::kInProcessBackend;
+    perfetto::Tracing::Initialize(args);
+    perfetto::TrackEvent::Register();
+    perfetto::DataSourceDescriptor dsd;
+    dsd.set_name("benchmark_data_source");
+    BenchmarkDataSource::Register(dsd);
+    return true;
+  }();
+  (void)initialized;
+}
+
+// Starts a tracing session with |num_instances| instances of the data source
+// called |name|.
+std::unique_ptr<perfetto::TracingSession> StartTracing(const char* name,
+                                                       int num_instances) {
+  perfetto::TraceConfig cfg;
+  auto* buffer = cfg.add_buffers();
+  buffer->set_size_kb(4096);
+  buffer->set_fill_policy(perfetto::TraceConfig::BufferConfig::RING_BUFFER);
+  for (int i = 0; i < num_instances; i++) {
+    auto* ds_cfg = cfg.add_data_sources()->mutable_config();
+    ds_cfg->set_name(name);
+    // Instances with identical configs are de-duplicated. Track event uses
+    // the legacy config as category filter, so leave it empty there.
+    if (i > 0)
+      ds_cfg->set_legacy_config(std::to_string(i));
+  }
+  auto session =
+      perfetto::Tracing::NewTrace(perfetto::BackendType::kInProcessBackend);
+  session->Setup(cfg);
+  session->StartBlocking();
+  return session;
+}
+
+static void BM_TraceEvent_Disabled(benchmark::State& state) {
+  InitializeTracing();
+  while (state.KeepRunning()) {
+    TRACE_EVENT_BEGIN("benchmark", "Event");
+    TRACE_EVENT_END("benchmark");
+  }
+}
+
+static void BM_TraceEvent_Enabled(benchmark::State& state) {
+  InitializeTracing();
+  auto session = StartTracing("track_event", 1);
+  while (state.KeepRunning()) {
+    TRACE_EVENT_BEGIN("benchmark", "Event");
+    TRACE_EVENT_END("benchmark");
+  }
+  session->StopBlocking();
+}
+
+// Returns the number of track events in the serialized Trace in |data|,
+// including the ones in coalesced packets.
+size_t CountTrackEvents(const uint8_t* data, size_t size) {
+  size_t count = 0;
+  perfetto::protos::pbzero::Trace::Decoder trace(data, size);
+  for (auto it = trace.packet(); it; ++it) {
+    perfetto::protos::pbzero::TracePacket::Decoder packet(*it);
+    if (packet.has_track_event())
+      count++;
+    if (packet.has_coalesced_packets()) {
+      count += CountTrackEvents(packet.coalesced_packets().data,
+                                packet.coalesced_packets().size);
+    }
+  }
+  return count;
+}
+
+// The argument is the maximum number of track events coalesced into a single
+// packet (0 = no coalescing). Also reports the average size of an event in the
+// trace buffer, including the per-packet overhead.
+static void BM_TraceEvent_Coalesced(benchmark::State& state) {
+  InitializeTracing();
+  perfetto::TrackEvent::SetMaxCoalescedEvents(
+      static_cast<uint32_t>(state.range(0)));
+  auto session = StartTracing("track_event", 1);
+  while (state.KeepRunning()) {
+    TRACE_EVENT_BEGIN("benchmark", "Event");
+    TRACE_EVENT_END("benchmark");
+  }
+  session->StopBlocking();
+  perfetto::TrackEvent::SetMaxCoalescedEvents(0);
+  state.SetItemsProcessed(2 * static_cast<int64_t>(state.iterations()));
+
+  std::vector<char> trace = session->ReadTraceBlocking();
+  size_t events = CountTrackEvents(reinterpret_cast<uint8_t*>(trace.data()),
+                                   trace.size());
+  if (events) {
+    state.counters["bytes_per_event"] =
+        static_cast<double>(trace.size()) / static_cast<double>(events);
+  }
+}
+
+static void BM_DataSource_Disabled(benchmark::State& state) {
+  InitializeTracing();
+  while (state.KeepRunning()) {
+    BenchmarkDataSource::Trace([](BenchmarkDataSource::TraceContext ctx) {
+      ctx.NewTracePacket()->set_for_testing()->set_str("event");
+    });
+  }
+}
+
+// The argument is the number of active instances of the data source, each of
+// which gets a copy of every event.
+static void BM_DataSource_Enabled(benchmark::State& state) {
+  InitializeTracing();
+  auto session =
+      StartTracing("benchmark_data_source", static_cast<int>(state.range(0)));
+  while (state.KeepRunning()) {
+    BenchmarkDataSource::Trace([](BenchmarkDataSource::TraceContext ctx) {
+      ctx.NewTracePacket()->set_for_testing()->set_str("event");
+    });
+  }
+  session->StopBlocking();
+}
+
+}  // namespace
+
+BENCHMARK(BM_TraceEvent_Disabled);
+BENCHMARK(BM_TraceEvent_Enabled);
+BENCHMARK(BM_TraceEvent_Coalesced)->Arg(0)->Arg(16)->Arg(64);
+BENCHMARK(BM_DataSource_Disabled);
+BENCHMARK(BM_DataSource_Enabled)->Arg(1)->Arg(8)->Arg(32);
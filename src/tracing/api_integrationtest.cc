@@ -21,6 +21,7 @@
 #include <functional>
 #include <list>
 #include <mutex>
+#include <string>
 #include <vector>
 
 #include "perfetto/tracing.h"
@@ -157,6 +158,26 @@ class MockDataSource2 : public perfetto::DataSource<MockDataSource2> {
   void OnStop(const StopArgs&) override {}
 };
 
+// Used to register lots of distinct data source types.
+template <int N>
+class NumberedDataSource : public perfetto::DataSource<NumberedDataSource<N>> {
+};
+
+template <int N>
+struct NumberedDataSourceRegistrar {
+  static bool Register() {
+    perfetto::DataSourceDescriptor dsd;
+    dsd.set_name("numbered_data_source_" + std::to_string(N));
+    return NumberedDataSource<N>::Register(dsd) &&
+           NumberedDataSourceRegistrar<N - 1>::Register();
+  }
+};
+
+template <>
+struct NumberedDataSourceRegistrar<0> {
+  static bool Register() { return true; }
+};
+
 // Used to verify that track event data sources in different namespaces register
 // themselves correctly in the muxer.
 class MockTracingMuxer : public perfetto::internal::TracingMuxer {
@@ -181,7 +202,8 @@ class MockTracingMuxer : public perfetto::internal::TracingMuxer {
 
   std::unique_ptr<perfetto::TraceWriterBase> CreateTraceWriter(
       perfetto::internal::DataSourceState*,
-      perfetto::BufferExhaustedPolicy) override {
+      perfetto::BufferExhaustedPolicy,
+      uint32_t) override {
     return nullptr;
   }
 
@@ -770,6 +792,33 @@ TEST_F(PerfettoApiTest, TrackEventCategoriesWithModule) {
   }
 }
 
+TEST_F(PerfettoApiTest, TrackEventCompiledOutCategories) {
+  tracing_module::InitializeCategories();
+
+  // Setup the trace config. All categories are enabled.
+  perfetto::TraceConfig cfg;
+  cfg.set_duration_ms(500);
+  cfg.add_buffers()->set_size_kb(1024);
+  auto* ds_cfg = cfg.add_data_sources()->mutable_config();
+  ds_cfg->set_name("track_event");
+
+  auto* tracing_session = NewTrace(cfg);
+  tracing_session->get()->StartBlocking();
+
+  // Events for the categories compiled out in the module are never written.
+  // The categories of both registries must also get distinct interning ids on
+  // the shared sequence.
+  TRACE_EVENT_BEGIN("test", "EventFromMain");
+  TRACE_EVENT_END("test");
+  tracing_module::EmitTrackEventsWithCompiledOutCategories();
+  perfetto::TrackEvent::Flush();
+
+  tracing_session->get()->StopBlocking();
+  auto slices = ReadSlicesFromTrace(tracing_session->get());
+  EXPECT_THAT(slices, ElementsAre("B:test.EventFromMain", "E:test.",
+                                  "B:cat1.EventFromModule3", "E:cat1."));
+}
+
 TEST_F(PerfettoApiTest, TrackEventConcurrentSessions) {
   // Check that categories that are enabled and disabled in two parallel tracing
   // sessions don't interfere.
@@ -1062,6 +1111,67 @@ TEST_F(PerfettoApiTest, TrackEventTypedArgsWithInterningByHashing) {
   EXPECT_THAT(log_messages, ElementsAre("Though this be madness,"));
 }
 
+struct InternedLogMessageBodyBounded
+    : public perfetto::TrackEventInternedDataIndex<
+          InternedLogMessageBodyBounded,
+          perfetto::protos::pbzero::InternedData::kLogMessageBodyFieldNumber,
+          std::string,
+          perfetto::BoundedInternedDataTraits<4>> {
+  static void Add(perfetto::protos::pbzero::InternedData* interned_data,
+                  size_t iid,
+                  const std::string& value) {
+    auto l = interned_data->add_log_message_body();
+    l->set_iid(iid);
+    l->set_body(value.data(), value.size());
+    commit_count++;
+  }
+
+  static int commit_count;
+};
+
+int InternedLogMessageBodyBounded::commit_count = 0;
+
+TEST_F(PerfettoApiTest, TrackEventTypedArgsWithInterningEviction) {
+  // Setup the trace config.
+  perfetto::TraceConfig cfg;
+  cfg.set_duration_ms(500);
+  cfg.add_buffers()->set_size_kb(1024);
+  auto* ds_cfg = cfg.add_data_sources()->mutable_config();
+  ds_cfg->set_name("track_event");
+  ds_cfg->set_legacy_config("foo");
+
+  // Create a new trace session.
+  auto* tracing_session = NewTrace(cfg);
+  tracing_session->get()->StartBlocking();
+
+  InternedLogMessageBodyBounded::commit_count = 0;
+  TRACE_EVENT_BEGIN("foo", "EventWithState", [&](perfetto::EventContext ctx) {
+    auto body_iid = InternedLogMessageBodyBounded::Get(&ctx, "Good night,");
+    auto body_iid2 = InternedLogMessageBodyBounded::Get(&ctx, "Good night,");
+    EXPECT_EQ(body_iid, body_iid2);
+    EXPECT_EQ(1, InternedLogMessageBodyBounded::commit_count);
+
+    // The index only has room for four values, so this evicts the first one.
+    InternedLogMessageBodyBounded::Get(&ctx, "sweet prince,");
+    InternedLogMessageBodyBounded::Get(&ctx, "And flights");
+    InternedLogMessageBodyBounded::Get(&ctx, "of angels");
+    InternedLogMessageBodyBounded::Get(&ctx, "sing thee to thy rest!");
+    EXPECT_EQ(5, InternedLogMessageBodyBounded::commit_count);
+
+    // Evicted values are emitted again with a new interning id.
+    auto body_iid3 = InternedLogMessageBodyBounded::Get(&ctx, "Good night,");
+    EXPECT_NE(body_iid, body_iid3);
+    EXPECT_EQ(6, InternedLogMessageBodyBounded::commit_count);
+    auto log = ctx.event()->set_log_message();
+    log->set_body_iid(body_iid3);
+  });
+  TRACE_EVENT_END("foo");
+
+  tracing_session->get()->StopBlocking();
+  auto log_messages = ReadLogMessagesFromTrace(tracing_session->get());
+  EXPECT_THAT(log_messages, ElementsAre("Good night,"));
+}
+
 struct InternedSourceLocation
     : public perfetto::TrackEventInternedDataIndex<
           InternedSourceLocation,
@@ -1611,6 +1721,59 @@ TEST_F(PerfettoApiTest, MultipleRegistrations) {
   EXPECT_EQ(trace_lambda_calls, 1);
 }
 
+TEST_F(PerfettoApiTest, ManyDataSourceTypes) {
+  // Register more data source types than the 32 that used to be supported.
+  EXPECT_TRUE(NumberedDataSourceRegistrar<40>::Register());
+
+  perfetto::TraceConfig cfg;
+  cfg.add_buffers()->set_size_kb(1024);
+  cfg.add_data_sources()->mutable_config()->set_name("numbered_data_source_40");
+  auto* tracing_session = NewTrace(cfg);
+  tracing_session->get()->StartBlocking();
+
+  std::atomic<int> trace_lambda_calls{0};
+  NumberedDataSource<40>::Trace(
+      [&trace_lambda_calls](NumberedDataSource<40>::TraceContext ctx) {
+        ctx.NewTracePacket()->set_for_testing()->set_str("event");
+        trace_lambda_calls++;
+      });
+  NumberedDataSource<1>::Trace([](NumberedDataSource<1>::TraceContext) {
+    FAIL() << "Should not be called because the data source isn't enabled";
+  });
+
+  tracing_session->get()->StopBlocking();
+  EXPECT_EQ(trace_lambda_calls, 1);
+}
+
+TEST_F(PerfettoApiTest, ManyDataSourceInstances) {
+  perfetto::DataSourceDescriptor dsd;
+  dsd.set_name("my_data_source2");
+  MockDataSource2::Register(dsd);
+
+  // Start more instances of the same data source than the 8 that used to be
+  // supported. Instances with identical configs are de-duplicated, so give
+  // each one a different config.
+  static constexpr int kNumInstances = 20;
+  perfetto::TraceConfig cfg;
+  cfg.add_buffers()->set_size_kb(1024);
+  for (int i = 0; i < kNumInstances; i++) {
+    auto* ds_cfg = cfg.add_data_sources()->mutable_config();
+    ds_cfg->set_name("my_data_source2");
+    ds_cfg->set_legacy_config(std::to_string(i));
+  }
+  auto* tracing_session = NewTrace(cfg);
+  tracing_session->get()->StartBlocking();
+
+  std::atomic<int> trace_lambda_calls{0};
+  MockDataSource2::Trace(
+      [&trace_lambda_calls](MockDataSource2::TraceContext) {
+        trace_lambda_calls++;
+      });
+
+  tracing_session->get()->StopBlocking();
+  EXPECT_EQ(trace_lambda_calls, kNumInstances);
+}
+
 TEST_F(PerfettoApiTest, CustomIncrementalState) {
   perfetto::DataSourceDescriptor dsd;
   dsd.set_name("incr_data_source");
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/tracing/core/coalescing_trace_writer.h"
+
+#include "perfetto/base/logging.h"
+#include "perfetto/protozero/message.h"
+
+#include "protos/perfetto/trace/trace.pbzero.h"
+#include "protos/perfetto/trace/trace_packet.pbzero.h"
+
+namespace perfetto {
+
+CoalescingTraceWriter::CoalescingTraceWriter(
+    std::unique_ptr<TraceWriter> writer,
+    uint32_t max_packets)
+    : writer_(std::move(writer)), max_packets_(max_packets) {
+  PERFETTO_DCHECK(max_packets_ > 0);
+}
+
+CoalescingTraceWriter::~CoalescingTraceWriter() {
+  // Make sure the last batch is complete before |writer_| commits its chunk.
+  EndBatch();
+}
+
+CoalescingTraceWriter::TracePacketHandle
+CoalescingTraceWriter::NewTracePacket() {
+  if (batch_packet_count_ &&
+      (batch_packet_count_ >= max_packets_ ||
+       writer_->written() - batch_start_ >= kMaxBatchSize)) {
+    EndBatch();
+  }
+
+  if (!batch_packet_count_) {
+    batch_packet_ = writer_->NewTracePacket();
+    batch_start_ = writer_->written();
+    coalesced_packets_ = batch_packet_->BeginNestedMessage<protozero::Message>(
+        protos::pbzero::TracePacket::kCoalescedPacketsFieldNumber);
+  }
+  batch_packet_count_++;
+
+  // The coalesced packets are encoded like the packets of a Trace message.
+  // Beginning a new nested message finalizes the previous one, in case the
+  // caller didn't.
+  return TracePacketHandle(
+      coalesced_packets_->BeginNestedMessage<protos::pbzero::TracePacket>(
+          protos::pbzero::Trace::kPacketFieldNumber));
+}
+
+void CoalescingTraceWriter::EndBatch() {
+  if (!batch_packet_count_)
+    return;
+  batch_packet_count_ = 0;
+  coalesced_packets_ = nullptr;
+  batch_packet_ = TracePacketHandle();  // Finalizes the batch.
+}
+
+void CoalescingTraceWriter::Flush(std::function<void()> callback) {
+  EndBatch();
+  writer_->Flush(std::move(callback));
+}
+
+WriterID CoalescingTraceWriter::writer_id() const {
+  return writer_->writer_id();
+}
+
+uint64_t CoalescingTraceWriter::written() const {
+  return writer_->written();
+}
+
+bool CoalescingTraceWriter::SetFirstChunkId(ChunkID chunk_id) {
+  return writer_->SetFirstChunkId(chunk_id);
+}
+
+}  // namespace perfetto
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SRC_TRACING_CORE_COALESCING_TRACE_WRITER_H_
+#define SRC_TRACING_CORE_COALESCING_TRACE_WRITER_H_
+
+#include <stdint.h>
+
+#include <memory>
+
+#include "perfetto/ext/tracing/core/trace_writer.h"
+#include "perfetto/protozero/message_handle.h"
+
+namespace protozero {
+class Message;
+}  // namespace protozero
+
+namespace perfetto {
+
+// A TraceWriter which coalesces consecutive packets into a single packet of
+// the underlying TraceWriter, nesting them in its |coalesced_packets| field.
+// This amortizes the per-packet costs (the packet header in the shared memory
+// buffer, the trusted fields the service appends to each packet, and the work
+// done by the service for each packet) over many packets, which is worthwhile
+// for data sources writing lots of small packets (e.g., track events).
+//
+// The coalesced packets inherit the trusted fields (e.g., the sequence id) of
+// the packet they are nested in, so they keep their own timestamps and
+// incremental state like any other packet on the sequence.
+//
+// The downside is that the coalesced packets only become visible to the
+// service when the current batch ends, i.e., after |max_packets| packets, when
+// the batch grows too large or on Flush(). Also, if the shared memory buffer
+// runs out of space, the whole batch is dropped rather than single packets.
+class CoalescingTraceWriter : public TraceWriter {
+ public:
+  // Once a batch reaches this size, no more packets are added to it. This
+  // keeps batches to a few chunks of the shared memory buffer even if some of
+  // the packets are large.
+  static constexpr uint64_t kMaxBatchSize = 4096;
+
+  CoalescingTraceWriter(std::unique_ptr<TraceWriter> writer,
+                        uint32_t max_packets);
+  ~CoalescingTraceWriter() override;
+
+  // TraceWriter implementation. See documentation in trace_writer.h.
+  TracePacketHandle NewTracePacket() override;
+  void Flush(std::function<void()> callback = {}) override;
+  WriterID writer_id() const override;
+  uint64_t written() const override;
+  bool SetFirstChunkId(ChunkID) override;
+
+ private:
+  CoalescingTraceWriter(const CoalescingTraceWriter&) = delete;
+  CoalescingTraceWriter& operator=(const CoalescingTraceWriter&) = delete;
+
+  // Finalizes the packet of the underlying writer holding the current batch.
+  void EndBatch();
+
+  const std::unique_ptr<TraceWriter> writer_;
+  const uint32_t max_packets_;
+
+  // The packet of |writer_| the current batch is written into and its
+  // |coalesced_packets| field. Only valid when |batch_packet_count_| > 0.
+  TracePacketHandle batch_packet_;
+  protozero::Message* coalesced_packets_ = nullptr;
+  uint32_t batch_packet_count_ = 0;
+  uint64_t batch_start_ = 0;
+};
+
+}  // namespace perfetto
+
+#endif  // SRC_TRACING_CORE_COALESCING_TRACE_WRITER_H_
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "src/tracing/core/coalescing_trace_writer.h"
+
+#include <string>
+#include <vector>
+
+#include "src/tracing/core/trace_writer_for_testing.h"
+#include "test/gtest_and_gmock.h"
+
+#include "protos/perfetto/trace/test_event.gen.h"
+#include "protos/perfetto/trace/test_event.pbzero.h"
+#include "protos/perfetto/trace/trace.gen.h"
+#include "protos/perfetto/trace/trace_packet.gen.h"
+#include "protos/perfetto/trace/trace_packet.pbzero.h"
+
+namespace perfetto {
+namespace {
+
+class CoalescingTraceWriterTest : public ::testing::Test {
+ protected:
+  std::unique_ptr<CoalescingTraceWriter> CreateWriter(uint32_t max_packets) {
+    std::unique_ptr<TraceWriterForTesting> writer(new TraceWriterForTesting());
+    inner_writer_ = writer.get();
+    return std::unique_ptr<CoalescingTraceWriter>(
+        new CoalescingTraceWriter(std::move(writer), max_packets));
+  }
+
+  // Returns the strings of the coalesced packets, grouped by the packet of
+  // the underlying writer they were written into.
+  std::vector<std::vector<std::string>> GetBatches() {
+    std::vector<std::vector<std::string>> batches;
+    for (const auto& packet : inner_writer_->GetAllTracePackets()) {
+      EXPECT_TRUE(packet.has_coalesced_packets());
+      protos::gen::Trace trace;
+      EXPECT_TRUE(trace.ParseFromString(packet.coalesced_packets()));
+      std::vector<std::string> batch;
+      for (const auto& coalesced : trace.packet())
+        batch.push_back(coalesced.for_testing().str());
+      batches.push_back(std::move(batch));
+    }
+    return batches;
+  }
+
+  TraceWriterForTesting* inner_writer_ = nullptr;
+};
+
+TEST_F(CoalescingTraceWriterTest, BatchesSplitAtMaxPackets) {
+  auto writer = CreateWriter(2);
+  for (int i = 0; i < 5; i++) {
+    auto packet = writer->NewTracePacket();
+    packet->set_for_testing()->set_str("packet " + std::to_string(i));
+  }
+  writer->Flush();
+
+  using Batch = std::vector<std::string>;
+  EXPECT_THAT(GetBatches(),
+              testing::ElementsAre(Batch{"packet 0", "packet 1"},
+                                   Batch{"packet 2", "packet 3"},
+                                   Batch{"packet 4"}));
+}
+
+TEST_F(CoalescingTraceWriterTest, FlushEndsBatch) {
+  auto writer = CreateWriter(100);
+  writer->NewTracePacket()->set_for_testing()->set_str("a");
+  writer->Flush();
+  writer->NewTracePacket()->set_for_testing()->set_str("b");
+  writer->NewTracePacket()->set_for_testing()->set_str("c");
+  writer->Flush();
+
+  // Flushing again without new packets shouldn't emit an empty batch.
+  writer->Flush();
+
+  using Batch = std::vector<std::string>;
+  EXPECT_THAT(GetBatches(),
+              testing::ElementsAre(Batch{"a"}, Batch{"b", "c"}));
+}
+
+TEST_F(CoalescingTraceWriterTest, BatchesSplitAtMaxBatchSize) {
+  auto writer = CreateWriter(1000);
+  const std::string payload(1000, 'x');
+  for (int i = 0; i < 10; i++)
+    writer->NewTracePacket()->set_for_testing()->set_str(payload);
+  writer->Flush();
+
+  auto batches = GetBatches();
+  size_t total_packets = 0;
+  for (const auto& batch : batches) {
+    // The size check happens before adding a packet, so a batch can overshoot
+    // the limit by at most one packet.
+    EXPECT_LE(batch.size() * payload.size(),
+              CoalescingTraceWriter::kMaxBatchSize + payload.size());
+    total_packets += batch.size();
+  }
+  EXPECT_GT(batches.size(), 1u);
+  EXPECT_EQ(total_packets, 10u);
+}
+
+}  // namespace
+}  // namespace perfetto
@@ -72,71 +72,37 @@ Chunk SharedMemoryArbiterImpl::GetNewChunk(
   static const int kAssertAtNStalls = 100;
 
   for (;;) {
-    // TODO(primiano): Probably this lock is not really required and this code
-    // could be rewritten leveraging only the Try* atomic operations in
-    // SharedMemoryABI. But let's not be too adventurous for the moment.
-    {
-      std::unique_lock<std::mutex> scoped_lock(lock_);
+    Chunk chunk = TryAcquireFreeChunk(header);
+    if (chunk.is_valid()) {
+      if (stall_count > kLogAfterNStalls) {
+        PERFETTO_LOG("Recovered from stall after %d iterations", stall_count);
+      }
 
       // If more than half of the SMB.size() is filled with completed chunks for
       // which we haven't notified the service yet (i.e. they are still enqueued
       // in |commit_data_req_|), force a synchronous CommitDataRequest() even if
-      // we acquire a chunk, to reduce the likeliness of stalling the writer.
+      // we acquired a chunk, to reduce the likeliness of stalling the writer.
       //
       // We can only do this if we're writing on the same thread that we access
       // the producer endpoint on, since we cannot notify the producer endpoint
       // to commit synchronously on a different thread. Attempting to flush
       // synchronously on another thread will lead to subtle bugs caused by
       // out-of-order commit requests (crbug.com/919187#c28).
-      bool should_commit_synchronously =
-          buffer_exhausted_policy == BufferExhaustedPolicy::kStall &&
-          commit_data_req_ && bytes_pending_commit_ >= shmem_abi_.size() / 2 &&
-          task_runner_->RunsTasksOnCurrentThread();
-
-      const size_t initial_page_idx = page_idx_;
-      for (size_t i = 0; i < shmem_abi_.num_pages(); i++) {
-        page_idx_ = (initial_page_idx + i) % shmem_abi_.num_pages();
-        bool is_new_page = false;
-
-        // TODO(primiano): make the page layout dynamic.
-        auto layout = SharedMemoryArbiterImpl::default_page_layout;
-
-        if (shmem_abi_.is_page_free(page_idx_)) {
-          // TODO(primiano): Use the |size_hint| here to decide the layout.
-          is_new_page = shmem_abi_.TryPartitionPage(page_idx_, layout);
-        }
-        uint32_t free_chunks;
-        if (is_new_page) {
-          free_chunks = (1 << SharedMemoryABI::kNumChunksForLayout[layout]) - 1;
-        } else {
-          free_chunks = shmem_abi_.GetFreeChunks(page_idx_);
-        }
-
-        for (uint32_t chunk_idx = 0; free_chunks;
-             chunk_idx++, free_chunks >>= 1) {
-          if (!(free_chunks & 1))
-            continue;
-          // We found a free chunk.
-          Chunk chunk = shmem_abi_.TryAcquireChunkForWriting(
-              page_idx_, chunk_idx, &header);
-          if (!chunk.is_valid())
-            continue;
-          if (stall_count > kLogAfterNStalls) {
-            PERFETTO_LOG("Recovered from stall after %d iterations",
-                         stall_count);
-          }
-
-          if (should_commit_synchronously) {
-            // We can't flush while holding the lock.
-            scoped_lock.unlock();
-            FlushPendingCommitDataRequests();
-            return chunk;
-          } else {
-            return chunk;
-          }
+      if (buffer_exhausted_policy == BufferExhaustedPolicy::kStall &&
+          task_runner_->RunsTasksOnCurrentThread()) {
+        bool should_commit_synchronously;
+        {
+          std::lock_guard<std::mutex> scoped_lock(lock_);
+          should_commit_synchronously =
+              commit_data_req_ &&
+              bytes_pending_commit_ >= shmem_abi_.size() / 2;
         }
+        // We can't flush while holding the lock.
+        if (should_commit_synchronously)
+          FlushPendingCommitDataRequests();
       }
-    }  // std::unique_lock<std::mutex>
+      return chunk;
+    }
 
     if (buffer_exhausted_policy == BufferExhaustedPolicy::kDrop) {
       PERFETTO_DLOG("Shared memory buffer exhaused, returning invalid Chunk!");
@@ -183,6 +149,50 @@ Chunk SharedMemoryArbiterImpl::GetNewChunk(
   }
 }
 
+Chunk SharedMemoryArbiterImpl::TryAcquireFreeChunk(
+    const SharedMemoryABI::ChunkHeader& header) {
+  // This doesn't need |lock_|: the state of the pages and chunks is only
+  // changed through the atomic Try* operations of SharedMemoryABI, which are
+  // safe against concurrent writers (and the service). If two threads race on
+  // the same page or chunk, the loser simply moves on to the next one.
+  const size_t num_pages = shmem_abi_.num_pages();
+  const size_t initial_page_idx = page_idx_.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < num_pages; i++) {
+    size_t page_idx = (initial_page_idx + i) % num_pages;
+    bool is_new_page = false;
+
+    // TODO(primiano): make the page layout dynamic.
+    auto layout = SharedMemoryArbiterImpl::default_page_layout;
+
+    if (shmem_abi_.is_page_free(page_idx)) {
+      // TODO(primiano): Use the |size_hint| here to decide the layout.
+      is_new_page = shmem_abi_.TryPartitionPage(page_idx, layout);
+    }
+    uint32_t free_chunks;
+    if (is_new_page) {
+      free_chunks = (1 << SharedMemoryABI::kNumChunksForLayout[layout]) - 1;
+    } else {
+      free_chunks = shmem_abi_.GetFreeChunks(page_idx);
+    }
+
+    for (uint32_t chunk_idx = 0; free_chunks; chunk_idx++, free_chunks >>= 1) {
+      if (!(free_chunks & 1))
+        continue;
+      // We found a free chunk.
+      Chunk chunk =
+          shmem_abi_.TryAcquireChunkForWriting(page_idx, chunk_idx, &header);
+      if (!chunk.is_valid())
+        continue;
+
+      // Start the next search from this page, which is likely to have more
+      // free chunks. This is only a hint, hence the relaxed store.
+      page_idx_.store(page_idx, std::memory_order_relaxed);
+      return chunk;
+    }
+  }
+  return Chunk();
+}
+
 void SharedMemoryArbiterImpl::ReturnCompletedChunk(Chunk chunk,
                                                    BufferID target_buffer,
                                                    PatchList* patch_list) {
@@ -19,6 +19,7 @@
 
 #include <stdint.h>
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -44,9 +45,11 @@ class TaskRunner;
 // This class handles the shared memory buffer on the producer side. It is used
 // to obtain thread-local chunks and to partition pages from several threads.
 // There is one arbiter instance per Producer.
-// This class is thread-safe and uses locks to do so. Data sources are supposed
-// to interact with this sporadically, only when they run out of space on their
-// current thread-local chunk.
+// This class is thread-safe. Acquiring new chunks is lock-free, as it relies
+// only on the atomic operations of SharedMemoryABI, while the commit requests
+// are protected by a lock. Data sources are supposed to interact with this
+// sporadically, only when they run out of space on their current thread-local
+// chunk.
 class SharedMemoryArbiterImpl : public SharedMemoryArbiter {
  public:
   // See SharedMemoryArbiter::CreateInstance(). |start|, |size| define the
@@ -121,6 +124,11 @@ class SharedMemoryArbiterImpl : public SharedMemoryArbiter {
   SharedMemoryArbiterImpl(const SharedMemoryArbiterImpl&) = delete;
   SharedMemoryArbiterImpl& operator=(const SharedMemoryArbiterImpl&) = delete;
 
+  // Scans the SMB for a free chunk and acquires it for writing. Returns an
+  // invalid chunk if all chunks are taken. Lock-free, see the .cc file.
+  SharedMemoryABI::Chunk TryAcquireFreeChunk(
+      const SharedMemoryABI::ChunkHeader&);
+
   void UpdateCommitDataRequest(SharedMemoryABI::Chunk chunk,
                                WriterID writer_id,
                                BufferID target_buffer,
@@ -132,10 +140,15 @@ class SharedMemoryArbiterImpl : public SharedMemoryArbiter {
   base::TaskRunner* const task_runner_;
   TracingService::ProducerEndpoint* const producer_endpoint_;
 
+  // The state of the SMB is only accessed through the atomic operations of
+  // SharedMemoryABI, so |shmem_abi_| doesn't need to be protected by |lock_|.
+  SharedMemoryABI shmem_abi_;
+
+  // The page from which GetNewChunk() starts looking for a free chunk.
+  std::atomic<size_t> page_idx_{0};
+
   // --- Begin lock-protected members ---
   std::mutex lock_;
-  SharedMemoryABI shmem_abi_;
-  size_t page_idx_ = 0;
   std::unique_ptr<CommitDataRequest> commit_data_req_;
   size_t bytes_pending_commit_ = 0;  // SUM(chunk.size() : commit_data_req_).
   IdAllocator<WriterID> active_writer_ids_;
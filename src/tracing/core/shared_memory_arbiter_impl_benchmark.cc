@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "perfetto/base/task_runner.h"
+#include "perfetto/ext/base/paged_memory.h"
+#include "perfetto/ext/tracing/core/commit_data_request.h"
+#include "perfetto/ext/tracing/core/shared_memory_abi.h"
+#include "src/tracing/core/shared_memory_arbiter_impl.h"
+
+namespace {
+
+using perfetto::SharedMemoryABI;
+using perfetto::SharedMemoryArbiterImpl;
+
+constexpr size_t kPageSize = 4096;
+constexpr size_t kSmbSize = 1024 * 1024;
+
+// GetNewChunk() only uses the task runner to tell whether it can commit
+// synchronously when stalling. Pretending it's never on the task runner thread
+// keeps the benchmark away from the (null) producer endpoint.
+class NullTaskRunner : public perfetto::base::TaskRunner {
+ public:
+  void PostTask(std::function<void()>) override {}
+  void PostDelayedTask(std::function<void()>, uint32_t) override {}
+  void AddFileDescriptorWatch(int, std::function<void()>) override {}
+  void RemoveFileDescriptorWatch(int) override {}
+  bool RunsTasksOnCurrentThread() const override { return false; }
+};
+
+struct Env {
+  Env()
+      : mem(perfetto::base::PagedMemory::Allocate(kSmbSize)),
+        arbiter(mem.Get(), kSmbSize, kPageSize, nullptr, &task_runner) {}
+
+  perfetto::base::PagedMemory mem;
+  NullTaskRunner task_runner;
+  SharedMemoryArbiterImpl arbiter;
+};
+
+// Each thread acquires a chunk, marks it as complete and then plays the role
+// of the service by reading it back and freeing it. This measures how well
+// chunk acquisition scales with the number of writer threads contending on
+// the same SMB.
+static void BM_SharedMemoryArbiter_GetNewChunk(benchmark::State& state) {
+  static Env* env = new Env();
+  SharedMemoryABI* abi = env->arbiter.shmem_abi_for_testing();
+
+  SharedMemoryABI::ChunkHeader header{};
+  header.writer_id.store(static_cast<uint16_t>(state.thread_index + 1),
+                         std::memory_order_relaxed);
+
+  for (auto _ : state) {
+    SharedMemoryABI::Chunk chunk = env->arbiter.GetNewChunk(
+        header, perfetto::BufferExhaustedPolicy::kDrop);
+    if (!chunk.is_valid())
+      continue;
+    uint8_t chunk_idx = chunk.chunk_idx();
+    size_t page_idx = abi->ReleaseChunkAsComplete(std::move(chunk));
+    chunk = abi->TryAcquireChunkForReading(page_idx, chunk_idx);
+    abi->ReleaseChunkAsFree(std::move(chunk));
+  }
+}
+
+}  // namespace
+
+BENCHMARK(BM_SharedMemoryArbiter_GetNewChunk)->ThreadRange(1, 64);
@@ -17,6 +17,9 @@
 #include "src/tracing/core/shared_memory_arbiter_impl.h"
 
 #include <bitset>
+#include <set>
+#include <thread>
+
 #include "perfetto/ext/base/utils.h"
 #include "perfetto/ext/tracing/core/basic_types.h"
 #include "perfetto/ext/tracing/core/commit_data_request.h"
@@ -238,7 +241,39 @@ TEST_P(SharedMemoryArbiterImplTest, BufferExhaustedPolicyDrop) {
   ASSERT_TRUE(chunks[0].is_valid());
 }
 
-// TODO(primiano): add multi-threaded tests.
+// Several threads acquire chunks concurrently until the SMB is exhausted. Each
+// chunk must be handed out exactly once.
+TEST_P(SharedMemoryArbiterImplTest, ConcurrentGetNewChunk) {
+  SharedMemoryArbiterImpl::set_default_layout_for_testing(
+      SharedMemoryABI::PageLayout::kPageDiv14);
+  static constexpr size_t kNumThreads = 8;
+  static constexpr size_t kTotChunks = kNumPages * 14;
+
+  std::vector<std::vector<uint8_t*>> chunks_per_thread(kNumThreads);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kNumThreads; t++) {
+    std::vector<uint8_t*>* chunks = &chunks_per_thread[t];
+    SharedMemoryArbiterImpl* arbiter = arbiter_.get();
+    threads.emplace_back([chunks, arbiter] {
+      for (;;) {
+        SharedMemoryABI::Chunk chunk =
+            arbiter->GetNewChunk({}, BufferExhaustedPolicy::kDrop);
+        if (!chunk.is_valid())
+          break;
+        chunks->push_back(chunk.begin());
+      }
+    });
+  }
+  for (std::thread& thread : threads)
+    thread.join();
+
+  std::set<uint8_t*> all_chunks;
+  for (const std::vector<uint8_t*>& chunks : chunks_per_thread) {
+    for (uint8_t* chunk : chunks)
+      ASSERT_TRUE(all_chunks.insert(chunk).second);
+  }
+  ASSERT_EQ(all_chunks.size(), kTotChunks);
+}
 
 }  // namespace
 }  // namespace perfetto
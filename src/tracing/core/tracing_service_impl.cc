@@ -75,6 +75,7 @@ namespace {
 constexpr int kMaxBuffersPerConsumer = 128;
 constexpr base::TimeMillis kSnapshotsInterval(10 * 1000);
 constexpr int kDefaultWriteIntoFilePeriodMs = 5000;
+constexpr uint32_t kMaxPendingFileWrites = 8;
 constexpr int kMaxConcurrentTracingSessions = 15;
 constexpr int64_t kMinSecondsBetweenTracesGuardrail = 5 * 60;
 
@@ -1105,7 +1106,18 @@ void TracingServiceImpl::DisableTracingNotifyConsumerAndFlushFile(
 
   if (tracing_session->write_into_file) {
     tracing_session->write_period_ms = 0;
-    ReadBuffers(tracing_session->id, nullptr);
+    if (ReadBuffers(tracing_session->id, nullptr) && file_writer_task_runner_) {
+      // The final drain continues in further tasks if needed and the file is
+      // closed on the file writer thread. The consumer is notified by
+      // OnWriteIntoFileClosed(), once the file is complete.
+      tracing_session->notify_disabled_on_file_close = true;
+      return;
+    }
+  } else if (tracing_session->closing_write_into_file) {
+    // The file was closed earlier (e.g. because it reached
+    // |max_file_size_bytes|) but the file writer thread is still writing it.
+    tracing_session->notify_disabled_on_file_close = true;
+    return;
   }
 
   if (tracing_session->consumer_maybe_null)
@@ -1488,6 +1500,24 @@ bool TracingServiceImpl::ReadBuffers(TracingSessionID tsid,
     return false;
   }
 
+  // When the file writer thread is enabled, don't read more data out of the
+  // buffers while the writer is lagging behind: this bounds the memory used by
+  // the copies of the data waiting to be written. This doesn't apply to the
+  // final drain, which must write all the remaining data.
+  if (file_writer_task_runner_ && tracing_session->write_into_file &&
+      tracing_session->write_period_ms > 0 &&
+      tracing_session->pending_file_writes >= kMaxPendingFileWrites) {
+    PERFETTO_DLOG("File writer lagging behind, skipping write period");
+    auto weak_this = weak_ptr_factory_.GetWeakPtr();
+    task_runner_->PostDelayedTask(
+        [weak_this, tsid] {
+          if (weak_this)
+            weak_this->ReadBuffers(tsid, nullptr);
+        },
+        tracing_session->delay_to_next_write_period_ms());
+    return true;
+  }
+
   std::vector<TracePacket> packets;
   packets.reserve(1024);  // Just an educated guess to avoid trivial expansions.
 
@@ -1543,6 +1573,20 @@ bool TracingServiceImpl::ReadBuffers(TracingSessionID tsid,
   // buffers are full and hang the service for a bit (until the consumer
   // catches up).
   static constexpr size_t kApproxBytesPerTask = 32768;
+
+  // When writing into a file, the buffers are normally drained in one task to
+  // minimize the number of write syscalls. With the file writer thread, the
+  // writes don't block the service thread and drains (including the final one)
+  // are split into tasks of this size, so that producer requests (e.g.
+  // CommitData) are served in between and each write only holds a bounded copy
+  // of the data.
+  static constexpr size_t kApproxBytesPerFileWriterTask = 1024 * 1024;
+  size_t bytes_per_task = kApproxBytesPerTask;
+  if (tracing_session->write_into_file) {
+    bytes_per_task = file_writer_task_runner_
+                         ? kApproxBytesPerFileWriterTask
+                         : std::numeric_limits<size_t>::max();
+  }
   bool did_hit_threshold = false;
 
   // TODO(primiano): Extend the ReadBuffers API to allow reading only some
@@ -1600,8 +1644,7 @@ bool TracingServiceImpl::ReadBuffers(TracingSessionID tsid,
       // Append the packet (inclusive of the trusted uid) to |packets|.
       packets_bytes += packet.size();
       total_slices += packet.slices().size();
-      did_hit_threshold = packets_bytes >= kApproxBytesPerTask &&
-                          !tracing_session->write_into_file;
+      did_hit_threshold = packets_bytes >= bytes_per_task;
       packets.emplace_back(std::move(packet));
     }  // for(packets...)
   }    // for(buffers...)
@@ -1623,6 +1666,14 @@ bool TracingServiceImpl::ReadBuffers(TracingSessionID tsid,
   // |write_into_file| == true in the trace config, drain the packets read
   // (if any) into the given file descriptor.
   if (tracing_session->write_into_file) {
+    if (compressor_fn_ && tracing_session->config.compression_type() ==
+                              TraceConfig::COMPRESSION_TYPE_DEFLATE) {
+      compressor_fn_(&packets);
+      total_slices = 0;
+      for (const TracePacket& packet : packets)
+        total_slices += packet.slices().size();
+    }
+
     const uint64_t max_size = tracing_session->max_file_size_bytes
                                   ? tracing_session->max_file_size_bytes
                                   : std::numeric_limits<size_t>::max();
@@ -1633,7 +1684,8 @@ bool TracingServiceImpl::ReadBuffers(TracingSessionID tsid,
     const size_t max_iovecs = total_slices + packets.size();
 
     size_t num_iovecs = 0;
-    bool stop_writing_into_file = tracing_session->write_period_ms == 0;
+    bool stop_writing_into_file =
+        tracing_session->write_period_ms == 0 && !has_more;
     std::unique_ptr<struct iovec[]> iovecs(new struct iovec[max_iovecs]);
     size_t num_iovecs_at_last_packet = 0;
     uint64_t bytes_about_to_be_written = 0;
@@ -1666,17 +1718,35 @@ bool TracingServiceImpl::ReadBuffers(TracingSessionID tsid,
 
     uint64_t total_wr_size = 0;
 
-    // writev() can take at most IOV_MAX entries per call. Batch them.
-    constexpr size_t kIOVMax = IOV_MAX;
-    for (size_t i = 0; i < num_iovecs; i += kIOVMax) {
-      int iov_batch_size = static_cast<int>(std::min(num_iovecs - i, kIOVMax));
-      ssize_t wr_size = PERFETTO_EINTR(writev(fd, &iovecs[i], iov_batch_size));
-      if (wr_size <= 0) {
-        PERFETTO_PLOG("writev() failed");
-        stop_writing_into_file = true;
-        break;
+    if (file_writer_task_runner_) {
+      // The iovecs point into the trace buffers, which can be overwritten by
+      // CopyChunkUntrusted() as soon as this task returns. Copy the data so
+      // that the file writer thread never touches the buffers.
+      for (size_t i = 0; i < num_iovecs; i++)
+        total_wr_size += iovecs[i].iov_len;
+      std::shared_ptr<std::string> data(new std::string());
+      data->reserve(static_cast<size_t>(total_wr_size));
+      for (size_t i = 0; i < num_iovecs; i++) {
+        data->append(static_cast<const char*>(iovecs[i].iov_base),
+                     iovecs[i].iov_len);
+      }
+      if (!data->empty())
+        PostFileWrite(tracing_session, std::move(data));
+    } else {
+      // writev() can take at most IOV_MAX entries per call. Batch them.
+      constexpr size_t kIOVMax = IOV_MAX;
+      for (size_t i = 0; i < num_iovecs; i += kIOVMax) {
+        int iov_batch_size =
+            static_cast<int>(std::min(num_iovecs - i, kIOVMax));
+        ssize_t wr_size =
+            PERFETTO_EINTR(writev(fd, &iovecs[i], iov_batch_size));
+        if (wr_size <= 0) {
+          PERFETTO_PLOG("writev() failed");
+          stop_writing_into_file = true;
+          break;
+        }
+        total_wr_size += static_cast<size_t>(wr_size);
       }
-      total_wr_size += static_cast<size_t>(wr_size);
     }
 
     tracing_session->bytes_written_into_file += total_wr_size;
@@ -1684,22 +1754,26 @@ bool TracingServiceImpl::ReadBuffers(TracingSessionID tsid,
     PERFETTO_DLOG("Draining into file, written: %" PRIu64 " KB, stop: %d",
                   (total_wr_size + 1023) / 1024, stop_writing_into_file);
     if (stop_writing_into_file) {
-      // Ensure all data was written to the file before we close it.
-      base::FlushFile(fd);
-      tracing_session->write_into_file.reset();
+      CloseWriteIntoFile(tracing_session);
       tracing_session->write_period_ms = 0;
       if (tracing_session->state == TracingSession::STARTED)
         DisableTracing(tsid);
       return true;
     }
 
+    // If the drain was split, continue it straight away rather than waiting
+    // for the next write period (or, for the final drain, the next call).
     auto weak_this = weak_ptr_factory_.GetWeakPtr();
-    task_runner_->PostDelayedTask(
-        [weak_this, tsid] {
-          if (weak_this)
-            weak_this->ReadBuffers(tsid, nullptr);
-        },
-        tracing_session->delay_to_next_write_period_ms());
+    auto read_task = [weak_this, tsid] {
+      if (weak_this)
+        weak_this->ReadBuffers(tsid, nullptr);
+    };
+    if (has_more) {
+      task_runner_->PostTask(read_task);
+    } else {
+      task_runner_->PostDelayedTask(
+          read_task, tracing_session->delay_to_next_write_period_ms());
+    }
     return true;
   }  // if (tracing_session->write_into_file)
 
@@ -1728,6 +1802,31 @@ void TracingServiceImpl::FreeBuffers(TracingSessionID tsid) {
   }
   DisableTracing(tsid, /*disable_immediately=*/true);
 
+  if (file_writer_task_runner_ && tracing_session->write_into_file) {
+    // The final drain into the file can still be in progress. Complete it
+    // before the buffers are freed: each call reads the next slice of the
+    // buffers and the last one closes the file.
+    PERFETTO_DCHECK(tracing_session->write_period_ms == 0);
+    while (tracing_session->write_into_file && ReadBuffers(tsid, nullptr)) {
+    }
+    if (tracing_session->write_into_file)
+      CloseWriteIntoFile(tracing_session);
+  }
+  // The session is destroyed below, before OnWriteIntoFileClosed() runs. As
+  // tasks are executed in order on the file writer thread, a task posted now
+  // runs after the file is closed: notify the consumer from there.
+  if (tracing_session->notify_disabled_on_file_close &&
+      tracing_session->consumer_maybe_null) {
+    auto weak_consumer = tracing_session->consumer_maybe_null->GetWeakPtr();
+    base::TaskRunner* task_runner = task_runner_;
+    file_writer_task_runner_->PostTask([task_runner, weak_consumer] {
+      task_runner->PostTask([weak_consumer] {
+        if (weak_consumer)
+          weak_consumer->NotifyOnTracingDisabled();
+      });
+    });
+  }
+
   PERFETTO_DCHECK(tracing_session->AllDataSourceInstancesStopped());
   tracing_session->data_source_instances.clear();
 
@@ -1741,6 +1840,7 @@ void TracingServiceImpl::FreeBuffers(TracingSessionID tsid) {
     PERFETTO_DCHECK(buffers_.count(buffer_id) == 1);
     buffers_.erase(buffer_id);
   }
+
   bool notify_traceur = tracing_session->config.notify_traceur();
   tracing_sessions_.erase(tsid);
   UpdateMemoryGuardrail();
@@ -1757,6 +1857,112 @@ void TracingServiceImpl::FreeBuffers(TracingSessionID tsid) {
 #endif
 }
 
+void TracingServiceImpl::PostFileWrite(TracingSession* tracing_session,
+                                       std::shared_ptr<std::string> data) {
+  PERFETTO_DCHECK_THREAD(thread_checker_);
+  PERFETTO_DCHECK(file_writer_task_runner_);
+  PERFETTO_DCHECK(tracing_session->write_into_file);
+  tracing_session->pending_file_writes++;
+
+  // The file descriptor stays valid until CloseWriteIntoFile(), which closes it
+  // on the file writer thread after all the writes posted here.
+  int fd = *tracing_session->write_into_file;
+  TracingSessionID tsid = tracing_session->id;
+  base::TaskRunner* task_runner = task_runner_;
+  auto weak_this = weak_ptr_factory_.GetWeakPtr();
+  file_writer_task_runner_->PostTask(
+      [fd, data, tsid, task_runner, weak_this] {
+        ssize_t wr_size = base::WriteAll(fd, data->data(), data->size());
+        bool success = wr_size == static_cast<ssize_t>(data->size());
+        if (!success)
+          PERFETTO_PLOG("write() failed");
+        task_runner->PostTask([weak_this, tsid, success] {
+          if (weak_this)
+            weak_this->OnFileWriteDone(tsid, success);
+        });
+      });
+}
+
+void TracingServiceImpl::OnFileWriteDone(TracingSessionID tsid, bool success) {
+  PERFETTO_DCHECK_THREAD(thread_checker_);
+  TracingSession* tracing_session = GetTracingSession(tsid);
+  if (!tracing_session)
+    return;
+  PERFETTO_DCHECK(tracing_session->pending_file_writes > 0);
+  tracing_session->pending_file_writes--;
+  if (success || !tracing_session->write_into_file)
+    return;
+
+  // Stop writing into the file on errors, as ReadBuffers() does when writing on
+  // the service thread.
+  CloseWriteIntoFile(tracing_session);
+  tracing_session->write_period_ms = 0;
+  if (tracing_session->state == TracingSession::STARTED)
+    DisableTracing(tsid);
+}
+
+void TracingServiceImpl::CloseWriteIntoFile(TracingSession* tracing_session) {
+  PERFETTO_DCHECK_THREAD(thread_checker_);
+  PERFETTO_DCHECK(tracing_session->write_into_file);
+  if (!file_writer_task_runner_) {
+    // Ensure all data was written to the file before we close it.
+    base::FlushFile(*tracing_session->write_into_file);
+    tracing_session->write_into_file.reset();
+    return;
+  }
+
+  // Tasks are executed in order on the file writer thread so the file is closed
+  // after all the pending writes. OnWriteIntoFileClosed() is called back on the
+  // service thread once this is done.
+  tracing_session->closing_write_into_file = true;
+  std::shared_ptr<base::ScopedFile> file(
+      new base::ScopedFile(std::move(tracing_session->write_into_file)));
+  TracingSessionID tsid = tracing_session->id;
+  base::TaskRunner* task_runner = task_runner_;
+  auto weak_this = weak_ptr_factory_.GetWeakPtr();
+  file_writer_task_runner_->PostTask([file, tsid, task_runner, weak_this] {
+    base::FlushFile(**file);
+    file->reset();
+    task_runner->PostTask([weak_this, tsid] {
+      if (weak_this)
+        weak_this->OnWriteIntoFileClosed(tsid);
+    });
+  });
+}
+
+void TracingServiceImpl::OnWriteIntoFileClosed(TracingSessionID tsid) {
+  PERFETTO_DCHECK_THREAD(thread_checker_);
+  TracingSession* tracing_session = GetTracingSession(tsid);
+  if (!tracing_session)
+    return;
+  tracing_session->closing_write_into_file = false;
+  if (!tracing_session->notify_disabled_on_file_close)
+    return;
+  tracing_session->notify_disabled_on_file_close = false;
+  if (tracing_session->consumer_maybe_null)
+    tracing_session->consumer_maybe_null->NotifyOnTracingDisabled();
+}
+
+void TracingServiceImpl::SetFileWriterThreadEnabled(bool enabled) {
+  PERFETTO_DCHECK_THREAD(thread_checker_);
+  if (!tracing_sessions_.empty()) {
+    PERFETTO_ELOG("Cannot toggle the file writer thread while tracing");
+    return;
+  }
+#if PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
+  base::ignore_result(enabled);
+#else
+  if (enabled && !file_writer_thread_) {
+    file_writer_thread_.reset(
+        new base::ThreadTaskRunner(base::ThreadTaskRunner::CreateAndStart()));
+  } else if (!enabled) {
+    file_writer_thread_.reset();
+  }
+  file_writer_task_runner_ =
+      file_writer_thread_ ? file_writer_thread_->get() : nullptr;
+#endif
+}
+
 void TracingServiceImpl::RegisterDataSource(ProducerID producer_id,
                                             const DataSourceDescriptor& desc) {
   PERFETTO_DCHECK_THREAD(thread_checker_);
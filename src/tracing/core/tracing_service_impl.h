@@ -22,8 +22,10 @@
 #include <memory>
 #include <mutex>
 #include <set>
+#include <string>
 #include <vector>
 
+#include "perfetto/base/build_config.h"
 #include "perfetto/base/logging.h"
 #include "perfetto/base/time.h"
 #include "perfetto/ext/base/optional.h"
@@ -39,6 +41,11 @@
 #include "perfetto/tracing/core/forward_decls.h"
 #include "perfetto/tracing/core/trace_config.h"
 #include "src/tracing/core/id_allocator.h"
+
+#if !PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
+#include "perfetto/ext/base/thread_task_runner.h"
+#endif
+
 namespace perfetto {
 
 namespace base {
@@ -283,6 +290,12 @@ class TracingServiceImpl : public TracingService {
     smb_scraping_enabled_ = enabled;
   }
 
+  void SetFileWriterThreadEnabled(bool enabled) override;
+
+  void SetCompressorFn(CompressorFn compressor_fn) override {
+    compressor_fn_ = compressor_fn;
+  }
+
   // Exposed mainly for testing.
   size_t num_producers() const { return producers_.size(); }
   ProducerEndpointImpl* GetProducer(ProducerID) const;
@@ -491,6 +504,19 @@ class TracingServiceImpl : public TracingService {
     uint32_t write_period_ms = 0;
     uint64_t max_file_size_bytes = 0;
     uint64_t bytes_written_into_file = 0;
+
+    // Number of writes into |write_into_file| posted to the file writer thread
+    // and not acknowledged yet. Only used when the file writer thread is
+    // enabled.
+    uint32_t pending_file_writes = 0;
+
+    // True while the file writer thread closes |write_into_file|, after the
+    // pending writes.
+    bool closing_write_into_file = false;
+
+    // Set when tracing is disabled while the file writer thread is still
+    // writing the file: the consumer is notified once the file is closed.
+    bool notify_disabled_on_file_close = false;
   };
 
   TracingServiceImpl(const TracingServiceImpl&) = delete;
@@ -543,6 +569,18 @@ class TracingServiceImpl : public TracingService {
   TraceBuffer* GetBufferByID(BufferID);
   void OnStartTriggersTimeout(TracingSessionID tsid);
 
+  // Posts a write of |data| into the |write_into_file| file of the session to
+  // the file writer thread. OnFileWriteDone() is called back on the service
+  // thread once the write has completed.
+  void PostFileWrite(TracingSession*, std::shared_ptr<std::string> data);
+  void OnFileWriteDone(TracingSessionID, bool success);
+
+  // Flushes and closes the |write_into_file| file of the session. When the file
+  // writer thread is enabled, the file is closed there after all the pending
+  // writes and OnWriteIntoFileClosed() is called back on the service thread.
+  void CloseWriteIntoFile(TracingSession*);
+  void OnWriteIntoFileClosed(TracingSessionID);
+
   base::TaskRunner* const task_runner_;
   std::unique_ptr<SharedMemory::Factory> shm_factory_;
   ProducerID last_producer_id_ = 0;
@@ -563,6 +601,7 @@ class TracingServiceImpl : public TracingService {
   std::map<std::string, int64_t> session_to_last_trace_s_;
 
   bool smb_scraping_enabled_ = false;
+  CompressorFn compressor_fn_ = nullptr;
   bool lockdown_mode_ = false;
   uint32_t min_write_period_ms_ = 100;  // Overridable for testing.
 
@@ -575,6 +614,15 @@ class TracingServiceImpl : public TracingService {
 
   PERFETTO_THREAD_CHECKER(thread_checker_)
 
+  // Thread performing the writes into the |write_into_file| files, see
+  // SetFileWriterThreadEnabled(). This must be destroyed (i.e. the thread must
+  // be joined) before |tracing_sessions_| as pending writes refer to the file
+  // descriptors owned by the sessions.
+#if !PERFETTO_BUILDFLAG(PERFETTO_OS_WIN)
+  std::unique_ptr<base::ThreadTaskRunner> file_writer_thread_;
+#endif
+  base::TaskRunner* file_writer_task_runner_ = nullptr;
+
   base::WeakPtrFactory<TracingServiceImpl>
       weak_ptr_factory_;  // Keep at the end.
 };
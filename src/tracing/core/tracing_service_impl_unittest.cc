@@ -1433,6 +1433,202 @@ TEST_F(TracingServiceImplTest, WriteIntoFileAndStopOnMaxSize) {
   }
 }
 
+// Like the test above, but the writes happen on the file writer thread and the
+// data exceeds the size of a single drain task. With a long write period, all
+// the data is written by the final drain.
+TEST_F(TracingServiceImplTest, WriteIntoFileWithFileWriterThread) {
+  svc->SetFileWriterThreadEnabled(true);
+
+  for (uint32_t write_period_ms : {1u, 3600u * 1000u}) {
+    std::unique_ptr<MockConsumer> consumer = CreateMockConsumer();
+    consumer->Connect(svc.get());
+
+    // Use a large SMB so that the producer never has to wait for the service.
+    std::unique_ptr<MockProducer> producer = CreateMockProducer();
+    producer->Connect(svc.get(), "mock_producer", /*uid=*/42,
+                      /*shared_memory_size_hint_bytes=*/4 * 1024 * 1024);
+    producer->RegisterDataSource("data_source");
+
+    TraceConfig trace_config;
+    trace_config.add_buffers()->set_size_kb(4096);
+    auto* ds_config = trace_config.add_data_sources()->mutable_config();
+    ds_config->set_name("data_source");
+    ds_config->set_target_buffer(0);
+    trace_config.set_write_into_file(true);
+    trace_config.set_file_write_period_ms(write_period_ms);
+    base::TempFile tmp_file = base::TempFile::Create();
+    consumer->EnableTracing(trace_config,
+                            base::ScopedFile(dup(tmp_file.fd())));
+
+    producer->WaitForTracingSetup();
+    producer->WaitForDataSourceSetup("data_source");
+    producer->WaitForDataSourceStart("data_source");
+
+    static const int kNumTestPackets = 2048;
+    std::unique_ptr<TraceWriter> writer =
+        producer->CreateTraceWriter("data_source");
+    for (int i = 0; i < kNumTestPackets; i++) {
+      auto tp = writer->NewTracePacket();
+      std::string payload(1024, 'x');
+      payload.append(std::to_string(i));
+      tp->set_for_testing()->set_str(payload.c_str(), payload.size());
+    }
+    writer->Flush();
+    writer.reset();
+
+    consumer->DisableTracing();
+    producer->WaitForDataSourceStop("data_source");
+    consumer->WaitForTracingDisabled();
+
+    // The file must be complete by the time the consumer is notified.
+    std::string trace_raw;
+    ASSERT_TRUE(base::ReadFile(tmp_file.path().c_str(), &trace_raw));
+    protos::gen::Trace trace;
+    ASSERT_TRUE(trace.ParseFromString(trace_raw));
+
+    int num_test_packets = 0;
+    for (const protos::gen::TracePacket& tp : trace.packet()) {
+      if (!tp.has_for_testing())
+        continue;
+      ASSERT_EQ(std::string(1024, 'x') + std::to_string(num_test_packets++),
+                tp.for_testing().str());
+    }
+    ASSERT_EQ(num_test_packets, kNumTestPackets);
+  }
+}
+
+// Frees the buffers while the final drain of the file writer thread is still
+// in progress: the consumer must only be notified once the file is complete.
+TEST_F(TracingServiceImplTest, WriteIntoFileFreeBuffersDuringFinalDrain) {
+  svc->SetFileWriterThreadEnabled(true);
+
+  std::unique_ptr<MockConsumer> consumer = CreateMockConsumer();
+  consumer->Connect(svc.get());
+
+  std::unique_ptr<MockProducer> producer = CreateMockProducer();
+  producer->Connect(svc.get(), "mock_producer", /*uid=*/42,
+                    /*shared_memory_size_hint_bytes=*/4 * 1024 * 1024);
+  producer->RegisterDataSource("data_source");
+
+  TraceConfig trace_config;
+  trace_config.add_buffers()->set_size_kb(4096);
+  auto* ds_config = trace_config.add_data_sources()->mutable_config();
+  ds_config->set_name("data_source");
+  ds_config->set_target_buffer(0);
+  trace_config.set_write_into_file(true);
+  trace_config.set_file_write_period_ms(100000);  // 100s
+  base::TempFile tmp_file = base::TempFile::Create();
+  consumer->EnableTracing(trace_config, base::ScopedFile(dup(tmp_file.fd())));
+
+  producer->WaitForTracingSetup();
+  producer->WaitForDataSourceSetup("data_source");
+  producer->WaitForDataSourceStart("data_source");
+
+  static const int kNumTestPackets = 2048;
+  std::unique_ptr<TraceWriter> writer =
+      producer->CreateTraceWriter("data_source");
+  for (int i = 0; i < kNumTestPackets; i++) {
+    auto tp = writer->NewTracePacket();
+    std::string payload(1024, 'x');
+    payload.append(std::to_string(i));
+    tp->set_for_testing()->set_str(payload.c_str(), payload.size());
+  }
+  writer->Flush();
+  writer.reset();
+
+  // Don't wait for the data source to stop: FreeBuffers() disables tracing
+  // immediately and has to complete the (split) final drain itself.
+  consumer->DisableTracing();
+  consumer->FreeBuffers();
+  producer->WaitForDataSourceStop("data_source");
+  consumer->WaitForTracingDisabled();
+
+  std::string trace_raw;
+  ASSERT_TRUE(base::ReadFile(tmp_file.path().c_str(), &trace_raw));
+  protos::gen::Trace trace;
+  ASSERT_TRUE(trace.ParseFromString(trace_raw));
+
+  int num_test_packets = 0;
+  for (const protos::gen::TracePacket& tp : trace.packet()) {
+    if (!tp.has_for_testing())
+      continue;
+    ASSERT_EQ(std::string(1024, 'x') + std::to_string(num_test_packets++),
+              tp.for_testing().str());
+  }
+  ASSERT_EQ(num_test_packets, kNumTestPackets);
+}
+
+namespace {
+
+size_t g_num_compressed_packets = 0;
+
+// Doesn't actually compress, only counts the packets passed to it.
+void FakeCompressFn(std::vector<TracePacket>* packets) {
+  g_num_compressed_packets += packets->size();
+}
+
+}  // namespace
+
+// Also runs with the file writer thread, where the final drain is split into
+// several batches (each compressed separately) and the file is closed
+// asynchronously.
+TEST_F(TracingServiceImplTest, WriteIntoFileWithCompression) {
+  svc->SetCompressorFn(FakeCompressFn);
+
+  for (bool file_writer_thread : {false, true}) {
+    g_num_compressed_packets = 0;
+    svc->SetFileWriterThreadEnabled(file_writer_thread);
+
+    std::unique_ptr<MockConsumer> consumer = CreateMockConsumer();
+    consumer->Connect(svc.get());
+
+    std::unique_ptr<MockProducer> producer = CreateMockProducer();
+    producer->Connect(svc.get(), "mock_producer", /*uid=*/42,
+                      /*shared_memory_size_hint_bytes=*/4 * 1024 * 1024);
+    producer->RegisterDataSource("data_source");
+
+    TraceConfig trace_config;
+    trace_config.add_buffers()->set_size_kb(4096);
+    auto* ds_config = trace_config.add_data_sources()->mutable_config();
+    ds_config->set_name("data_source");
+    ds_config->set_target_buffer(0);
+    trace_config.set_write_into_file(true);
+    trace_config.set_file_write_period_ms(100000);  // 100s
+    trace_config.set_compression_type(TraceConfig::COMPRESSION_TYPE_DEFLATE);
+    base::TempFile tmp_file = base::TempFile::Create();
+    consumer->EnableTracing(trace_config,
+                            base::ScopedFile(dup(tmp_file.fd())));
+
+    producer->WaitForTracingSetup();
+    producer->WaitForDataSourceSetup("data_source");
+    producer->WaitForDataSourceStart("data_source");
+
+    // Enough data for more than one drain task with the file writer thread.
+    static const int kNumTestPackets = 2048;
+    std::unique_ptr<TraceWriter> writer =
+        producer->CreateTraceWriter("data_source");
+    for (int i = 0; i < kNumTestPackets; i++) {
+      auto tp = writer->NewTracePacket();
+      tp->set_for_testing()->set_str(std::string(1024, 'x'));
+    }
+    writer->Flush();
+    writer.reset();
+
+    consumer->DisableTracing();
+    producer->WaitForDataSourceStop("data_source");
+    consumer->WaitForTracingDisabled();
+
+    // All the packets written into the file went through the compressor.
+    std::string trace_raw;
+    ASSERT_TRUE(base::ReadFile(tmp_file.path().c_str(), &trace_raw));
+    protos::gen::Trace trace;
+    ASSERT_TRUE(trace.ParseFromString(trace_raw));
+    ASSERT_GT(trace.packet_size(), kNumTestPackets);
+    ASSERT_EQ(g_num_compressed_packets,
+              static_cast<size_t>(trace.packet_size()));
+  }
+}
+
 // Test the logic that allows the trace config to set the shm total size and
 // page size from the trace config. Also check that, if the config doesn't
 // specify a value we fall back on the hint provided by the producer.
@@ -37,6 +37,7 @@
 #include "perfetto/tracing/trace_writer_base.h"
 #include "perfetto/tracing/tracing.h"
 #include "perfetto/tracing/tracing_backend.h"
+#include "src/tracing/core/coalescing_trace_writer.h"
 #include "src/tracing/internal/in_process_tracing_backend.h"
 #include "src/tracing/internal/system_tracing_backend.h"
 
@@ -464,16 +465,11 @@ bool TracingMuxerImpl::RegisterDataSource(
     DataSourceFactory factory,
     DataSourceStaticState* static_state) {
   // Ignore repeated registrations.
-  if (static_state->index != kMaxDataSources)
+  if (static_state->index != kInvalidDataSourceIndex)
     return true;
 
   static std::atomic<uint32_t> last_id{};
   uint32_t new_index = last_id++;
-  if (new_index >= kMaxDataSources) {
-    PERFETTO_DLOG(
-        "RegisterDataSource failed: too many data sources already registered");
-    return false;
-  }
 
   // Initialize the static state.
   static_assert(sizeof(static_state->instances[0]) >= sizeof(DataSourceState),
@@ -555,7 +551,8 @@ void TracingMuxerImpl::SetupDataSource(TracingBackendId backend_id,
 
       // This must be made at the end. See matching acquire-load in
       // DataSource::Trace().
-      static_state.valid_instances.fetch_or(1 << i, std::memory_order_release);
+      static_state.valid_instances.fetch_or(1u << i,
+                                            std::memory_order_release);
 
       DataSourceBase::SetupArgs setup_args;
       setup_args.config = &cfg;
@@ -645,7 +642,7 @@ void TracingMuxerImpl::StopDataSource_AsyncEnd(
     return;
   }
 
-  const uint32_t mask = ~(1 << ds.instance_idx);
+  const uint32_t mask = ~(1u << ds.instance_idx);
   ds.static_state->valid_instances.fetch_and(mask, std::memory_order_acq_rel);
 
   // Take the mutex to prevent that the data source is in the middle of
@@ -697,10 +694,10 @@ void TracingMuxerImpl::DestroyStoppedTraceWritersForCurrentThread() {
     }
   };
 
-  for (size_t ds_idx = 0; ds_idx < kMaxDataSources; ds_idx++) {
+  for (auto& tls : root_tls->data_sources_tls) {
     // |tls| has a vector of per-data-source-instance thread-local state.
-    DataSourceThreadLocalState& tls = root_tls->data_sources_tls[ds_idx];
-    destroy_stopped_instances(tls);
+    if (tls)
+      destroy_stopped_instances(*tls);
   }
   destroy_stopped_instances(root_tls->track_event_tls);
   root_tls->generation = cur_generation;
@@ -717,15 +714,18 @@ void TracingMuxerImpl::UpdateDataSourcesOnAllBackends() {
       if (!backend.producer->connected_)
         continue;
 
-      PERFETTO_DCHECK(rds.static_state->index < kMaxDataSourceInstances);
-      if (backend.producer->registered_data_sources_.test(
-              rds.static_state->index))
+      uint32_t index = rds.static_state->index;
+      PERFETTO_DCHECK(index != kInvalidDataSourceIndex);
+      auto& registered = backend.producer->registered_data_sources_;
+      if (index < registered.size() && registered[index])
         continue;
 
       rds.descriptor.set_will_notify_on_start(true);
       rds.descriptor.set_will_notify_on_stop(true);
       backend.producer->service_->RegisterDataSource(rds.descriptor);
-      backend.producer->registered_data_sources_.set(rds.static_state->index);
+      if (index >= registered.size())
+        registered.resize(index + 1);
+      registered[index] = true;
     }
   }
 }
@@ -899,10 +899,16 @@ TracingMuxerImpl::FindDataSourceRes TracingMuxerImpl::FindDataSource(
 // Can be called from any thread.
 std::unique_ptr<TraceWriterBase> TracingMuxerImpl::CreateTraceWriter(
     DataSourceState* data_source,
-    BufferExhaustedPolicy buffer_exhausted_policy) {
+    BufferExhaustedPolicy buffer_exhausted_policy,
+    uint32_t max_coalesced_packets) {
   ProducerImpl* producer = backends_[data_source->backend_id].producer.get();
-  return producer->service_->CreateTraceWriter(data_source->buffer_id,
-                                               buffer_exhausted_policy);
+  std::unique_ptr<TraceWriter> writer = producer->service_->CreateTraceWriter(
+      data_source->buffer_id, buffer_exhausted_policy);
+  if (max_coalesced_packets) {
+    writer.reset(
+        new CoalescingTraceWriter(std::move(writer), max_coalesced_packets));
+  }
+  return std::move(writer);
 }
 
 // This is called via the public API Tracing::NewTrace().
@@ -22,7 +22,6 @@
 
 #include <array>
 #include <atomic>
-#include <bitset>
 #include <map>
 #include <memory>
 #include <vector>
@@ -100,7 +99,8 @@ class TracingMuxerImpl : public TracingMuxer {
                           DataSourceStaticState*) override;
   std::unique_ptr<TraceWriterBase> CreateTraceWriter(
       DataSourceState*,
-      BufferExhaustedPolicy buffer_exhausted_policy) override;
+      BufferExhaustedPolicy buffer_exhausted_policy,
+      uint32_t max_coalesced_packets) override;
   void DestroyStoppedTraceWritersForCurrentThread() override;
 
   std::unique_ptr<TracingSession> CreateTracingSession(BackendType);
@@ -163,7 +163,8 @@ class TracingMuxerImpl : public TracingMuxer {
     // Set of data sources that have been actually registered on this producer.
     // This can be a subset of the global |data_sources_|, because data sources
     // can register before the producer is fully connected.
-    std::bitset<kMaxDataSources> registered_data_sources_{};
+    // Indexed by DataSourceStaticState::index.
+    std::vector<bool> registered_data_sources_;
 
     std::unique_ptr<ProducerEndpoint> service_;  // Keep last.
   };
@@ -39,28 +39,16 @@ BaseTrackEventInternedDataIndex::~BaseTrackEventInternedDataIndex() = default;
 namespace {
 
 std::atomic<perfetto::base::PlatformThreadID> g_main_thread;
-
-struct InternedEventCategory
-    : public TrackEventInternedDataIndex<
-          InternedEventCategory,
-          perfetto::protos::pbzero::InternedData::kEventCategoriesFieldNumber,
-          const char*,
-          SmallInternedDataTraits> {
-  static void Add(protos::pbzero::InternedData* interned_data,
-                  size_t iid,
-                  const char* value) {
-    auto category = interned_data->add_event_categories();
-    category->set_iid(iid);
-    category->set_name(value);
-  }
-};
+std::atomic<uint32_t> g_max_coalesced_events;
 
 struct InternedEventName
     : public TrackEventInternedDataIndex<
           InternedEventName,
           perfetto::protos::pbzero::InternedData::kEventNamesFieldNumber,
           const char*,
-          SmallInternedDataTraits> {
+          // Bound the memory used by processes with lots of distinct event
+          // names. 256 entries take 8KB per thread on 64-bit platforms.
+          BoundedInternedDataTraits<256>> {
   static void Add(protos::pbzero::InternedData* interned_data,
                   size_t iid,
                   const char* value) {
@@ -138,6 +126,38 @@ void WriteSequenceDescriptors(TraceWriterBase* trace_writer,
   }
 }
 
+// Returns the interning id of the |category_index|th category of |registry|,
+// writing the category into the interned data of the current packet if this is
+// the first time it is used on this sequence.
+size_t InternCategory(TrackEventIncrementalState* incr_state,
+                      const TrackEventCategoryRegistry& registry,
+                      size_t category_index) {
+  TrackEventIncrementalState::InternedCategories* categories = nullptr;
+  for (auto& entry : incr_state->interned_categories) {
+    if (entry.registry == &registry) {
+      categories = &entry;
+      break;
+    }
+  }
+  if (PERFETTO_UNLIKELY(!categories)) {
+    incr_state->interned_categories.push_back(
+        {&registry, incr_state->next_category_iid,
+         std::vector<bool>(registry.category_count())});
+    incr_state->next_category_iid += registry.category_count();
+    categories = &incr_state->interned_categories.back();
+  }
+
+  PERFETTO_DCHECK(category_index < categories->seen.size());
+  size_t iid = categories->first_iid + category_index;
+  if (PERFETTO_LIKELY(categories->seen[category_index]))
+    return iid;
+  categories->seen[category_index] = true;
+  auto category = incr_state->serialized_interned_data->add_event_categories();
+  category->set_iid(iid);
+  category->set_name(registry.GetCategory(category_index)->name);
+  return iid;
+}
+
 }  // namespace
 
 // static
@@ -176,14 +196,24 @@ void TrackEventInternal::DisableTracing(
     registry.DisableCategoryForInstance(i, instance_index);
 }
 
+// static
+void TrackEventInternal::SetMaxCoalescedEvents(uint32_t max_events) {
+  g_max_coalesced_events.store(max_events, std::memory_order_relaxed);
+}
+
+// static
+uint32_t TrackEventInternal::GetMaxCoalescedEvents() {
+  return g_max_coalesced_events.load(std::memory_order_relaxed);
+}
+
 // static
 EventContext TrackEventInternal::WriteEvent(
     TraceWriterBase* trace_writer,
     TrackEventIncrementalState* incr_state,
-    const char* category,
+    const TrackEventCategoryRegistry& registry,
+    size_t category_index,
     const char* name,
     perfetto::protos::pbzero::TrackEvent::Type type) {
-  PERFETTO_DCHECK(category);
   PERFETTO_DCHECK(g_main_thread);
   auto timestamp = GetTimeNs();
 
@@ -193,10 +223,10 @@ EventContext TrackEventInternal::WriteEvent(
   }
   auto packet = NewTracePacket(trace_writer, timestamp);
 
-  // We assume that |category| and |name| point to strings with static lifetime.
-  // This means we can use their addresses as interning keys.
+  // We assume that |name| points to a string with static lifetime. This means
+  // we can use its address as an interning key.
   EventContext ctx(std::move(packet), incr_state);
-  size_t category_iid = InternedEventCategory::Get(&ctx, category);
+  size_t category_iid = InternCategory(incr_state, registry, category_index);
 
   auto track_event = ctx.event();
   track_event->set_type(type);
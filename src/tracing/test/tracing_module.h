@@ -30,6 +30,7 @@ namespace tracing_module {
 void InitializeCategories();
 void EmitTrackEvents();
 void EmitTrackEvents2();
+void EmitTrackEventsWithCompiledOutCategories();
 perfetto::internal::TrackEventIncrementalState* GetIncrementalState();
 
 // These functions are used to check the instruction size overhead track events.
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// This file checks that categories can be compiled out in one compilation unit
+// while still being shared with other compilation units where they are
+// compiled in.
+#define PERFETTO_TRACK_EVENT_DISABLED_CATEGORIES "cat2,cat3"
+
+#include "src/tracing/test/tracing_module.h"
+
+#include "src/tracing/test/tracing_module_categories.h"
+
+namespace tracing_module {
+
+void EmitTrackEventsWithCompiledOutCategories() {
+  TRACE_EVENT_BEGIN("cat1", "EventFromModule3");
+  TRACE_EVENT_END("cat1");
+  TRACE_EVENT_BEGIN("cat2", "CompiledOutEventFromModule3");
+  TRACE_EVENT_END("cat2");
+  TRACE_EVENT("cat3", "CompiledOutScopedEventFromModule3");
+}
+
+}  // namespace tracing_module
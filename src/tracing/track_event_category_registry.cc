@@ -31,8 +31,8 @@ void TrackEventCategoryRegistry::EnableCategoryForInstance(
   PERFETTO_DCHECK(instance_index < kMaxDataSourceInstances);
   PERFETTO_DCHECK(category_index < category_count_);
   // Matches the acquire_load in DataSource::Trace().
-  state_storage_[category_index].fetch_or(
-      static_cast<uint8_t>(1u << instance_index), std::memory_order_release);
+  state_storage_[category_index].fetch_or(1u << instance_index,
+                                          std::memory_order_release);
 }
 
 void TrackEventCategoryRegistry::DisableCategoryForInstance(
@@ -41,8 +41,8 @@ void TrackEventCategoryRegistry::DisableCategoryForInstance(
   PERFETTO_DCHECK(instance_index < kMaxDataSourceInstances);
   PERFETTO_DCHECK(category_index < category_count_);
   // Matches the acquire_load in DataSource::Trace().
-  state_storage_[category_index].fetch_and(
-      static_cast<uint8_t>(~(1u << instance_index)), std::memory_order_release);
+  state_storage_[category_index].fetch_and(~(1u << instance_index),
+                                           std::memory_order_release);
 }
 
 }  // namespace internal
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include "perfetto/tracing/track_event_interned_data_index.h"
+
+namespace {
+
+// Converts the benchmark strings into the type stored in the index.
+template <typename ValueType>
+ValueType ToValue(const std::string& str);
+
+template <>
+std::string ToValue<std::string>(const std::string& str) {
+  return str;
+}
+
+template <>
+const char* ToValue<const char*>(const std::string& str) {
+  return str.c_str();
+}
+
+// Measures the cost of looking up (and, for new values, inserting) interned
+// values, which is what TrackEventInternedDataIndex::Get() pays on every trace
+// point. The argument is the number of distinct values.
+template <typename Traits, typename ValueType>
+void BM_InternedDataIndex(benchmark::State& state) {
+  std::vector<std::string> values;
+  for (int64_t i = 0; i < state.range(0); i++)
+    values.push_back("event_name_" + std::to_string(i));
+
+  // A pseudo-random access pattern over the values, which roughly models the
+  // event names seen by a thread.
+  std::vector<ValueType> pattern;
+  uint32_t seed = 42;
+  for (size_t i = 0; i < 4096; i++) {
+    seed = seed * 1103515245 + 12345;
+    pattern.push_back(ToValue<ValueType>(values[(seed >> 8) % values.size()]));
+  }
+
+  typename Traits::template Index<ValueType> index;
+  size_t misses = 0;
+  size_t pos = 0;
+  while (state.KeepRunning()) {
+    size_t iid;
+    if (!index.LookUpOrInsert(&iid, pattern[pos]))
+      misses++;
+    benchmark::DoNotOptimize(iid);
+    pos = (pos + 1) % pattern.size();
+  }
+  state.counters["miss_ratio"] =
+      static_cast<double>(misses) / static_cast<double>(state.iterations());
+}
+
+void IndexArgs(benchmark::internal::Benchmark* b) {
+  b->Arg(16)->Arg(256)->Arg(4096);
+}
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(BM_InternedDataIndex,
+                   perfetto::SmallInternedDataTraits,
+                   const char*)
+    ->Apply(IndexArgs);
+BENCHMARK_TEMPLATE(BM_InternedDataIndex,
+                   perfetto::BoundedInternedDataTraits<256>,
+                   const char*)
+    ->Apply(IndexArgs);
+BENCHMARK_TEMPLATE(BM_InternedDataIndex,
+                   perfetto::BigInternedDataTraits,
+                   std::string)
+    ->Apply(IndexArgs);
+BENCHMARK_TEMPLATE(BM_InternedDataIndex,
+                   perfetto::BoundedInternedDataTraits<256>,
+                   std::string)
+    ->Apply(IndexArgs);